@@ -32,14 +32,15 @@
 #include <sys/wait.h> /* WEXITSTATUS() waitpid() */
 #endif
 #include <signal.h> /* kill() */
-#include <unistd.h> /* select() */
+#include <unistd.h> /* read() select() */
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
 #include <stddef.h> /* NULL wchar_t */
 #include <stdint.h> /* uintptr_t */
-#include <stdlib.h> /* EXIT_FAILURE _Exit() free() malloc() */
-#include <string.h> /* memcpy() */
+#include <stdio.h> /* FILE fclose() fileno() snprintf() */
+#include <stdlib.h> /* EXIT_FAILURE _Exit() calloc() free() malloc() */
+#include <string.h> /* memchr() memcmp() memcpy() strdup() */
 
 #include "cfg/config.h"
 #include "compat/pthread.h"
@@ -52,6 +53,7 @@
 #include "utils/log.h"
 #include "utils/path.h"
 #include "utils/str.h"
+#include "utils/string_array.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
 #include "status.h"
@@ -110,6 +112,37 @@ typedef struct
 }
 background_task_args;
 
+/* Output of a command that is read in background thread or of a function
+ * that is run there. */
+struct bg_stream_t
+{
+	pid_t pid;   /* Process id of the command. */
+	FILE *out;   /* Output stream of the command. */
+	FILE *err;   /* Error stream of the command. */
+	char *descr; /* Description of the stream. */
+
+	bg_stream_func func; /* Producer of lines or NULL for a command. */
+	void *arg;           /* Argument of the producer. */
+
+	/* The lock is meant to guard fields below. */
+	pthread_mutex_t lock;
+	char **lines;      /* Lines that weren't fetched yet. */
+	int nlines;        /* Number of elements in lines. */
+	char *errors;      /* Contents of error stream, set on finishing. */
+	size_t errors_len; /* Length of errors reported by the producer. */
+	bg_op_t *bg_op;    /* Operation of the reader or NULL before start. */
+	int finished;      /* Whether reading is over. */
+	int dropped;       /* Whether owner has freed the stream. */
+
+	/* These fields are used only by reader (or producer) thread. */
+	char *partial;      /* Beginning of a line that hasn't been read whole. */
+	size_t partial_len; /* Length of the partial field. */
+	int sep_known;      /* Whether separator of lines has been picked. */
+	int null_sep;       /* Whether null character separates lines. */
+	int after_cr;       /* Whether last separator was carriage return. */
+	int total;          /* Number of lines read so far. */
+};
+
 static void job_check(bg_job_t *job);
 static void job_free(bg_job_t *job);
 #ifndef _WIN32
@@ -123,6 +156,15 @@ static void append_error_msg(bg_job_t *job, const char err_msg[]);
 #endif
 static bg_job_t * add_background_job(pid_t pid, const char cmd[],
 		uintptr_t data, BgJobType type);
+static void stream_task(bg_op_t *bg_op, void *arg);
+static void produce_task(bg_op_t *bg_op, void *arg);
+static int stream_cancelled(void *arg);
+static void stream_feed(bg_stream_t *stream, const char data[], size_t len);
+static void stream_add_line(bg_stream_t *stream, const char line[],
+		const char end[]);
+static void stream_report_progress(bg_stream_t *stream, int nlines);
+static int stream_finish(bg_stream_t *stream);
+static void stream_free(bg_stream_t *stream);
 static void * background_task_bootstrap(void *arg);
 static void set_current_job(bg_job_t *job);
 static void make_current_job_key(void);
@@ -958,6 +1000,419 @@ bg_run_external(const char cmd[], int skip_errors)
 	return 0;
 }
 
+bg_stream_t *
+bg_stream_start(const char descr[], const char cmd[], int user_sh)
+{
+	bg_stream_t *const stream = calloc(1, sizeof(*stream));
+	if(stream == NULL)
+	{
+		return NULL;
+	}
+
+	stream->descr = strdup(descr);
+	if(stream->descr == NULL)
+	{
+		free(stream);
+		return NULL;
+	}
+
+	stream->pid = bg_run_and_capture((char *)cmd, user_sh, &stream->out,
+			&stream->err);
+	if(stream->pid == (pid_t)-1)
+	{
+		free(stream->descr);
+		free(stream);
+		return NULL;
+	}
+
+	pthread_mutex_init(&stream->lock, NULL);
+
+	if(bg_execute(cmd, descr, BG_UNDEFINED_TOTAL, 1, &stream_task, stream) != 0)
+	{
+		/* Closing the pipe makes the command quit on the next write. */
+		stream->dropped = 1;
+		(void)stream_finish(stream);
+		stream_free(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+bg_stream_t *
+bg_stream_produce(const char descr[], bg_stream_func func, void *arg)
+{
+	bg_stream_t *const stream = calloc(1, sizeof(*stream));
+	if(stream == NULL)
+	{
+		return NULL;
+	}
+
+	stream->descr = strdup(descr);
+	if(stream->descr == NULL)
+	{
+		free(stream);
+		return NULL;
+	}
+
+	stream->func = func;
+	stream->arg = arg;
+	pthread_mutex_init(&stream->lock, NULL);
+
+	if(bg_execute(descr, descr, BG_UNDEFINED_TOTAL, 1, &produce_task,
+				stream) != 0)
+	{
+		stream_free(stream);
+		return NULL;
+	}
+
+	return stream;
+}
+
+void
+bg_stream_put(bg_stream_t *stream, char line[])
+{
+	int nlines;
+
+	pthread_mutex_lock(&stream->lock);
+	nlines = stream->nlines;
+	stream->nlines = put_into_string_array(&stream->lines, stream->nlines, line);
+	if(stream->nlines == nlines)
+	{
+		free(line);
+	}
+	pthread_mutex_unlock(&stream->lock);
+
+	stream_report_progress(stream, 1);
+}
+
+void
+bg_stream_put_error(bg_stream_t *stream, const char line[])
+{
+	pthread_mutex_lock(&stream->lock);
+	(void)strappend(&stream->errors, &stream->errors_len, line);
+	(void)strappendch(&stream->errors, &stream->errors_len, '\n');
+	pthread_mutex_unlock(&stream->lock);
+}
+
+int
+bg_stream_cancelled(bg_stream_t *stream)
+{
+	return stream_cancelled(stream);
+}
+
+char **
+bg_stream_fetch(bg_stream_t *stream, int *nlines)
+{
+	char **lines;
+
+	pthread_mutex_lock(&stream->lock);
+	lines = stream->lines;
+	*nlines = stream->nlines;
+	stream->lines = NULL;
+	stream->nlines = 0;
+	pthread_mutex_unlock(&stream->lock);
+
+	return lines;
+}
+
+int
+bg_stream_finished(bg_stream_t *stream)
+{
+	int finished;
+
+	pthread_mutex_lock(&stream->lock);
+	finished = stream->finished;
+	pthread_mutex_unlock(&stream->lock);
+
+	return finished;
+}
+
+const char *
+bg_stream_errors(bg_stream_t *stream)
+{
+	return bg_stream_finished(stream) ? stream->errors : NULL;
+}
+
+void
+bg_stream_free(bg_stream_t *stream)
+{
+	int finished;
+
+	if(stream == NULL)
+	{
+		return;
+	}
+
+	/* Reader thread frees the stream on its own if it's still running. */
+	pthread_mutex_lock(&stream->lock);
+	finished = stream->finished;
+	stream->dropped = 1;
+	pthread_mutex_unlock(&stream->lock);
+
+	if(finished)
+	{
+		stream_free(stream);
+	}
+}
+
+/* Entry point of a thread that reads output of a command. */
+static void
+stream_task(bg_op_t *bg_op, void *arg)
+{
+	bg_stream_t *const stream = arg;
+	const cancellation_t cancellation = {
+		.hook = &stream_cancelled,
+		.arg = stream,
+	};
+	char buf[4096];
+
+	pthread_mutex_lock(&stream->lock);
+	stream->bg_op = bg_op;
+	pthread_mutex_unlock(&stream->lock);
+
+	while(1)
+	{
+		ssize_t nread;
+
+		wait_for_data_from(stream->pid, stream->out, 0, &cancellation);
+		if(cancellation_requested(&cancellation))
+		{
+			break;
+		}
+
+		nread = read(fileno(stream->out), buf, sizeof(buf));
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread <= 0)
+		{
+			break;
+		}
+
+		stream_feed(stream, buf, nread);
+	}
+
+	if(stream_finish(stream))
+	{
+		stream_free(stream);
+	}
+}
+
+/* Entry point of a thread that runs producer of a stream. */
+static void
+produce_task(bg_op_t *bg_op, void *arg)
+{
+	bg_stream_t *const stream = arg;
+
+	pthread_mutex_lock(&stream->lock);
+	stream->bg_op = bg_op;
+	pthread_mutex_unlock(&stream->lock);
+
+	stream->func(stream, stream->arg);
+
+	if(stream_finish(stream))
+	{
+		stream_free(stream);
+	}
+}
+
+/* Implementation of cancellation hook for stream reader.  Returns non-zero if
+ * reading should be stopped. */
+static int
+stream_cancelled(void *arg)
+{
+	bg_stream_t *const stream = arg;
+	int cancelled;
+
+	pthread_mutex_lock(&stream->lock);
+	cancelled = stream->dropped;
+	pthread_mutex_unlock(&stream->lock);
+
+	return cancelled
+	    || (stream->bg_op != NULL && bg_op_cancelled(stream->bg_op));
+}
+
+/* Splits newly read piece of output into lines and queues them for fetching.
+ * Separator is picked on the first piece: null character if it's present,
+ * otherwise newline characters. */
+static void
+stream_feed(bg_stream_t *stream, const char data[], size_t len)
+{
+	const char *const end = data + len;
+	const char *line;
+	int nlines;
+	char *last;
+
+	if(!stream->sep_known)
+	{
+		if(len >= 3U && memcmp(data, "\xef\xbb\xbf", 3U) == 0)
+		{
+			data += 3;
+		}
+		stream->null_sep = (memchr(data, '\0', end - data) != NULL);
+		stream->sep_known = 1;
+	}
+
+	pthread_mutex_lock(&stream->lock);
+	nlines = stream->nlines;
+
+	line = data;
+	while(data < end)
+	{
+		const char c = *data++;
+
+		if(stream->after_cr)
+		{
+			stream->after_cr = 0;
+			if(c == '\n')
+			{
+				line = data;
+				continue;
+			}
+		}
+
+		if(stream->null_sep ? (c != '\0') : (c != '\n' && c != '\r'))
+		{
+			continue;
+		}
+
+		stream->after_cr = (c == '\r');
+		stream_add_line(stream, line, data - 1);
+		line = data;
+	}
+
+	nlines = stream->nlines - nlines;
+	pthread_mutex_unlock(&stream->lock);
+
+	/* Keep incomplete line until the rest of it arrives. */
+	if(line != end)
+	{
+		last = realloc(stream->partial, stream->partial_len + (end - line));
+		if(last != NULL)
+		{
+			memcpy(last + stream->partial_len, line, end - line);
+			stream->partial = last;
+			stream->partial_len += end - line;
+		}
+	}
+
+	stream_report_progress(stream, nlines);
+}
+
+/* Updates description of the reader to include number of lines read so far.
+ * Called only by the thread that fills the stream. */
+static void
+stream_report_progress(bg_stream_t *stream, int nlines)
+{
+	char descr[128];
+
+	if(nlines == 0)
+	{
+		return;
+	}
+
+	stream->total += nlines;
+	snprintf(descr, sizeof(descr), "%s: %d", stream->descr, stream->total);
+	bg_op_set_descr(stream->bg_op, descr);
+}
+
+/* Queues a line that ends right before the end pointer prepending incomplete
+ * line left from the previous piece of output, if any.  Must be called with the
+ * lock held. */
+static void
+stream_add_line(bg_stream_t *stream, const char line[], const char end[])
+{
+	const size_t len = end - line;
+	char *text = malloc(stream->partial_len + len + 1U);
+	if(text == NULL)
+	{
+		return;
+	}
+
+	memcpy(text, stream->partial, stream->partial_len);
+	memcpy(text + stream->partial_len, line, len);
+	text[stream->partial_len + len] = '\0';
+
+	free(stream->partial);
+	stream->partial = NULL;
+	stream->partial_len = 0U;
+
+	/* Sequences of null separators don't produce empty lines. */
+	if(stream->null_sep && text[0] == '\0')
+	{
+		free(text);
+		return;
+	}
+
+	stream->nlines = put_into_string_array(&stream->lines, stream->nlines, text);
+	if(stream->nlines == 0 || stream->lines[stream->nlines - 1] != text)
+	{
+		free(text);
+	}
+}
+
+/* Queues the last line, collects error stream and closes streams of the
+ * command.  Returns non-zero if the stream was dropped by its owner and should
+ * be freed by the caller, otherwise zero is returned. */
+static int
+stream_finish(bg_stream_t *stream)
+{
+	size_t errors_len;
+	char *errors = NULL;
+	int dropped;
+
+	if(stream->func != NULL)
+	{
+		/* Producer has already reported its errors. */
+		pthread_mutex_lock(&stream->lock);
+		stream->finished = 1;
+		dropped = stream->dropped;
+		pthread_mutex_unlock(&stream->lock);
+		return dropped;
+	}
+
+	if(stream->partial != NULL && !stream_cancelled(stream))
+	{
+		pthread_mutex_lock(&stream->lock);
+		stream_add_line(stream, stream->partial, stream->partial);
+		pthread_mutex_unlock(&stream->lock);
+	}
+	fclose(stream->out);
+
+	if(!stream_cancelled(stream))
+	{
+		errors = read_nonseekable_stream(stream->err, &errors_len, NULL, NULL);
+		if(errors != NULL && errors_len == 0U)
+		{
+			free(errors);
+			errors = NULL;
+		}
+	}
+	fclose(stream->err);
+
+	pthread_mutex_lock(&stream->lock);
+	stream->errors = errors;
+	stream->finished = 1;
+	dropped = stream->dropped;
+	pthread_mutex_unlock(&stream->lock);
+
+	return dropped;
+}
+
+/* Frees resources of the stream. */
+static void
+stream_free(bg_stream_t *stream)
+{
+	free_string_array(stream->lines, stream->nlines);
+	free(stream->partial);
+	free(stream->errors);
+	free(stream->descr);
+	pthread_mutex_destroy(&stream->lock);
+	free(stream);
+}
+
 int
 bg_execute(const char descr[], const char op_descr[], int total, int important,
 		bg_task_func task_func, void *args)
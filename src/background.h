@@ -99,6 +99,14 @@ typedef struct bg_job_t
 }
 bg_job_t;
 
+/* Output of an external command or of a function read in background. */
+typedef struct bg_stream_t bg_stream_t;
+
+/* Function that produces lines of a stream in background thread via
+ * bg_stream_put() and bg_stream_put_error() checking bg_stream_cancelled()
+ * periodically.  It's responsible for freeing its argument. */
+typedef void (*bg_stream_func)(bg_stream_t *stream, void *arg);
+
 /* Background task entry point function signature. */
 typedef void (*bg_task_func)(bg_op_t *bg_op, void *arg);
 
@@ -132,6 +140,48 @@ int bg_and_wait_for_errors(char cmd[],
  * non-*nix like systems) or (pid_t)-1 on error. */
 pid_t bg_run_and_capture(char cmd[], int user_sh, FILE **out, FILE **err);
 
+/* Runs the command in background and reads its output line by line in a
+ * separate thread, which is listed among jobs as an operation described by the
+ * descr.  Like process_cmd_output(), takes null character as line separator if
+ * output contains it.  Returns the stream or NULL on error. */
+bg_stream_t * bg_stream_start(const char descr[], const char cmd[],
+		int user_sh);
+
+/* Runs the function in a separate thread, which is listed among jobs as an
+ * operation described by the descr, and collects lines it produces.  On failure
+ * the arg isn't used.  Returns the stream or NULL on error. */
+bg_stream_t * bg_stream_produce(const char descr[], bg_stream_func func,
+		void *arg);
+
+/* Queues newly allocated line produced by bg_stream_func taking ownership of
+ * it. */
+void bg_stream_put(bg_stream_t *stream, char line[]);
+
+/* Appends line to errors of a stream produced by bg_stream_func. */
+void bg_stream_put_error(bg_stream_t *stream, const char line[]);
+
+/* Checks whether producer of the stream should stop.  Returns non-zero if so,
+ * otherwise zero is returned. */
+int bg_stream_cancelled(bg_stream_t *stream);
+
+/* Takes lines read from the stream since previous call.  Sets *nlines to their
+ * number.  Returns array of lines, which should be freed by the caller. */
+char ** bg_stream_fetch(bg_stream_t *stream, int *nlines);
+
+/* Checks whether reading of the stream is over, which happens when the command
+ * (or the function) exits or is cancelled.  Returns non-zero if so, otherwise
+ * zero is returned. */
+int bg_stream_finished(bg_stream_t *stream);
+
+/* Retrieves what command has printed to its error stream (or what function has
+ * reported as errors).  Returns the text or NULL if reading isn't finished yet
+ * or nothing was read. */
+const char * bg_stream_errors(bg_stream_t *stream);
+
+/* Frees the stream cancelling the command if it's still running.  The stream
+ * can be NULL. */
+void bg_stream_free(bg_stream_t *stream);
+
 /* Callback-like function that marks background job specified by its process id,
  * which is finished with the exit_code. */
 void bg_process_finished_cb(pid_t pid, int exit_code);
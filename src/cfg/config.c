@@ -203,6 +203,13 @@ cfg_init(void)
 	cfg.name_dec_count = 0;
 
 	cfg.fast_file_cloning = 0;
+	cfg.io_nocache = 0;
+	cfg.io_direct = 0;
+	cfg.copy_threads = 0;
+	cfg.sort_threads = get_proc_count();
+	cfg.stat_threads = 0;
+	cfg.lazy_stat = 0;
+	cfg.max_watches = 512;
 	cfg.cvoptions = 0;
 
 	cfg.case_override = 0;
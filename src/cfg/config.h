@@ -108,6 +108,7 @@ enum
 	CVO_AUTOCMDS    = 1, /* Trigger autocommands on entering/leaving [v]cv. */
 	CVO_LOCALOPTS   = 2, /* Reset local options on entering/leaving [v]cv. */
 	CVO_LOCALFILTER = 4, /* Reset local filter on entering/leaving [v]cv. */
+	CVO_STREAM      = 8, /* Fill [v]cv while command that lists files runs. */
 };
 
 /* Which elements of runtime state should be stored in vifminfo. */
@@ -129,7 +130,8 @@ enum
 	VINFO_PHISTORY  = 1 << 13, /* Prompt history. */
 	VINFO_SHISTORY  = 1 << 14, /* Search history. */
 	VINFO_SAVEDIRS  = 1 << 15, /* Restore last used directories on startup. */
-	NUM_VINFO       = 16,      /* Number of VINFO_* constants. */
+	VINFO_DCACHE    = 1 << 16, /* Sizes of directories. */
+	NUM_VINFO       = 17,      /* Number of VINFO_* constants. */
 };
 
 /* When cursor position should be adjusted according to directory history. */
@@ -287,6 +289,30 @@ typedef struct config_t
 
 	/* Controls use of fast file cloning for file systems that support it. */
 	int fast_file_cloning;
+	/* Whether copied data should be dropped from page cache. */
+	int io_nocache;
+	/* Whether large files should be copied bypassing page cache. */
+	int io_direct;
+
+	/* Number of threads that copy files of a background operation.  Zero means
+	 * copying one file at a time. */
+	int copy_threads;
+
+	/* Number of threads that sort long lists of files.  Zero means sorting
+	 * serially. */
+	int sort_threads;
+
+	/* Number of threads that query file system for metadata of files while
+	 * loading directories.  Zero means doing it serially. */
+	int stat_threads;
+
+	/* Whether metadata of files not needed to display or sort them is queried
+	 * only on demand. */
+	int lazy_stat;
+
+	/* Maximum number of directories watched for changes in addition to the
+	 * current one in tree and custom views. */
+	int max_watches;
 
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
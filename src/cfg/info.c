@@ -519,6 +519,11 @@ write_info_file(void)
 			(void)remove(tmp_file);
 		}
 	}
+
+	if((cfg.vifm_info & VINFO_DCACHE) && dcache_save() != 0)
+	{
+		LOG_ERROR_MSG("Can't save sizes of directories");
+	}
 }
 
 /* Copies the src file to the dst location.  Returns zero on success. */
@@ -975,6 +980,7 @@ write_options(FILE *fp)
 	fprintf(fp, "=cdpath=%s\n", cfg.cd_path);
 	fprintf(fp, "=%schaselinks\n", cfg.chase_links ? "" : "no");
 	fprintf(fp, "=columns=%d\n", cfg.columns);
+	fprintf(fp, "=copythreads=%d\n", cfg.copy_threads);
 	fprintf(fp, "=cpoptions=%s\n",
 			escape_spaces(get_option_value("cpoptions", OPT_GLOBAL)));
 	fprintf(fp, "=deleteprg=%s\n", escape_spaces(cfg.delete_prg));
@@ -996,9 +1002,11 @@ write_options(FILE *fp)
 	fprintf(fp, "=%signorecase\n", cfg.ignore_case ? "" : "no");
 	fprintf(fp, "=%sincsearch\n", cfg.inc_search ? "" : "no");
 	fprintf(fp, "=%slaststatus\n", cfg.display_statusline ? "" : "no");
+	fprintf(fp, "=%slazystat\n", cfg.lazy_stat ? "" : "no");
 	fprintf(fp, "=%stitle\n", cfg.set_title ? "" : "no");
 	fprintf(fp, "=lines=%d\n", cfg.lines);
 	fprintf(fp, "=locateprg=%s\n", escape_spaces(cfg.locate_prg));
+	fprintf(fp, "=maxwatches=%d\n", cfg.max_watches);
 	fprintf(fp, "=mintimeoutlen=%d\n", cfg.min_timeout_len);
 	fprintf(fp, "=%squickview\n", curr_stats.preview.on ? "" : "no");
 	fprintf(fp, "=rulerformat=%s\n", escape_spaces(cfg.ruler_format));
@@ -1017,6 +1025,8 @@ write_options(FILE *fp)
 #endif
 	fprintf(fp, "=%ssmartcase\n", cfg.smart_case ? "" : "no");
 	fprintf(fp, "=%ssortnumbers\n", cfg.sort_numbers ? "" : "no");
+	fprintf(fp, "=sortthreads=%d\n", cfg.sort_threads);
+	fprintf(fp, "=statthreads=%d\n", cfg.stat_threads);
 	fprintf(fp, "=statusline=%s\n", escape_spaces(cfg.status_line));
 	fprintf(fp, "=syncregs=%s\n",
 			escape_spaces(get_option_value("syncregs", OPT_GLOBAL)));
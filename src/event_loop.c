@@ -34,11 +34,13 @@
 #include "engine/completion.h"
 #include "engine/keys.h"
 #include "engine/mode.h"
+#include "menus/menus.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "modes/modes.h"
 #include "modes/wk.h"
 #include "ui/color_manager.h"
 #include "ui/fileview.h"
+#include "ui/quickview.h"
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/ui.h"
@@ -50,6 +52,8 @@
 #include "background.h"
 #include "bracket_notation.h"
 #include "filelist.h"
+#include "flist_meta.h"
+#include "flist_stream.h"
 #include "ipc.h"
 #include "registers.h"
 #include "status.h"
@@ -411,9 +415,18 @@ process_scheduled_updates(void)
 
 	if(vle_mode_get_primary() != MENU_MODE)
 	{
+		flist_stream_check(curr_view);
+		flist_stream_check(other_view);
+		qv_check_cache();
+
 		need_redraw += (process_scheduled_updates_of_view(curr_view) != 0);
 		need_redraw += (process_scheduled_updates_of_view(other_view) != 0);
 	}
+	else if(vle_mode_is(MENU_MODE))
+	{
+		/* Not in submodes, which might be working with the items. */
+		need_redraw += (menus_stream_check() != 0);
+	}
 
 	need_redraw += (stats_redraw_fetch() != 0);
 
@@ -504,6 +517,7 @@ check_view_for_changes(view_t *view)
 {
 	if(window_shows_dirlist(view))
 	{
+		(void)flist_meta_apply(view);
 		check_if_filelist_has_changed(view);
 	}
 }
@@ -21,27 +21,29 @@
 
 #ifdef _WIN32
 #include <windows.h>
-#include <fcntl.h>
 #include <lm.h>
 #include <winioctl.h>
 #endif
 
 #include <curses.h>
 
-#include <sys/stat.h> /* stat */
+#include <sys/stat.h> /* stat statx() */
 
 #include <assert.h> /* assert() */
-#include <errno.h> /* errno */
+#include <errno.h> /* ENOSYS errno */
+#include <fcntl.h> /* AT_FDCWD AT_SYMLINK_NOFOLLOW */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* intptr_t uint64_t */
 #include <stdio.h> /* snprintf() */
-#include <stdlib.h> /* calloc() free() */
-#include <string.h> /* memcmp() memcpy() memset() strcat() strcmp() strcpy()
-                       strdup() strlen() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* memcmp() memcpy() memmove() memset() strcat() strcmp()
+                       strcpy() strdup() strlen() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
 #include "engine/autocmds.h"
 #include "engine/mode.h"
 #include "int/fuse.h"
@@ -71,10 +73,13 @@
 #include "utils/trie.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filtering.h"
 #include "flist_hist.h"
+#include "flist_meta.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
+#include "flist_stream.h"
 #include "fops_misc.h"
 #include "macros.h"
 #include "opt_handlers.h"
@@ -84,6 +89,74 @@
 #include "status.h"
 #include "types.h"
 
+/* Change of a single file collected from directory watcher. */
+typedef struct
+{
+	char *dir;   /* Path to directory of the file. */
+	char *name;  /* Name of the file. */
+	int existed; /* Whether the file existed before the first change. */
+	int removed; /* Whether the last change was removal of the file. */
+}
+fs_change_t;
+
+/* Changes of files of a directory collected by fswatch_poll(). */
+typedef struct
+{
+	trie_t *index;        /* Maps paths of files to their positions in list. */
+	fs_change_t *list;    /* Changes in the order of their first appearance. */
+	int count;            /* Number of elements in the list. */
+	int rescan;           /* Whether the directory needs to be re-read. */
+}
+fs_changes_t;
+
+/* Cached target of a symbolic link. */
+typedef struct
+{
+	time_t mtime; /* Modification time of the link. */
+#ifndef _WIN32
+	ino_t inode;  /* Inode number of the link. */
+#endif
+	char *target; /* Target of the link (allocated along with the structure). */
+}
+link_target_t;
+
+/* Directory listed by parallel tree walker. */
+typedef struct walk_dir_t walk_dir_t;
+
+/* File of a directory listed by parallel tree walker. */
+typedef struct
+{
+	int entry;       /* Index of entry of the file or -1 for a directory that is
+	                    filtered out, but is traversed anyway. */
+	walk_dir_t *dir; /* Listing of a directory to descend into or NULL. */
+}
+walk_item_t;
+
+struct walk_dir_t
+{
+	char *path;           /* Path to the directory. */
+	dir_entry_t *entries; /* Entries of visible files (dynamic array). */
+	int nentries;         /* Number of elements in the entries array. */
+	walk_item_t *items;   /* Files in the order in which they were listed. */
+	int nitems;           /* Number of elements in the items array. */
+	int nfiltered;        /* Number of files that were filtered out. */
+	int failed;           /* Whether listing failed. */
+};
+
+/* State of parallel tree walker that is shared among its threads. */
+typedef struct
+{
+	view_t *view;                /* View for which the tree is being built. */
+	trie_t *excluded_paths;      /* Paths that should be skipped. */
+	workers_t *workers;          /* Threads that list directories. */
+	pthread_t main_thread;       /* Thread that reports progress. */
+	pthread_mutex_t filter_lock; /* Serializes checks of filters. */
+	pthread_mutex_t lock;        /* Protects fields below it. */
+	int nfiles;                  /* Number of files listed so far. */
+	int reported;                /* Number of files at the last report. */
+}
+walk_job_t;
+
 static void init_flist(view_t *view);
 static void reset_view(view_t *view);
 static void init_view_history(view_t *view);
@@ -92,7 +165,15 @@ static int navigate_to_file_in_custom_view(view_t *view, const char dir[],
 static int fill_dir_entry_by_path(dir_entry_t *entry, const char path[]);
 #ifndef _WIN32
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
-		const struct dirent *d);
+		const struct dirent *d, int meta);
+static int fill_dir_entry_from_stat(dir_entry_t *entry, const char path[],
+		const struct dirent *d, const struct stat *s, int loaded);
+static int lstat_meta(const char path[], int meta, struct stat *s);
+#ifdef STATX_TYPE
+static void probe_statx(void);
+static unsigned int meta_to_statx(int meta);
+static int statx_to_meta(unsigned int mask);
+#endif
 static int data_is_dir_entry(const struct dirent *d, const char path[]);
 #else
 static int fill_dir_entry(dir_entry_t *entry, const char path[],
@@ -119,6 +200,9 @@ static void zap_compare_view(view_t *view, view_t *other, zap_filter filter,
 		void *arg);
 static int find_separator(view_t *view, int idx);
 static void update_dir_watcher(view_t *view);
+static void watch_origins(view_t *view, const dir_entry_t entries[],
+		int count);
+static void add_extra_watch(view_t *view, const char path[]);
 static int custom_list_is_incomplete(const view_t *view);
 static int is_dead_or_filtered(view_t *view, const dir_entry_t *entry,
 		void *arg);
@@ -142,6 +226,25 @@ static int rescue_from_empty_filelist(view_t *view);
 static void add_parent_entry(view_t *view, dir_entry_t **entries, int *count);
 static void init_dir_entry(view_t *view, dir_entry_t *entry, const char name[]);
 static dir_entry_t * alloc_dir_entry(dir_entry_t **list, int list_size);
+static void collect_fs_change(FSWatchChange change, const char dir[],
+		const char name[], void *arg);
+static void free_fs_changes(fs_changes_t *changes);
+static int can_apply_fs_changes(const view_t *view);
+static int apply_fs_changes(view_t *view, const fs_changes_t *changes);
+static int apply_dir_changes(view_t *view, const fs_changes_t *changes);
+static int apply_custom_changes(view_t *view, const fs_changes_t *changes);
+static int apply_tree_changes(view_t *view, const fs_changes_t *changes);
+static int find_tree_dir(const view_t *view, const char path[], int *pos);
+static int build_tree_block(view_t *view, const char dir[], const char name[],
+		dir_entry_t **block, int *count);
+static void insert_tree_block(view_t *view, int parent_pos,
+		dir_entry_t block[], int count);
+static int is_not_marked(view_t *view, const dir_entry_t *entry, void *arg);
+static int is_not_extra_leaf(view_t *view, const dir_entry_t *entry,
+		void *arg);
+static int refresh_entry(view_t *view, dir_entry_t *entry);
+static void drop_entry(view_t *view, dir_entry_t *entry);
+static void insert_entries(view_t *view, dir_entry_t entries[], int count);
 static int tree_has_changed(const dir_entry_t *entries, size_t nchildren);
 TSTATIC void pick_cd_path(view_t *view, const char base_dir[],
 		const char path[], int *updir, char buf[], size_t buf_size);
@@ -166,14 +269,36 @@ static int complete_tree(const char name[], int valid, const void *parent_data,
 static void reset_entry_list(view_t *view, dir_entry_t **entries, int *count);
 static void drop_tops(view_t *view, dir_entry_t *entries, int *nentries,
 		int extra);
+static int add_tree_file(view_t *view, const char path[], const char name[],
+		trie_t *excluded_paths, int parent_pos);
 static int add_files_recursively(view_t *view, const char path[],
 		trie_t *excluded_paths, int parent_pos, int no_direct_parent);
+static int add_files_in_parallel(view_t *view, const char path[],
+		trie_t *excluded_paths);
+static int walk_job_init(walk_job_t *job);
+static void walk_job_free(walk_job_t *job);
+static void walk_dir_task(void *task, void *arg);
+static void walk_list_dir(walk_job_t *job, walk_dir_t *dir);
+static int walk_add_file(walk_job_t *job, walk_dir_t *dir, const char name[]);
+static walk_item_t * walk_add_item(walk_dir_t *dir, int entry);
+static walk_dir_t * walk_push_dir(walk_job_t *job, const char path[]);
+static int assemble_tree(view_t *view, walk_dir_t *dir, int parent_pos,
+		int no_direct_parent);
+static void walk_dir_free(view_t *view, walk_dir_t *dir);
 static int file_is_visible(view_t *view, const char name[], int is_dir,
 		const void *data, int apply_local_filter);
 static int add_directory_leaf(view_t *view, const char path[], int parent_pos);
 static int init_parent_entry(view_t *view, dir_entry_t *entry,
 		const char path[]);
 
+/* Targets of symbolic links keyed by their full paths. */
+static trie_t *link_targets;
+
+#if !defined(_WIN32) && defined(STATX_TYPE)
+/* Whether statx() is implemented by the kernel.  Set by probe_statx(). */
+static int statx_works;
+#endif
+
 void
 init_filelists(void)
 {
@@ -213,6 +338,7 @@ init_flist(view_t *view)
 	view->custom.entry_count = 0;
 	view->custom.orig_dir = NULL;
 	view->custom.title = NULL;
+	view->custom.stream = NULL;
 
 	/* Load fake empty element to make dir_entry valid. */
 	view->dir_entry = dynarray_extend(NULL, sizeof(dir_entry_t));
@@ -221,6 +347,8 @@ init_flist(view_t *view)
 	view->dir_entry[0].type = FT_DIR;
 	view->dir_entry[0].hi_num = -1;
 	view->dir_entry[0].name_dec_num = -1;
+	view->dir_entry[0].meta_idx = -1;
+	view->dir_entry[0].meta_missing = FMETA_NONE;
 	view->dir_entry[0].origin = &view->curr_dir[0];
 	view->list_rows = 1;
 }
@@ -233,6 +361,9 @@ flist_free_view(view_t *view)
 
 	int i;
 
+	flist_meta_drop(view);
+	flist_stream_stop(view);
+
 	for(i = 0; i < view->list_rows; ++i)
 	{
 		fentry_free(view, &view->dir_entry[i]);
@@ -312,6 +443,7 @@ flist_free_view(view_t *view)
 	view_info_free(view->vi);
 
 	regfree(&view->primary_group);
+	sort_drop_cache(view);
 }
 
 void
@@ -675,6 +807,10 @@ change_directory(view_t *view, const char directory[])
 	{
 		copy_str(view->last_dir, sizeof(view->last_dir), flist_get_dir(view));
 		view->on_slow_fs = is_on_slow_fs(dir_dup, cfg.slow_fs_list);
+
+		/* Targets are read again on demand, this keeps the cache from growing with
+		 * every visited directory. */
+		flist_free_link_targets();
 	}
 
 	copy_str(view->curr_dir, sizeof(view->curr_dir), dir_dup);
@@ -803,6 +939,7 @@ flist_custom_active(const view_t *view)
 void
 flist_custom_start(view_t *view, const char title[])
 {
+	flist_stream_stop(view);
 	free_dir_entries(view, &view->custom.entries, &view->custom.entry_count);
 	(void)replace_string(&view->custom.next_title, title);
 
@@ -827,6 +964,48 @@ flist_custom_add(view_t *view, const char path[])
 			canonic_path);
 }
 
+dir_entry_t *
+flist_custom_add_stat(view_t *view, const char path[], const struct stat *st)
+{
+#ifndef _WIN32
+	char canonic_path[PATH_MAX + 1];
+	dir_entry_t *dir_entry;
+
+	to_canonic_path(path, flist_get_dir(view), canonic_path,
+			sizeof(canonic_path));
+
+	/* Don't add duplicates. */
+	if(trie_put(view->custom.paths_cache, canonic_path) != 0)
+	{
+		return NULL;
+	}
+
+	dir_entry = alloc_dir_entry(&view->custom.entries, view->custom.entry_count);
+	if(dir_entry == NULL)
+	{
+		return NULL;
+	}
+
+	init_dir_entry(view, dir_entry, get_last_path_component(canonic_path));
+
+	dir_entry->origin = strdup(canonic_path);
+	remove_last_path_component(dir_entry->origin);
+
+	if(fill_dir_entry_from_stat(dir_entry, canonic_path, NULL, st,
+				FMETA_ALL) != 0)
+	{
+		fentry_free(view, dir_entry);
+		return NULL;
+	}
+
+	++view->custom.entry_count;
+	return dir_entry;
+#else
+	/* Information from stat() isn't enough to fill an entry on Windows. */
+	return flist_custom_add(view, path);
+#endif
+}
+
 dir_entry_t *
 flist_custom_put(view_t *view, dir_entry_t *entry)
 {
@@ -861,6 +1040,86 @@ flist_custom_add_separator(view_t *view, int id)
 	}
 }
 
+int
+flist_custom_extend(view_t *view, char *lines[], int nlines, trie_t *seen)
+{
+	dir_entry_t *entries = NULL;
+	int nentries = 0;
+	int i, nsorted;
+	char current[PATH_MAX + 1];
+
+	for(i = 0; i < nlines; ++i)
+	{
+		char canonic_path[PATH_MAX + 1];
+		char *const path = parse_line_for_path(lines[i], flist_get_dir(view));
+		if(path == NULL)
+		{
+			continue;
+		}
+
+		to_canonic_path(path, flist_get_dir(view), canonic_path,
+				sizeof(canonic_path));
+		free(path);
+
+		/* Don't add duplicates. */
+		if(trie_put(seen, canonic_path) == 0)
+		{
+			(void)entry_list_add(view, &entries, &nentries, canonic_path);
+		}
+	}
+
+	if(nentries == 0)
+	{
+		dynarray_free(entries);
+		return 0;
+	}
+
+	get_current_full_path(view, sizeof(current), current);
+
+	/* Drop ".." that was added only because the list was empty. */
+	if(view->list_rows == 1 && is_parent_dir(view->dir_entry[0].name) &&
+			(ui_view_unsorted(view) || !cfg_parent_dir_is_visible(0)))
+	{
+		free_dir_entries(view, &view->dir_entry, &view->list_rows);
+		free_dir_entries(view, &view->local_filter.entries,
+				&view->local_filter.entry_count);
+		current[0] = '\0';
+	}
+
+	/* Keep unfiltered list of entries complete. */
+	if(view->local_filter.entry_count != 0)
+	{
+		dir_entry_t *copies = NULL;
+		int ncopies = 0;
+		replace_dir_entries(view, &copies, &ncopies, entries, nentries);
+		view->local_filter.entries = dynarray_extend(view->local_filter.entries,
+				ncopies*sizeof(*copies));
+		memcpy(&view->local_filter.entries[view->local_filter.entry_count], copies,
+				ncopies*sizeof(*copies));
+		view->local_filter.entry_count += ncopies;
+		dynarray_free(copies);
+	}
+
+	(void)zap_entries(view, entries, &nentries, &is_dead_or_filtered, NULL, 1, 0);
+
+	nsorted = view->list_rows;
+	view->dir_entry = dynarray_extend(view->dir_entry,
+			nentries*sizeof(*view->dir_entry));
+	memcpy(&view->dir_entry[nsorted], entries, nentries*sizeof(*entries));
+	view->list_rows += nentries;
+	dynarray_free(entries);
+
+	sort_view_tail(view, nsorted);
+
+	if(current[0] == '\0' || set_position_by_path(view, current) != 0)
+	{
+		view->list_pos = 0;
+	}
+
+	fview_list_updated(view);
+	return nentries;
+}
+
 #ifndef _WIN32
 
 /* Fills directory entry with information about file specified by the path.
@@ -868,28 +1127,52 @@ flist_custom_add_separator(view_t *view, int id)
 static int
 fill_dir_entry_by_path(dir_entry_t *entry, const char path[])
 {
-	return fill_dir_entry(entry, path, NULL);
+	return fill_dir_entry(entry, path, NULL, FMETA_ALL);
 }
 
 /* Fills fields of the entry from stat information of the file specified by its
- * path.  d is optional source of file type.  Returns zero on success, otherwise
- * non-zero is returned. */
+ * path.  d is optional source of file type, if it's NULL, current type of the
+ * entry is used as a fallback.  meta is a set of FMETA_* flags that specifies
+ * which fields should be filled, the rest is left intact and can be loaded
+ * later.  Returns zero on success, otherwise non-zero is returned. */
 static int
-fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
+fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d,
+		int meta)
 {
 	struct stat s;
+	int loaded;
 
 	/* Load the inode information or leave blank values in the entry. */
-	if(os_lstat(path, &s) != 0)
+	loaded = lstat_meta(path, meta, &s);
+	if(loaded < 0)
 	{
 		LOG_SERROR_MSG(errno, "Can't lstat() \"%s\"", path);
 		return 1;
 	}
 
-	entry->type = get_type_from_mode(s.st_mode);
-	if(entry->type == FT_UNK)
+	return fill_dir_entry_from_stat(entry, path, d, &s, loaded);
+}
+
+/* Fills fields of the entry from already obtained lstat() information of the
+ * file specified by its path.  d is the same as for fill_dir_entry().  loaded
+ * is a set of FMETA_* flags that specifies which fields of *s are valid.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+fill_dir_entry_from_stat(dir_entry_t *entry, const char path[],
+		const struct dirent *d, const struct stat *s, int loaded)
+{
+	FileType type = get_type_from_mode(s->st_mode);
+	if(type == FT_UNK && d != NULL)
+	{
+		type = type_from_dir_entry(d, path);
+	}
+	if(type != FT_UNK && type != entry->type)
 	{
-		entry->type = (d == NULL) ? FT_UNK : type_from_dir_entry(d, path);
+		/* Cached decorations might depend on type, which could have been guessed
+		 * from readdir() data (it can't tell executables from regular files). */
+		entry->type = type;
+		entry->hi_num = -1;
+		entry->name_dec_num = -1;
 	}
 	if(entry->type == FT_UNK)
 	{
@@ -897,33 +1180,146 @@ fill_dir_entry(dir_entry_t *entry, const char path[], const struct dirent *d)
 		return 1;
 	}
 
-	entry->size = (uintmax_t)s.st_size;
-	entry->uid = s.st_uid;
-	entry->gid = s.st_gid;
-	entry->mode = s.st_mode;
-	entry->inode = s.st_ino;
-	entry->mtime = s.st_mtime;
-	entry->atime = s.st_atime;
-	entry->ctime = s.st_ctime;
-	entry->nlinks = s.st_nlink;
+	if(loaded & FMETA_SIZE)
+	{
+		entry->size = (uintmax_t)s->st_size;
+	}
+	if(loaded & FMETA_OWNER)
+	{
+		entry->uid = s->st_uid;
+		entry->gid = s->st_gid;
+	}
+	if(loaded & FMETA_MODE)
+	{
+		entry->mode = s->st_mode;
+	}
+	if(loaded & FMETA_INODE)
+	{
+		entry->inode = s->st_ino;
+	}
+	if(loaded & FMETA_MTIME)
+	{
+		entry->mtime = s->st_mtime;
+	}
+	if(loaded & FMETA_ATIME)
+	{
+		entry->atime = s->st_atime;
+	}
+	if(loaded & FMETA_CTIME)
+	{
+		entry->ctime = s->st_ctime;
+	}
+	if(loaded & FMETA_NLINK)
+	{
+		entry->nlinks = s->st_nlink;
+	}
+	entry->meta_missing &= ~loaded;
 
 	if(entry->type == FT_LINK)
 	{
-		struct stat s;
+		struct stat target;
 
 		const SymLinkType symlink_type = get_symlink_type(path);
 		entry->dir_link = (symlink_type != SLT_UNKNOWN);
 
 		/* Query mode of symbolic link target. */
-		if(symlink_type != SLT_SLOW && os_stat(entry->name, &s) == 0)
+		if((loaded & FMETA_MODE) && symlink_type != SLT_SLOW &&
+				os_stat(path, &target) == 0)
 		{
-			entry->mode = s.st_mode;
+			entry->mode = target.st_mode;
 		}
 	}
 
 	return 0;
 }
 
+/* Queries information about the file without following symbolic links.  meta
+ * is a set of FMETA_* flags that are needed, file type is always queried.  On
+ * Linux statx() is used to avoid requesting unnecessary fields, which is
+ * cheaper on network file systems.  Returns set of FMETA_* flags that were
+ * loaded or -1 on error. */
+static int
+lstat_meta(const char path[], int meta, struct stat *s)
+{
+#ifdef STATX_TYPE
+	/* Workers of 'statthreads' get here concurrently, so availability of
+	 * statx() is determined only once. */
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+	pthread_once(&once, &probe_statx);
+
+	if(statx_works)
+	{
+		struct statx stx;
+		/* Permission bits are needed to detect executable files. */
+		const unsigned int mask = STATX_TYPE | STATX_MODE | meta_to_statx(meta);
+		if(statx(AT_FDCWD, path, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask,
+					&stx) == 0)
+		{
+			s->st_mode = stx.stx_mode;
+			s->st_size = stx.stx_size;
+			s->st_uid = stx.stx_uid;
+			s->st_gid = stx.stx_gid;
+			s->st_ino = stx.stx_ino;
+			s->st_nlink = stx.stx_nlink;
+			s->st_mtime = stx.stx_mtime.tv_sec;
+			s->st_atime = stx.stx_atime.tv_sec;
+			s->st_ctime = stx.stx_ctime.tv_sec;
+			return statx_to_meta(stx.stx_mask);
+		}
+
+		return -1;
+	}
+#endif
+
+	return (os_lstat(path, s) == 0 ? FMETA_ALL : -1);
+}
+
+#ifdef STATX_TYPE
+
+/* Checks whether statx() is implemented by the kernel (and isn't forbidden) and
+ * sets statx_works accordingly. */
+static void
+probe_statx(void)
+{
+	struct statx stx;
+	statx_works = (statx(AT_FDCWD, "/", AT_STATX_DONT_SYNC, STATX_TYPE,
+				&stx) == 0);
+}
+
+/* Maps set of FMETA_* flags to mask of STATX_* flags.  Returns the mask. */
+static unsigned int
+meta_to_statx(int meta)
+{
+	unsigned int mask = 0U;
+	mask |= (meta & FMETA_SIZE) ? STATX_SIZE : 0U;
+	mask |= (meta & FMETA_OWNER) ? (STATX_UID | STATX_GID) : 0U;
+	mask |= (meta & FMETA_MODE) ? STATX_MODE : 0U;
+	mask |= (meta & FMETA_MTIME) ? STATX_MTIME : 0U;
+	mask |= (meta & FMETA_ATIME) ? STATX_ATIME : 0U;
+	mask |= (meta & FMETA_CTIME) ? STATX_CTIME : 0U;
+	mask |= (meta & FMETA_INODE) ? STATX_INO : 0U;
+	mask |= (meta & FMETA_NLINK) ? STATX_NLINK : 0U;
+	return mask;
+}
+
+/* Maps mask of STATX_* flags to set of FMETA_* flags.  Returns the set. */
+static int
+statx_to_meta(unsigned int mask)
+{
+	int meta = FMETA_NONE;
+	meta |= (mask & STATX_SIZE) ? FMETA_SIZE : 0;
+	meta |= ((mask & STATX_UID) && (mask & STATX_GID)) ? FMETA_OWNER : 0;
+	meta |= (mask & STATX_MODE) ? FMETA_MODE : 0;
+	meta |= (mask & STATX_MTIME) ? FMETA_MTIME : 0;
+	meta |= (mask & STATX_ATIME) ? FMETA_ATIME : 0;
+	meta |= (mask & STATX_CTIME) ? FMETA_CTIME : 0;
+	meta |= (mask & STATX_INO) ? FMETA_INODE : 0;
+	meta |= (mask & STATX_NLINK) ? FMETA_NLINK : 0;
+	return meta;
+}
+
+#endif
+
 /* Checks whether file is a directory.  Returns non-zero if so, otherwise zero
  * is returned. */
 static int
@@ -1008,6 +1404,106 @@ data_is_dir_entry(const WIN32_FIND_DATAW *ffd, const char path[])
 
 #endif
 
+int
+fentry_load_meta(dir_entry_t *entry, const char path[], int meta)
+{
+#ifndef _WIN32
+	return fill_dir_entry(entry, path, NULL, meta);
+#else
+	return fill_dir_entry_by_path(entry, path);
+#endif
+}
+
+void
+fentry_ensure_meta(const dir_entry_t *entry, int meta)
+{
+	/* Metadata is loaded on demand, so conceptually the entry doesn't change. */
+	dir_entry_t *const e = (dir_entry_t *)entry;
+	char full_path[PATH_MAX + 1];
+
+	/* Metadata of entries that are being loaded in background arrives later. */
+	meta &= entry->meta_missing;
+	if(meta == FMETA_NONE || entry->meta_idx >= 0)
+	{
+		return;
+	}
+
+	get_full_path_of(entry, sizeof(full_path), full_path);
+	if(fentry_load_meta(e, full_path, meta) != 0)
+	{
+		/* Don't try again, the file is likely gone and will disappear from the
+		 * list on the next reload. */
+		e->meta_missing &= ~meta;
+	}
+}
+
+uint64_t
+fentry_get_raw_size(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_SIZE);
+	return entry->size;
+}
+
+time_t
+fentry_get_mtime(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_MTIME);
+	return entry->mtime;
+}
+
+time_t
+fentry_get_atime(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_ATIME);
+	return entry->atime;
+}
+
+time_t
+fentry_get_ctime(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_CTIME);
+	return entry->ctime;
+}
+
+#ifndef _WIN32
+
+uid_t
+fentry_get_uid(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_OWNER);
+	return entry->uid;
+}
+
+gid_t
+fentry_get_gid(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_OWNER);
+	return entry->gid;
+}
+
+mode_t
+fentry_get_mode(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_MODE);
+	return entry->mode;
+}
+
+ino_t
+fentry_get_inode(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_INODE);
+	return entry->inode;
+}
+
+int
+fentry_get_nlinks(const dir_entry_t *entry)
+{
+	fentry_ensure_meta(entry, FMETA_NLINK);
+	return entry->nlinks;
+}
+
+#endif
+
 int
 flist_custom_finish(view_t *view, CVType type, int allow_empty)
 {
@@ -1072,6 +1568,7 @@ flist_custom_finish_internal(view_t *view, CVType type, int reload,
 	}
 
 	/* Replace view file list with custom list. */
+	flist_meta_drop(view);
 	free_dir_entries(view, &view->dir_entry, &view->list_rows);
 	view->dir_entry = view->custom.entries;
 	view->list_rows = view->custom.entry_count;
@@ -1081,6 +1578,10 @@ flist_custom_finish_internal(view_t *view, CVType type, int reload,
 	view->filtered = 0;
 	view->matches = 0;
 
+	/* Watch is recreated on next check to cover directories of the new list. */
+	fswatch_free(view->watch);
+	view->watch = NULL;
+
 	/* Kind of custom view must be set to correct value before option loading and
 	 * sorting. */
 	view->custom.type = type;
@@ -1519,6 +2020,8 @@ fentry_get_dir_info(const view_t *view, const dir_entry_t *entry,
 	assert((size != NULL || nitems != NULL) &&
 			"At least one of out parameters has to be non-NULL.");
 
+	/* Cached values are validated against modification time. */
+	fentry_ensure_meta(entry, FMETA_MTIME);
 	dcache_get_of(entry, &size_res, &nitems_res);
 
 	if(size != NULL)
@@ -1919,19 +2422,82 @@ static void
 update_dir_watcher(view_t *view)
 {
 	const char *const curr_dir = flist_get_dir(view);
+	const int custom = flist_custom_active(view);
 
-	if(view->watch == NULL || stroscmp(view->watched_dir, curr_dir) != 0)
+	/* Extra watches of a custom view aren't needed after leaving it. */
+	if(view->watch == NULL || stroscmp(view->watched_dir, curr_dir) != 0 ||
+			(!custom && view->extra_watches != 0))
 	{
 		fswatch_free(view->watch);
 		view->watch = fswatch_create(curr_dir);
+		view->extra_watches = 0;
 
 		/* Failure to create a watch is bad, but there isn't much we can do here and
 		 * this doesn't feel like a reason to block anything else. */
 		if(view->watch != NULL)
 		{
 			copy_str(view->watched_dir, sizeof(view->watched_dir), curr_dir);
+
+			if(custom && !cv_compare(view->custom.type))
+			{
+				watch_origins(view, view->dir_entry, view->list_rows);
+			}
+		}
+	}
+}
+
+/* Adds watches for directories that contain the entries of a custom view.
+ * Every directory of a tree has at least one entry with it as an origin (".."
+ * leaf if it's empty), so all of them are covered. */
+static void
+watch_origins(view_t *view, const dir_entry_t entries[], int count)
+{
+	int i;
+	trie_t *const watched = trie_create();
+	if(watched == NULL)
+	{
+		view->extra_watches = -1;
+		return;
+	}
+
+	(void)trie_put(watched, view->watched_dir);
+
+	for(i = 0; i < count && view->extra_watches >= 0; ++i)
+	{
+		const char *const origin = entries[i].origin;
+		const int known = trie_put(watched, origin);
+		if(known < 0)
+		{
+			view->extra_watches = -1;
+		}
+		else if(known == 0)
+		{
+			add_extra_watch(view, origin);
 		}
 	}
+
+	trie_free(watched);
+}
+
+/* Watches one more directory of a custom view unless doing so exceeds the
+ * limit.  On failure marks watch of the view as incomplete. */
+static void
+add_extra_watch(view_t *view, const char path[])
+{
+	if(view->extra_watches < 0)
+	{
+		return;
+	}
+
+	if(view->extra_watches >= cfg.max_watches ||
+			fswatch_add(view->watch, path) != 0)
+	{
+		view->extra_watches = -1;
+		return;
+	}
+
+	/* Same directory might be reachable by several paths. */
+	view->extra_watches = fswatch_count(view->watch) - 1;
 }
 
 /* Checks whether currently loaded custom list of files is missing some files
@@ -2169,6 +2735,8 @@ update_dir_list(view_t *view, int reload)
 		return 1;
 	}
 
+	flist_meta_load(view);
+
 	if(cfg_parent_dir_is_visible(is_root_dir(view->curr_dir)) ||
 			view->list_rows == 0)
 	{
@@ -2189,6 +2757,8 @@ update_dir_list(view_t *view, int reload)
 static void
 start_dir_list_change(view_t *view, dir_entry_t **entries, int *len, int reload)
 {
+	flist_meta_drop(view);
+
 	if(reload)
 	{
 		*entries = view->dir_entry;
@@ -2250,6 +2820,13 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 
 	init_dir_entry(view, entry, name);
 
+#ifndef _WIN32
+	/* Postpone querying metadata, it's loaded by flist_meta_load() later.  Type
+	 * reported by readdir() is used in the meantime. */
+	entry->type = type_from_dir_entry(data, name);
+	entry->meta_idx = view->list_rows++;
+	entry->meta_missing = FMETA_ALL;
+#else
 	if(fill_dir_entry(entry, entry->name, data) == 0)
 	{
 		++view->list_rows;
@@ -2258,6 +2835,7 @@ add_file_entry_to_view(const char name[], const void *data, void *param)
 	{
 		fentry_free(view, entry);
 	}
+#endif
 
 	return 0;
 }
@@ -2504,6 +3082,9 @@ init_dir_entry(view_t *view, dir_entry_t *entry, const char name[])
 	entry->child_count = 0;
 	entry->child_pos = 0;
 
+	entry->meta_idx = -1;
+	entry->meta_missing = FMETA_NONE;
+
 	/* All files start as unselected, unmatched and unmarked. */
 	entry->selected = 0;
 	entry->was_selected = 0;
@@ -2636,9 +3217,10 @@ check_if_filelist_has_changed(view_t *view)
 {
 	int failed, changed;
 	const char *const curr_dir = flist_get_dir(view);
+	fs_changes_t changes = { .index = NULL };
 
 	if(view->on_slow_fs ||
-			(flist_custom_active(view) && !cv_tree(view->custom.type)) ||
+			(flist_custom_active(view) && cv_compare(view->custom.type)) ||
 			is_unc_root(curr_dir))
 	{
 		return;
@@ -2646,22 +3228,35 @@ check_if_filelist_has_changed(view_t *view)
 
 	if(view->watch == NULL)
 	{
-		/* If watch is not initialized, try to do this, but don't fail on error. */
+		/* If watch is not initialized, try to do this, but don't fail on error.
+		 * Custom views get their watches right after they are built, so there is
+		 * nothing to catch up with. */
 
 		update_dir_watcher(view);
 		failed = 0;
-		changed = (view->watch != NULL);
+		changed = (view->watch != NULL && !flist_custom_active(view));
 	}
 	else
 	{
-		changed = fswatch_changed(view->watch, &failed);
-	}
+		changes.index = trie_create();
+		changes.rescan = (changes.index == NULL || !can_apply_fs_changes(view));
+		changed = fswatch_poll(view->watch, &failed, &collect_fs_change,
+				&changes);
+
+		/* Watches of removed directories are gone and don't count anymore. */
+		if(view->extra_watches > 0)
+		{
+			view->extra_watches = fswatch_count(view->watch) - 1;
+		}
+	}
 
 	/* Check if we still have permission to visit this directory. */
 	failed |= (os_access(curr_dir, X_OK) != 0);
 
 	if(failed)
 	{
+		free_fs_changes(&changes);
+
 		LOG_SERROR_MSG(errno, "Can't stat() \"%s\"", curr_dir);
 		log_cwd();
 
@@ -2676,12 +3271,22 @@ check_if_filelist_has_changed(view_t *view)
 
 	if(changed)
 	{
-		ui_view_schedule_reload(view);
+		/* Files that changed are updated in place, re-reading whole directory is
+		 * necessary only when changes weren't tracked. */
+		if(changes.index == NULL || changes.rescan ||
+				apply_fs_changes(view, &changes) != 0)
+		{
+			ui_view_schedule_reload(view);
+		}
+		else
+		{
+			ui_view_schedule_redraw(view);
+		}
 	}
-	else if(flist_custom_active(view) && cv_tree(view->custom.type))
+	else if(flist_custom_active(view))
 	{
-		/* Custom trees don't track file-system changes. */
-		if(view->custom.type == CV_TREE &&
+		/* Trees that have too many directories to watch are checked manually. */
+		if(view->custom.type == CV_TREE && view->extra_watches < 0 &&
 				tree_has_changed(view->dir_entry, view->list_rows))
 		{
 			ui_view_schedule_reload(view);
@@ -2697,6 +3302,679 @@ check_if_filelist_has_changed(view_t *view)
 	}
 }
 
+/* fswatch_poll() callback that accumulates changes of files. */
+static void
+collect_fs_change(FSWatchChange change, const char dir[], const char name[],
+		void *arg)
+{
+	fs_changes_t *const changes = arg;
+	fs_change_t *new_list;
+	fs_change_t *new_change;
+	char path[PATH_MAX + 1];
+	void *data;
+
+	if(changes->rescan)
+	{
+		return;
+	}
+
+	if(change == FSWC_RESCAN)
+	{
+		changes->rescan = 1;
+		return;
+	}
+
+	/* Same way as get_full_path_of() does it to be able to match entries. */
+	build_path(path, sizeof(path), dir, name);
+
+	if(trie_get(changes->index, path, &data) == 0)
+	{
+		changes->list[(intptr_t)data].removed = (change == FSWC_REMOVED);
+		return;
+	}
+
+	new_list = reallocarray(changes->list, changes->count + 1,
+			sizeof(*changes->list));
+	if(new_list == NULL)
+	{
+		changes->rescan = 1;
+		return;
+	}
+	changes->list = new_list;
+
+	new_change = &new_list[changes->count];
+	new_change->dir = strdup(dir);
+	new_change->name = strdup(name);
+	if(new_change->dir == NULL || new_change->name == NULL ||
+			trie_set(changes->index, path, (void *)(intptr_t)changes->count) != 0)
+	{
+		free(new_change->dir);
+		free(new_change->name);
+		changes->rescan = 1;
+		return;
+	}
+
+	new_change->existed = (change != FSWC_ADDED);
+	new_change->removed = (change == FSWC_REMOVED);
+	++changes->count;
+}
+
+/* Frees resources of changes collected by collect_fs_change(). */
+static void
+free_fs_changes(fs_changes_t *changes)
+{
+	int i;
+	for(i = 0; i < changes->count; ++i)
+	{
+		free(changes->list[i].dir);
+		free(changes->list[i].name);
+	}
+	free(changes->list);
+	trie_free(changes->index);
+}
+
+/* Checks whether file list of the view can be updated in place.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+can_apply_fs_changes(const view_t *view)
+{
+	/* Lists that are being loaded or filtered are reloaded to keep their state
+	 * consistent.  So are trees which aren't watched completely or that can lack
+	 * parent nodes of files because of local filter. */
+	if(flist_custom_active(view) && view->custom.type == CV_TREE)
+	{
+		if(view->extra_watches < 0 || !filter_is_empty(&view->local_filter.filter))
+		{
+			return 0;
+		}
+	}
+
+	return !flist_meta_loading(view)
+	    && !view->local_filter.in_progress
+	    && curr_stats.load_stage >= 2;
+}
+
+/* Updates file list of the view according to changes of files without
+ * re-reading the whole directory.  Returns non-zero if the list should be
+ * reloaded instead, otherwise zero is returned. */
+static int
+apply_fs_changes(view_t *view, const fs_changes_t *changes)
+{
+	if(!flist_custom_active(view))
+	{
+		return apply_dir_changes(view, changes);
+	}
+
+	return (view->custom.type == CV_TREE)
+	     ? apply_tree_changes(view, changes)
+	     : apply_custom_changes(view, changes);
+}
+
+/* Implements apply_fs_changes() for regular file lists. */
+static int
+apply_dir_changes(view_t *view, const fs_changes_t *changes)
+{
+	int i, j;
+	int *seen;
+	int npending = 0;
+	dir_entry_t *pending, *entries;
+	char *const curr_name = strdup(get_current_file_name(view));
+
+	/* Let full reload take care of adding and removing ".." entry. */
+	if(view->list_rows == 0 ||
+			(view->list_rows == 1 && is_parent_dir(view->dir_entry[0].name)))
+	{
+		free(curr_name);
+		return 1;
+	}
+
+	seen = calloc(changes->count + 1, sizeof(*seen));
+	pending = reallocarray(NULL, changes->count + 1, sizeof(*pending));
+	entries = dynarray_extend(NULL, view->list_rows*sizeof(*entries));
+	if(curr_name == NULL || seen == NULL || pending == NULL || entries == NULL)
+	{
+		free(curr_name);
+		free(seen);
+		free(pending);
+		dynarray_free(entries);
+		return 1;
+	}
+
+	/* Update or remove entries of changed files that are in the list, everything
+	 * else is moved to the new list as is. */
+	j = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		char full_path[PATH_MAX + 1];
+		void *data;
+		int idx;
+
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		if(trie_get(changes->index, full_path, &data) != 0 ||
+				is_parent_dir(entry->name))
+		{
+			entries[j++] = *entry;
+			continue;
+		}
+
+		idx = (intptr_t)data;
+		seen[idx] = 1;
+
+		if(changes->list[idx].removed || refresh_entry(view, entry) != 0)
+		{
+			drop_entry(view, entry);
+			continue;
+		}
+
+		pending[npending++] = *entry;
+	}
+
+	/* Create entries for files that weren't in the list. */
+	for(i = 0; i < changes->count; ++i)
+	{
+		const fs_change_t *const change = &changes->list[i];
+		dir_entry_t *const entry = &pending[npending];
+
+		if(seen[i])
+		{
+			continue;
+		}
+
+		/* File that existed, but wasn't in the list, was filtered out. */
+		if(change->existed && view->filtered > 0)
+		{
+			--view->filtered;
+		}
+
+		if(change->removed)
+		{
+			continue;
+		}
+
+		init_dir_entry(view, entry, change->name);
+		entry->meta_missing = FMETA_ALL;
+		if(entry->name == NULL || refresh_entry(view, entry) != 0)
+		{
+			fentry_free(view, entry);
+			continue;
+		}
+
+		++npending;
+	}
+
+	dynarray_free(view->dir_entry);
+	view->dir_entry = entries;
+	view->list_rows = j;
+
+	insert_entries(view, pending, npending);
+
+	if(view->list_rows == 0)
+	{
+		/* Need to add ".." or leave the directory. */
+		free(curr_name);
+		free(seen);
+		free(pending);
+		return 1;
+	}
+
+	/* Keep cursor on the same file if it's still there. */
+	i = fpos_find_by_name(view, curr_name);
+	if(i >= 0)
+	{
+		view->list_pos = i;
+	}
+	fpos_ensure_valid_pos(view);
+
+	free(curr_name);
+	free(seen);
+	free(pending);
+	return 0;
+}
+
+/* Re-reads metadata of the entry.  Returns non-zero if the entry should be
+ * removed from the list (file is gone or got filtered out), otherwise zero is
+ * returned. */
+static int
+refresh_entry(view_t *view, dir_entry_t *entry)
+{
+	char full_path[PATH_MAX + 1];
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	entry->meta_missing = FMETA_ALL;
+	if(fentry_load_meta(entry, full_path, flist_meta_needed(view)) != 0)
+	{
+		return 1;
+	}
+
+	if(!file_is_visible(view, entry->name, fentry_is_dir(entry), NULL, 1))
+	{
+		++view->filtered;
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Frees the entry that's being removed from the list of the view updating
+ * counters of the view. */
+static void
+drop_entry(view_t *view, dir_entry_t *entry)
+{
+	view->selected_files -= (entry->selected != 0);
+	view->matches -= (entry->search_match != 0);
+	fentry_free(view, entry);
+}
+
+/* Adds entries to the list of the view keeping it sorted.  Entries are moved
+ * into the view. */
+static void
+insert_entries(view_t *view, dir_entry_t entries[], int count)
+{
+	/* Each binary insertion moves part of the list, so many new entries are
+	 * appended at once and the whole list is sorted instead. */
+	enum { MAX_INSERTIONS = 64 };
+
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		int pos;
+		dir_entry_t *const entry = alloc_dir_entry(&view->dir_entry,
+				view->list_rows);
+		if(entry == NULL)
+		{
+			fentry_free(view, &entries[i]);
+			continue;
+		}
+
+		if(count > MAX_INSERTIONS)
+		{
+			*entry = entries[i];
+			++view->list_rows;
+			continue;
+		}
+
+		pos = sort_find_pos(view, &entries[i]);
+		memmove(&view->dir_entry[pos + 1], &view->dir_entry[pos],
+				sizeof(*view->dir_entry)*(view->list_rows - pos));
+		view->dir_entry[pos] = entries[i];
+		++view->list_rows;
+	}
+
+	if(count > MAX_INSERTIONS)
+	{
+		sort_view(view);
+	}
+}
+
+/* Implements apply_fs_changes() for custom views other than tree views.  Files
+ * are never added to such views, only updated or removed. */
+static int
+apply_custom_changes(view_t *view, const fs_changes_t *changes)
+{
+	int i;
+	int nmarked = 0;
+	char curr_path[PATH_MAX + 1];
+	char *const marked = calloc(view->list_rows + 1, sizeof(*marked));
+	if(marked == NULL)
+	{
+		return 1;
+	}
+
+	get_current_full_path(view, sizeof(curr_path), curr_path);
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		char full_path[PATH_MAX + 1];
+		void *data;
+
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		if(trie_get(changes->index, full_path, &data) != 0 ||
+				is_parent_dir(entry->name))
+		{
+			continue;
+		}
+
+		if(changes->list[(intptr_t)data].removed || refresh_entry(view, entry) != 0)
+		{
+			marked[i] = 1;
+			++nmarked;
+		}
+	}
+
+	if(nmarked != 0)
+	{
+		/* Same as reloading custom view does it. */
+		(void)zap_entries(view, view->dir_entry, &view->list_rows, &is_not_marked,
+				marked, 0, 0);
+		flist_sel_recount(view);
+	}
+	free(marked);
+
+	if(!cv_unsorted(view->custom.type))
+	{
+		sort_view(view);
+	}
+
+	(void)set_position_by_path(view, curr_path);
+	fpos_ensure_valid_pos(view);
+	return 0;
+}
+
+/* Implements apply_fs_changes() for tree views.  Only subtrees of changed files
+ * are rebuilt, the rest of the tree is left intact. */
+static int
+apply_tree_changes(view_t *view, const fs_changes_t *changes)
+{
+	int i;
+	int nmarked = 0, ninserted = 0, nfiltered = 0;
+	const char *last_dir = NULL;
+	int last_dir_pos = -1, last_dir_found = 0;
+	char curr_path[PATH_MAX + 1];
+	char *const marked = calloc(view->list_rows + 1, sizeof(*marked));
+	int *const seen = calloc(changes->count + 1, sizeof(*seen));
+	if(marked == NULL || seen == NULL)
+	{
+		free(marked);
+		free(seen);
+		return 1;
+	}
+
+	get_current_full_path(view, sizeof(curr_path), curr_path);
+
+	/* Update entries of changed files and mark removed ones. */
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		char full_path[PATH_MAX + 1];
+		void *data;
+		int idx, was_dir;
+
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		if(trie_get(changes->index, full_path, &data) != 0 ||
+				is_parent_dir(entry->name))
+		{
+			continue;
+		}
+
+		idx = (intptr_t)data;
+		seen[idx] = 1;
+
+		was_dir = (entry->type == FT_DIR);
+		if(changes->list[idx].removed || refresh_entry(view, entry) != 0)
+		{
+			marked[i] = 1;
+			++nmarked;
+		}
+		else if((entry->type == FT_DIR) != was_dir)
+		{
+			/* File was replaced by a directory or vice versa, build it anew. */
+			marked[i] = 1;
+			++nmarked;
+			seen[idx] = 0;
+		}
+	}
+
+	if(nmarked != 0)
+	{
+		(void)zap_entries(view, view->dir_entry, &view->list_rows, &is_not_marked,
+				marked, 1, 1);
+	}
+	free(marked);
+
+	/* Add subtrees of files that weren't in the tree. */
+	for(i = 0; i < changes->count; ++i)
+	{
+		const fs_change_t *const change = &changes->list[i];
+		dir_entry_t *block;
+		int count, filtered;
+
+		if(seen[i])
+		{
+			continue;
+		}
+
+		/* File that existed, but wasn't in the tree, was filtered out. */
+		if(change->existed && view->filtered > 0)
+		{
+			--view->filtered;
+		}
+
+		if(change->removed)
+		{
+			continue;
+		}
+
+		/* Changes come grouped by directories, so remember the last one. */
+		if(last_dir == NULL || stroscmp(last_dir, change->dir) != 0)
+		{
+			last_dir = change->dir;
+			last_dir_found = (find_tree_dir(view, last_dir, &last_dir_pos) == 0);
+		}
+
+		/* Directory that isn't in the tree has nothing to add to. */
+		if(!last_dir_found)
+		{
+			continue;
+		}
+
+		filtered = build_tree_block(view, change->dir, change->name, &block,
+				&count);
+		if(filtered < 0)
+		{
+			free(seen);
+			return 1;
+		}
+
+		nfiltered += filtered;
+		insert_tree_block(view, last_dir_pos, block, count);
+		ninserted += count;
+		dynarray_free(block);
+	}
+	free(seen);
+
+	if(ninserted != 0)
+	{
+		(void)zap_entries(view, view->dir_entry, &view->list_rows,
+				&is_not_extra_leaf, NULL, 1, 0);
+	}
+
+	/* Let full reload take care of empty tree. */
+	if(view->list_rows == 0 ||
+			(view->list_rows == 1 && is_parent_dir(view->dir_entry[0].name)))
+	{
+		return 1;
+	}
+
+	view->filtered += nfiltered;
+	flist_sel_recount(view);
+	sort_view(view);
+
+	(void)set_position_by_path(view, curr_path);
+	fpos_ensure_valid_pos(view);
+	return 0;
+}
+
+/* Looks up directory of a tree view by its path.  *pos is set to -1 for root
+ * of the tree.  Returns zero on success, otherwise non-zero is returned. */
+static int
+find_tree_dir(const view_t *view, const char path[], int *pos)
+{
+	int i;
+
+	if(stroscmp(path, flist_get_dir(view)) == 0)
+	{
+		*pos = -1;
+		return 0;
+	}
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		const dir_entry_t *const entry = &view->dir_entry[i];
+		char full_path[PATH_MAX + 1];
+
+		if(entry->type != FT_DIR || is_parent_dir(entry->name))
+		{
+			continue;
+		}
+
+		get_full_path_of(entry, sizeof(full_path), full_path);
+		if(stroscmp(full_path, path) == 0)
+		{
+			*pos = i;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* Builds list of entries of a tree view for a file and whole its subtree if
+ * it's a directory.  New directories are watched for changes.  Returns number
+ * of filtered out files on success and negative value on error. */
+static int
+build_tree_block(view_t *view, const char dir[], const char name[],
+		dir_entry_t **block, int *count)
+{
+	int nfiltered;
+
+	/* Entries are built by the same code that builds whole tree, which puts
+	 * them into custom list. */
+	dir_entry_t *const entries = view->custom.entries;
+	const int entry_count = view->custom.entry_count;
+	trie_t *const paths_cache = view->custom.paths_cache;
+
+	view->custom.paths_cache = trie_create();
+	if(view->custom.paths_cache == NULL)
+	{
+		view->custom.paths_cache = paths_cache;
+		return -1;
+	}
+	view->custom.entries = NULL;
+	view->custom.entry_count = 0;
+
+	nfiltered = add_tree_file(view, dir, name, view->custom.excluded_paths, -1);
+
+	*block = view->custom.entries;
+	*count = view->custom.entry_count;
+
+	trie_free(view->custom.paths_cache);
+	view->custom.paths_cache = paths_cache;
+	view->custom.entries = entries;
+	view->custom.entry_count = entry_count;
+
+	if(nfiltered < 0)
+	{
+		free_dir_entries(view, block, count);
+		return -1;
+	}
+
+	watch_origins(view, *block, *count);
+	return nfiltered;
+}
+
+/* Moves entries of a subtree into the tree view as the last children of node
+ * at parent_pos (-1 means root of the tree). */
+static void
+insert_tree_block(view_t *view, int parent_pos, dir_entry_t block[], int count)
+{
+	int i, pos;
+	dir_entry_t *new_list;
+
+	const int at = (parent_pos < 0)
+	             ? view->list_rows
+	             : parent_pos + view->dir_entry[parent_pos].child_count + 1;
+
+	if(count == 0)
+	{
+		return;
+	}
+
+	new_list = dynarray_extend(view->dir_entry, count*sizeof(*new_list));
+	if(new_list == NULL)
+	{
+		for(i = 0; i < count; ++i)
+		{
+			fentry_free(view, &block[i]);
+		}
+		return;
+	}
+	view->dir_entry = new_list;
+
+	memmove(&new_list[at + count], &new_list[at],
+			sizeof(*new_list)*(view->list_rows - at));
+	memcpy(&new_list[at], block, sizeof(*new_list)*count);
+	view->list_rows += count;
+
+	/* Attach top nodes of the subtree to the parent. */
+	for(i = 0; i < count && parent_pos >= 0; i += block[i].child_count + 1)
+	{
+		new_list[at + i].child_pos = (at + i) - parent_pos;
+	}
+
+	/* Update counts of all parents and positions of their siblings that were
+	 * shifted. */
+	pos = parent_pos;
+	while(pos >= 0)
+	{
+		int sibling, last, up;
+		dir_entry_t *const dir = &new_list[pos];
+
+		dir->child_count += count;
+		if(dir->child_pos == 0)
+		{
+			break;
+		}
+
+		up = pos - dir->child_pos;
+		/* Child count of the parent doesn't include new entries yet. */
+		last = up + new_list[up].child_count + count;
+		for(sibling = pos + dir->child_count + 1; sibling <= last;
+				sibling += new_list[sibling].child_count + 1)
+		{
+			new_list[sibling].child_pos += count;
+		}
+
+		pos = up;
+	}
+
+	if(view->list_pos >= at)
+	{
+		view->list_pos += count;
+	}
+}
+
+/* zap_entries() filter that keeps entries which weren't marked in an array
+ * passed in arg.  Returns non-zero for entries to keep, otherwise zero is
+ * returned. */
+static int
+is_not_marked(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	const char *const marked = arg;
+	/* Entries are filtered before they are moved within the list. */
+	return !marked[entry - view->dir_entry];
+}
+
+/* zap_entries() filter that drops ".." leaves of tree directories that got
+ * other children.  Returns non-zero for entries to keep, otherwise zero is
+ * returned. */
+static int
+is_not_extra_leaf(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	const dir_entry_t *const next = entry + 1;
+
+	if(!is_parent_dir(entry->name) || entry->child_pos == 0)
+	{
+		return 1;
+	}
+
+	/* Leaf is the only child of a directory until new children are added after
+	 * it. */
+	return next == view->dir_entry + view->list_rows
+	    || next->child_pos != entry->child_pos + 1;
+}
+
 /* Checks whether tree-view needs a reload (any of subdirectories were changed).
  * Returns non-zero if so, otherwise zero is returned. */
 static int
@@ -3215,22 +4493,100 @@ set_view_path(view_t *view, const char path[])
 {
 	if(view_needs_cd(view, path))
 	{
-		copy_str(view->curr_dir, sizeof(view->curr_dir), path);
-		exclude_file_name(view->curr_dir);
+		copy_str(view->curr_dir, sizeof(view->curr_dir), path);
+		exclude_file_name(view->curr_dir);
+	}
+}
+
+uint64_t
+fentry_get_size(const view_t *view, const dir_entry_t *entry)
+{
+	uint64_t size = DCACHE_UNKNOWN;
+
+	if(fentry_is_dir(entry))
+	{
+		fentry_get_dir_info(view, entry, &size, NULL);
+	}
+
+	if(size == DCACHE_UNKNOWN)
+	{
+		fentry_ensure_meta(entry, FMETA_SIZE);
+		size = entry->size;
+	}
+	return size;
+}
+
+const char *
+fentry_get_target(const dir_entry_t *entry)
+{
+	char full_path[PATH_MAX + 1];
+	char target[PATH_MAX + 1];
+	void *data;
+	link_target_t *rec;
+
+	if(entry->type != FT_LINK)
+	{
+		return NULL;
+	}
+
+	/* Replaced or changed link has different metadata, which is updated on
+	 * reload. */
+	fentry_ensure_meta(entry, FMETA_MTIME | FMETA_INODE);
+	get_full_path_of(entry, sizeof(full_path), full_path);
+
+	if(trie_get(link_targets, full_path, &data) != 0)
+	{
+		data = NULL;
+	}
+
+	rec = data;
+	if(rec != NULL && rec->mtime == entry->mtime
+#ifndef _WIN32
+			&& rec->inode == entry->inode
+#endif
+			)
+	{
+		return rec->target;
+	}
+
+	if(get_link_target(full_path, target, sizeof(target)) != 0)
+	{
+		return NULL;
+	}
+
+	if(link_targets == NULL)
+	{
+		link_targets = trie_create();
+	}
+
+	rec = malloc(sizeof(*rec) + strlen(target) + 1U);
+	if(rec == NULL)
+	{
+		return NULL;
 	}
-}
 
-uint64_t
-fentry_get_size(const view_t *view, const dir_entry_t *entry)
-{
-	uint64_t size = DCACHE_UNKNOWN;
+	rec->mtime = entry->mtime;
+#ifndef _WIN32
+	rec->inode = entry->inode;
+#endif
+	rec->target = (char *)(rec + 1);
+	strcpy(rec->target, target);
 
-	if(fentry_is_dir(entry))
+	if(trie_set(link_targets, full_path, rec) < 0)
 	{
-		fentry_get_dir_info(view, entry, &size, NULL);
+		free(rec);
+		return NULL;
 	}
 
-	return (size == DCACHE_UNKNOWN ? entry->size : size);
+	free(data);
+	return rec->target;
+}
+
+void
+flist_free_link_targets(void)
+{
+	trie_free_with_data(link_targets, &free);
+	link_targets = NULL;
 }
 
 int
@@ -3686,7 +5042,9 @@ make_tree(view_t *view, const char path[], int reload, trie_t *excluded_paths)
 	}
 	else
 	{
-		nfiltered = add_files_recursively(view, path, excluded_paths, -1, 0);
+		nfiltered = (cfg.stat_threads > 1)
+		          ? add_files_in_parallel(view, path, excluded_paths)
+		          : add_files_recursively(view, path, excluded_paths, -1, 0);
 		type = CV_TREE;
 	}
 	ui_cancellation_disable();
@@ -3878,6 +5236,78 @@ drop_tops(view_t *view, dir_entry_t *entries, int *nentries, int extra)
 	}
 }
 
+/* Adds custom view entry for a file at path/name and its subtree if it's a
+ * directory.  parent_pos is negative if there is no parent entry.  Returns
+ * number of filtered out files on success or partial success and negative
+ * value on serious error. */
+static int
+add_tree_file(view_t *view, const char path[], const char name[],
+		trie_t *excluded_paths, int parent_pos)
+{
+	int dir;
+	void *dummy;
+	dir_entry_t *entry;
+	int nfiltered = 0;
+	char *const full_path = format_str("%s/%s", path, name);
+
+	if(trie_get(excluded_paths, full_path, &dummy) == 0)
+	{
+		free(full_path);
+		return 0;
+	}
+
+	dir = is_dir(full_path);
+	if(!file_is_visible(view, name, dir, NULL, 1))
+	{
+		/* Traverse directory (but not symlink to it) even if we're skipping it,
+		 * because we might need files that are inside of it. */
+		if(dir && !is_symlink(full_path) &&
+				file_is_visible(view, name, dir, NULL, 0))
+		{
+			nfiltered += add_files_recursively(view, full_path, excluded_paths,
+					parent_pos, 1);
+		}
+
+		free(full_path);
+		return nfiltered + 1;
+	}
+
+	entry = flist_custom_add(view, full_path);
+	if(entry == NULL)
+	{
+		free(full_path);
+		return -1;
+	}
+
+	if(parent_pos >= 0)
+	{
+		entry->child_pos = (view->custom.entry_count - 1) - parent_pos;
+	}
+
+	/* Not using dir variable here, because it is set for symlinks to
+	 * directories as well. */
+	if(entry->type == FT_DIR)
+	{
+		const int idx = view->custom.entry_count - 1;
+		const int filtered = add_files_recursively(view, full_path,
+				excluded_paths, idx, 0);
+		/* Keep going in case of error and load partial list. */
+		if(filtered >= 0)
+		{
+			/* If one of recursive calls returned error, keep going and build
+			 * partial tree. */
+			view->custom.entries[idx].child_count = (view->custom.entry_count - 1)
+			                                      - idx;
+			nfiltered += filtered;
+		}
+	}
+
+	free(full_path);
+
+	show_progress("Building tree...", 1000);
+	return nfiltered;
+}
+
 /* Adds custom view entries corresponding to file system tree.  parent_pos is
  * expected to be negative for the outermost invocation.  Returns number of
  * filtered out files on success or partial success and negative value on
@@ -3899,80 +5329,358 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 
 	for(i = 0; i < len && !ui_cancellation_requested(); ++i)
 	{
-		int dir;
-		void *dummy;
-		dir_entry_t *entry;
-		char *const full_path = format_str("%s/%s", path, lst[i]);
+		const int filtered = add_tree_file(view, path, lst[i], excluded_paths,
+				parent_pos);
+		if(filtered < 0)
+		{
+			free_string_array(lst, len);
+			return -1;
+		}
+
+		nfiltered += filtered;
+	}
 
-		if(trie_get(excluded_paths, full_path, &dummy) == 0)
+	free_string_array(lst, len);
+
+	/* The prev_count != 0 check is to make sure that we won't create leaf instead
+	 * of the whole tree (this is handled in flist_custom_finish()). */
+	if(!no_direct_parent && prev_count != 0 &&
+			view->custom.entry_count == prev_count)
+	{
+		/* To be able to perform operations inside directory (e.g., create files),
+		 * we need at least one element there. */
+		if(add_directory_leaf(view, path, parent_pos) != 0)
 		{
-			free(full_path);
-			continue;
+			return -1;
+		}
+	}
+
+	return nfiltered;
+}
+
+/* Same as add_files_recursively() for the outermost invocation, but lists
+ * directories using several threads.  Result is the same as when done
+ * serially. */
+static int
+add_files_in_parallel(view_t *view, const char path[], trie_t *excluded_paths)
+{
+	int nfiltered;
+	walk_dir_t *root;
+	walk_job_t job = { .view = view, .excluded_paths = excluded_paths };
+
+	if(walk_job_init(&job) != 0)
+	{
+		return add_files_recursively(view, path, excluded_paths, -1, 0);
+	}
+
+	root = walk_push_dir(&job, path);
+	if(root == NULL)
+	{
+		walk_job_free(&job);
+		return -1;
+	}
+
+	/* Current thread takes part in walking as well. */
+	workers_wait(job.workers);
+	walk_job_free(&job);
+
+	/* Nodes are added to the view in the same order in which serial walk adds
+	 * them. */
+	nfiltered = ui_cancellation_requested()
+	          ? 0
+	          : assemble_tree(view, root, -1, 0);
+	walk_dir_free(view, root);
+	return nfiltered;
+}
+
+/* Initializes synchronization primitives and threads of the job.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+walk_job_init(walk_job_t *job)
+{
+	job->main_thread = pthread_self();
+	if(pthread_mutex_init(&job->filter_lock, NULL) != 0)
+	{
+		return 1;
+	}
+	if(pthread_mutex_init(&job->lock, NULL) != 0)
+	{
+		pthread_mutex_destroy(&job->filter_lock);
+		return 1;
+	}
+	job->workers = workers_create(cfg.stat_threads - 1, &walk_dir_task, job);
+	if(job->workers == NULL)
+	{
+		pthread_mutex_destroy(&job->lock);
+		pthread_mutex_destroy(&job->filter_lock);
+		return 1;
+	}
+	return 0;
+}
+
+/* Frees threads and synchronization primitives of the job. */
+static void
+walk_job_free(walk_job_t *job)
+{
+	workers_free(job->workers);
+	pthread_mutex_destroy(&job->lock);
+	pthread_mutex_destroy(&job->filter_lock);
+}
+
+/* Lists a pending directory unless walking is cancelled.  Main thread also
+ * reports progress. */
+static void
+walk_dir_task(void *task, void *arg)
+{
+	enum { PROGRESS_PERIOD = 1000 };
+
+	walk_dir_t *const dir = task;
+	walk_job_t *const job = arg;
+	int nfiles;
+
+	if(ui_cancellation_requested())
+	{
+		return;
+	}
+
+	if(pthread_equal(pthread_self(), job->main_thread))
+	{
+		pthread_mutex_lock(&job->lock);
+		nfiles = job->nfiles;
+		pthread_mutex_unlock(&job->lock);
+
+		if(nfiles - job->reported >= PROGRESS_PERIOD)
+		{
+			char msg[64];
+			snprintf(msg, sizeof(msg), "Building tree... %d", nfiles);
+			show_progress(msg, 1);
+			job->reported = nfiles;
 		}
+	}
+
+	walk_list_dir(job, dir);
+
+	pthread_mutex_lock(&job->lock);
+	job->nfiles += dir->nitems + dir->nfiltered;
+	pthread_mutex_unlock(&job->lock);
+}
+
+/* Lists files of the directory scheduling its subdirectories for listing. */
+static void
+walk_list_dir(walk_job_t *job, walk_dir_t *dir)
+{
+	int i;
+	int len;
+	char **lst = list_all_files(dir->path, &len);
+	if(len < 0)
+	{
+		dir->failed = 1;
+		return;
+	}
+
+	for(i = 0; i < len && !ui_cancellation_requested(); ++i)
+	{
+		if(walk_add_file(job, dir, lst[i]) != 0)
+		{
+			dir->failed = 1;
+			break;
+		}
+	}
+
+	free_string_array(lst, len);
+}
+
+/* Processes single file of a directory in the same way add_tree_file() does.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+walk_add_file(walk_job_t *job, walk_dir_t *dir, const char name[])
+{
+	int is_a_dir, visible, traverse;
+	void *dummy;
+	walk_item_t *item;
+	char canonic_path[PATH_MAX + 1];
+	char *const full_path = format_str("%s/%s", dir->path, name);
+
+	if(trie_get(job->excluded_paths, full_path, &dummy) == 0)
+	{
+		free(full_path);
+		return 0;
+	}
+
+	is_a_dir = is_dir(full_path);
+
+	/* Matchers of filters aren't meant to be used concurrently. */
+	pthread_mutex_lock(&job->filter_lock);
+	visible = file_is_visible(job->view, name, is_a_dir, NULL, 1);
+	traverse = !visible && is_a_dir
+	        && file_is_visible(job->view, name, is_a_dir, NULL, 0);
+	pthread_mutex_unlock(&job->filter_lock);
+
+	if(!visible)
+	{
+		++dir->nfiltered;
 
-		dir = is_dir(full_path);
-		if(!file_is_visible(view, lst[i], dir, NULL, 1))
+		/* Traverse directory (but not symlink to it) even if we're skipping it,
+		 * because we might need files that are inside of it. */
+		if(traverse && !is_symlink(full_path))
 		{
-			/* Traverse directory (but not symlink to it) even if we're skipping it,
-			 * because we might need files that are inside of it. */
-			if(dir && !is_symlink(full_path) &&
-					file_is_visible(view, lst[i], dir, NULL, 0))
+			item = walk_add_item(dir, -1);
+			if(item == NULL || (item->dir = walk_push_dir(job, full_path)) == NULL)
 			{
-				nfiltered += add_files_recursively(view, full_path, excluded_paths,
-						parent_pos, 1);
+				free(full_path);
+				return 1;
 			}
+		}
+
+		free(full_path);
+		return 0;
+	}
+
+	to_canonic_path(full_path, flist_get_dir(job->view), canonic_path,
+			sizeof(canonic_path));
+	if(entry_list_add(job->view, &dir->entries, &dir->nentries,
+				canonic_path) == NULL)
+	{
+		free(full_path);
+		return 1;
+	}
+
+	item = walk_add_item(dir, dir->nentries - 1);
+	if(item == NULL)
+	{
+		free(full_path);
+		return 1;
+	}
 
+	if(dir->entries[dir->nentries - 1].type == FT_DIR)
+	{
+		item->dir = walk_push_dir(job, full_path);
+		if(item->dir == NULL)
+		{
 			free(full_path);
-			++nfiltered;
+			return 1;
+		}
+	}
+
+	free(full_path);
+	return 0;
+}
+
+/* Appends item to the directory.  Returns pointer to the item or NULL on
+ * error. */
+static walk_item_t *
+walk_add_item(walk_dir_t *dir, int entry)
+{
+	walk_item_t *const items = reallocarray(dir->items, dir->nitems + 1,
+			sizeof(*items));
+	if(items == NULL)
+	{
+		return NULL;
+	}
+
+	dir->items = items;
+	items[dir->nitems].entry = entry;
+	items[dir->nitems].dir = NULL;
+	return &items[dir->nitems++];
+}
+
+/* Schedules directory at the path for listing.  Returns the directory or NULL
+ * on error. */
+static walk_dir_t *
+walk_push_dir(walk_job_t *job, const char path[])
+{
+	walk_dir_t *const dir = calloc(1, sizeof(*dir));
+	if(dir == NULL)
+	{
+		return NULL;
+	}
+
+	dir->path = strdup(path);
+	if(dir->path == NULL)
+	{
+		free(dir);
+		return NULL;
+	}
+
+	if(workers_push(job->workers, dir) != 0)
+	{
+		free(dir->path);
+		free(dir);
+		return NULL;
+	}
+
+	return dir;
+}
+
+/* Moves entries of the listed directory and its subdirectories into custom
+ * list of the view.  Parameters and return value are the same as for
+ * add_files_recursively(). */
+static int
+assemble_tree(view_t *view, walk_dir_t *dir, int parent_pos,
+		int no_direct_parent)
+{
+	int i;
+	const int prev_count = view->custom.entry_count;
+	int nfiltered = dir->nfiltered;
+
+	for(i = 0; i < dir->nitems; ++i)
+	{
+		const walk_item_t *const item = &dir->items[i];
+		dir_entry_t *entry;
+		char full_path[PATH_MAX + 1];
+		int idx;
+
+		if(item->entry < 0)
+		{
+			nfiltered += assemble_tree(view, item->dir, parent_pos, 1);
 			continue;
 		}
 
-		entry = flist_custom_add(view, full_path);
+		/* Don't add duplicates. */
+		get_full_path_of(&dir->entries[item->entry], sizeof(full_path), full_path);
+		if(trie_put(view->custom.paths_cache, full_path) != 0)
+		{
+			return -1;
+		}
+
+		entry = alloc_dir_entry(&view->custom.entries, view->custom.entry_count);
 		if(entry == NULL)
 		{
-			free(full_path);
-			free_string_array(lst, len);
 			return -1;
 		}
 
+		*entry = dir->entries[item->entry];
+		dir->entries[item->entry].name = NULL;
+		dir->entries[item->entry].origin = NULL;
+
+		idx = view->custom.entry_count++;
 		if(parent_pos >= 0)
 		{
-			entry->child_pos = (view->custom.entry_count - 1) - parent_pos;
+			entry->child_pos = idx - parent_pos;
 		}
 
-		/* Not using dir variable here, because it is set for symlinks to
-		 * directories as well. */
-		if(entry->type == FT_DIR)
+		if(item->dir != NULL)
 		{
-			const int idx = view->custom.entry_count - 1;
-			const int filtered = add_files_recursively(view, full_path,
-					excluded_paths, idx, 0);
+			const int filtered = assemble_tree(view, item->dir, idx, 0);
 			/* Keep going in case of error and load partial list. */
 			if(filtered >= 0)
 			{
-				/* If one of recursive calls returned error, keep going and build
-				 * partial tree. */
 				view->custom.entries[idx].child_count = (view->custom.entry_count - 1)
 				                                      - idx;
 				nfiltered += filtered;
 			}
 		}
-
-		free(full_path);
-
-		show_progress("Building tree...", 1000);
 	}
 
-	free_string_array(lst, len);
+	if(dir->failed)
+	{
+		return -1;
+	}
 
-	/* The prev_count != 0 check is to make sure that we won't create leaf instead
-	 * of the whole tree (this is handled in flist_custom_finish()). */
 	if(!no_direct_parent && prev_count != 0 &&
 			view->custom.entry_count == prev_count)
 	{
-		/* To be able to perform operations inside directory (e.g., create files),
-		 * we need at least one element there. */
-		if(add_directory_leaf(view, path, parent_pos) != 0)
+		if(add_directory_leaf(view, dir->path, parent_pos) != 0)
 		{
 			return -1;
 		}
@@ -3981,6 +5689,29 @@ add_files_recursively(view_t *view, const char path[], trie_t *excluded_paths,
 	return nfiltered;
 }
 
+/* Frees listing of the directory along with listings of its subdirectories.
+ * dir can be NULL. */
+static void
+walk_dir_free(view_t *view, walk_dir_t *dir)
+{
+	int i;
+
+	if(dir == NULL)
+	{
+		return;
+	}
+
+	for(i = 0; i < dir->nitems; ++i)
+	{
+		walk_dir_free(view, dir->items[i].dir);
+	}
+	free(dir->items);
+
+	free_dir_entries(view, &dir->entries, &dir->nentries);
+	free(dir->path);
+	free(dir);
+}
+
 /* Checks whether file is visible according to dot and filename filters.  is_dir
  * is used when data is NULL, otherwise data_is_dir_entry() called (this is an
  * optimization).  Returns non-zero if so, otherwise zero is returned. */
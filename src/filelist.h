@@ -20,14 +20,17 @@
 #ifndef VIFM__FILELIST_H__
 #define VIFM__FILELIST_H__
 
-#include <sys/types.h> /* ssize_t */
+#include <sys/types.h> /* gid_t ino_t mode_t ssize_t uid_t */
 
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
+#include <time.h> /* time_t */
 
 #include "ui/ui.h"
 #include "utils/test_helpers.h"
 
+struct stat;
+
 /* Type of filter function for zapping list of entries.  Should return non-zero
  * if entry is to be kept and zero otherwise. */
 typedef int (*zap_filter)(view_t *view, const dir_entry_t *entry, void *arg);
@@ -116,6 +119,11 @@ void flist_custom_start(view_t *view, const char title[]);
 /* Adds an entry to custom list of files.  Returns pointer to just added entry
  * or NULL on error. */
 dir_entry_t * flist_custom_add(view_t *view, const char path[]);
+/* Same as flist_custom_add(), but reuses lstat() information about the file
+ * instead of querying it.  Returns pointer to just added entry or NULL on
+ * error. */
+dir_entry_t * flist_custom_add_stat(view_t *view, const char path[],
+		const struct stat *st);
 /* Puts an entry to custom list of files, contents of the entry gets stolen.
  * Returns pointer to just added entry or NULL on error. */
 dir_entry_t * flist_custom_put(view_t *view, dir_entry_t *entry);
@@ -123,6 +131,13 @@ dir_entry_t * flist_custom_put(view_t *view, dir_entry_t *entry);
 void flist_custom_add_spec(view_t *view, const char line[]);
 /* Appends entry separator to the list with specified id. */
 void flist_custom_add_separator(view_t *view, int id);
+/* Adds files specified by lines of the form accepted by flist_custom_add_spec()
+ * to custom view that's already displayed.  Paths found in the seen trie are
+ * skipped, others are added to it.  The list stays filtered and sorted and
+ * cursor stays on the same file.  Returns number of files added to the
+ * list. */
+int flist_custom_extend(view_t *view, char *lines[], int nlines,
+		struct trie_t *seen);
 /* Finishes file list population, handles empty resulting list corner case.
  * Non-zero allow_empty makes a single-entry (..) view instead of aborting.
  * Returns zero on success, otherwise (on empty list) non-zero is returned. */
@@ -183,6 +198,13 @@ void set_view_path(view_t *view, const char path[]);
 /* Retrieves size of the entry, possibly using cached or calculated value.
  * Returns the size. */
 uint64_t fentry_get_size(const view_t *view, const dir_entry_t *entry);
+/* Retrieves target of a symbolic link reading it only if the link changed since
+ * the last call.  Returns pointer, which is valid until the link changes or
+ * either of views changes its location, or NULL if entry isn't a link or its
+ * target can't be read. */
+const char * fentry_get_target(const dir_entry_t *entry);
+/* Frees all targets of links cached by fentry_get_target(). */
+void flist_free_link_targets(void);
 /* Loads pointer to the next selected entry in file list of the view.  *entry
  * should be NULL for the first call and result of previous call otherwise.
  * Returns zero when there is no more entries to supply, otherwise non-zero is
@@ -271,6 +293,31 @@ dir_entry_t * entry_list_add(view_t *view, dir_entry_t **list, int *list_size,
 void free_dir_entries(view_t *view, dir_entry_t **entries, int *count);
 /* Frees single directory entry. */
 void fentry_free(const view_t *view, dir_entry_t *entry);
+/* Fills metadata fields of the entry (all except name and origin) with
+ * information about file at the path.  meta is a set of FMETA_* flags that
+ * limits which fields need to be loaded, other fields might be left intact.
+ * Doesn't depend on current working directory and can be called from any
+ * thread.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int fentry_load_meta(dir_entry_t *entry, const char path[], int meta);
+/* Loads those of metadata fields of the entry specified by meta (set of
+ * FMETA_* flags) which weren't loaded yet.  Does nothing for entries which are
+ * being loaded in background. */
+void fentry_ensure_meta(const dir_entry_t *entry, int meta);
+/* Accessors of metadata of entries, which load corresponding field if it's
+ * missing.  Use these instead of reading fields of dir_entry_t directly.  Each
+ * returns value of the field. */
+uint64_t fentry_get_raw_size(const dir_entry_t *entry);
+time_t fentry_get_mtime(const dir_entry_t *entry);
+time_t fentry_get_atime(const dir_entry_t *entry);
+time_t fentry_get_ctime(const dir_entry_t *entry);
+#ifndef _WIN32
+uid_t fentry_get_uid(const dir_entry_t *entry);
+gid_t fentry_get_gid(const dir_entry_t *entry);
+mode_t fentry_get_mode(const dir_entry_t *entry);
+ino_t fentry_get_inode(const dir_entry_t *entry);
+int fentry_get_nlinks(const dir_entry_t *entry);
+#endif
 /* Adds parent directory entry (..) to filelist. */
 void add_parent_dir(view_t *view);
 /* Changes name of a file entry, performing additional required updates. */
@@ -0,0 +1,882 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "flist_meta.h"
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* abs() calloc() free() malloc() */
+#include <string.h> /* strdup() */
+
+#include "cfg/config.h"
+#include "compat/fs_limits.h"
+#include "compat/pthread.h"
+#include "engine/mode.h"
+#include "modes/modes.h"
+#include "ui/column_view.h"
+#include "ui/ui.h"
+#include "utils/macros.h"
+#include "utils/path.h"
+#include "utils/str.h"
+#include "utils/string_array.h"
+#include "utils/workers.h"
+#include "background.h"
+#include "filelist.h"
+#include "flist_pos.h"
+#include "flist_sel.h"
+
+/* Minimal number of entries for which metadata is loaded in background. */
+#define ASYNC_THRESHOLD 4096
+
+/* Number of entries processed by background loader between publishing its
+ * results. */
+#define BATCH_SIZE 256
+
+/* Flags returned by apply_batches(). */
+enum
+{
+	AF_UPDATED    = 1 << 0, /* Some entries were updated. */
+	AF_DIR_STATUS = 1 << 1, /* Some entries changed whether they are dirs. */
+	AF_FAILED     = 1 << 2, /* Metadata of some entries couldn't be loaded. */
+};
+
+/* Value of meta_idx field of entries whose metadata couldn't be loaded in
+ * background, such entries are removed right after applying metadata. */
+#define META_FAILED (-2)
+
+/* Portion of metadata loaded in background. */
+typedef struct meta_batch_t
+{
+	int first;                       /* Index of the first entry in the batch. */
+	int count;                       /* Number of entries in the batch. */
+	dir_entry_t entries[BATCH_SIZE]; /* Entries holding loaded metadata. */
+	char loaded[BATCH_SIZE];         /* Whether loading of each entry
+	                                    succeeded. */
+	struct meta_batch_t *next;       /* Next batch in the queue. */
+}
+meta_batch_t;
+
+/* State of background metadata loader.  Shared between a view and a background
+ * job, which is why it's reference counted. */
+typedef struct meta_loader_t
+{
+	pthread_mutex_t lock; /* Protects fields below it. */
+	int refs;             /* Number of owners. */
+	int stop;             /* Whether loading should be stopped. */
+	int finished;         /* Whether background job is done. */
+	meta_batch_t *head;   /* First loaded batch which wasn't applied yet. */
+	meta_batch_t *tail;   /* Last loaded batch which wasn't applied yet. */
+
+	/* These fields aren't changed after the job is started. */
+	char *dir;    /* Path to directory being loaded. */
+	char **names; /* Names of entries to load. */
+	int count;    /* Number of elements in the names array. */
+	int threads;  /* Number of threads to query metadata with. */
+	int meta;     /* Set of FMETA_* flags of metadata to load. */
+
+	/* This field is accessed only by the thread that owns the view. */
+	int applied; /* Number of entries which were applied to the view. */
+}
+meta_loader_t;
+
+/* Loading of metadata of a set of entries which can be shared by several
+ * threads. */
+typedef struct
+{
+	dir_entry_t *entries;  /* Entries to fill in. */
+	char *loaded;          /* Whether loading of each entry succeeded. */
+	int count;             /* Number of elements in entries and loaded. */
+	int meta;              /* Set of FMETA_* flags of metadata to load. */
+	const char *dir;       /* Directory of entries or NULL to use their origins. */
+	char **names;          /* Names of entries when dir isn't NULL. */
+	meta_loader_t *loader; /* Loader to check for cancellation or NULL. */
+	bg_op_t *bg_op;        /* Background operation or NULL. */
+	int next;              /* Index of the next entry to be processed (updated
+	                          atomically). */
+}
+stat_job_t;
+
+static void load_sync(view_t *view);
+static workers_t * get_sync_workers(void);
+static int start_async(view_t *view, int count);
+static void loader_release(meta_loader_t *loader);
+static void load_meta_task(bg_op_t *bg_op, void *arg);
+static int should_stop(meta_loader_t *loader, bg_op_t *bg_op);
+static workers_t * make_stat_workers(int threads, int count);
+static void run_stat_job(stat_job_t *job, workers_t *workers);
+static void stat_task(void *task, void *arg);
+static void stat_entries(stat_job_t *job);
+static void publish_batch(meta_loader_t *loader, meta_batch_t *batch,
+		int finished);
+static int apply_batches(dir_entry_t *entries, int count, meta_batch_t **map,
+		int first, int last);
+static void copy_meta(dir_entry_t *to, const dir_entry_t *from);
+static void remove_failed(view_t *view);
+static int is_not_failed(view_t *view, const dir_entry_t *entry, void *arg);
+static void reset_pending(dir_entry_t *entries, int count);
+static int sorting_depends_on_meta(const view_t *view);
+
+/* Threads that query metadata for synchronous loading.  Loading happens only
+ * in the main thread, which keeps them from being used concurrently. */
+static workers_t *sync_workers;
+/* Value of 'statthreads' for which sync_workers were started. */
+static int sync_threads;
+
+void
+flist_meta_load(view_t *view)
+{
+	int i;
+	int count = 0;
+	const int lazy = (cfg.lazy_stat && flist_meta_needed(view) == FMETA_NONE);
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		if(entry->meta_idx < 0)
+		{
+			continue;
+		}
+
+		if(lazy && entry->type != FT_LINK && entry->type != FT_UNK)
+		{
+			/* Type reported by readdir() is enough, everything else is loaded on
+			 * first access. */
+			entry->meta_idx = -1;
+			continue;
+		}
+
+		++count;
+	}
+
+	if(count >= ASYNC_THRESHOLD && start_async(view, count) == 0)
+	{
+		return;
+	}
+
+	load_sync(view);
+}
+
+/* Loads metadata of all entries that miss it right away.  Entries that can't
+ * be queried are removed. */
+static void
+load_sync(view_t *view)
+{
+	int i, j;
+	stat_job_t job = {
+		.entries = view->dir_entry,
+		.count = view->list_rows,
+		.meta = flist_meta_needed(view),
+	};
+
+	job.loaded = malloc(job.count);
+	if(job.loaded == NULL && job.count != 0)
+	{
+		return;
+	}
+
+	run_stat_job(&job, get_sync_workers());
+
+	j = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+
+		if(entry->meta_idx >= 0)
+		{
+			entry->meta_idx = -1;
+			if(!job.loaded[i])
+			{
+				fentry_free(view, entry);
+				continue;
+			}
+		}
+
+		if(i != j)
+		{
+			view->dir_entry[j] = *entry;
+		}
+		++j;
+	}
+
+	view->list_rows = j;
+	free(job.loaded);
+}
+
+/* Retrieves threads for synchronous loading, which are started on first use
+ * and restarted when 'statthreads' changes.  Returns the threads or NULL. */
+static workers_t *
+get_sync_workers(void)
+{
+	if(sync_threads != cfg.stat_threads)
+	{
+		flist_meta_free_threads();
+		sync_workers = make_stat_workers(cfg.stat_threads, cfg.stat_threads);
+		sync_threads = cfg.stat_threads;
+	}
+	return sync_workers;
+}
+
+void
+flist_meta_free_threads(void)
+{
+	workers_free(sync_workers);
+	sync_workers = NULL;
+	sync_threads = 0;
+}
+
+/* Starts loading metadata in background for count entries of the view.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+start_async(view_t *view, int count)
+{
+	int i, j;
+	meta_loader_t *loader = malloc(sizeof(*loader));
+	if(loader == NULL)
+	{
+		return 1;
+	}
+
+	loader->dir = strdup(flist_get_dir(view));
+	loader->names = calloc(count, sizeof(*loader->names));
+	loader->count = count;
+	if(loader->dir == NULL || loader->names == NULL)
+	{
+		free(loader->dir);
+		free(loader->names);
+		free(loader);
+		return 1;
+	}
+
+	/* Number entries in the order in which they are loaded. */
+	j = 0;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		dir_entry_t *const entry = &view->dir_entry[i];
+		if(entry->meta_idx >= 0)
+		{
+			entry->meta_idx = j;
+			loader->names[j++] = strdup(entry->name);
+		}
+	}
+
+	if(pthread_mutex_init(&loader->lock, NULL) != 0)
+	{
+		free_string_array(loader->names, count);
+		free(loader->dir);
+		free(loader);
+		return 1;
+	}
+
+	loader->refs = 2;
+	loader->threads = cfg.stat_threads;
+	loader->meta = flist_meta_needed(view);
+	loader->stop = 0;
+	loader->finished = 0;
+	loader->head = NULL;
+	loader->tail = NULL;
+	loader->applied = 0;
+
+	if(bg_execute("Loading metadata", loader->dir, count, 0, &load_meta_task,
+				loader) != 0)
+	{
+		loader->refs = 1;
+		loader_release(loader);
+		return 1;
+	}
+
+	view->meta_loader = loader;
+	return 0;
+}
+
+int
+flist_meta_loading(const view_t *view)
+{
+	return (view->meta_loader != NULL);
+}
+
+int
+flist_meta_apply(view_t *view)
+{
+	meta_loader_t *const loader = view->meta_loader;
+	meta_batch_t *batches, *batch;
+	meta_batch_t **map;
+	int finished, first, last, nbatches;
+	int changed;
+	int resort;
+
+	if(loader == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	batches = loader->head;
+	loader->head = NULL;
+	loader->tail = NULL;
+	finished = loader->finished;
+	pthread_mutex_unlock(&loader->lock);
+
+	/* Batches are published in order and all of them except for the last one are
+	 * full, which makes it easy to map index of an entry to its batch. */
+	nbatches = 0;
+	first = loader->applied;
+	last = first;
+	for(batch = batches; batch != NULL; batch = batch->next)
+	{
+		last = batch->first + batch->count;
+		++nbatches;
+	}
+
+	changed = 0;
+	resort = 0;
+	map = (nbatches == 0) ? NULL : malloc(sizeof(*map)*nbatches);
+	if(map != NULL)
+	{
+		int flags;
+		int i = 0;
+		for(batch = batches; batch != NULL; batch = batch->next)
+		{
+			map[i++] = batch;
+		}
+
+		flags = apply_batches(view->dir_entry, view->list_rows, map, first, last);
+		(void)apply_batches(view->local_filter.unfiltered,
+				view->local_filter.unfiltered_count, map, first, last);
+		free(map);
+
+		changed = (flags & AF_UPDATED);
+		resort = (flags & AF_DIR_STATUS) || sorting_depends_on_meta(view);
+
+		/* Synchronous loading doesn't list such entries either. */
+		if(flags & AF_FAILED)
+		{
+			remove_failed(view);
+		}
+	}
+	loader->applied = last;
+
+	while(batches != NULL)
+	{
+		meta_batch_t *const next = batches->next;
+		free(batches);
+		batches = next;
+	}
+
+	if(finished)
+	{
+		flist_meta_drop(view);
+		changed = 1;
+	}
+
+	if(!changed)
+	{
+		return 0;
+	}
+
+	/* Don't reorder entries while they are being selected by index. */
+	if(resort && !vle_mode_is(VISUAL_MODE))
+	{
+		resort_dir_list(0, view);
+	}
+	ui_view_schedule_redraw(view);
+	return 1;
+}
+
+/* Applies metadata for entries in the [first; last) range to corresponding
+ * elements of the entries array marking those that failed to load with
+ * META_FAILED.  Returns combination of AF_* flags. */
+static int
+apply_batches(dir_entry_t *entries, int count, meta_batch_t **map, int first,
+		int last)
+{
+	int i;
+	int flags = 0;
+
+	for(i = 0; i < count; ++i)
+	{
+		dir_entry_t *const entry = &entries[i];
+		const int idx = entry->meta_idx;
+		const meta_batch_t *batch;
+
+		if(idx < first || idx >= last)
+		{
+			continue;
+		}
+
+		batch = map[(idx - first)/BATCH_SIZE];
+		if(batch->loaded[idx - batch->first])
+		{
+			const int was_dir = fentry_is_dir(entry);
+			copy_meta(entry, &batch->entries[idx - batch->first]);
+			if(fentry_is_dir(entry) != was_dir)
+			{
+				flags |= AF_DIR_STATUS;
+			}
+			entry->meta_idx = -1;
+		}
+		else
+		{
+			entry->meta_idx = META_FAILED;
+			flags |= AF_FAILED;
+		}
+		flags |= AF_UPDATED;
+	}
+
+	return flags;
+}
+
+/* Copies loaded metadata fields from one entry to another. */
+static void
+copy_meta(dir_entry_t *to, const dir_entry_t *from)
+{
+	const int loaded = FMETA_ALL & ~from->meta_missing;
+
+	if(to->type != from->type)
+	{
+		/* Highlighting and decorations depend on type. */
+		to->hi_num = -1;
+		to->name_dec_num = -1;
+	}
+
+	if(loaded & FMETA_SIZE)
+	{
+		to->size = from->size;
+	}
+#ifndef _WIN32
+	if(loaded & FMETA_OWNER)
+	{
+		to->uid = from->uid;
+		to->gid = from->gid;
+	}
+	if(loaded & FMETA_MODE)
+	{
+		to->mode = from->mode;
+	}
+	if(loaded & FMETA_INODE)
+	{
+		to->inode = from->inode;
+	}
+#else
+	to->attrs = from->attrs;
+#endif
+	if(loaded & FMETA_MTIME)
+	{
+		to->mtime = from->mtime;
+	}
+	if(loaded & FMETA_ATIME)
+	{
+		to->atime = from->atime;
+	}
+	if(loaded & FMETA_CTIME)
+	{
+		to->ctime = from->ctime;
+	}
+	if(loaded & FMETA_NLINK)
+	{
+		to->nlinks = from->nlinks;
+	}
+	to->type = from->type;
+	to->dir_link = from->dir_link;
+	to->meta_missing &= from->meta_missing;
+}
+
+/* Removes entries whose metadata couldn't be loaded. */
+static void
+remove_failed(view_t *view)
+{
+	int count = view->local_filter.unfiltered_count;
+	(void)zap_entries(view, view->local_filter.unfiltered, &count,
+			&is_not_failed, NULL, 1, 0);
+	view->local_filter.unfiltered_count = count;
+
+	(void)zap_entries(view, view->dir_entry, &view->list_rows, &is_not_failed,
+			NULL, 0, 0);
+
+	fpos_ensure_valid_pos(view);
+	flist_sel_recount(view);
+}
+
+/* zap_entries() filter to filter-out entries whose metadata couldn't be
+ * loaded.  Returns non-zero if entry is to be kept and zero otherwise. */
+static int
+is_not_failed(view_t *view, const dir_entry_t *entry, void *arg)
+{
+	return (entry->meta_idx != META_FAILED);
+}
+
+int
+flist_meta_cancel(view_t *view)
+{
+	meta_loader_t *const loader = view->meta_loader;
+	if(loader == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&loader->lock);
+	loader->stop = 1;
+	pthread_mutex_unlock(&loader->lock);
+	return 1;
+}
+
+void
+flist_meta_drop(view_t *view)
+{
+	meta_loader_t *const loader = view->meta_loader;
+	if(loader == NULL)
+	{
+		return;
+	}
+
+	(void)flist_meta_cancel(view);
+	view->meta_loader = NULL;
+	loader_release(loader);
+
+	reset_pending(view->dir_entry, view->list_rows);
+	reset_pending(view->local_filter.unfiltered,
+			view->local_filter.unfiltered_count);
+}
+
+/* Marks all entries as not waiting for metadata anymore. */
+static void
+reset_pending(dir_entry_t *entries, int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		entries[i].meta_idx = -1;
+	}
+}
+
+/* Drops reference to the loader freeing it when the last one is gone. */
+static void
+loader_release(meta_loader_t *loader)
+{
+	int refs;
+
+	pthread_mutex_lock(&loader->lock);
+	refs = --loader->refs;
+	pthread_mutex_unlock(&loader->lock);
+
+	if(refs != 0)
+	{
+		return;
+	}
+
+	while(loader->head != NULL)
+	{
+		meta_batch_t *const next = loader->head->next;
+		free(loader->head);
+		loader->head = next;
+	}
+
+	pthread_mutex_destroy(&loader->lock);
+	free_string_array(loader->names, loader->count);
+	free(loader->dir);
+	free(loader);
+}
+
+/* Entry point of background job that queries file system for metadata. */
+static void
+load_meta_task(bg_op_t *bg_op, void *arg)
+{
+	meta_loader_t *const loader = arg;
+	int i;
+
+	/* Threads are started once and are fed with entries of each batch. */
+	workers_t *const workers = make_stat_workers(loader->threads,
+			MIN(BATCH_SIZE, loader->count));
+
+	for(i = 0; i < loader->count; i += BATCH_SIZE)
+	{
+		int j;
+		stat_job_t job = {
+			.count = MIN(BATCH_SIZE, loader->count - i),
+			.meta = loader->meta,
+			.dir = loader->dir,
+			.names = &loader->names[i],
+			.loader = loader,
+			.bg_op = bg_op,
+		};
+		meta_batch_t *const batch = malloc(sizeof(*batch));
+
+		if(batch == NULL || should_stop(loader, bg_op))
+		{
+			free(batch);
+			break;
+		}
+
+		batch->first = i;
+		batch->count = job.count;
+		batch->next = NULL;
+		for(j = 0; j < batch->count; ++j)
+		{
+			dir_entry_t *const entry = &batch->entries[j];
+			entry->type = FT_UNK;
+			entry->dir_link = 0;
+			entry->meta_missing = FMETA_ALL;
+			entry->meta_idx = i + j;
+		}
+
+		job.entries = batch->entries;
+		job.loaded = batch->loaded;
+		run_stat_job(&job, workers);
+
+		publish_batch(loader, batch, 0);
+
+		bg_op_lock(bg_op);
+		bg_op->done = i + batch->count;
+		bg_op_unlock(bg_op);
+		bg_op_changed(bg_op);
+	}
+
+	workers_free(workers);
+
+	publish_batch(loader, NULL, 1);
+	loader_release(loader);
+}
+
+/* Checks whether background loading should be stopped.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+should_stop(meta_loader_t *loader, bg_op_t *bg_op)
+{
+	int stop;
+
+	pthread_mutex_lock(&loader->lock);
+	stop = loader->stop;
+	pthread_mutex_unlock(&loader->lock);
+
+	return stop || bg_op_cancelled(bg_op);
+}
+
+/* Makes batch available for applying.  batch can be NULL.  finished flag
+ * specifies whether this is the last batch. */
+static void
+publish_batch(meta_loader_t *loader, meta_batch_t *batch, int finished)
+{
+	pthread_mutex_lock(&loader->lock);
+	if(batch != NULL)
+	{
+		if(loader->tail == NULL)
+		{
+			loader->head = batch;
+		}
+		else
+		{
+			loader->tail->next = batch;
+		}
+		loader->tail = batch;
+	}
+	loader->finished = finished;
+	pthread_mutex_unlock(&loader->lock);
+}
+
+/* Starts threads for querying metadata of sets of up to count entries.  The
+ * current thread is one of the workers, so there is one thread less than
+ * specified.  Returns the threads or NULL. */
+static workers_t *
+make_stat_workers(int threads, int count)
+{
+	threads = MIN(threads, count);
+	return (threads > 1) ? workers_create(threads - 1, &stat_task, NULL) : NULL;
+}
+
+/* Queries metadata of entries of the job using the threads, which can be NULL.
+ * Entries are distributed among threads dynamically, but each result is stored
+ * at index of its entry, so the outcome doesn't depend on number of
+ * threads. */
+static void
+run_stat_job(stat_job_t *job, workers_t *workers)
+{
+	job->next = 0;
+
+	if(workers != NULL)
+	{
+		int i;
+		const int n = MIN(workers_count(workers), job->count - 1);
+		for(i = 0; i < n; ++i)
+		{
+			if(workers_append(workers, job) != 0)
+			{
+				break;
+			}
+		}
+	}
+
+	stat_entries(job);
+
+	/* Entries might still be processed by other threads. */
+	if(workers != NULL)
+	{
+		workers_wait(workers);
+	}
+}
+
+/* Processes entries of the job passed in as a task. */
+static void
+stat_task(void *task, void *arg)
+{
+	stat_entries(task);
+}
+
+/* Processes entries of the job until there are none left. */
+static void
+stat_entries(stat_job_t *job)
+{
+	while(1)
+	{
+		char full_path[PATH_MAX + 1];
+		dir_entry_t *entry;
+
+		const int i = __sync_fetch_and_add(&job->next, 1);
+		if(i >= job->count)
+		{
+			break;
+		}
+
+		entry = &job->entries[i];
+		job->loaded[i] = 0;
+
+		if(job->loader != NULL && should_stop(job->loader, job->bg_op))
+		{
+			continue;
+		}
+
+		if(job->dir == NULL)
+		{
+			if(entry->meta_idx < 0)
+			{
+				job->loaded[i] = 1;
+				continue;
+			}
+			get_full_path_of(entry, sizeof(full_path), full_path);
+		}
+		else
+		{
+			const char *const slash = ends_with_slash(job->dir) ? "" : "/";
+			snprintf(full_path, sizeof(full_path), "%s%s%s", job->dir, slash,
+					job->names[i]);
+		}
+
+		job->loaded[i] = (fentry_load_meta(entry, full_path, job->meta) == 0);
+	}
+}
+
+int
+flist_meta_needed(const view_t *view)
+{
+	int i;
+	int meta = FMETA_NONE;
+
+	/* Filters match names of files and whether they are directories, which is
+	 * known without querying metadata. */
+
+	for(i = 0; i < SK_COUNT; ++i)
+	{
+		const int key = abs(view->sort[i]);
+		if(key > SK_LAST)
+		{
+			break;
+		}
+		meta |= flist_meta_of_key(key);
+	}
+
+	if(view->columns != NULL)
+	{
+		const size_t count = columns_count(view->columns);
+		size_t j;
+		for(j = 0; j < count; ++j)
+		{
+			meta |= flist_meta_of_key(columns_get_column_id(view->columns, j));
+		}
+	}
+
+	return meta;
+}
+
+int
+flist_meta_of_key(int key)
+{
+	switch(key)
+	{
+		case SK_BY_SIZE:
+			/* Cached sizes of directories are validated using modification time. */
+			return FMETA_SIZE | FMETA_MTIME;
+		case SK_BY_NITEMS:
+			return FMETA_MTIME;
+		case SK_BY_TIME_ACCESSED:
+			return FMETA_ATIME;
+		case SK_BY_TIME_CHANGED:
+			return FMETA_CTIME;
+		case SK_BY_TIME_MODIFIED:
+			return FMETA_MTIME;
+#ifndef _WIN32
+		case SK_BY_GROUP_ID:
+		case SK_BY_GROUP_NAME:
+		case SK_BY_OWNER_ID:
+		case SK_BY_OWNER_NAME:
+			return FMETA_OWNER;
+		case SK_BY_MODE:
+		case SK_BY_PERMISSIONS:
+			return FMETA_MODE;
+		case SK_BY_NLINKS:
+			return FMETA_NLINK;
+		case SK_BY_INODE:
+			return FMETA_INODE;
+#endif
+
+		default:
+			return FMETA_NONE;
+	}
+}
+
+/* Checks whether sorting of the view might change after metadata of its
+ * entries is updated.  Returns non-zero if so, otherwise zero is returned. */
+static int
+sorting_depends_on_meta(const view_t *view)
+{
+	int i;
+	for(i = 0; i < SK_COUNT; ++i)
+	{
+		const int key = abs(view->sort[i]);
+		if(key > SK_LAST)
+		{
+			break;
+		}
+
+		switch(key)
+		{
+			case SK_BY_NAME:
+			case SK_BY_INAME:
+			case SK_BY_DIR:
+			case SK_BY_EXTENSION:
+			case SK_BY_FILEEXT:
+			case SK_BY_GROUPS:
+				/* These depend only on name and type of an entry. */
+				break;
+
+			default:
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,70 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__FLIST_META_H__
+#define VIFM__FLIST_META_H__
+
+/* This unit loads metadata of file list entries.  Entries of a file list are
+ * first created from names and types reported by readdir() and their metadata
+ * (sizes, times, modes, etc.) is then filled in either right away or in
+ * background for large directories.  Only metadata needed to display and sort
+ * entries is loaded this way, the rest is fetched on first use. */
+
+struct view_t;
+
+/* Fills in metadata of entries of the view which have it missing (their
+ * meta_idx field isn't negative).  Might do it synchronously or start a
+ * background job depending on number of such entries.  Entries for which
+ * loading fails are removed from the list either right away or when metadata
+ * is applied. */
+void flist_meta_load(struct view_t *view);
+
+/* Checks whether background loading of metadata is in progress for the view.
+ * Returns non-zero if so, otherwise zero is returned. */
+int flist_meta_loading(const struct view_t *view);
+
+/* Applies metadata loaded in background since the last call, re-sorts the view
+ * if necessary and schedules its redraw.  Should be called periodically.
+ * Returns non-zero if anything has changed, otherwise zero is returned. */
+int flist_meta_apply(struct view_t *view);
+
+/* Requests background loader of the view to stop.  Metadata loaded so far is
+ * applied.  Returns non-zero if there was a loader to stop, otherwise zero is
+ * returned. */
+int flist_meta_cancel(struct view_t *view);
+
+/* Computes which metadata of entries is necessary to display and sort entries
+ * of the view.  Returns set of FMETA_* flags. */
+int flist_meta_needed(const struct view_t *view);
+
+/* Determines which metadata of entries is needed for sorting key or column with
+ * the specified id.  Returns set of FMETA_* flags. */
+int flist_meta_of_key(int key);
+
+/* Stops background loader of the view discarding its results.  Safe to call if
+ * no loader is active. */
+void flist_meta_drop(struct view_t *view);
+
+/* Stops threads that are kept for synchronous loading of metadata.  They are
+ * started again on demand. */
+void flist_meta_free_threads(void);
+
+#endif /* VIFM__FLIST_META_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -438,7 +438,7 @@ fpos_find_group(const view_t *view, int next)
 	regmatch_t pmatch = { .rm_so = 0, .rm_eo = 0 };
 #ifndef _WIN32
 	char perms[16];
-	get_perm_string(perms, sizeof(perms), pentry->mode);
+	get_perm_string(perms, sizeof(perms), fentry_get_mode(pentry));
 #endif
 	if(sorting_key == SK_BY_GROUPS)
 	{
@@ -489,21 +489,9 @@ fpos_find_group(const view_t *view, int next)
 				if(nentry->type == FT_LINK)
 				{
 					/* Both entries are symbolic links. */
-					char full_path[PATH_MAX + 1];
-					char nlink[PATH_MAX + 1], plink[PATH_MAX + 1];
-
-					get_full_path_of(nentry, sizeof(full_path), full_path);
-					if(get_link_target(full_path, nlink, sizeof(nlink)) != 0)
-					{
-						return pos;
-					}
-					get_full_path_of(pentry, sizeof(full_path), full_path);
-					if(get_link_target(full_path, plink, sizeof(plink)) != 0)
-					{
-						return pos;
-					}
-
-					if(stroscmp(nlink, plink) != 0)
+					const char *const nlink = fentry_get_target(nentry);
+					const char *const plink = fentry_get_target(pentry);
+					if(nlink == NULL || plink == NULL || stroscmp(nlink, plink) != 0)
 					{
 						return pos;
 					}
@@ -518,7 +506,7 @@ fpos_find_group(const view_t *view, int next)
 					return pos;
 				break;
 			case SK_BY_SIZE:
-				if(nentry->size != pentry->size)
+				if(fentry_get_raw_size(nentry) != fentry_get_raw_size(pentry))
 					return pos;
 				break;
 			case SK_BY_NITEMS:
@@ -526,15 +514,15 @@ fpos_find_group(const view_t *view, int next)
 					return pos;
 				break;
 			case SK_BY_TIME_ACCESSED:
-				if(nentry->atime != pentry->atime)
+				if(fentry_get_atime(nentry) != fentry_get_atime(pentry))
 					return pos;
 				break;
 			case SK_BY_TIME_CHANGED:
-				if(nentry->ctime != pentry->ctime)
+				if(fentry_get_ctime(nentry) != fentry_get_ctime(pentry))
 					return pos;
 				break;
 			case SK_BY_TIME_MODIFIED:
-				if(nentry->mtime != pentry->mtime)
+				if(fentry_get_mtime(nentry) != fentry_get_mtime(pentry))
 					return pos;
 				break;
 			case SK_BY_DIR:
@@ -552,26 +540,26 @@ fpos_find_group(const view_t *view, int next)
 #ifndef _WIN32
 			case SK_BY_GROUP_NAME:
 			case SK_BY_GROUP_ID:
-				if(nentry->gid != pentry->gid)
+				if(fentry_get_gid(nentry) != fentry_get_gid(pentry))
 					return pos;
 				break;
 			case SK_BY_OWNER_NAME:
 			case SK_BY_OWNER_ID:
-				if(nentry->uid != pentry->uid)
+				if(fentry_get_uid(nentry) != fentry_get_uid(pentry))
 					return pos;
 				break;
 			case SK_BY_MODE:
-				if(nentry->mode != pentry->mode)
+				if(fentry_get_mode(nentry) != fentry_get_mode(pentry))
 					return pos;
 				break;
 			case SK_BY_INODE:
-				if(nentry->inode != pentry->inode)
+				if(fentry_get_inode(nentry) != fentry_get_inode(pentry))
 					return pos;
 				break;
 			case SK_BY_PERMISSIONS:
 				{
 					char nperms[16];
-					get_perm_string(nperms, sizeof(nperms), nentry->mode);
+					get_perm_string(nperms, sizeof(nperms), fentry_get_mode(nentry));
 					if(strcmp(nperms, perms) != 0)
 					{
 						return pos;
@@ -579,7 +567,7 @@ fpos_find_group(const view_t *view, int next)
 					break;
 				}
 			case SK_BY_NLINKS:
-				if(nentry->nlinks != pentry->nlinks)
+				if(fentry_get_nlinks(nentry) != fentry_get_nlinks(pentry))
 				{
 					return pos;
 				}
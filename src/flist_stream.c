@@ -0,0 +1,146 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "flist_stream.h"
+
+#include <stdlib.h> /* free() malloc() */
+
+#include "engine/mode.h"
+#include "modes/dialogs/msg_dialog.h"
+#include "modes/modes.h"
+#include "ui/ui.h"
+#include "utils/str.h"
+#include "utils/string_array.h"
+#include "utils/trie.h"
+#include "background.h"
+#include "filelist.h"
+#include "flist_pos.h"
+
+/* State of filling a custom view with output of a command. */
+typedef struct flist_stream_t
+{
+	bg_stream_t *output; /* Output of the command. */
+	trie_t *paths;       /* Paths that were added to the view. */
+}
+flist_stream_t;
+
+int
+flist_stream_start(view_t *view, const char cmd[], int very)
+{
+	char *title;
+
+	flist_stream_t *const stream = malloc(sizeof(*stream));
+	if(stream == NULL)
+	{
+		return 1;
+	}
+
+	stream->output = bg_stream_start("Loading custom view", cmd, 1);
+	stream->paths = trie_create();
+	if(stream->output == NULL || stream->paths == NULL)
+	{
+		bg_stream_free(stream->output);
+		trie_free(stream->paths);
+		free(stream);
+		return 1;
+	}
+
+	title = format_str("!%s", cmd);
+	flist_custom_start(view, title);
+	free(title);
+
+	/* Files are yet to come, so start with an empty list. */
+	(void)flist_custom_finish(view, very ? CV_VERY : CV_REGULAR, 1);
+	fpos_set_pos(view, 0);
+
+	view->custom.stream = stream;
+	return 0;
+}
+
+void
+flist_stream_check(view_t *view)
+{
+	flist_stream_t *const stream = view->custom.stream;
+	char **lines;
+	int nlines;
+	int finished;
+
+	if(stream == NULL)
+	{
+		return;
+	}
+
+	if(!flist_custom_active(view))
+	{
+		/* The view has left custom view, nowhere to put the files. */
+		flist_stream_stop(view);
+		return;
+	}
+
+	/* Don't move entries around while they are being selected or filtered. */
+	if(view->local_filter.in_progress ||
+			(view == curr_view && vle_mode_is(VISUAL_MODE)))
+	{
+		return;
+	}
+
+	/* Query state before fetching to not miss lines read in between. */
+	finished = bg_stream_finished(stream->output);
+
+	lines = bg_stream_fetch(stream->output, &nlines);
+	if(nlines != 0)
+	{
+		(void)flist_custom_extend(view, lines, nlines, stream->paths);
+		ui_view_schedule_redraw(view);
+	}
+	free_string_array(lines, nlines);
+
+	if(finished)
+	{
+		const char *const errors = bg_stream_errors(stream->output);
+
+		/* Detach the stream first as the dialog might check views. */
+		view->custom.stream = NULL;
+		if(!is_null_or_empty(errors))
+		{
+			show_error_msg("Loading custom view", errors);
+		}
+
+		bg_stream_free(stream->output);
+		trie_free(stream->paths);
+		free(stream);
+	}
+}
+
+void
+flist_stream_stop(view_t *view)
+{
+	flist_stream_t *const stream = view->custom.stream;
+	if(stream == NULL)
+	{
+		return;
+	}
+
+	view->custom.stream = NULL;
+	bg_stream_free(stream->output);
+	trie_free(stream->paths);
+	free(stream);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,44 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__FLIST_STREAM_H__
+#define VIFM__FLIST_STREAM_H__
+
+/* This unit fills custom views with output of commands while they are still
+ * running. */
+
+struct view_t;
+
+/* Replaces file list of the view with custom view that is filled with paths
+ * printed by the command as they arrive.  Very flag selects unsorted custom
+ * view.  Returns zero on success, otherwise non-zero is returned. */
+int flist_stream_start(struct view_t *view, const char cmd[], int very);
+
+/* Adds files printed since previous call to custom view of the view and
+ * finishes filling it when the command is done.  Does nothing if the view isn't
+ * being filled. */
+void flist_stream_check(struct view_t *view);
+
+/* Stops filling custom view of the view cancelling the command if it's still
+ * running.  Does nothing if the view isn't being filled. */
+void flist_stream_stop(struct view_t *view);
+
+#endif /* VIFM__FLIST_STREAM_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -19,12 +19,19 @@
 
 #include "fops_misc.h"
 
+#include <sys/stat.h> /* S_ISDIR stat */
 #include <sys/types.h> /* gid_t uid_t */
+#include <dirent.h> /* DIR dirent */
 
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() qsort() */
 #include <string.h> /* strdup() strlen() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/fileview.h"
@@ -37,12 +44,14 @@
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "cmd_completion.h"
 #include "filelist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
 #include "fops_common.h"
 #include "registers.h"
+#include "status.h"
 #include "trash.h"
 #include "undo.h"
 
@@ -54,6 +63,67 @@ typedef struct
 }
 dir_size_args_t;
 
+/* Number of sizes that are put to dcache at once. */
+#define DSIZE_BATCH 64
+
+/* File with several hard links. */
+typedef struct
+{
+	uint64_t dev;  /* Device number. */
+	uint64_t ino;  /* Inode number. */
+	uint64_t size; /* Size of the file. */
+}
+dsize_link_t;
+
+/* Set of files with several hard links sorted by device and inode. */
+typedef struct
+{
+	dsize_link_t *items; /* Elements of the set. */
+	int count;           /* Number of elements in the set. */
+	int capacity;        /* Number of elements that fit into the items. */
+}
+dsize_links_t;
+
+/* Directory whose size is being calculated by fops_dir_size(). */
+typedef struct dsize_node_t dsize_node_t;
+struct dsize_node_t
+{
+	char *path;           /* Path to the directory. */
+	dsize_node_t *parent; /* Parent directory or NULL for the root. */
+	dsize_links_t links;  /* Hard links found in the subtree, which are counted
+	                         once in its size.  Guarded by links_lock. */
+	pthread_mutex_t links_lock; /* Protects links. */
+	uint64_t size;        /* Accumulated size (updated atomically). */
+	int pending;          /* Number of unfinished subdirectories plus one while
+	                         the directory isn't listed (updated atomically). */
+	int incomplete;       /* Whether size misses some parts of the subtree
+	                         because of cancellation (set atomically). */
+	int unreadable;       /* Whether the directory couldn't be listed. */
+	uint64_t mtime;       /* Modification time of the directory. */
+	uint64_t inode;       /* Inode number of the directory. */
+};
+
+/* Sizes of finished directories yet to be put to dcache at once. */
+typedef struct
+{
+	dcache_size_t sizes[DSIZE_BATCH]; /* Sizes of directories. */
+	char *paths[DSIZE_BATCH];         /* Paths owned by the batch. */
+	int count;                        /* Number of elements in both arrays. */
+}
+dsize_batch_t;
+
+/* State of fops_dir_size() that is shared among its threads. */
+typedef struct
+{
+	int force;                          /* Whether to ignore cached sizes. */
+	const cancellation_t *cancellation; /* Cancellation state. */
+	workers_t *workers;                 /* Threads that list directories. */
+	pthread_mutex_t lock;               /* Protects fields below it. */
+	dsize_batch_t batch;                /* Sizes yet to be put to dcache. */
+	uint64_t size;                      /* Size of the root. */
+}
+dsize_job_t;
+
 static int delete_file(dir_entry_t *entry, ops_t *ops, int reg, int use_trash,
 		int nested);
 static const char * get_top_dir(const view_t *view);
@@ -74,6 +144,16 @@ static void dir_size_bg(bg_op_t *bg_op, void *arg);
 static void dir_size(bg_op_t *bg_op, char path[], int force);
 static int bg_cancellation_hook(void *arg);
 static void redraw_after_path_change(view_t *view, const char path[]);
+static void dsize_task(void *task, void *arg);
+static void dsize_list(dsize_job_t *job, dsize_node_t *node);
+static int dsize_push(dsize_job_t *job, dsize_node_t *parent,
+		const char path[]);
+static uint64_t dsize_file_size(const char path[], dsize_links_t *links);
+static uint64_t dsize_sort_links(dsize_links_t *links);
+static int dsize_link_cmp(const void *a, const void *b);
+static uint64_t dsize_merge_links(dsize_node_t *node, dsize_links_t *from);
+static void dsize_finish(dsize_job_t *job, dsize_node_t *node);
+static void dsize_flush(dsize_batch_t *batch);
 #ifndef _WIN32
 static void change_owner_cb(const char new_owner[]);
 static int complete_owner(const char str[], void *arg);
@@ -1173,19 +1253,77 @@ redraw_after_path_change(view_t *view, const char path[])
 uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
+{
+	dsize_job_t job = { .force = force_update, .cancellation = cancellation };
+
+	if(pthread_mutex_init(&job.lock, NULL) != 0)
+	{
+		return 0U;
+	}
+
+	/* Current thread takes part in the calculation as well. */
+	job.workers = workers_create(cfg.stat_threads - 1, &dsize_task, &job);
+	if(job.workers != NULL)
+	{
+		if(dsize_push(&job, NULL, path) == 0)
+		{
+			workers_wait(job.workers);
+		}
+		workers_free(job.workers);
+	}
+	dsize_flush(&job.batch);
+
+	pthread_mutex_destroy(&job.lock);
+
+	return job.size;
+}
+
+/* Lists pending directory.  After cancellation directories are finished without
+ * listing them. */
+static void
+dsize_task(void *task, void *arg)
+{
+	dsize_node_t *const node = task;
+	dsize_job_t *const job = arg;
+
+	if(cancellation_requested(job->cancellation))
+	{
+		node->incomplete = 1;
+	}
+	else
+	{
+		dsize_list(job, node);
+	}
+
+	dsize_finish(job, node);
+}
+
+/* Sums sizes of files of the directory scheduling its subdirectories for
+ * processing unless their size is known. */
+static void
+dsize_list(dsize_job_t *job, dsize_node_t *node)
 {
 	struct dirent *dentry;
 	const char *slash;
-	uint64_t size;
+	struct stat st;
+	uint64_t size = 0U;
+	dsize_links_t links = { .items = NULL, .count = 0, .capacity = 0 };
 
-	DIR *dir = os_opendir(path);
+	DIR *const dir = os_opendir(node->path);
 	if(dir == NULL)
 	{
-		return 0U;
+		node->unreadable = 1;
+		return;
+	}
+
+	/* This information is used to validate size after it's saved. */
+	if(os_stat(node->path, &st) == 0)
+	{
+		node->mtime = st.st_mtime;
+		node->inode = st.st_ino;
 	}
 
-	slash = (ends_with_slash(path) ? "" : "/");
-	size = 0U;
+	slash = (ends_with_slash(node->path) ? "" : "/");
 	while((dentry = os_readdir(dir)) != NULL)
 	{
 		char full_path[PATH_MAX + 1];
@@ -1195,34 +1333,349 @@ fops_dir_size(const char path[], int force_update,
 			continue;
 		}
 
-		snprintf(full_path, sizeof(full_path), "%s%s%s", path, slash,
+		snprintf(full_path, sizeof(full_path), "%s%s%s", node->path, slash,
 				dentry->d_name);
 		if(fops_is_dir_entry(full_path, dentry))
 		{
-			uint64_t dir_size;
-			dcache_get_at(full_path, &dir_size, NULL);
-			if(dir_size == DCACHE_UNKNOWN || force_update)
+			/* Links of a subdirectory whose size is taken from the cache aren't
+			 * known, so such sizes are used only if there are no links. */
+			uint64_t dir_size = DCACHE_UNKNOWN;
+			if(!job->force)
 			{
-				dir_size = fops_dir_size(full_path, force_update, cancellation);
+				dcache_get_linkless_size(full_path, &dir_size);
+			}
+
+			if(dir_size != DCACHE_UNKNOWN)
+			{
+				size += dir_size;
+			}
+			else if(dsize_push(job, node, full_path) != 0)
+			{
+				(void)__sync_fetch_and_or(&node->incomplete, 1);
+				break;
 			}
-			size += dir_size;
 		}
 		else
 		{
-			size += get_file_size(full_path);
+			size += dsize_file_size(full_path, &links);
 		}
 
-		if(cancellation_requested(cancellation))
+		if(cancellation_requested(job->cancellation))
 		{
-			os_closedir(dir);
-			return 0U;
+			(void)__sync_fetch_and_or(&node->incomplete, 1);
+			break;
 		}
 	}
 
 	os_closedir(dir);
 
-	(void)dcache_set_at(path, size, DCACHE_UNKNOWN);
-	return size;
+	/* Sorting the set once is cheaper than keeping it sorted while listing.
+	 * Subdirectories might have been finished already and have links of this
+	 * directory. */
+	size -= dsize_sort_links(&links);
+	size -= dsize_merge_links(node, &links);
+	(void)__sync_fetch_and_add(&node->size, size);
+}
+
+/* Schedules directory for processing.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+dsize_push(dsize_job_t *job, dsize_node_t *parent, const char path[])
+{
+	dsize_node_t *const node = calloc(1, sizeof(*node));
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	node->path = strdup(path);
+	if(node->path == NULL)
+	{
+		free(node);
+		return 1;
+	}
+
+	if(pthread_mutex_init(&node->links_lock, NULL) != 0)
+	{
+		free(node->path);
+		free(node);
+		return 1;
+	}
+
+	node->parent = parent;
+	node->pending = 1;
+	if(parent != NULL)
+	{
+		(void)__sync_fetch_and_add(&parent->pending, 1);
+	}
+
+	if(workers_push(job->workers, node) != 0)
+	{
+		if(parent != NULL)
+		{
+			(void)__sync_fetch_and_sub(&parent->pending, 1);
+		}
+		pthread_mutex_destroy(&node->links_lock);
+		free(node->path);
+		free(node);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Retrieves size of a file remembering files with several hard links in the
+ * set, which isn't sorted by this function.  Returns the size. */
+static uint64_t
+dsize_file_size(const char path[], dsize_links_t *links)
+{
+#ifndef _WIN32
+	struct stat st;
+	dsize_link_t *link;
+
+	if(os_lstat(path, &st) != 0)
+	{
+		return 0U;
+	}
+
+	if(st.st_nlink <= 1 || S_ISDIR(st.st_mode))
+	{
+		return st.st_size;
+	}
+
+	if(links->count == links->capacity)
+	{
+		const int capacity = (links->capacity == 0) ? 16 : links->capacity*2;
+		void *const items = reallocarray(links->items, capacity,
+				sizeof(*links->items));
+		if(items == NULL)
+		{
+			/* The link can't be remembered, so it's just counted. */
+			return st.st_size;
+		}
+		links->items = items;
+		links->capacity = capacity;
+	}
+
+	link = &links->items[links->count++];
+	link->dev = st.st_dev;
+	link->ino = st.st_ino;
+	link->size = st.st_size;
+	return link->size;
+#else
+	return get_file_size(path);
+#endif
+}
+
+/* Sorts the set and removes duplicates from it.  Returns total size of removed
+ * elements. */
+static uint64_t
+dsize_sort_links(dsize_links_t *links)
+{
+	int i, j;
+	uint64_t seen = 0U;
+
+	if(links->count == 0)
+	{
+		return 0U;
+	}
+
+	qsort(links->items, links->count, sizeof(*links->items), &dsize_link_cmp);
+
+	for(i = 1, j = 0; i < links->count; ++i)
+	{
+		if(dsize_link_cmp(&links->items[i], &links->items[j]) == 0)
+		{
+			seen += links->items[i].size;
+		}
+		else
+		{
+			links->items[++j] = links->items[i];
+		}
+	}
+	links->count = j + 1;
+
+	return seen;
+}
+
+/* Orders links by device and inode.  Returns negative number, zero or positive
+ * number like strcmp() does. */
+static int
+dsize_link_cmp(const void *a, const void *b)
+{
+	const dsize_link_t *const x = a;
+	const dsize_link_t *const y = b;
+
+	if(x->dev != y->dev)
+	{
+		return (x->dev < y->dev) ? -1 : 1;
+	}
+	if(x->ino != y->ino)
+	{
+		return (x->ino < y->ino) ? -1 : 1;
+	}
+	return 0;
+}
+
+/* Moves links from a sorted set to links of the node in a single pass over
+ * both sets, the source set is emptied.  Sizes of directories don't depend on
+ * the order in which their parts are processed this way.  Returns total size of
+ * links that were already in the target. */
+static uint64_t
+dsize_merge_links(dsize_node_t *node, dsize_links_t *from)
+{
+	dsize_links_t *const to = &node->links;
+	dsize_link_t *items;
+	int i = 0, j = 0, n = 0;
+	uint64_t seen = 0U;
+
+	if(from->count == 0)
+	{
+		free(from->items);
+		from->items = NULL;
+		from->capacity = 0;
+		return 0U;
+	}
+
+	pthread_mutex_lock(&node->links_lock);
+
+	if(to->count == 0)
+	{
+		free(to->items);
+		*to = *from;
+		pthread_mutex_unlock(&node->links_lock);
+		from->items = NULL;
+		from->count = 0;
+		from->capacity = 0;
+		return 0U;
+	}
+
+	items = reallocarray(NULL, to->count + from->count, sizeof(*items));
+	if(items == NULL)
+	{
+		/* Links that can't be remembered are counted once more at most. */
+		pthread_mutex_unlock(&node->links_lock);
+		free(from->items);
+		from->items = NULL;
+		from->count = 0;
+		from->capacity = 0;
+		return 0U;
+	}
+
+	while(i < to->count || j < from->count)
+	{
+		int cmp;
+		if(i == to->count)
+		{
+			cmp = 1;
+		}
+		else if(j == from->count)
+		{
+			cmp = -1;
+		}
+		else
+		{
+			cmp = dsize_link_cmp(&to->items[i], &from->items[j]);
+		}
+
+		if(cmp < 0)
+		{
+			items[n++] = to->items[i++];
+		}
+		else
+		{
+			if(cmp == 0)
+			{
+				seen += from->items[j].size;
+				++i;
+			}
+			items[n++] = from->items[j++];
+		}
+	}
+
+	free(to->items);
+	to->items = items;
+	to->count = n;
+	to->capacity = n;
+
+	pthread_mutex_unlock(&node->links_lock);
+
+	free(from->items);
+	from->items = NULL;
+	from->count = 0;
+	from->capacity = 0;
+	return seen;
+}
+
+/* Accounts for the directory being processed.  Once all of its subdirectories
+ * are processed as well its size is added to its parent and recorded. */
+static void
+dsize_finish(dsize_job_t *job, dsize_node_t *node)
+{
+	while(node != NULL && __sync_sub_and_fetch(&node->pending, 1) == 0)
+	{
+		dsize_node_t *const parent = node->parent;
+
+		if(node->incomplete || node->unreadable)
+		{
+			free(node->path);
+		}
+		else
+		{
+			dsize_batch_t *const batch = &job->batch;
+
+			pthread_mutex_lock(&job->lock);
+			if(batch->count == DSIZE_BATCH)
+			{
+				dsize_flush(batch);
+			}
+
+			batch->paths[batch->count] = node->path;
+			batch->sizes[batch->count].path = node->path;
+			batch->sizes[batch->count].size = node->size;
+			batch->sizes[batch->count].mtime = node->mtime;
+			batch->sizes[batch->count].inode = node->inode;
+			batch->sizes[batch->count].links = (node->links.count != 0);
+			++batch->count;
+			pthread_mutex_unlock(&job->lock);
+		}
+
+		if(parent == NULL)
+		{
+			/* Root is the last one to finish, so no locking is needed. */
+			job->size = node->incomplete ? 0U : node->size;
+		}
+		else
+		{
+			/* Links shared with other parts of the parent are counted once. */
+			const uint64_t seen = dsize_merge_links(parent, &node->links);
+			(void)__sync_fetch_and_add(&parent->size, node->size - seen);
+			if(node->incomplete)
+			{
+				(void)__sync_fetch_and_or(&parent->incomplete, 1);
+			}
+		}
+
+		pthread_mutex_destroy(&node->links_lock);
+		free(node->links.items);
+		free(node);
+		node = parent;
+	}
+}
+
+/* Puts sizes accumulated in the batch to dcache and empties the batch. */
+static void
+dsize_flush(dsize_batch_t *batch)
+{
+	int i;
+
+	(void)dcache_set_sizes(batch->sizes, batch->count);
+
+	for(i = 0; i < batch->count; ++i)
+	{
+		free(batch->paths[i]);
+	}
+	batch->count = 0;
 }
 
 #ifndef _WIN32
@@ -1259,7 +1712,7 @@ fops_chown(int u, int g, uid_t uid, gid_t gid)
 
 		if(u && perform_operation(OP_CHOWN, ops, V(uid), full_path, NULL) == 0)
 		{
-			add_operation(OP_CHOWN, V(uid), V(entry->uid), full_path, "");
+			add_operation(OP_CHOWN, V(uid), V(fentry_get_uid(entry)), full_path, "");
 		}
 		else
 		{
@@ -1268,7 +1721,7 @@ fops_chown(int u, int g, uid_t uid, gid_t gid)
 
 		if(g && perform_operation(OP_CHGRP, ops, V(gid), full_path, NULL) == 0)
 		{
-			add_operation(OP_CHGRP, V(gid), V(entry->gid), full_path, "");
+			add_operation(OP_CHGRP, V(gid), V(fentry_get_gid(entry)), full_path, "");
 		}
 		else
 		{
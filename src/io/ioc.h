@@ -21,10 +21,14 @@
 
 #include <sys/types.h> /* gid_t mode_t uid_t */
 
+#include <stdint.h> /* uint64_t */
+
 #include "ioe.h"
 
 /* ioc - I/O common - Input/Output common */
 
+struct workers_t;
+
 /* Conflict resolution strategy.  Defines what to do if destination path already
  * exists. */
 typedef enum
@@ -107,10 +111,25 @@ struct io_args_t
 	}
 	arg3;
 
-	union
+	struct
 	{
 		/* Whether try to use O(1) file cloning feature of btrfs. */
 		int fast_file_cloning;
+		/* Whether contents of copied files shouldn't be left in page cache. */
+		int nocache;
+		/* Whether large files should be copied bypassing page cache. */
+		int direct_io;
+		/* Number of threads that copy files of a directory concurrently.  Values
+		 * less than two mean copying one file at a time. */
+		int nthreads;
+		/* Where pool of threads that copy files is kept between operations, pool
+		 * is created there on first use.  NULL means using temporary pool. */
+		struct workers_t **workers;
+		/* Mode of source file obtained by lstat() beforehand or zero if it's
+		 * unknown.  Regular files aren't examined once again. */
+		mode_t src_mode;
+		/* Size of source file obtained along with src_mode. */
+		uint64_t src_size;
 	}
 	arg4;
 
@@ -62,6 +62,16 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow)
 	}
 }
 
+void
+ioeta_plan(ioeta_estim_t *estim, const char path[])
+{
+	if(ioeta_plan_add(estim, path) != 0)
+	{
+		/* Fall back to estimating right away. */
+		ioeta_calculate(estim, path, 0);
+	}
+}
+
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
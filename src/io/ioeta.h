@@ -68,6 +68,9 @@ typedef struct ioeta_estim_t
 
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
+
+	/* Plans of traversing subtrees that are being made in background or NULL. */
+	struct ioeta_plan_t *plan;
 }
 ioeta_estim_t;
 
@@ -82,6 +85,12 @@ void ioeta_free(ioeta_estim_t *estim);
  * directories. */
 void ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow);
 
+/* Same as ioeta_calculate() without shallow flag, but the subtree is traversed
+ * in background and its structure is remembered for ior_cp() to follow instead
+ * of traversing it once again.  This way copying can start right away while
+ * estimates are still being calculated. */
+void ioeta_plan(ioeta_estim_t *estim, const char path[]);
+
 #endif /* VIFM__IO__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -27,16 +27,27 @@
 #ifndef _WIN32
 #include <sys/ioctl.h> /* ioctl() */
 #endif
-#include <sys/stat.h> /* stat */
+#ifdef __linux__
+#include <sys/sendfile.h> /* sendfile() */
+#include <sys/syscall.h> /* __NR_copy_file_range */
+#endif
+#include <sys/stat.h> /* fstat() stat */
+#include <sys/time.h> /* gettimeofday() timeval */
 #include <sys/types.h> /* mode_t */
-#include <unistd.h> /* rmdir() symlink() unlink() */
+#include <fcntl.h> /* F_GETFL F_SETFL O_DIRECT O_NOFOLLOW O_NONBLOCK O_RDONLY
+                      POSIX_FADV_* fcntl() open() posix_fadvise() */
+#include <unistd.h> /* SEEK_DATA SEEK_HOLE close() fdatasync() ftruncate()
+                       lseek() read() rmdir() symlink() syscall() unlink()
+                       write() */
 
 #include <assert.h> /* assert() */
-#include <errno.h> /* EEXIST ENOENT EISDIR errno */
+#include <errno.h> /* EBADF EEXIST EINTR EINVAL ENOENT ENOMEM ENOSYS ENXIO
+                      EISDIR EOPNOTSUPP EXDEV errno */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
-                      fsetpos() fwrite() snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdint.h> /* uint64_t uintptr_t */
+#include <stdio.h> /* FILE fpos_t fclose() fdopen() fgetpos() fflush() fread()
+                      fseek() fsetpos() fwrite() snprintf() */
+#include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strchr() */
 
 #include "../compat/fs_limits.h"
@@ -53,18 +64,78 @@
 #include "private/ioeta.h"
 #include "ioc.h"
 
-/* Amount of data to transfer at once. */
+/* Amount of data to transfer at once through streams. */
 #define BLOCK_SIZE 32*1024
 
+/* Initial amount of data to transfer at once when regular file is copied in
+ * user space. */
+#define MIN_BLOCK_SIZE (64*1024)
+
+/* Largest amount of data to transfer at once in user space. */
+#define MAX_BLOCK_SIZE (8*1024*1024)
+
+/* Amount of data to transfer at once when copying is done by the kernel. */
+#define KERNEL_BLOCK_SIZE (8*1024*1024)
+
+/* Block size is doubled while a block is transferred faster than this and
+ * halved when it takes longer than SLOW_BLOCK_USEC (both are in
+ * microseconds), which keeps progress and cancellation responsive. */
+#define FAST_BLOCK_USEC 50000
+#define SLOW_BLOCK_USEC 500000
+
+/* Files smaller than this are never copied bypassing page cache. */
+#define DIRECT_IO_MIN_SIZE (16*1024*1024)
+
+/* Alignment of buffers, offsets and sizes required by O_DIRECT. */
+#define DIRECT_IO_ALIGNMENT 4096
+
+/* Amount of written data after which it's flushed and dropped from page cache
+ * if that's requested. */
+#define NOCACHE_FLUSH_SIZE (32*1024*1024)
+
 /* Type of io function used by retry_wrapper(). */
 typedef int (*iop_func)(io_args_t *args);
 
+/* State of copying contents of a regular file. */
+typedef struct
+{
+	io_args_t *args;    /* Arguments of the operation. */
+	int dst_fd;         /* Descriptor of destination file. */
+	int src_fd;         /* Descriptor of source file. */
+	uint64_t size;      /* Size of source file. */
+	int direct;         /* Whether descriptors are in O_DIRECT mode. */
+	char *buf_mem;      /* Memory allocated for the buffer or NULL. */
+	char *buf;          /* Buffer for copying in user space (aligned). */
+	size_t buf_size;    /* Size of the buffer. */
+	size_t block_size;  /* Current amount of data to transfer at once in user
+	                       space. */
+	uint64_t unflushed; /* Amount of written data left in page cache. */
+}
+copy_state_t;
+
 static int iop_mkfile_internal(io_args_t *args);
 static int iop_mkdir_internal(io_args_t *args);
 static int iop_rmfile_internal(io_args_t *args);
 static int iop_rmdir_internal(io_args_t *args);
 static int iop_cp_internal(io_args_t *args);
+static FILE * open_planned(const char path[], struct stat *st);
 static int clone_file(int dst_fd, int src_fd);
+static int copy_contents(io_args_t *args, int dst_fd, int src_fd,
+		const struct stat *st);
+static int is_sparse(const struct stat *st);
+static int copy_sparse(copy_state_t *state);
+static int copy_range(copy_state_t *state, uint64_t len);
+static ssize_t copy_block(IoCopyMethod method, int dst_fd, int src_fd,
+		size_t len);
+static ssize_t copy_in_userspace(copy_state_t *state, uint64_t left);
+static int alloc_buffer(copy_state_t *state);
+static int write_block(copy_state_t *state, size_t len);
+static int write_all(int fd, const char buf[], size_t len);
+static void adapt_block_size(copy_state_t *state, long usec);
+static void set_direct(copy_state_t *state, int enable);
+static int toggle_direct(int fd, int enable);
+static void drop_cache(copy_state_t *state);
+static int is_unsupported(int error);
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER transferred, LARGE_INTEGER stream_size,
@@ -74,6 +145,8 @@ static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 static int iop_ln_internal(io_args_t *args);
 static int retry_wrapper(iop_func func, io_args_t *args);
 
+TSTATIC IoCopyMethod iop_cp_method = IO_CM_COPY_FILE_RANGE;
+
 int
 iop_mkfile(io_args_t *args)
 {
@@ -296,13 +369,23 @@ iop_cp_internal(io_args_t *args)
 	size_t nread = (size_t)-1;
 	int error;
 	int cloned;
-	struct stat src_st;
 	const char *open_mode = "wb";
 
 	uint64_t orig_out_size = 0U;
 	int correct_out_size = 0;
 
-	ioeta_update(args->estim, src, dst, 0, 0);
+	/* Regular file that is known from a plan of copying needs no examination
+	 * before opening it as long as it's still a regular file. */
+	int planned = S_ISREG(args->arg4.src_mode);
+
+	if(planned)
+	{
+		ioeta_update_file(args->estim, src, dst, args->arg4.src_size);
+	}
+	else
+	{
+		ioeta_update(args->estim, src, dst, 0, 0);
+	}
 
 #ifdef _WIN32
 	if(is_symlink(src) || crs != IO_CRS_APPEND_TO_FILES)
@@ -352,9 +435,16 @@ iop_cp_internal(io_args_t *args)
 	}
 #endif
 
+	in = NULL;
+	if(planned)
+	{
+		in = open_planned(src, &st);
+		planned = (in != NULL);
+	}
+
 	/* Create symbolic link rather than copying file it points to.  This check
 	 * should go before directory check as is_dir() resolves symbolic links. */
-	if(is_symlink(src))
+	if(!planned && is_symlink(src))
 	{
 		char link_target[PATH_MAX + 1];
 		int error;
@@ -388,14 +478,14 @@ iop_cp_internal(io_args_t *args)
 		return 0;
 	}
 
-	if(is_dir(src))
+	if(!planned && is_dir(src))
 	{
 		(void)ioe_errlst_append(&args->result.errors, src, EISDIR,
 				"Target path specifies existing directory");
 		return 1;
 	}
 
-	if(os_stat(src, &st) != 0)
+	if(!planned && os_stat(src, &st) != 0)
 	{
 		(void)ioe_errlst_append(&args->result.errors, src, errno,
 				"Failed to stat() source file");
@@ -405,13 +495,14 @@ iop_cp_internal(io_args_t *args)
 #ifndef _WIN32
 	/* Fifo/socket/device files don't need to be opened, their content is not
 	 * accessed. */
-	if(S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) || S_ISBLK(st.st_mode) ||
-			S_ISCHR(st.st_mode))
+	if(!planned && (S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode) ||
+				S_ISBLK(st.st_mode) || S_ISCHR(st.st_mode)))
 	{
 		in = NULL;
 	}
 	else
 #endif
+	if(!planned)
 	{
 		in = os_fopen(src, "rb");
 		if(in == NULL)
@@ -533,16 +624,24 @@ iop_cp_internal(io_args_t *args)
 			ioeta_update(args->estim, NULL, NULL, 0, orig_out_size);
 		}
 	}
-	else if(args->arg4.fast_file_cloning)
+	else
 	{
-		if(clone_file(fileno(out), fileno(in)) == 0)
+		if(args->arg4.fast_file_cloning &&
+				clone_file(fileno(out), fileno(in)) == 0)
 		{
 			cloned = 1;
+			/* Progress should match estimation, which doesn't count holes. */
+			ioeta_update(args->estim, NULL, NULL, 0, get_data_size(src, &st));
+		}
+		/* Nothing has been read or written through the streams yet, so their
+		 * descriptors can be used directly. */
+		else if(S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+			error = copy_contents(args, fileno(out), fileno(in), &st);
+			cloned = !error;
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
-
 	if(!error && !cloned)
 	{
 		while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
@@ -609,9 +708,10 @@ iop_cp_internal(io_args_t *args)
 		error = 1;
 	}
 
-	if(error == 0 && os_lstat(src, &src_st) == 0)
+	/* Symbolic links are handled above, so stat() and lstat() agree here. */
+	if(error == 0)
 	{
-		error = os_chmod(dst, src_st.st_mode & 07777);
+		error = os_chmod(dst, st.st_mode & 07777);
 		if(error != 0)
 		{
 			(void)ioe_errlst_append(&args->result.errors, dst, errno,
@@ -629,17 +729,55 @@ iop_cp_internal(io_args_t *args)
 	return error;
 }
 
-/* Try to clone file fast on btrfs.  Returns 0 on success, otherwise non-zero is
+/* Opens source file that the plan of copying knows to be a regular file.
+ * Symbolic links aren't followed and fifos don't block opening, so that
+ * changes made after planning are noticed.  Returns NULL if the file can't be
+ * opened or isn't a regular file anymore, such file should be examined as if
+ * it wasn't planned. */
+static FILE *
+open_planned(const char path[], struct stat *st)
+{
+#ifndef _WIN32
+	FILE *fp;
+	const int fd = open(path, O_RDONLY | O_NOFOLLOW | O_NONBLOCK);
+	if(fd == -1)
+	{
+		return NULL;
+	}
+
+	/* Querying opened file is cheaper than resolving its path once again. */
+	if(fstat(fd, st) != 0 || !S_ISREG(st->st_mode) ||
+			(fp = fdopen(fd, "rb")) == NULL)
+	{
+		(void)close(fd);
+		return NULL;
+	}
+
+	(void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	return fp;
+#else
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp != NULL && (fstat(fileno(fp), st) != 0 || !S_ISREG(st->st_mode)))
+	{
+		(void)fclose(fp);
+		return NULL;
+	}
+	return fp;
+#endif
+}
+
+/* Try to clone file fast on file systems that support reflinks (btrfs, XFS,
+ * bcachefs and others).  Returns 0 on success, otherwise non-zero is
  * returned. */
 static int
 clone_file(int dst_fd, int src_fd)
 {
 #ifdef __linux__
-#undef BTRFS_IOCTL_MAGIC
-#define BTRFS_IOCTL_MAGIC 0x94
-#undef BTRFS_IOC_CLONE
-#define BTRFS_IOC_CLONE _IOW(BTRFS_IOCTL_MAGIC, 9, int)
-	return ioctl(dst_fd, BTRFS_IOC_CLONE, src_fd);
+/* FICLONE is generalized BTRFS_IOC_CLONE and has the same value. */
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+	return ioctl(dst_fd, FICLONE, src_fd);
 #else
 	(void)dst_fd;
 	(void)src_fd;
@@ -647,6 +785,449 @@ clone_file(int dst_fd, int src_fd)
 #endif
 }
 
+/* Copies contents of a regular file into empty destination file.  Returns zero
+ * on success, otherwise non-zero is returned. */
+static int
+copy_contents(io_args_t *args, int dst_fd, int src_fd, const struct stat *st)
+{
+	int result = 1;
+	copy_state_t state = {
+		.args = args,
+		.dst_fd = dst_fd,
+		.src_fd = src_fd,
+		.size = st->st_size,
+		.block_size = MIN_BLOCK_SIZE,
+	};
+
+#ifdef POSIX_FADV_SEQUENTIAL
+	(void)posix_fadvise(src_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	if(is_sparse(st))
+	{
+		result = copy_sparse(&state);
+	}
+	else if(args->arg4.direct_io && state.size >= DIRECT_IO_MIN_SIZE)
+	{
+		set_direct(&state, 1);
+	}
+
+	if(result > 0)
+	{
+		result = copy_range(&state, state.size);
+	}
+
+	if(args->arg4.nocache)
+	{
+		drop_cache(&state);
+	}
+
+	free(state.buf_mem);
+	return (result != 0);
+}
+
+/* Checks whether file has holes in it.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+is_sparse(const struct stat *st)
+{
+#ifndef _WIN32
+	return (uint64_t)st->st_blocks*512U < (uint64_t)st->st_size;
+#else
+	(void)st;
+	return 0;
+#endif
+}
+
+/* Copies contents of a regular file recreating its holes in the destination
+ * file.  Only data extents are counted as progress.  Returns zero on success,
+ * positive number if holes can't be found and negative number on error or
+ * cancellation. */
+static int
+copy_sparse(copy_state_t *state)
+{
+#ifdef SEEK_DATA
+	io_args_t *const args = state->args;
+	off_t offset = 0;
+
+	while((uint64_t)offset < state->size)
+	{
+		off_t hole;
+		const off_t data = lseek(state->src_fd, offset, SEEK_DATA);
+		if(data < 0)
+		{
+			if(errno == ENXIO)
+			{
+				/* There is only a hole till the end of the file. */
+				break;
+			}
+			if(offset == 0 && is_unsupported(errno))
+			{
+				return 1;
+			}
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to find data in source file");
+			return -1;
+		}
+
+		/* Data past the size the file had when it was examined was appended
+		 * after that and isn't copied. */
+		if((uint64_t)data >= state->size)
+		{
+			break;
+		}
+
+		hole = lseek(state->src_fd, data, SEEK_HOLE);
+		if(hole < 0 || lseek(state->src_fd, data, SEEK_SET) < 0 ||
+				lseek(state->dst_fd, data, SEEK_SET) < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+					"Failed to find data in source file");
+			return -1;
+		}
+
+		/* The file could have grown since it was examined. */
+		hole = MIN((uint64_t)hole, state->size);
+		if(copy_range(state, hole - data) != 0)
+		{
+			return -1;
+		}
+		offset = hole;
+	}
+
+	/* Writing past end of file left holes in place of skipped ranges, but
+	 * trailing hole needs to be created explicitly. */
+	if(ftruncate(state->dst_fd, (off_t)state->size) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Failed to set size of destination file");
+		return -1;
+	}
+	return 0;
+#else
+	(void)state;
+	return 1;
+#endif
+}
+
+/* Copies specified number of bytes from current position of source file to
+ * current position of destination file.  Tries copy_file_range() first,
+ * sendfile() next and then falls back to reading and writing, which is the only
+ * way in O_DIRECT mode.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+copy_range(copy_state_t *state, uint64_t len)
+{
+	io_args_t *const args = state->args;
+	IoCopyMethod method = (state->direct ? IO_CM_USERSPACE : iop_cp_method);
+	uint64_t copied = 0U;
+
+	while(copied < len)
+	{
+		ssize_t ncopied;
+
+		if(io_cancelled(args))
+		{
+			return 1;
+		}
+
+		if(method != IO_CM_USERSPACE)
+		{
+			ncopied = copy_block(method, state->dst_fd, state->src_fd,
+					MIN(len - copied, (uint64_t)KERNEL_BLOCK_SIZE));
+			if(ncopied == 0 || (ncopied < 0 && is_unsupported(errno)))
+			{
+				/* Premature end of file means that either the file has shrunk or the
+				 * method doesn't work for it (some virtual file systems report no
+				 * data), let the next method figure that out. */
+				++method;
+				continue;
+			}
+			if(ncopied < 0 && errno != EINTR)
+			{
+				(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+						"Write to destination file failed");
+				return 1;
+			}
+		}
+		else
+		{
+			ncopied = copy_in_userspace(state, len - copied);
+			if(ncopied == 0)
+			{
+				/* The file has shrunk. */
+				break;
+			}
+			if(ncopied < 0)
+			{
+				return 1;
+			}
+		}
+
+		if(ncopied > 0)
+		{
+			copied += ncopied;
+			ioeta_update(args->estim, NULL, NULL, 0, ncopied);
+
+			state->unflushed += ncopied;
+			if(args->arg4.nocache && state->unflushed >= NOCACHE_FLUSH_SIZE)
+			{
+				drop_cache(state);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Copies next block of a file in the kernel using specified method.  Returns
+ * number of copied bytes, zero on end of file or negative number on error with
+ * errno set. */
+static ssize_t
+copy_block(IoCopyMethod method, int dst_fd, int src_fd, size_t len)
+{
+#ifdef __linux__
+	switch(method)
+	{
+		case IO_CM_COPY_FILE_RANGE:
+#ifdef __NR_copy_file_range
+			/* Using system call directly as older libc might not have a wrapper. */
+			return syscall(__NR_copy_file_range, src_fd, NULL, dst_fd, NULL, len,
+					0U);
+#else
+			break;
+#endif
+		case IO_CM_SENDFILE:
+			return sendfile(dst_fd, src_fd, NULL, len);
+		case IO_CM_USERSPACE:
+			break;
+	}
+#else
+	(void)method;
+	(void)dst_fd;
+	(void)src_fd;
+	(void)len;
+#endif
+
+	errno = ENOSYS;
+	return -1;
+}
+
+/* Copies next block of at most left bytes by reading and writing it.  Returns
+ * number of copied bytes, zero on end of file or negative number on error,
+ * which is reported. */
+static ssize_t
+copy_in_userspace(copy_state_t *state, uint64_t left)
+{
+	io_args_t *const args = state->args;
+	struct timeval start, end;
+	ssize_t nread;
+	size_t len;
+
+	if(state->buf == NULL && alloc_buffer(state) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg1.src, ENOMEM,
+				"Failed to allocate buffer");
+		return -1;
+	}
+
+	len = MIN(left, (uint64_t)MIN(state->block_size, state->buf_size));
+
+	/* O_DIRECT needs aligned sizes, so the tail is transferred normally. */
+	if(state->direct && len%DIRECT_IO_ALIGNMENT != 0)
+	{
+		set_direct(state, 0);
+	}
+
+	(void)gettimeofday(&start, NULL);
+
+	do
+	{
+		nread = read(state->src_fd, state->buf, len);
+		/* The file system might have requirements for O_DIRECT which aren't
+		 * met, do without it then. */
+		if(nread < 0 && errno == EINVAL && state->direct)
+		{
+			set_direct(state, 0);
+			errno = (state->direct ? EINVAL : EINTR);
+		}
+	}
+	while(nread < 0 && errno == EINTR);
+
+	if(nread < 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg1.src, errno,
+				"Read from source file failed");
+		return -1;
+	}
+
+	if(nread > 0 && write_block(state, nread) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+				"Write to destination file failed");
+		return -1;
+	}
+
+	(void)gettimeofday(&end, NULL);
+	if((size_t)nread == len)
+	{
+		adapt_block_size(state, (end.tv_sec - start.tv_sec)*1000000L +
+				(end.tv_usec - start.tv_usec));
+	}
+
+	return nread;
+}
+
+/* Allocates buffer that is aligned for O_DIRECT and is large enough to hold the
+ * largest block.  Returns zero on success, otherwise non-zero is returned. */
+static int
+alloc_buffer(copy_state_t *state)
+{
+	const uint64_t size = (state->size + DIRECT_IO_ALIGNMENT - 1U)
+	                    & ~(uint64_t)(DIRECT_IO_ALIGNMENT - 1U);
+
+	state->buf_size = MIN(size, (uint64_t)MAX_BLOCK_SIZE);
+	state->buf_mem = malloc(state->buf_size + DIRECT_IO_ALIGNMENT - 1U);
+	if(state->buf_mem == NULL)
+	{
+		return 1;
+	}
+
+	state->buf = (char *)(((uintptr_t)state->buf_mem + DIRECT_IO_ALIGNMENT - 1U)
+	                      & ~(uintptr_t)(DIRECT_IO_ALIGNMENT - 1U));
+	return 0;
+}
+
+/* Writes specified number of bytes from the buffer to destination file
+ * retrying without O_DIRECT if it's rejected.  Returns zero on success,
+ * otherwise non-zero is returned with errno set. */
+static int
+write_block(copy_state_t *state, size_t len)
+{
+	const off_t offset = (state->direct ? lseek(state->dst_fd, 0, SEEK_CUR) : 0);
+
+	if(write_all(state->dst_fd, state->buf, len) == 0)
+	{
+		return 0;
+	}
+
+	if(!state->direct || errno != EINVAL || offset < 0)
+	{
+		return 1;
+	}
+
+	set_direct(state, 0);
+	if(lseek(state->dst_fd, offset, SEEK_SET) < 0)
+	{
+		return 1;
+	}
+	return write_all(state->dst_fd, state->buf, len);
+}
+
+/* Writes whole buffer to a file retrying on partial writes.  Returns zero on
+ * success, otherwise non-zero is returned with errno set. */
+static int
+write_all(int fd, const char buf[], size_t len)
+{
+	while(len != 0U)
+	{
+		const ssize_t nwritten = write(fd, buf, len);
+		if(nwritten < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return 1;
+		}
+		buf += nwritten;
+		len -= nwritten;
+	}
+	return 0;
+}
+
+/* Grows block size while blocks are transferred fast and shrinks it when they
+ * are slow. */
+static void
+adapt_block_size(copy_state_t *state, long usec)
+{
+	if(usec < FAST_BLOCK_USEC && state->block_size < state->buf_size)
+	{
+		state->block_size *= 2U;
+	}
+	else if(usec > SLOW_BLOCK_USEC && state->block_size > MIN_BLOCK_SIZE)
+	{
+		state->block_size /= 2U;
+	}
+}
+
+/* Turns O_DIRECT mode of both files on or off.  The state changes only if that
+ * succeeds for both of them. */
+static void
+set_direct(copy_state_t *state, int enable)
+{
+	if(state->direct == enable)
+	{
+		return;
+	}
+
+	if(toggle_direct(state->src_fd, enable) != 0)
+	{
+		return;
+	}
+
+	if(toggle_direct(state->dst_fd, enable) != 0)
+	{
+		(void)toggle_direct(state->src_fd, !enable);
+		return;
+	}
+
+	state->direct = enable;
+}
+
+/* Turns O_DIRECT mode of a file on or off.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+toggle_direct(int fd, int enable)
+{
+#if defined(O_DIRECT) && defined(F_GETFL)
+	const int flags = fcntl(fd, F_GETFL);
+	if(flags == -1)
+	{
+		return 1;
+	}
+	return (fcntl(fd, F_SETFL, enable ? (flags | O_DIRECT)
+	                                  : (flags & ~O_DIRECT)) != 0);
+#else
+	(void)fd;
+	(void)enable;
+	return 1;
+#endif
+}
+
+/* Writes out data copied so far and asks the kernel to drop contents of both
+ * files from page cache. */
+static void
+drop_cache(copy_state_t *state)
+{
+#ifdef POSIX_FADV_DONTNEED
+	/* Dirty pages aren't dropped, so they need to be written out first. */
+	(void)fdatasync(state->dst_fd);
+	(void)posix_fadvise(state->dst_fd, 0, 0, POSIX_FADV_DONTNEED);
+	(void)posix_fadvise(state->src_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	state->unflushed = 0U;
+}
+
+/* Checks whether error code means that copying method can't be used for the
+ * files.  Returns non-zero if so, otherwise zero is returned. */
+static int
+is_unsupported(int error)
+{
+	return error == ENOSYS || error == EXDEV || error == EINVAL
+	    || error == EOPNOTSUPP || error == EBADF;
+}
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
@@ -19,10 +19,22 @@
 #ifndef VIFM__IO__IOP_H__
 #define VIFM__IO__IOP_H__
 
+#include "../utils/test_helpers.h"
 #include "ioc.h"
 
 /* iop - I/O primitive - Input/Output primitive */
 
+/* Ways of copying contents of files from the most to the least preferred.  More
+ * preferred way falls back to the next one if it's not supported.  Cloning of
+ * files is attempted before all of them if it's requested. */
+typedef enum
+{
+	IO_CM_COPY_FILE_RANGE, /* In-kernel copying, can be done by file server. */
+	IO_CM_SENDFILE,        /* In-kernel copying through page cache. */
+	IO_CM_USERSPACE,       /* Reading and writing through a buffer. */
+}
+IoCopyMethod;
+
 /* All functions return zero on success and non-zero on error. */
 
 /* Creates file.  Expects path in arg1.  Fails if one already exists. */
@@ -58,6 +70,12 @@ int iop_chmod(io_args_t *args);
  * link. */
 int iop_ln(io_args_t *args);
 
+TSTATIC_DEFS(
+	/* The most preferred way of copying, which tests and benchmarks can change to
+	 * check the other ways. */
+	extern IoCopyMethod iop_cp_method;
+)
+
 #endif /* VIFM__IO__IOP_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
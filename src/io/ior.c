@@ -19,21 +19,25 @@
 #include "ior.h"
 
 #include <sys/stat.h> /* stat */
+#include <sys/types.h> /* mode_t */
 #include <unistd.h> /* unlink() */
 
 #include <errno.h> /* EEXIST EISDIR ENOTEMPTY EXDEV errno */
 #include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* remove() snprintf() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strdup() strlen() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
 #include "../utils/fs.h"
 #include "../utils/log.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/utils.h"
+#include "../utils/workers.h"
 #include "../background.h"
 #include "private/ioc.h"
 #include "private/ioe.h"
@@ -42,6 +46,40 @@
 #include "ioc.h"
 #include "iop.h"
 
+/* Maximum number of files waiting to be copied, traversal pauses when it's
+ * reached. */
+#define MAX_CP_QUEUE 1024
+
+/* State of copying a tree with several threads. */
+typedef struct par_cp_t par_cp_t;
+
+/* Path in the source tree along with its counterpart in destination tree. */
+typedef struct cp_item_t cp_item_t;
+struct cp_item_t
+{
+	char *src;       /* Source path. */
+	char *dst;       /* Destination path. */
+	mode_t mode;     /* Mode of the source from its plan or zero. */
+	uint64_t size;   /* Size of the source from its plan. */
+	par_cp_t *pc;    /* Copying the path is part of. */
+	cp_item_t *next; /* Next item in the list. */
+};
+
+/* Traversal creates directories and queues files, which are copied by worker
+ * threads.  Setting up attributes of directories is postponed until all their
+ * files are copied. */
+struct par_cp_t
+{
+	io_args_t *args;    /* Arguments of the whole operation. */
+	workers_t *workers; /* Threads that copy files. */
+
+	pthread_mutex_t lock; /* Protects fields below it and args->result. */
+	int failed;           /* Whether copying of some file has failed. */
+
+	cp_item_t *dirs;      /* First directory to finish. */
+	cp_item_t *dirs_tail; /* Last directory to finish. */
+};
+
 static VisitResult rm_visitor(const char full_path[], VisitAction action,
 		void *param);
 static VisitResult cp_visitor(const char full_path[], VisitAction action,
@@ -51,6 +89,19 @@ static VisitResult mv_visitor(const char full_path[], VisitAction action,
 		void *param);
 static VisitResult cp_mv_visitor(const char full_path[], VisitAction action,
 		void *param, int cp);
+static char * get_dst_path(const io_args_t *cp_args, const char full_path[]);
+static int cp_traverse(io_args_t *args, subtree_visitor visitor, void *param);
+static int follow_plan(io_args_t *args, ioeta_tree_t *tree,
+		subtree_visitor visitor, void *param);
+static int can_cp_in_parallel(const io_args_t *args);
+static int cp_in_parallel(io_args_t *args);
+static VisitResult par_cp_visitor(const char full_path[], VisitAction action,
+		void *param);
+static int append_item(par_cp_t *pc, const char full_path[]);
+static cp_item_t * make_item(par_cp_t *pc, const char full_path[]);
+static void par_cp_task(void *task, void *arg);
+static void par_cp_file(par_cp_t *pc, const cp_item_t *item);
+static void free_items(cp_item_t *items);
 
 int
 ior_rm(io_args_t *args)
@@ -150,7 +201,12 @@ ior_cp(io_args_t *args)
 		}
 	}
 
-	return traverse(src, &cp_visitor, args);
+	if(can_cp_in_parallel(args))
+	{
+		return cp_in_parallel(args);
+	}
+
+	return cp_traverse(args, &cp_visitor, args);
 }
 
 /* Implementation of traverse() visitor for subtree copying.  Returns 0 on
@@ -347,18 +403,17 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 	const char *dst_full_path;
 	char *free_me = NULL;
 	VisitResult result = VR_OK;
-	const char *rel_part;
 
 	if(io_cancelled(cp_args))
 	{
 		return VR_CANCELLED;
 	}
 
-	/* TODO: come up with something better than this. */
-	rel_part = full_path + strlen(cp_args->arg1.src);
-	dst_full_path = (rel_part[0] == '\0')
-	              ? cp_args->arg2.dst
-	              : (free_me = format_str("%s/%s", cp_args->arg2.dst, rel_part));
+	dst_full_path = free_me = get_dst_path(cp_args, full_path);
+	if(dst_full_path == NULL)
+	{
+		return VR_ERROR;
+	}
 
 	switch(action)
 	{
@@ -389,6 +444,10 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 					.arg3.crs = cp_args->arg3.crs,
 					/* It's safe to always use fast file cloning on moving files. */
 					.arg4.fast_file_cloning = cp ? cp_args->arg4.fast_file_cloning : 1,
+					.arg4.nocache = cp_args->arg4.nocache,
+					.arg4.direct_io = cp_args->arg4.direct_io,
+					.arg4.src_mode = cp_args->arg4.src_mode,
+					.arg4.src_size = cp_args->arg4.src_size,
 
 					.cancellation = cp_args->cancellation,
 					.confirm = cp_args->confirm,
@@ -445,5 +504,341 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 	return result;
 }
 
+/* Maps path in source tree to path in destination tree.  Returns newly
+ * allocated string or NULL on error. */
+static char *
+get_dst_path(const io_args_t *cp_args, const char full_path[])
+{
+	/* TODO: come up with something better than this. */
+	const char *const rel_part = full_path + strlen(cp_args->arg1.src);
+	return (rel_part[0] == '\0')
+	     ? strdup(cp_args->arg2.dst)
+	     : format_str("%s/%s", cp_args->arg2.dst, rel_part);
+}
+
+/* Visits source tree of copying by following its plan made during estimation
+ * if there is one or by traversing it otherwise.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+cp_traverse(io_args_t *args, subtree_visitor visitor, void *param)
+{
+	ioeta_tree_t *const tree = ioeta_plan_find(args->estim, args->arg1.src);
+	if(tree == NULL)
+	{
+		return traverse(args->arg1.src, visitor, param);
+	}
+	return follow_plan(args, tree, visitor, param);
+}
+
+/* Calls the visitor for each step of the plan as traverse() would do.  Copying
+ * visitors don't skip leaving directories, so any result other than VR_OK stops
+ * the process.  Returns zero on success, otherwise non-zero is returned. */
+static int
+follow_plan(io_args_t *args, ioeta_tree_t *tree, subtree_visitor visitor,
+		void *param)
+{
+	char *path = strdup(args->arg1.src);
+	size_t len = (path == NULL) ? 0U : strlen(path);
+	int depth = 0;
+	int result = (path == NULL);
+	ioeta_step_t *step;
+
+	while(result == 0 &&
+			(step = ioeta_plan_next(args->estim, tree, &result)) != NULL)
+	{
+		const size_t parent_len = len;
+
+		if(step->name != NULL && (strappendch(&path, &len, '/') != 0 ||
+					strappend(&path, &len, step->name) != 0))
+		{
+			result = 1;
+		}
+		else
+		{
+			/* Copying of a file can use what planning has found out about it. */
+			args->arg4.src_mode = step->mode;
+			args->arg4.src_size = step->size;
+			result = visitor(path, step->action, param);
+			args->arg4.src_mode = 0;
+			args->arg4.src_size = 0U;
+		}
+
+		switch(step->action)
+		{
+			case VA_DIR_ENTER:
+				++depth;
+				break;
+			case VA_FILE:
+				path[len = parent_len] = '\0';
+				break;
+			case VA_DIR_LEAVE:
+				if(--depth > 0)
+				{
+					len = strrchr(path, '/') - path;
+					path[len] = '\0';
+				}
+				break;
+		}
+	}
+
+	ioeta_plan_drop(args->estim, tree);
+	free(path);
+	return result;
+}
+
+/* Checks whether files can be copied by several threads, which is impossible
+ * when user might be asked something.  Returns non-zero if so, otherwise zero
+ * is returned. */
+static int
+can_cp_in_parallel(const io_args_t *args)
+{
+	return args->arg4.nthreads > 1
+	    && args->confirm == NULL
+	    && args->result.errors_cb == NULL;
+}
+
+/* Copies a tree with several threads.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+cp_in_parallel(io_args_t *args)
+{
+	par_cp_t pc = { .args = args };
+	workers_t *tmp_workers = NULL;
+	workers_t **const workers = (args->arg4.workers == NULL)
+	                          ? &tmp_workers
+	                          : args->arg4.workers;
+	int result;
+	cp_item_t *dir;
+
+	if(*workers == NULL)
+	{
+		*workers = workers_create(args->arg4.nthreads, &par_cp_task, NULL);
+	}
+
+	if(*workers == NULL || workers_count(*workers) == 0)
+	{
+		workers_free(tmp_workers);
+		return cp_traverse(args, &cp_visitor, args);
+	}
+
+	if(pthread_mutex_init(&pc.lock, NULL) != 0)
+	{
+		workers_free(tmp_workers);
+		return cp_traverse(args, &cp_visitor, args);
+	}
+
+	pc.workers = *workers;
+	result = cp_traverse(args, &par_cp_visitor, &pc);
+
+	/* Pool might be shared with other operations, but they are performed one
+	 * after another, so all queued files are from this one. */
+	workers_wait(pc.workers);
+	workers_free(tmp_workers);
+
+	/* Directories are in the order of leaving them, so nested ones go first. */
+	for(dir = pc.dirs; dir != NULL; dir = dir->next)
+	{
+		if(cp_mv_visitor(dir->src, VA_DIR_LEAVE, args, 1) != VR_OK)
+		{
+			result = 1;
+		}
+	}
+
+	if(pc.failed)
+	{
+		result = 1;
+	}
+
+	free_items(pc.dirs);
+	pthread_mutex_destroy(&pc.lock);
+	return result;
+}
+
+/* Implementation of traverse() visitor for copying with several threads.
+ * Creates directories, queues files for copying and remembers directories to
+ * finish.  Returns 0 on success, otherwise non-zero is returned. */
+static VisitResult
+par_cp_visitor(const char full_path[], VisitAction action, void *param)
+{
+	par_cp_t *const pc = param;
+	io_args_t *const args = pc->args;
+	int error;
+
+	if(io_cancelled(args))
+	{
+		return VR_CANCELLED;
+	}
+
+	pthread_mutex_lock(&pc->lock);
+	error = pc->failed;
+	pthread_mutex_unlock(&pc->lock);
+
+	if(error)
+	{
+		return VR_ERROR;
+	}
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			{
+				/* Errors are collected separately to not race with worker threads. */
+				io_args_t dir_args = *args;
+				VisitResult result;
+
+				ioe_errlst_init(&dir_args.result.errors);
+				result = cp_mv_visitor(full_path, action, &dir_args, 1);
+
+				pthread_mutex_lock(&pc->lock);
+				ioe_errlst_splice(&args->result.errors, &dir_args.result.errors);
+				pthread_mutex_unlock(&pc->lock);
+
+				ioe_errlst_free(&dir_args.result.errors);
+				return result;
+			}
+		case VA_FILE:
+			{
+				cp_item_t *const item = make_item(pc, full_path);
+				if(item == NULL)
+				{
+					return VR_ERROR;
+				}
+				if(workers_append(pc->workers, item) != 0)
+				{
+					free_items(item);
+					return VR_ERROR;
+				}
+
+				/* Traversal helps with copying when it outpaces worker threads. */
+				workers_throttle(pc->workers, MAX_CP_QUEUE);
+				return VR_OK;
+			}
+		case VA_DIR_LEAVE:
+			/* Only this thread accesses the list. */
+			error = append_item(pc, full_path);
+			return error ? VR_ERROR : VR_OK;
+	}
+
+	return VR_OK;
+}
+
+/* Appends directory and its counterpart in destination tree to the list of
+ * directories to finish.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+append_item(par_cp_t *pc, const char full_path[])
+{
+	cp_item_t *const item = make_item(pc, full_path);
+	if(item == NULL)
+	{
+		return 1;
+	}
+
+	if(pc->dirs_tail == NULL)
+	{
+		pc->dirs = item;
+	}
+	else
+	{
+		pc->dirs_tail->next = item;
+	}
+	pc->dirs_tail = item;
+	return 0;
+}
+
+/* Pairs path with its counterpart in destination tree and remembers what's
+ * known about the path.  Returns the pair or NULL on error. */
+static cp_item_t *
+make_item(par_cp_t *pc, const char full_path[])
+{
+	cp_item_t *const item = malloc(sizeof(*item));
+	if(item == NULL)
+	{
+		return NULL;
+	}
+
+	item->src = strdup(full_path);
+	item->dst = get_dst_path(pc->args, full_path);
+	item->mode = pc->args->arg4.src_mode;
+	item->size = pc->args->arg4.src_size;
+	item->pc = pc;
+	item->next = NULL;
+	if(item->src == NULL || item->dst == NULL)
+	{
+		free_items(item);
+		return NULL;
+	}
+
+	return item;
+}
+
+/* Copies a queued file.  After a failure or cancellation files are dropped
+ * without copying them. */
+static void
+par_cp_task(void *task, void *arg)
+{
+	cp_item_t *const item = task;
+	par_cp_t *const pc = item->pc;
+	int skip;
+
+	pthread_mutex_lock(&pc->lock);
+	skip = pc->failed;
+	pthread_mutex_unlock(&pc->lock);
+
+	if(!skip && !io_cancelled(pc->args))
+	{
+		par_cp_file(pc, item);
+	}
+
+	free_items(item);
+}
+
+/* Copies single file of the tree. */
+static void
+par_cp_file(par_cp_t *pc, const cp_item_t *item)
+{
+	const io_args_t *const cp_args = pc->args;
+	int error;
+
+	io_args_t args = {
+		.arg1.src = item->src,
+		.arg2.dst = item->dst,
+		.arg3.crs = cp_args->arg3.crs,
+		.arg4 = cp_args->arg4,
+
+		.cancellation = cp_args->cancellation,
+		.estim = cp_args->estim,
+	};
+	args.arg4.src_mode = item->mode;
+	args.arg4.src_size = item->size;
+	ioe_errlst_init(&args.result.errors);
+
+	error = iop_cp(&args);
+
+	pthread_mutex_lock(&pc->lock);
+	ioe_errlst_splice(&pc->args->result.errors, &args.result.errors);
+	if(error)
+	{
+		pc->failed = 1;
+	}
+	pthread_mutex_unlock(&pc->lock);
+
+	ioe_errlst_free(&args.result.errors);
+}
+
+/* Frees list of items. */
+static void
+free_items(cp_item_t *items)
+{
+	while(items != NULL)
+	{
+		cp_item_t *const next = items->next;
+		free(items->src);
+		free(items->dst);
+		free(items);
+		items = next;
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
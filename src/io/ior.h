@@ -29,7 +29,9 @@
 int ior_rm(io_args_t *args);
 
 /* Copies file/directory recursively.  Expects path in arg1 and overwrite in
- * arg3. */
+ * arg3.  Files are copied by a pool of arg4.nthreads threads if there are no
+ * callbacks that need to interact with the user, the pool is kept in
+ * arg4.workers. */
 int ior_cp(io_args_t *args);
 
 /* Moves/renames file/directory recursively.  Expects src in arg1, dst in arg2
@@ -18,40 +18,182 @@
 
 #include "ioeta.h"
 
-#include <stddef.h> /* NULL */
+#include <sys/stat.h> /* S_ISLNK() stat */
+#include <sys/types.h> /* mode_t */
+
+#include <stddef.h> /* NULL offsetof() size_t */
 #include <stdint.h> /* uint64_t */
-#include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strcmp() strcpy() strdup() strlen() strrchr() */
 
+#include "../../compat/os.h"
+#include "../../compat/pthread.h"
 #include "../../utils/fs.h"
 #include "../../utils/str.h"
+#include "../../utils/workers.h"
 #include "../ioeta.h"
+#include "ioc.h"
 #include "ionotif.h"
+#include "traverser.h"
+
+/* Size of memory chunks from which steps are allocated. */
+#define CHUNK_SIZE (16U*1024U)
+
+/* Piece of memory holding steps along with their names, which is freed once
+ * all of its steps are taken or dropped. */
+typedef struct ioeta_chunk_t ioeta_chunk_t;
+struct ioeta_chunk_t
+{
+	ioeta_chunk_t *next; /* Next chunk in the order of allocation. */
+	size_t used;         /* Number of used bytes of data. */
+	int live;            /* Number of steps that are still in use. */
+
+	/* Storage, union makes it suitably aligned for steps. */
+	union
+	{
+		ioeta_step_t step;
+		char bytes[CHUNK_SIZE];
+	}
+	data;
+};
+
+/* Helper for computing alignment of steps. */
+typedef struct
+{
+	char c;            /* Something that requires no alignment. */
+	ioeta_step_t step; /* Properly aligned step. */
+}
+step_align_t;
+
+/* Plan of traversing a single subtree. */
+struct ioeta_tree_t
+{
+	char *path;            /* Root of the subtree. */
+	ioeta_step_t *head;    /* First step that wasn't taken yet. */
+	ioeta_step_t *tail;    /* Last step that was made. */
+	ioeta_step_t *current; /* Last step that was taken. */
+	int done;              /* Whether traversal is over. */
+	int result;            /* Result of the traversal. */
+	int taken;             /* Whether plan is being followed or was dropped. */
+	int dropped;           /* Whether steps aren't needed anymore. */
+	ioeta_tree_t *next;    /* Next subtree in the order of addition. */
+};
+
+/* Plans of subtrees of a single estimation.  Subtrees are traversed one by one
+ * by a background thread in the order of their addition. */
+typedef struct ioeta_plan_t
+{
+	ioeta_estim_t *estim;           /* Estimation to update. */
+	io_cancellation_t cancellation; /* Cancellation of the estimation. */
+	workers_t *workers;             /* Single thread that makes plans. */
+
+	pthread_mutex_t lock; /* Protects all fields below and plans of subtrees. */
+	pthread_cond_t cond;  /* Signaled on new steps. */
+	int stop;             /* Whether the thread should stop. */
+	ioeta_tree_t *trees;  /* All subtrees. */
+	ioeta_tree_t *last;   /* Last subtree. */
+	ioeta_tree_t *next;   /* First subtree that wasn't taken yet. */
+
+	ioeta_chunk_t *chunks;     /* Oldest chunk of memory for steps. */
+	ioeta_chunk_t *last_chunk; /* Chunk that is being filled. */
+}
+ioeta_plan_t;
+
+/* State of traversing a subtree for its plan. */
+typedef struct
+{
+	ioeta_plan_t *plan; /* Plans of the estimation. */
+	ioeta_tree_t *tree; /* Plan to fill. */
+	int depth;          /* Current depth of the traversal. */
+}
+plan_walk_t;
+
+static void stop_planning(ioeta_estim_t *estim);
+static ioeta_plan_t * make_plan(ioeta_estim_t *estim);
+static void plan_task(void *task, void *arg);
+static void update(ioeta_estim_t *estim, const char path[],
+		const char target[], int finished, uint64_t bytes,
+		const uint64_t *file_size);
+static VisitResult plan_visitor(const char full_path[], VisitAction action,
+		void *param);
+static uint64_t stat_file(const char path[], uint64_t *size, mode_t *mode);
+static ioeta_step_t * alloc_step(ioeta_plan_t *plan, const char name[]);
+static void release_steps(ioeta_plan_t *plan, ioeta_step_t *steps);
+
+/* Serializes updates of estimations by threads that work on the same
+ * operation. */
+static pthread_mutex_t update_lock = PTHREAD_MUTEX_INITIALIZER;
 
 void
 ioeta_release(ioeta_estim_t *estim)
 {
+	stop_planning(estim);
+
 	free(estim->item);
 	free(estim->target);
 }
 
+/* Stops background thread of planning if it's running and frees plans. */
+static void
+stop_planning(ioeta_estim_t *estim)
+{
+	ioeta_plan_t *const plan = estim->plan;
+	if(plan == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&plan->lock);
+	plan->stop = 1;
+	pthread_mutex_unlock(&plan->lock);
+
+	workers_free(plan->workers);
+
+	while(plan->trees != NULL)
+	{
+		ioeta_tree_t *const tree = plan->trees;
+		plan->trees = tree->next;
+		free(tree->path);
+		free(tree);
+	}
+
+	while(plan->chunks != NULL)
+	{
+		ioeta_chunk_t *const chunk = plan->chunks;
+		plan->chunks = chunk->next;
+		free(chunk);
+	}
+
+	pthread_cond_destroy(&plan->cond);
+	pthread_mutex_destroy(&plan->lock);
+	free(plan);
+	estim->plan = NULL;
+}
+
 void
 ioeta_add_item(ioeta_estim_t *estim, const char path[])
 {
+	pthread_mutex_lock(&update_lock);
+
 	++estim->total_items;
 
 	replace_string(&estim->item, path);
 
 	ionotif_notify(IO_PS_ESTIMATING, estim);
+
+	pthread_mutex_unlock(&update_lock);
 }
 
 void
 ioeta_add_file(ioeta_estim_t *estim, const char path[])
 {
-	if(!is_symlink(path))
-	{
-		estim->total_bytes += get_file_size(path);
-	}
+	uint64_t file_size;
+	mode_t mode;
+	const uint64_t size = stat_file(path, &file_size, &mode);
+
+	pthread_mutex_lock(&update_lock);
+	estim->total_bytes += size;
+	pthread_mutex_unlock(&update_lock);
 
 	ioeta_add_item(estim, path);
 }
@@ -64,20 +206,42 @@ ioeta_add_dir(ioeta_estim_t *estim, const char path[])
 	 *       progress reports and it even might be the reason of getting more than
 	 *       100% progress. */
 
+	pthread_mutex_lock(&update_lock);
+
 	replace_string(&estim->item, path);
 
 	ionotif_notify(IO_PS_ESTIMATING, estim);
+
+	pthread_mutex_unlock(&update_lock);
 }
 
 void
 ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes)
+{
+	update(estim, path, target, finished, bytes, NULL);
+}
+
+void
+ioeta_update_file(ioeta_estim_t *estim, const char path[],
+		const char target[], uint64_t size)
+{
+	update(estim, path, target, 0, 0U, &size);
+}
+
+/* Implementation of ioeta_update() and ioeta_update_file().  file_size is NULL
+ * if size of the file should be queried. */
+static void
+update(ioeta_estim_t *estim, const char path[], const char target[],
+		int finished, uint64_t bytes, const uint64_t *file_size)
 {
 	if(estim == NULL || estim->silent)
 	{
 		return;
 	}
 
+	pthread_mutex_lock(&update_lock);
+
 	estim->current_byte += bytes;
 	estim->current_file_byte += bytes;
 	if(estim->current_byte > estim->total_bytes)
@@ -100,7 +264,9 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	else if(estim->inspected_items != estim->current_item + 1)
 	{
 		estim->inspected_items = estim->current_item + 1;
-		estim->total_file_bytes = get_file_size(path);
+		estim->total_file_bytes = (file_size == NULL)
+		                         ? get_file_size(path)
+		                         : *file_size;
 	}
 
 	if(path != NULL)
@@ -114,6 +280,8 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	}
 
 	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+
+	pthread_mutex_unlock(&update_lock);
 }
 
 int
@@ -143,9 +311,16 @@ ioeta_silent_set(ioeta_estim_t *estim, int silent)
 ioeta_estim_t
 ioeta_save(const ioeta_estim_t *estim)
 {
-	ioeta_estim_t copy = *estim;
+	ioeta_estim_t copy;
+
+	pthread_mutex_lock(&update_lock);
+	copy = *estim;
+	pthread_mutex_unlock(&update_lock);
+
 	copy.item = (copy.item == NULL ? NULL : strdup(copy.item));
 	copy.target = (copy.target == NULL ? NULL : strdup(copy.target));
+	/* Plans belong to the original. */
+	copy.plan = NULL;
 
 	return copy;
 }
@@ -155,6 +330,7 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 {
 	char *item = estim->item;
 	char *target = estim->target;
+	struct ioeta_plan_t *const plan = estim->plan;
 
 	if(estim->silent)
 	{
@@ -164,9 +340,415 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 	update_string(&item, save->item);
 	update_string(&target, save->target);
 
-	*estim = *save;
+	pthread_mutex_lock(&update_lock);
+	if(plan != NULL)
+	{
+		/* Totals might have grown since the save. */
+		const size_t total_items = estim->total_items;
+		const uint64_t total_bytes = estim->total_bytes;
+		*estim = *save;
+		estim->total_items = total_items;
+		estim->total_bytes = total_bytes;
+	}
+	else
+	{
+		*estim = *save;
+	}
 	estim->item = item;
 	estim->target = target;
+	estim->plan = plan;
+	pthread_mutex_unlock(&update_lock);
+}
+
+int
+ioeta_plan_add(ioeta_estim_t *estim, const char path[])
+{
+	ioeta_plan_t *plan = estim->plan;
+	ioeta_tree_t *const tree = calloc(1U, sizeof(*tree));
+	if(tree == NULL || (tree->path = strdup(path)) == NULL)
+	{
+		free(tree);
+		return 1;
+	}
+
+	if(plan == NULL)
+	{
+		plan = make_plan(estim);
+		if(plan == NULL)
+		{
+			free(tree->path);
+			free(tree);
+			return 1;
+		}
+		estim->plan = plan;
+	}
+
+	pthread_mutex_lock(&plan->lock);
+	if(plan->last == NULL)
+	{
+		plan->trees = tree;
+	}
+	else
+	{
+		plan->last->next = tree;
+	}
+	plan->last = tree;
+	if(plan->next == NULL)
+	{
+		plan->next = tree;
+	}
+	pthread_mutex_unlock(&plan->lock);
+
+	if(workers_append(plan->workers, tree) != 0)
+	{
+		/* The tree is in the list already, so just don't wait for it. */
+		pthread_mutex_lock(&plan->lock);
+		tree->done = 1;
+		tree->result = 1;
+		pthread_mutex_unlock(&plan->lock);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Allocates plans of the estimation along with a thread that makes them.
+ * Returns the plans or NULL on error. */
+static ioeta_plan_t *
+make_plan(ioeta_estim_t *estim)
+{
+	ioeta_plan_t *const plan = calloc(1U, sizeof(*plan));
+	if(plan == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&plan->lock, NULL) != 0)
+	{
+		free(plan);
+		return NULL;
+	}
+	if(pthread_cond_init(&plan->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&plan->lock);
+		free(plan);
+		return NULL;
+	}
+
+	plan->estim = estim;
+	plan->cancellation = estim->cancellation;
+
+	/* Planning is pointless if it's going to be done by the operation. */
+	plan->workers = workers_create(1, &plan_task, plan);
+	if(plan->workers == NULL || workers_count(plan->workers) == 0)
+	{
+		workers_free(plan->workers);
+		pthread_cond_destroy(&plan->cond);
+		pthread_mutex_destroy(&plan->lock);
+		free(plan);
+		return NULL;
+	}
+
+	return plan;
+}
+
+/* Traverses a subtree making its plan unless planning was stopped. */
+static void
+plan_task(void *task, void *arg)
+{
+	ioeta_tree_t *const tree = task;
+	ioeta_plan_t *const plan = arg;
+	plan_walk_t walk = { .plan = plan, .tree = tree };
+	int stop;
+	int result = 1;
+
+	pthread_mutex_lock(&plan->lock);
+	stop = plan->stop;
+	pthread_mutex_unlock(&plan->lock);
+
+	if(!stop)
+	{
+		result = traverse(tree->path, &plan_visitor, &walk);
+	}
+
+	pthread_mutex_lock(&plan->lock);
+	tree->done = 1;
+	tree->result = result;
+	pthread_cond_broadcast(&plan->cond);
+	pthread_mutex_unlock(&plan->lock);
+}
+
+/* Implementation of traverse() visitor for making plans.  Returns 0 on success,
+ * otherwise non-zero is returned. */
+static VisitResult
+plan_visitor(const char full_path[], VisitAction action, void *param)
+{
+	plan_walk_t *const walk = param;
+	ioeta_plan_t *const plan = walk->plan;
+	const char *name = NULL;
+	uint64_t size = 0U;
+	mode_t mode = 0;
+	ioeta_step_t *step = NULL;
+	int stop;
+
+	if(cancelled(&plan->cancellation))
+	{
+		return VR_CANCELLED;
+	}
+
+	if(action == VA_DIR_LEAVE)
+	{
+		--walk->depth;
+	}
+	else if(walk->depth != 0)
+	{
+		/* Parent directories are known from preceding steps. */
+		name = strrchr(full_path, '/') + 1;
+	}
+
+	if(action == VA_DIR_ENTER)
+	{
+		++walk->depth;
+	}
+	else if(action == VA_FILE)
+	{
+		const uint64_t data_size = stat_file(full_path, &size, &mode);
+
+		/* Progress is reported by the operation, so no notification here. */
+		pthread_mutex_lock(&update_lock);
+		++plan->estim->total_items;
+		plan->estim->total_bytes += data_size;
+		pthread_mutex_unlock(&update_lock);
+	}
+
+	pthread_mutex_lock(&plan->lock);
+	stop = (plan->stop || walk->tree->dropped);
+	if(!stop && (step = alloc_step(plan, name)) != NULL)
+	{
+		step->action = action;
+		step->mode = mode;
+		step->size = size;
+		step->next = NULL;
+
+		if(walk->tree->tail == NULL)
+		{
+			walk->tree->head = step;
+		}
+		else
+		{
+			walk->tree->tail->next = step;
+		}
+		walk->tree->tail = step;
+		pthread_cond_broadcast(&plan->cond);
+	}
+	pthread_mutex_unlock(&plan->lock);
+
+	if(stop)
+	{
+		return VR_CANCELLED;
+	}
+	return (step == NULL) ? VR_ERROR : VR_OK;
+}
+
+/* Queries information about a file with a single lstat() where it recognizes
+ * symbolic links.  *mode is set to zero if it's unknown.  Returns size of data
+ * of the file, which is zero for symbolic links. */
+static uint64_t
+stat_file(const char path[], uint64_t *size, mode_t *mode)
+{
+#ifndef _WIN32
+	struct stat st;
+
+	*size = 0U;
+	*mode = 0;
+
+	if(os_lstat(path, &st) != 0)
+	{
+		return 0U;
+	}
+
+	*size = st.st_size;
+	*mode = st.st_mode;
+	return S_ISLNK(st.st_mode) ? 0U : get_data_size(path, &st);
+#else
+	*size = get_file_size(path);
+	*mode = 0;
+	return is_symlink(path) ? 0U : *size;
+#endif
+}
+
+/* Allocates step along with a copy of its name, which can be NULL, from chunks
+ * of the plan.  Must be called with the lock held.  Returns the step or NULL
+ * on error. */
+static ioeta_step_t *
+alloc_step(ioeta_plan_t *plan, const char name[])
+{
+	const size_t align = offsetof(step_align_t, step);
+	const size_t size = sizeof(ioeta_step_t)
+	                  + (name == NULL ? 0U : strlen(name) + 1U);
+	ioeta_chunk_t *chunk = plan->last_chunk;
+	size_t offset = 0U;
+	ioeta_step_t *step;
+
+	if(size > CHUNK_SIZE)
+	{
+		return NULL;
+	}
+
+	if(chunk != NULL)
+	{
+		offset = (chunk->used + align - 1U)/align*align;
+	}
+
+	if(chunk == NULL || offset + size > CHUNK_SIZE)
+	{
+		chunk = malloc(sizeof(*chunk));
+		if(chunk == NULL)
+		{
+			return NULL;
+		}
+
+		chunk->next = NULL;
+		chunk->live = 0;
+		if(plan->last_chunk == NULL)
+		{
+			plan->chunks = chunk;
+		}
+		else
+		{
+			plan->last_chunk->next = chunk;
+		}
+		plan->last_chunk = chunk;
+		offset = 0U;
+	}
+
+	step = (ioeta_step_t *)(chunk->data.bytes + offset);
+	step->chunk = chunk;
+	step->name = NULL;
+	if(name != NULL)
+	{
+		step->name = (char *)(step + 1);
+		strcpy(step->name, name);
+	}
+
+	chunk->used = offset + size;
+	++chunk->live;
+	return step;
+}
+
+/* Marks list of steps as unused and frees chunks that have no steps in use.
+ * Must be called with the lock held. */
+static void
+release_steps(ioeta_plan_t *plan, ioeta_step_t *steps)
+{
+	for(; steps != NULL; steps = steps->next)
+	{
+		--steps->chunk->live;
+	}
+
+	/* Plans are mostly followed in the order of making them, so it's enough to
+	 * check the oldest chunks.  The last one might still get new steps. */
+	while(plan->chunks != plan->last_chunk && plan->chunks->live == 0)
+	{
+		ioeta_chunk_t *const chunk = plan->chunks;
+		plan->chunks = chunk->next;
+		free(chunk);
+	}
+}
+
+ioeta_tree_t *
+ioeta_plan_find(ioeta_estim_t *estim, const char path[])
+{
+	ioeta_plan_t *const plan = (estim == NULL) ? NULL : estim->plan;
+	ioeta_tree_t *tree, *match = NULL;
+
+	if(plan == NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&plan->lock);
+
+	/* Subtrees are taken in the order of their addition, so everything before
+	 * the first one that wasn't taken can be skipped. */
+	for(tree = plan->next; tree != NULL; tree = tree->next)
+	{
+		if(strcmp(tree->path, path) == 0)
+		{
+			match = tree;
+			break;
+		}
+	}
+
+	if(match != NULL)
+	{
+		/* Operation has skipped subtrees that precede the match. */
+		for(tree = plan->next; tree != match; tree = tree->next)
+		{
+			tree->taken = 1;
+			tree->dropped = 1;
+			release_steps(plan, tree->head);
+			tree->head = NULL;
+			tree->tail = NULL;
+		}
+		match->taken = 1;
+		plan->next = match->next;
+	}
+
+	pthread_mutex_unlock(&plan->lock);
+	return match;
+}
+
+ioeta_step_t *
+ioeta_plan_next(ioeta_estim_t *estim, ioeta_tree_t *tree, int *result)
+{
+	ioeta_plan_t *const plan = estim->plan;
+	ioeta_step_t *step;
+
+	pthread_mutex_lock(&plan->lock);
+
+	/* Previous step isn't used anymore. */
+	release_steps(plan, tree->current);
+	tree->current = NULL;
+
+	while(tree->head == NULL && !tree->done)
+	{
+		pthread_cond_wait(&plan->cond, &plan->lock);
+	}
+
+	step = tree->head;
+	if(step == NULL)
+	{
+		*result = tree->result;
+	}
+	else
+	{
+		tree->head = step->next;
+		if(tree->head == NULL)
+		{
+			tree->tail = NULL;
+		}
+		step->next = NULL;
+		tree->current = step;
+	}
+
+	pthread_mutex_unlock(&plan->lock);
+	return step;
+}
+
+void
+ioeta_plan_drop(ioeta_estim_t *estim, ioeta_tree_t *tree)
+{
+	ioeta_plan_t *const plan = estim->plan;
+
+	pthread_mutex_lock(&plan->lock);
+	tree->dropped = 1;
+	release_steps(plan, tree->current);
+	release_steps(plan, tree->head);
+	tree->current = NULL;
+	tree->head = NULL;
+	tree->tail = NULL;
+	pthread_mutex_unlock(&plan->lock);
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,14 +19,36 @@
 #ifndef VIFM__IO__PRIVATE__IOETA_H__
 #define VIFM__IO__PRIVATE__IOETA_H__
 
+#include <sys/types.h> /* mode_t */
+
 #include <stdint.h> /* uint64_t */
 
 #include "../ioeta.h"
+#include "traverser.h"
 
 /* ioeta - private functions of Input/Output estimation */
 
-/* Frees resources of estimation, but not the structure itself.  estim can't be
- * NULL. */
+struct ioeta_chunk_t;
+
+/* Step of traversing a subtree recorded in its plan. */
+typedef struct ioeta_step_t ioeta_step_t;
+struct ioeta_step_t
+{
+	VisitAction action; /* What traverse() reported. */
+	char *name;         /* Last path component or NULL for the root and leaving
+	                       directories. */
+	mode_t mode;        /* Mode of a file from lstat() or zero if it's unknown. */
+	uint64_t size;      /* Size of a file from lstat() or zero. */
+	ioeta_step_t *next; /* Next step of the plan. */
+
+	struct ioeta_chunk_t *chunk; /* Memory the step and its name occupy. */
+};
+
+/* Plan of traversing a single subtree. */
+typedef struct ioeta_tree_t ioeta_tree_t;
+
+/* Frees resources of estimation and waits for its planning to stop, but not the
+ * structure itself.  estim can't be NULL. */
 void ioeta_release(ioeta_estim_t *estim);
 
 /* Adds zero-size item to the estimation. */
@@ -48,6 +70,11 @@ void ioeta_add_dir(ioeta_estim_t *estim, const char path[]);
 void ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		int finished, uint64_t bytes);
 
+/* Same as ioeta_update(estim, path, target, 0, 0), but uses size of the file
+ * known to the caller instead of querying it. */
+void ioeta_update_file(ioeta_estim_t *estim, const char path[],
+		const char target[], uint64_t size);
+
 /* Silence future progress reports.  Returns previous state to be passed to
  * ioeta_silent_set() later.  If estim is NULL, returns zero. */
 int ioeta_silent_on(ioeta_estim_t *estim);
@@ -60,9 +87,30 @@ void ioeta_silent_set(ioeta_estim_t *estim, int silent);
  * multiple times and needs to be freed with ioeta_release() after last use. */
 ioeta_estim_t ioeta_save(const ioeta_estim_t *estim);
 
-/* Restores estimation to its previous state. */
+/* Restores estimation to its previous state.  Totals are left intact while
+ * they are being planned. */
 void ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save);
 
+/* Starts traversing subtree rooted at the path in background thread, which adds
+ * it to the estimation and records its plan.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int ioeta_plan_add(ioeta_estim_t *estim, const char path[]);
+
+/* Looks up plan of subtree rooted at the path to follow it.  Plans of subtrees
+ * added before this one are dropped as they won't be used.  Returns the plan or
+ * NULL if there is none. */
+ioeta_tree_t * ioeta_plan_find(ioeta_estim_t *estim, const char path[]);
+
+/* Retrieves next step of the plan waiting for it to be made if necessary.
+ * Returns the step, which stays valid until the next call of this function or
+ * of ioeta_plan_drop() for the same tree, or NULL at the end of the plan, in
+ * which case *result is set to result of the traversal. */
+ioeta_step_t * ioeta_plan_next(ioeta_estim_t *estim, ioeta_tree_t *tree,
+		int *result);
+
+/* Stops making the plan and discards the rest of its steps. */
+void ioeta_plan_drop(ioeta_estim_t *estim, ioeta_tree_t *tree);
+
 #endif /* VIFM__IO__PRIVATE__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,16 +19,27 @@
 
 #include "find_menu.h"
 
+#include <stddef.h> /* NULL */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strdup() */
+#include <string.h> /* strdup() strlen() */
 
 #include "../cfg/config.h"
+#include "../compat/fs_limits.h"
+#include "../compat/pthread.h"
 #include "../modes/dialogs/msg_dialog.h"
+#include "../ui/cancellation.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/find.h"
 #include "../utils/macros.h"
+#include "../utils/matcher.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../utils/utils.h"
+#include "../filelist.h"
+#include "../filtering.h"
+#include "../flist_pos.h"
 #include "../macros.h"
 #include "menus.h"
 
@@ -38,7 +49,28 @@
 #define DEFAULT_PREDICATE "-name"
 #endif
 
+/* State of built-in search. */
+typedef struct
+{
+	view_t *view;         /* View that receives results and whose filters are
+	                         applied. */
+	matcher_t *matcher;   /* What is being looked for. */
+	int lock_matcher;     /* Whether matcher can't be used concurrently. */
+	int lock_filters;     /* Whether filters can't be used concurrently. */
+	pthread_mutex_t lock; /* Serializes use of matcher and filters. */
+	char *errors;         /* Errors collected during the search or NULL. */
+}
+builtin_find_t;
+
 static int execute_find_cb(view_t *view, menu_data_t *m);
+static int run_builtin_find(view_t *view, int with_path, const char args[]);
+static char * split_path_arg(const char args[], const char **rest);
+static int builtin_find_filter(const char path[], int is_dir, void *arg);
+static int builtin_find_match(const char path[], const struct stat *st,
+		void *arg);
+static void builtin_find_found(const char path[], const struct stat *st,
+		void *arg);
+static void builtin_find_error(char msg[], void *arg);
 
 int
 show_find_menu(view_t *view, int with_path, const char args[])
@@ -61,6 +93,12 @@ show_find_menu(view_t *view, int with_path, const char args[])
 
 	static menu_data_t m;
 
+	if(cfg.find_prg[0] == '\0')
+	{
+		ui_sb_msg("find...");
+		return run_builtin_find(view, with_path, args);
+	}
+
 	if(with_path)
 	{
 		macros[M_s].value = args;
@@ -121,5 +159,206 @@ execute_find_cb(view_t *view, menu_data_t *m)
 	return 0;
 }
 
+/* Looks for files without running external tool and shows them in a custom
+ * view.  Directories and files hidden in the view are skipped.  Returns
+ * non-zero if status bar message should be saved. */
+static int
+run_builtin_find(view_t *view, int with_path, const char args[])
+{
+	builtin_find_t find = { .view = view };
+	const char *pattern = args;
+	char **targets;
+	int ntargets;
+	char *error;
+	char *title;
+
+	const find_params_t params = {
+		.nthreads = get_proc_count(),
+		.dir = flist_get_dir(view),
+		.filter = &builtin_find_filter,
+		.match = &builtin_find_match,
+		.on_found = &builtin_find_found,
+		.on_error = &builtin_find_error,
+		.cancellation = &ui_cancellation_info,
+		.arg = &find,
+	};
+
+	if(with_path)
+	{
+		char *const path = split_path_arg(args, &pattern);
+		targets = NULL;
+		ntargets = (path == NULL) ? 0 : put_into_string_array(&targets, 0, path);
+	}
+	else
+	{
+		targets = menus_get_target_list(view, &ntargets);
+	}
+
+	if(ntargets == 0)
+	{
+		show_error_msg("Find", "Not enough memory.");
+		return 0;
+	}
+
+	if(pattern[0] == '-' || pattern[0] == '\0')
+	{
+		free_string_array(targets, ntargets);
+		show_error_msg("Find",
+				"Only a pattern can be passed to :find when 'findprg' is empty.");
+		return 0;
+	}
+
+	find.matcher = matcher_alloc(pattern, FILTER_DEF_CASE_SENSITIVITY, 1, "",
+			&error);
+	if(find.matcher == NULL)
+	{
+		free_string_array(targets, ntargets);
+		show_error_msgf("Find", "Wrong pattern: %s", error);
+		free(error);
+		return 0;
+	}
+
+	if(pthread_mutex_init(&find.lock, NULL) != 0)
+	{
+		matcher_free(find.matcher);
+		free_string_array(targets, ntargets);
+		show_error_msg("Find", "Failed to start search.");
+		return 0;
+	}
+
+	/* Mime types are detected by code that keeps its state in static
+	 * variables. */
+	find.lock_matcher = matcher_is_mime(find.matcher);
+	find.lock_filters = !matcher_is_empty(view->manual_filter)
+	                 && matcher_is_mime(view->manual_filter);
+
+	title = format_str("find %s", args);
+	flist_custom_start(view, title);
+	free(title);
+
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	(void)find_files(targets, ntargets, &params);
+	ui_cancellation_disable();
+
+	pthread_mutex_destroy(&find.lock);
+	matcher_free(find.matcher);
+	free_string_array(targets, ntargets);
+
+	if(find.errors != NULL)
+	{
+		show_error_msg("Find", find.errors);
+		free(find.errors);
+	}
+
+	if(flist_custom_finish(view, CV_REGULAR, 0) != 0)
+	{
+		ui_sb_msg("No files found");
+		return 1;
+	}
+
+	fpos_set_pos(view, 0);
+	ui_sb_clear();
+	return 0;
+}
+
+/* Extracts first argument of the args, which is a path.  Sets *rest to point
+ * to what follows it.  Returns newly allocated unescaped path. */
+static char *
+split_path_arg(const char args[], const char **rest)
+{
+	char *path;
+	const char *end = args;
+
+	while(*end != '\0' && *end != ' ' && *end != '\t')
+	{
+		if(*end == '\\' && end[1] != '\0')
+		{
+			++end;
+		}
+		++end;
+	}
+
+	path = format_str("%.*s", (int)(end - args), args);
+	if(path != NULL)
+	{
+		unescape(path, 0);
+	}
+
+	*rest = skip_whitespace(end);
+	return path;
+}
+
+/* Applies dot, name and auto filters of the view to files and directories met
+ * during the search.  Returns non-zero if the entry should be examined. */
+static int
+builtin_find_filter(const char path[], int is_dir, void *arg)
+{
+	builtin_find_t *const find = arg;
+	const char *const name = get_last_path_component(path);
+	char dir[PATH_MAX + 1];
+	int visible;
+
+	if(find->view->hide_dot && name[0] == '.')
+	{
+		return 0;
+	}
+
+	copy_str(dir, sizeof(dir), path);
+	remove_last_path_component(dir);
+
+	if(find->lock_filters)
+	{
+		pthread_mutex_lock(&find->lock);
+	}
+	visible = filters_file_is_visible(find->view, dir, name, is_dir, 0);
+	if(find->lock_filters)
+	{
+		pthread_mutex_unlock(&find->lock);
+	}
+
+	return visible;
+}
+
+/* Checks whether file matches pattern of the search.  Returns non-zero if so,
+ * otherwise zero is returned. */
+static int
+builtin_find_match(const char path[], const struct stat *st, void *arg)
+{
+	builtin_find_t *const find = arg;
+	int matches;
+
+	if(find->lock_matcher)
+	{
+		pthread_mutex_lock(&find->lock);
+	}
+	matches = matcher_matches(find->matcher, path);
+	if(find->lock_matcher)
+	{
+		pthread_mutex_unlock(&find->lock);
+	}
+
+	return matches;
+}
+
+/* Adds found file to the custom view reusing information about it. */
+static void
+builtin_find_found(const char path[], const struct stat *st, void *arg)
+{
+	builtin_find_t *const find = arg;
+	(void)flist_custom_add_stat(find->view, path, st);
+}
+
+/* Collects error messages to display them after the search. */
+static void
+builtin_find_error(char msg[], void *arg)
+{
+	builtin_find_t *const find = arg;
+	size_t len = (find->errors == NULL ? 0U : strlen(find->errors));
+	(void)strappend(&find->errors, &len, (len == 0U ? "" : "\n"));
+	(void)strappend(&find->errors, &len, msg);
+	free(msg);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -19,20 +19,58 @@
 
 #include "grep_menu.h"
 
-#include <stdlib.h> /* free() */
+#include <regex.h> /* regex_t regcomp() regfree() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* calloc() free() */
 #include <string.h> /* strdup() */
 
 #include "../cfg/config.h"
+#include "../compat/fs_limits.h"
 #include "../modes/dialogs/msg_dialog.h"
 #include "../ui/statusbar.h"
 #include "../ui/ui.h"
+#include "../utils/cancellation.h"
+#include "../utils/grep.h"
 #include "../utils/macros.h"
+#include "../utils/matcher.h"
 #include "../utils/path.h"
+#include "../utils/regexp.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../utils/utils.h"
+#include "../background.h"
+#include "../filelist.h"
 #include "../macros.h"
 #include "menus.h"
 
+/* Parameters of built-in search, which is run in background. */
+typedef struct
+{
+	char *pattern;          /* Regular expression to look for. */
+	int cflags;             /* Flags for compiling the pattern. */
+	int invert;             /* Whether to look for lines that don't match. */
+	int nthreads;           /* Number of threads to search with. */
+	char *dir;              /* Base directory of targets. */
+	char **targets;         /* Files and directories to search. */
+	int ntargets;           /* Number of elements in targets. */
+	int hide_dot;           /* Whether dot files are skipped. */
+	matcher_t *name_filter; /* Copy of name filter of the view or NULL. */
+	int invert_filter;      /* Whether name filter hides what it matches. */
+	bg_stream_t *stream;    /* Receiver of the results. */
+}
+builtin_grep_t;
+
 static int execute_grep_cb(view_t *view, menu_data_t *m);
+static int run_builtin_grep(view_t *view, const char args[], int invert,
+		menu_data_t *m);
+static void builtin_grep_task(bg_stream_t *stream, void *arg);
+static int builtin_grep_cancelled(void *arg);
+static int builtin_grep_filter(const char path[], int is_dir, void *arg);
+static void builtin_grep_match(char line[], void *arg);
+static void builtin_grep_error(char line[], void *arg);
+static void free_builtin_grep(builtin_grep_t *grep);
 
 int
 show_grep_menu(view_t *view, const char args[], int invert)
@@ -70,6 +108,13 @@ show_grep_menu(view_t *view, const char args[], int invert)
 	m.execute_handler = &execute_grep_cb;
 	m.key_handler = &menus_def_khandler;
 
+	if(cfg.grep_prg[0] == '\0')
+	{
+		free(targets);
+		ui_sb_msg("grep...");
+		return run_builtin_grep(view, args, invert, &m);
+	}
+
 	macros[M_i].value = invert ? "-v" : "";
 	macros[M_a].value = args;
 	macros[M_s].value = targets;
@@ -102,5 +147,165 @@ execute_grep_cb(view_t *view, menu_data_t *m)
 	return 1;
 }
 
+/* Searches files without running external tool.  Results are put into the
+ * menu as they are found.  Returns non-zero if status bar message should be
+ * saved. */
+static int
+run_builtin_grep(view_t *view, const char args[], int invert, menu_data_t *m)
+{
+	regex_t re;
+	int err;
+	bg_stream_t *stream;
+
+	builtin_grep_t *const grep = calloc(1, sizeof(*grep));
+	if(grep == NULL)
+	{
+		show_error_msg("Grep", "Not enough memory.");
+		return 0;
+	}
+
+	grep->pattern = strdup(args);
+	grep->cflags = get_regexp_cflags(args);
+	grep->invert = invert;
+	grep->nthreads = get_proc_count();
+	grep->dir = strdup(flist_get_dir(view));
+	grep->targets = menus_get_target_list(view, &grep->ntargets);
+	grep->hide_dot = view->hide_dot;
+	grep->invert_filter = view->invert;
+	if(!matcher_is_empty(view->manual_filter))
+	{
+		/* View's filter can change while search is running. */
+		grep->name_filter = matcher_clone(view->manual_filter);
+	}
+
+	if(grep->pattern == NULL || grep->dir == NULL || grep->ntargets == 0)
+	{
+		free_builtin_grep(grep);
+		show_error_msg("Grep", "Not enough memory.");
+		return 0;
+	}
+
+	/* Report errors in the pattern before any work is started. */
+	err = regcomp(&re, grep->pattern, grep->cflags);
+	if(err != 0)
+	{
+		show_error_msgf("Grep", "Regexp error: %s", get_regexp_error(err, &re));
+		regfree(&re);
+		free_builtin_grep(grep);
+		return 0;
+	}
+	regfree(&re);
+
+	stream = bg_stream_produce("grep", &builtin_grep_task, grep);
+	if(stream == NULL)
+	{
+		free_builtin_grep(grep);
+		show_error_msg("Grep", "Failed to start search.");
+		return 0;
+	}
+
+	return menus_capture_stream(view, stream, m);
+}
+
+/* Implementation of bg_stream_func that performs the search. */
+static void
+builtin_grep_task(bg_stream_t *stream, void *arg)
+{
+	builtin_grep_t *const grep = arg;
+	const cancellation_t cancellation = {
+		.hook = &builtin_grep_cancelled,
+		.arg = stream,
+	};
+	const grep_params_t params = {
+		.pattern = grep->pattern,
+		.cflags = grep->cflags,
+		.invert = grep->invert,
+		.nthreads = grep->nthreads,
+		.dir = grep->dir,
+		.filter = &builtin_grep_filter,
+		.on_match = &builtin_grep_match,
+		.on_error = &builtin_grep_error,
+		.cancellation = &cancellation,
+		.arg = grep,
+	};
+
+	grep->stream = stream;
+	(void)grep_files(grep->targets, grep->ntargets, &params);
+	free_builtin_grep(grep);
+}
+
+/* Implementation of cancellation hook for built-in search.  Returns non-zero if
+ * search should be stopped. */
+static int
+builtin_grep_cancelled(void *arg)
+{
+	return bg_stream_cancelled(arg);
+}
+
+/* Applies dot and name filters of the view to files and directories met during
+ * the search.  Returns non-zero if the entry should be searched. */
+static int
+builtin_grep_filter(const char path[], int is_dir, void *arg)
+{
+	builtin_grep_t *const grep = arg;
+	char path_with_slash[PATH_MAX + 1 + 1];
+	const char *name = get_last_path_component(path);
+
+	if(grep->hide_dot && name[0] == '.')
+	{
+		return 0;
+	}
+
+	if(grep->name_filter == NULL)
+	{
+		return 1;
+	}
+
+	/* Like in the view, directories are matched with trailing slash. */
+	if(is_dir)
+	{
+		snprintf(path_with_slash, sizeof(path_with_slash), "%s/", path);
+		path = path_with_slash;
+		name = get_last_path_component(path);
+	}
+
+	if(matcher_is_full_path(grep->name_filter))
+	{
+		name = path;
+	}
+
+	return matcher_matches(grep->name_filter, name)
+	     ? !grep->invert_filter
+	     : grep->invert_filter;
+}
+
+/* Passes found line to the menu. */
+static void
+builtin_grep_match(char line[], void *arg)
+{
+	builtin_grep_t *const grep = arg;
+	bg_stream_put(grep->stream, line);
+}
+
+/* Collects error messages to be displayed after the search is over. */
+static void
+builtin_grep_error(char line[], void *arg)
+{
+	builtin_grep_t *const grep = arg;
+	bg_stream_put_error(grep->stream, line);
+	free(line);
+}
+
+/* Frees parameters of built-in search. */
+static void
+free_builtin_grep(builtin_grep_t *grep)
+{
+	free(grep->pattern);
+	free(grep->dir);
+	free_string_array(grep->targets, grep->ntargets);
+	matcher_free(grep->name_filter);
+	free(grep);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -20,6 +20,7 @@
 #include "menus.h"
 
 #include <curses.h>
+#include <unistd.h> /* usleep() */
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
@@ -73,6 +74,8 @@ static void draw_search_match(char str[], int start, int end, int line,
 static void normalize_top(menu_state_t *m);
 static void draw_menu_frame(const menu_state_t *m);
 static void output_handler(const char line[], void *arg);
+static int fetch_stream_lines(menu_data_t *m);
+static void stop_stream(menu_data_t *m);
 static void append_to_string(char **str, const char suffix[]);
 static char * expand_tabulation_a(const char line[], size_t tab_stops);
 static void init_menu_state(menu_state_t *ms, view_t *view);
@@ -80,6 +83,7 @@ static const char * get_relative_path_base(const menu_data_t *m,
 		const view_t *view);
 static int menu_and_view_are_in_sync(const menu_data_t *m, const view_t *view);
 static int search_menu(menu_state_t *ms, int start_pos, int print_errors);
+static int mark_matches(menu_state_t *ms, int from, int print_errors);
 static int search_menu_forwards(menu_state_t *m, int start_pos);
 static int search_menu_backwards(menu_state_t *m, int start_pos);
 static int navigate_to_match(menu_state_t *m, int pos);
@@ -177,6 +181,7 @@ menus_init_data(menu_data_t *m, view_t *view, char title[], char empty_msg[])
 	m->execute_handler = NULL;
 	m->empty_msg = empty_msg;
 	m->cwd = strdup(flist_get_dir(view));
+	m->stream = NULL;
 	m->state = &menu_state;
 	m->initialized = 1;
 }
@@ -189,6 +194,8 @@ menus_reset_data(menu_data_t *m)
 		return;
 	}
 
+	stop_stream(m);
+
 	/* On releasing of non-empty stashable menu, but not the stash. */
 	if(m->stashable && m->len > 0 && m != &menu_data_stash)
 	{
@@ -696,6 +703,40 @@ menus_get_targets(view_t *view)
 	return (vifm_chdir(flist_get_dir(view)) == 0) ? strdup(".") : NULL;
 }
 
+char **
+menus_get_target_list(view_t *view, int *ntargets)
+{
+	char **targets = NULL;
+	dir_entry_t *entry = NULL;
+
+	*ntargets = 0;
+
+	if(view->selected_files == 0)
+	{
+		*ntargets = add_to_string_array(&targets, *ntargets, 1, ".");
+		return targets;
+	}
+
+	while(iter_selected_entries(view, &entry))
+	{
+		char path[PATH_MAX + 1];
+
+		/* Files of custom views can come from different directories. */
+		if(flist_custom_active(view))
+		{
+			get_full_path_of(entry, sizeof(path), path);
+		}
+		else
+		{
+			copy_str(path, sizeof(path), entry->name);
+		}
+
+		*ntargets = add_to_string_array(&targets, *ntargets, 1, path);
+	}
+
+	return targets;
+}
+
 int
 menus_unstash(view_t *view)
 {
@@ -844,6 +885,17 @@ menus_capture(view_t *view, const char cmd[], int user_sh, menu_data_t *m,
 		return 0;
 	}
 
+	if(curr_stats.load_stage == 3)
+	{
+		bg_stream_t *const stream = bg_stream_start("Loading menu", cmd, user_sh);
+		if(stream == NULL)
+		{
+			show_error_msgf("Trouble running command", "Unable to run: %s", cmd);
+			return 0;
+		}
+		return menus_capture_stream(view, stream, m);
+	}
+
 	if(process_cmd_output("Loading menu", cmd, user_sh, 0, &output_handler,
 				m) != 0)
 	{
@@ -860,6 +912,162 @@ menus_capture(view_t *view, const char cmd[], int user_sh, menu_data_t *m,
 	return menus_enter(m->state, view);
 }
 
+int
+menus_capture_stream(view_t *view, bg_stream_t *stream, menu_data_t *m)
+{
+	int finished = 0;
+
+	m->stream = stream;
+
+	ui_cancellation_reset();
+	ui_cancellation_enable();
+	show_progress("", 0);
+
+	while((m->len == 0 || curr_stats.load_stage != 3) && !finished)
+	{
+		/* Query state before fetching to not miss lines read in between. */
+		finished = bg_stream_finished(m->stream);
+		if(fetch_stream_lines(m) == 0 && !finished)
+		{
+			if(ui_cancellation_requested())
+			{
+				break;
+			}
+			show_progress("Loading menu", -250);
+			usleep(10000);
+		}
+	}
+
+	ui_cancellation_disable();
+
+	if(ui_cancellation_requested())
+	{
+		stop_stream(m);
+	}
+	else if(finished)
+	{
+		const char *const errors = bg_stream_errors(m->stream);
+		if(!is_null_or_empty(errors))
+		{
+			show_error_msg("Loading menu", errors);
+		}
+		bg_stream_free(m->stream);
+		m->stream = NULL;
+	}
+
+	return menus_enter(m->state, view);
+}
+
+int
+menus_stream_check(void)
+{
+	menu_data_t *const m = menu_state.d;
+	int finished;
+	int nadded;
+
+	if(m == NULL || m->stream == NULL)
+	{
+		return 0;
+	}
+
+	/* Query state before fetching to not miss lines read in between. */
+	finished = bg_stream_finished(m->stream);
+	nadded = fetch_stream_lines(m);
+
+	if(finished)
+	{
+		const char *const errors = bg_stream_errors(m->stream);
+		if(!is_null_or_empty(errors))
+		{
+			show_error_msg("Loading menu", errors);
+		}
+		bg_stream_free(m->stream);
+		m->stream = NULL;
+	}
+
+	return (nadded != 0);
+}
+
+/* Turns lines read by the stream since the last call into menu items keeping
+ * search matches up to date.  Returns number of added items. */
+static int
+fetch_stream_lines(menu_data_t *m)
+{
+	menu_state_t *const ms = m->state;
+	const int old_len = m->len;
+	int nlines;
+	int i;
+	char **new_items;
+
+	char **const lines = bg_stream_fetch(m->stream, &nlines);
+	if(nlines == 0)
+	{
+		return 0;
+	}
+
+	new_items = reallocarray(m->items, m->len + nlines, sizeof(char *));
+	if(new_items == NULL)
+	{
+		free_string_array(lines, nlines);
+		return 0;
+	}
+	m->items = new_items;
+
+	/* Lines are released right away to not keep two copies of the output. */
+	for(i = 0; i < nlines; ++i)
+	{
+		char *item = lines[i];
+		if(strchr(item, '\t') != NULL)
+		{
+			item = expand_tabulation_a(lines[i], cfg.tab_stop);
+			free(lines[i]);
+		}
+		if(item != NULL)
+		{
+			m->items[m->len++] = item;
+		}
+	}
+	free(lines);
+
+	if(ms != NULL && ms->matches != NULL)
+	{
+		short int (*const matches)[2] = reallocarray(ms->matches, m->len,
+				sizeof(*ms->matches));
+		if(matches == NULL)
+		{
+			/* Drop the matches to have them recomputed on next search. */
+			free(ms->matches);
+			ms->matches = NULL;
+			ms->matching_entries = 0;
+		}
+		else
+		{
+			ms->matches = matches;
+			memset(ms->matches + old_len, -1,
+					2*sizeof(**ms->matches)*(m->len - old_len));
+			if(!is_null_or_empty(ms->regexp))
+			{
+				(void)mark_matches(ms, old_len, 0);
+			}
+		}
+	}
+
+	return m->len - old_len;
+}
+
+/* Cancels command that fills the menu, if it's still running. */
+static void
+stop_stream(menu_data_t *m)
+{
+	if(m->stream != NULL)
+	{
+		bg_stream_free(m->stream);
+		m->stream = NULL;
+		append_to_string(&m->title, "(cancelled)");
+		append_to_string(&m->empty_msg, " (cancelled)");
+	}
+}
+
 void
 menus_search_repeat(menu_state_t *m, int backward)
 {
@@ -929,10 +1137,6 @@ static int
 search_menu(menu_state_t *ms, int start_pos, int print_errors)
 {
 	menu_data_t *const m = ms->d;
-	int cflags;
-	regex_t re;
-	int err;
-	int i;
 
 	if(ms->matches == NULL)
 	{
@@ -947,6 +1151,20 @@ search_menu(menu_state_t *ms, int start_pos, int print_errors)
 		return 0;
 	}
 
+	return mark_matches(ms, 0, print_errors);
+}
+
+/* Marks menu items starting at the given index that match search pattern.
+ * Returns non-zero on error. */
+static int
+mark_matches(menu_state_t *ms, int from, int print_errors)
+{
+	menu_data_t *const m = ms->d;
+	int cflags;
+	regex_t re;
+	int err;
+	int i;
+
 	cflags = get_regexp_cflags(ms->regexp);
 	err = regcomp(&re, ms->regexp, cflags);
 	if(err != 0)
@@ -959,7 +1177,7 @@ search_menu(menu_state_t *ms, int start_pos, int print_errors)
 		return -1;
 	}
 
-	for(i = 0; i < m->len; ++i)
+	for(i = from; i < m->len; ++i)
 	{
 		regmatch_t matches[1];
 		if(regexec(&re, m->items[i], 1, matches, 0) == 0)
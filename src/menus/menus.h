@@ -22,6 +22,7 @@
 
 #include <stddef.h> /* wchar_t */
 
+struct bg_stream_t;
 struct view_t;
 
 /* Result of handling key sequence by menu-specific shortcut handler. */
@@ -79,6 +80,9 @@ typedef struct menu_data_t
 	 * menu. */
 	int stashable;
 
+	/* Output of a command that is still adding items to the menu or NULL. */
+	struct bg_stream_t *stream;
+
 	menu_state_t *state; /* Opaque pointer to menu mode state. */
 	int initialized;     /* Marker that shows whether menu data needs freeing. */
 }
@@ -112,11 +116,24 @@ int menus_unstash(struct view_t *view);
  * non-zero is returned. */
 int menus_to_custom_view(menu_state_t *m, struct view_t *view, int very);
 
-/* Either makes a menu or custom view out of command output.  Returns non-zero
- * if status bar message should be saved. */
+/* Either makes a menu or custom view out of command output.  Once TUI is up,
+ * menu is displayed as soon as the command prints something and the rest of
+ * its output is added by menus_stream_check().  Returns non-zero if status bar
+ * message should be saved. */
 int menus_capture(struct view_t *view, const char cmd[], int user_sh,
 		menu_data_t *m, int custom_view, int very_custom_view);
 
+/* Makes a menu out of lines of the stream, which is taken over.  Once TUI is
+ * up, menu is displayed as soon as there is a line and the rest of them is
+ * added by menus_stream_check(), otherwise all lines are read first.  Returns
+ * non-zero if status bar message should be saved. */
+int menus_capture_stream(struct view_t *view, struct bg_stream_t *stream,
+		menu_data_t *m);
+
+/* Appends items printed by command of the active menu since the previous
+ * call.  Returns non-zero if menu needs to be redrawn. */
+int menus_stream_check(void);
+
 /* Menu drawing. */
 
 /* Erases current menu item in menu window. */
@@ -178,6 +195,11 @@ int menus_search_matched(menu_state_t *m);
  * returned. */
 char * menus_get_targets(struct view_t *view);
 
+/* Same as menus_get_targets(), but produces a list of unescaped paths that are
+ * relative to the current directory of the view unless they come from a custom
+ * view.  Sets *ntargets to number of elements.  Returns the list. */
+char ** menus_get_target_list(struct view_t *view, int *ntargets);
+
 /* Predefined key handler for processing keys on elements of file lists.
  * Returns code that specifies both taken actions and what should be done
  * next. */
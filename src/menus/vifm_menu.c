@@ -24,6 +24,8 @@
 
 #include "../compat/reallocarray.h"
 #include "../ui/ui.h"
+#include "../utils/string_array.h"
+#include "../status.h"
 #include "../version.h"
 #include "menus.h"
 
@@ -32,6 +34,7 @@ show_vifm_menu(view_t *view)
 {
 	static menu_data_t m;
 	int len;
+	char *stats;
 	/* Version information menu always contains at least one item. */
 	menus_init_data(&m, view, strdup("Vifm Information"), NULL);
 
@@ -39,6 +42,15 @@ show_vifm_menu(view_t *view)
 	m.items = reallocarray(NULL, len, sizeof(char *));
 	m.len = fill_version_info(m.items);
 
+	/* Counters of caches are gathered at runtime and thus are shown only here
+	 * rather than in output of --version. */
+	stats = dcache_format_stats();
+	if(stats != NULL)
+	{
+		m.len = add_to_string_array(&m.items, m.len, 1, "");
+		m.len = put_into_string_array(&m.items, m.len, stats);
+	}
+
 	return menus_enter(m.state, view);
 }
 
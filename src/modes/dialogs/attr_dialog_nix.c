@@ -144,16 +144,18 @@ enter_attr_mode(view_t *active_view)
 	entry = NULL;
 	while(iter_selection_or_current(view, &entry))
 	{
+		const mode_t mode = fentry_get_mode(entry);
+
 		if(first)
 		{
-			fmode = entry->mode;
+			fmode = mode;
 			first = 0;
 		}
 
-		diff |= (entry->mode ^ fmode);
+		diff |= (mode ^ fmode);
 		file_is_dir |= fentry_is_dir(entry);
 
-		if(uid != 0 && entry->uid != uid)
+		if(uid != 0 && fentry_get_uid(entry) != uid)
 		{
 			show_error_msgf("Access error", "You are not owner of %s", entry->name);
 			return;
@@ -480,7 +482,7 @@ files_chmod(view_t *view, const char mode[], int recurse_dirs)
 	while(iter_selection_or_current(view, &entry) && !ui_cancellation_requested())
 	{
 		char inv[16];
-		snprintf(inv, sizeof(inv), "0%o", entry->mode & 0xff);
+		snprintf(inv, sizeof(inv), "0%o", fentry_get_mode(entry) & 0xff);
 		chmod_file_in_list(view, entry_to_pos(view, entry), mode, inv,
 				recurse_dirs);
 	}
@@ -143,6 +143,7 @@ redraw_file_info_dialog(void)
 	werase(menu_win);
 
 	curr = get_current_entry(view);
+	fentry_ensure_meta(curr, FMETA_ALL);
 
 	size = fentry_get_size(view, curr);
 	size_not_precise = friendly_size_notation(size, sizeof(size_buf), size_buf);
@@ -165,20 +166,20 @@ redraw_file_info_dialog(void)
 	curr_y += show_mime_type(view, curr_y);
 
 #ifndef _WIN32
-	get_perm_string(perm_buf, sizeof(perm_buf), curr->mode);
+	get_perm_string(perm_buf, sizeof(perm_buf), fentry_get_mode(curr));
 	curr_y += print_item("Permissions: ", perm_buf, curr_y);
 #else
 	copy_str(perm_buf, sizeof(perm_buf), attr_str_long(curr->attrs));
 	curr_y += print_item("Attributes: ", perm_buf, curr_y);
 #endif
 
-	format_time(curr->mtime, buf, sizeof(buf));
+	format_time(fentry_get_mtime(curr), buf, sizeof(buf));
 	curr_y += print_item("Modified: ", buf, curr_y);
 
-	format_time(curr->atime, buf, sizeof(buf));
+	format_time(fentry_get_atime(curr), buf, sizeof(buf));
 	curr_y += print_item("Accessed: ", buf, curr_y);
 
-	format_time(curr->ctime, buf, sizeof(buf));
+	format_time(fentry_get_ctime(curr), buf, sizeof(buf));
 #ifndef _WIN32
 	curr_y += print_item("Changed: ", buf, curr_y);
 #else
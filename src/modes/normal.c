@@ -58,6 +58,7 @@
 #include "../cmd_core.h"
 #include "../filelist.h"
 #include "../flist_hist.h"
+#include "../flist_meta.h"
 #include "../filtering.h"
 #include "../flist_pos.h"
 #include "../flist_sel.h"
@@ -518,10 +519,12 @@ cmd_ctrl_b(key_info_t key_info, keys_info_t *keys_info)
 	}
 }
 
-/* Resets selection and search highlight. */
+/* Resets selection and search highlight, stops background loading of file
+ * metadata. */
 static void
 cmd_ctrl_c(key_info_t key_info, keys_info_t *keys_info)
 {
+	(void)flist_meta_cancel(curr_view);
 	ui_view_reset_search_highlight(curr_view);
 	flist_sel_stash(curr_view);
 	redraw_current_view();
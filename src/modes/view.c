@@ -25,7 +25,7 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* ptrdiff_t size_t */
-#include <string.h> /* memset() strdup() */
+#include <string.h> /* memset() strdup() strlen() */
 #include <stdio.h>  /* fclose() snprintf() */
 #include <stdlib.h> /* free() */
 
@@ -1056,26 +1056,33 @@ get_view_data(view_info_t *vi, const char file_to_view[])
 	FILE *fp;
 	const char *const viewer = qv_get_viewer(file_to_view);
 
-	if(vi->viewer == NULL && is_null_or_empty(viewer))
+	if(vi->viewer == NULL && is_null_or_empty(viewer) && is_dir(file_to_view))
 	{
-		if(is_dir(file_to_view))
-		{
-			ui_cancellation_reset();
-			ui_cancellation_enable();
-			fp = qv_view_dir(file_to_view);
-			ui_cancellation_disable();
-		}
-		else
+		char *text;
+
+		ui_cancellation_reset();
+		ui_cancellation_enable();
+		text = qv_view_dir(file_to_view);
+		ui_cancellation_disable();
+
+		if(text == NULL)
 		{
-			fp = os_fopen(file_to_view, "rb");
+			return 2;
 		}
 
+		vi->lines = break_into_lines(text, strlen(text), &vi->nlines, 0);
+		free(text);
+	}
+	else if(vi->viewer == NULL && is_null_or_empty(viewer))
+	{
+		fp = os_fopen(file_to_view, "rb");
 		if(fp == NULL)
 		{
 			return 2;
 		}
 
 		vi->lines = read_file_lines(fp, &vi->nlines);
+		fclose(fp);
 	}
 	else
 	{
@@ -1121,9 +1128,9 @@ get_view_data(view_info_t *vi, const char file_to_view[])
 		ui_cancellation_enable();
 		vi->lines = read_stream_lines(fp, &vi->nlines, 0, NULL, NULL);
 		ui_cancellation_disable();
-	}
 
-	fclose(fp);
+		fclose(fp);
+	}
 
 	if(vi->lines == NULL || vi->nlines == 0)
 	{
@@ -51,6 +51,7 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "background.h"
 #include "bmarks.h"
 #include "status.h"
@@ -179,6 +180,9 @@ ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 	update_string(&ops->delete_prg, cfg.delete_prg);
 	ops->use_system_calls = cfg.use_system_calls;
 	ops->fast_file_cloning = cfg.fast_file_cloning;
+	ops->io_nocache = cfg.io_nocache;
+	ops->io_direct = cfg.io_direct;
+	ops->copy_threads = cfg.copy_threads;
 	ops->base_dir = strdup(base_dir);
 	ops->target_dir = strdup(target_dir);
 	ops->bg = bg;
@@ -201,9 +205,12 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 		return;
 	}
 
-	/* Check once and cache result, it should be the same for each invocation. */
-	if(ops->estim->total_items == 0)
+	/* Check once and cache result, it should be the same for each invocation.
+	 * Totals can't be used for this as they are updated by planning thread. */
+	if(!ops->eta_checked)
 	{
+		ops->eta_checked = 1;
+
 		switch(ops->main_op)
 		{
 			case OP_MOVE:
@@ -238,6 +245,15 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 		}
 	}
 
+	if(!ops->shallow_eta && (ops->main_op == OP_COPY ||
+				ops->main_op == OP_COPYF || ops->main_op == OP_COPYA))
+	{
+		/* Copying follows the plan instead of traversing the tree once again and
+		 * doesn't need to wait for the estimation to finish. */
+		ioeta_plan(ops->estim, src);
+		return;
+	}
+
 	ioeta_calculate(ops->estim, src, ops->shallow_eta);
 }
 
@@ -261,6 +277,7 @@ ops_free(ops_t *ops)
 		return;
 	}
 
+	workers_free(ops->copy_workers);
 	ioeta_free(ops->estim);
 	free(ops->errors);
 	free(ops->slow_fs_list);
@@ -507,6 +524,10 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg2.dst = dst,
 		.arg3.crs = ca_to_crs(conflict_action),
 		.arg4.fast_file_cloning = fast_file_cloning,
+		.arg4.nocache = (ops == NULL) ? cfg.io_nocache : ops->io_nocache,
+		.arg4.direct_io = (ops == NULL) ? cfg.io_direct : ops->io_direct,
+		.arg4.nthreads = (ops == NULL) ? cfg.copy_threads : ops->copy_threads,
+		.arg4.workers = (ops == NULL) ? NULL : &ops->copy_workers,
 	};
 	return exec_io_op(ops, &ior_cp, &args, data == NULL);
 }
@@ -608,6 +629,8 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 			.arg3.crs = ca_to_crs(conflict_action),
 			/* It's safe to always use fast file cloning on moving files. */
 			.arg4.fast_file_cloning = 1,
+			.arg4.nocache = (ops == NULL) ? cfg.io_nocache : ops->io_nocache,
+			.arg4.direct_io = (ops == NULL) ? cfg.io_direct : ops->io_direct,
 		};
 		result = exec_io_op(ops, &ior_mv, &args, data == NULL);
 	}
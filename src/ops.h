@@ -85,6 +85,7 @@ typedef struct
 	                          and also frees it on ops_free(). */
 	const char *descr;     /* Description of operations. */
 	int shallow_eta;       /* Count only top level items, without recursion. */
+	int eta_checked;       /* Whether shallow_eta was set up already. */
 	int bg;                /* Executed in background (no user interaction). */
 	struct bg_op_t *bg_op; /* Information for background operation. */
 	char *errors;          /* Multi-line string of errors. */
@@ -95,6 +96,12 @@ typedef struct
 	char *delete_prg;      /* Copy of 'deleteprg' option value. */
 	int use_system_calls;  /* Copy of 'syscalls' option value. */
 	int fast_file_cloning; /* Copy of part of 'iooptions' option value. */
+	int io_nocache;        /* Copy of part of 'iooptions' option value. */
+	int io_direct;         /* Copy of part of 'iooptions' option value. */
+	int copy_threads;      /* Copy of 'copythreads' option value. */
+
+	/* Threads that copy files for all operations, created on first use. */
+	struct workers_t *copy_workers;
 
 	char *base_dir;   /* Base directory in which operation is taking place. */
 	char *target_dir; /* Target directory of the operation (same as base_dir if
@@ -122,6 +122,7 @@ static int validate_decorations(const char prefix[], const char suffix[]);
 static void free_file_decs(file_dec_t *name_decs, int count);
 static void columns_handler(OPT_OP op, optval_t val);
 static void confirm_handler(OPT_OP op, optval_t val);
+static void copythreads_handler(OPT_OP op, optval_t val);
 static void cpoptions_handler(OPT_OP op, optval_t val);
 static void cvoptions_handler(OPT_OP op, optval_t val);
 static void deleteprg_handler(OPT_OP op, optval_t val);
@@ -143,8 +144,10 @@ static void ignorecase_handler(OPT_OP op, optval_t val);
 static void incsearch_handler(OPT_OP op, optval_t val);
 static void iooptions_handler(OPT_OP op, optval_t val);
 static void laststatus_handler(OPT_OP op, optval_t val);
+static void lazystat_handler(OPT_OP op, optval_t val);
 static void lines_handler(OPT_OP op, optval_t val);
 static void locateprg_handler(OPT_OP op, optval_t val);
+static void maxwatches_handler(OPT_OP op, optval_t val);
 static void mintimeoutlen_handler(OPT_OP op, optval_t val);
 static void scroll_line_down(view_t *view);
 static void quickview_handler(OPT_OP op, optval_t val);
@@ -205,6 +208,8 @@ static void set_view_columns_option(view_t *view, const char value[],
 static void add_column(columns_t *columns, column_info_t column_info);
 static int map_name(const char name[], void *arg);
 static void resort_view(view_t * view);
+static void sortthreads_handler(OPT_OP op, optval_t val);
+static void statthreads_handler(OPT_OP op, optval_t val);
 static void statusline_handler(OPT_OP op, optval_t val);
 static void suggestoptions_handler(OPT_OP op, optval_t val);
 static void reset_suggestoptions(void);
@@ -289,6 +294,7 @@ static const char *cvoptions_vals[][2] = {
 	{ "autocmds", "trigger autocommands on entering/leaving custom views" },
 	{ "localopts", "reset local options on entering/leaving custom views" },
 	{ "localfilter", "reset local filter on entering/leaving custom views" },
+	{ "stream", "show files of custom views while command is running" },
 };
 
 /* Possible values of 'confirm'. */
@@ -342,6 +348,8 @@ ARRAY_GUARD(suggestoptions_vals, NUM_SUGGESTION_FLAGS);
 /* Possible flags of 'iooptions'. */
 static const char *iooptions_vals[][2] = {
 	{ "fastfilecloning", "use COW if FS supports it" },
+	{ "nocache",         "don't keep copied data in page cache" },
+	{ "directio",        "bypass page cache for large files" },
 };
 
 /* Possible flags of 'shortmess' and their count. */
@@ -520,6 +528,7 @@ static const char *vifminfo_set[][2] = {
 	[BIT(VINFO_REGISTERS)] = { "registers", "contents of registers" },
 	[BIT(VINFO_PHISTORY)]  = { "phistory",  "prompt history" },
 	[BIT(VINFO_FHISTORY)]  = { "fhistory",  "local filter history" },
+	[BIT(VINFO_DCACHE)]    = { "dcache",    "sizes of directories" },
 };
 ARRAY_GUARD(vifminfo_set, NUM_VINFO);
 
@@ -583,6 +592,10 @@ options[] = {
 	  OPT_SET, ARRAY_LEN(confirm_vals), confirm_vals, &confirm_handler, NULL,
 	  { .ref.bool_val = &cfg.confirm },
 	},
+	{ "copythreads", "", "number of threads copying files",
+	  OPT_INT, 0, NULL, &copythreads_handler, NULL,
+	  { .ref.int_val = &cfg.copy_threads },
+	},
 	{ "cpoptions", "cpo", "compatibility options",
 	  OPT_CHARSET, ARRAY_LEN(cpoptions_vals), cpoptions_vals, &cpoptions_handler,
 		NULL,
@@ -668,6 +681,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &laststatus_handler, NULL,
 	  { .ref.bool_val = &cfg.display_statusline },
 	},
+	{ "lazystat", "", "query metadata of files only when it's needed",
+	  OPT_BOOL, 0, NULL, &lazystat_handler, NULL,
+	  { .ref.bool_val = &cfg.lazy_stat },
+	},
 	{ "lines", "", "height of TUI in chars",
 	  OPT_INT, 0, NULL, &lines_handler, NULL,
 	  { .ref.int_val = &cfg.lines },
@@ -676,6 +693,10 @@ options[] = {
 	  OPT_STR, 0, NULL, &locateprg_handler, NULL,
 	  { .ref.str_val = &cfg.locate_prg },
 	},
+	{ "maxwatches", "", "number of extra directories to watch for changes",
+	  OPT_INT, 0, NULL, &maxwatches_handler, NULL,
+	  { .ref.int_val = &cfg.max_watches },
+	},
 	{ "mintimeoutlen", "", "delay between input polls",
 	  OPT_INT, 0, NULL, &mintimeoutlen_handler, NULL,
 	  { .ref.int_val = &cfg.min_timeout_len },
@@ -732,6 +753,14 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &sortnumbers_handler, NULL,
 	  { .ref.bool_val = &cfg.sort_numbers },
 	},
+	{ "sortthreads", "", "number of threads sorting files",
+	  OPT_INT, 0, NULL, &sortthreads_handler, NULL,
+	  { .ref.int_val = &cfg.sort_threads },
+	},
+	{ "statthreads", "", "number of threads querying file metadata",
+	  OPT_INT, 0, NULL, &statthreads_handler, NULL,
+	  { .ref.int_val = &cfg.stat_threads },
+	},
 	{ "statusline", "stl", "format of the status line",
 	  OPT_STR, 0, NULL, &statusline_handler, NULL,
 	  { .ref.str_val = &cfg.status_line },
@@ -1148,7 +1177,9 @@ init_sizefmt(optval_t *val)
 static void
 init_iooptions(optval_t *val)
 {
-	val->set_items = (cfg.fast_file_cloning != 0) << 0;
+	val->set_items = ((cfg.fast_file_cloning != 0) << 0)
+	               | ((cfg.io_nocache != 0) << 1)
+	               | ((cfg.io_direct != 0) << 2);
 }
 
 /* Default-initializes whether to display file numbers. */
@@ -1879,6 +1910,22 @@ confirm_handler(OPT_OP op, optval_t val)
 	cfg.confirm = val.set_items;
 }
 
+/* Number of threads used to copy files of background operations. */
+static void
+copythreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("copythreads", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.copy_threads = val.int_val;
+}
+
 /* Parses set of compatibility flags and changes configuration accordingly. */
 static void
 cpoptions_handler(OPT_OP op, optval_t val)
@@ -2102,6 +2149,8 @@ static void
 iooptions_handler(OPT_OP op, optval_t val)
 {
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
+	cfg.io_nocache = ((val.set_items & 2) != 0);
+	cfg.io_direct = ((val.set_items & 4) != 0);
 }
 
 static void
@@ -2120,6 +2169,12 @@ laststatus_handler(OPT_OP op, optval_t val)
 	curr_stats.need_update = UT_REDRAW;
 }
 
+static void
+lazystat_handler(OPT_OP op, optval_t val)
+{
+	cfg.lazy_stat = val.bool_val;
+}
+
 /* Handles updates of the global 'lines' option, which reflects height of
  * terminal. */
 static void
@@ -2161,6 +2216,23 @@ locateprg_handler(OPT_OP op, optval_t val)
 	(void)replace_string(&cfg.locate_prg, val.str_val);
 }
 
+/* Number of directories of tree and custom views watched for changes besides
+ * the current one. */
+static void
+maxwatches_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("maxwatches", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.max_watches = val.int_val;
+}
+
 /* Minimum period on waiting for the input.  Works together with timeoutlen. */
 static void
 mintimeoutlen_handler(OPT_OP op, optval_t val)
@@ -3011,6 +3083,39 @@ resort_view(view_t * view)
 	ui_view_schedule_redraw(curr_view);
 }
 
+/* Number of threads used to sort long lists of files. */
+static void
+sortthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("sortthreads", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.sort_threads = val.int_val;
+}
+
+/* Number of threads used to query metadata of files of directories being
+ * loaded. */
+static void
+statthreads_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		val.int_val = 0;
+		set_option("statthreads", val, OPT_GLOBAL);
+		return;
+	}
+
+	cfg.stat_threads = val.int_val;
+}
+
 static void
 statusline_handler(OPT_OP op, optval_t val)
 {
@@ -70,6 +70,7 @@
 #include "flist_hist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
+#include "flist_stream.h"
 #include "macros.h"
 #include "opt_handlers.h"
 #include "status.h"
@@ -236,7 +237,8 @@ is_executable(const char full_path[], const dir_entry_t *curr, int dont_execute,
 	int executable;
 #ifndef _WIN32
 	executable = curr->type == FT_EXEC ||
-			(runnable && os_access(full_path, X_OK) == 0 && S_ISEXE(curr->mode));
+			(runnable && os_access(full_path, X_OK) == 0 &&
+			 S_ISEXE(fentry_get_mode(curr)));
 #else
 	executable = curr->type == FT_EXEC;
 #endif
@@ -1372,6 +1374,22 @@ output_to_custom_flist(view_t *view, const char cmd[], int very,
 	char *title;
 	int error;
 
+	/* Filling the view in background requires fully functional TUI. */
+	if(!interactive && (cfg.cvoptions & CVO_STREAM) &&
+			curr_stats.load_stage == 3)
+	{
+		setup_shellout_env();
+		error = flist_stream_start(view, cmd, very);
+		cleanup_shellout_env();
+
+		if(error)
+		{
+			show_error_msgf("Trouble running command", "Unable to run: %s", cmd);
+			return 1;
+		}
+		return 0;
+	}
+
 	title = format_str("!%s", cmd);
 	flist_custom_start(view, title);
 	free(title);
@@ -23,11 +23,16 @@
 
 #include <assert.h> /* assert() */
 #include <ctype.h>
-#include <stdlib.h> /* abs() qsort() */
-#include <string.h> /* strcmp() strrchr() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* abs() free() qsort() */
+#include <string.h> /* memcmp() memcpy() memmove() strcmp() strdup()
+                       strrchr() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
 #include "ui/ui.h"
 #include "utils/dynarray.h"
 #include "utils/fs.h"
@@ -38,18 +43,108 @@
 #include "utils/string_array.h"
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
+#include "utils/workers.h"
 #include "filelist.h"
 #include "filtering.h"
+#include "flist_meta.h"
 #include "status.h"
 #include "types.h"
 
+/* Minimal number of entries per thread for parallel sorting to pay off. */
+#define MIN_PSORT_RUN 16384
+/* Maximum number of threads used for sorting. */
+#define MAX_PSORT_THREADS 64
+
+/* Single sorting key along with its data. */
+typedef struct
+{
+	char key;   /* Sorting key, negative for descending order. */
+	void *data; /* Data of the key (compiled group for SK_BY_GROUPS). */
+	int group;  /* Index of SK_BY_GROUPS key among such keys or -1. */
+}
+sort_key_t;
+
+/* Sorting configuration of a view flattened into a list of keys. */
+typedef struct
+{
+	sort_key_t *keys; /* Keys in order of decreasing priority. */
+	int nkeys;        /* Number of keys. */
+	int ngroups;      /* Number of SK_BY_GROUPS keys. */
+}
+sort_spec_t;
+
+/* Data of an entry extracted once before sorting. */
+typedef struct
+{
+	dir_entry_t *entry; /* Entry itself. */
+	const char *name;   /* Name of the entry or its short path in custom view. */
+	char *short_path;   /* Allocated short path or NULL. */
+	char *lower;        /* Lower-cased name or NULL if it's not needed. */
+	const char *ext;    /* Last dot in the name or NULL. */
+	const char *target; /* Target of a symbolic link if it's needed or NULL. */
+	regmatch_t *groups; /* Matches of every sorting group in the name. */
+	uint64_t size;      /* Size of the entry if it's needed. */
+	uint64_t nitems;    /* Number of items in a directory if it's needed. */
+	int idx;            /* Original position of the entry. */
+	int is_dir;         /* Whether entry is a directory. */
+	int is_parent;      /* Whether entry is a link to parent directory. */
+}
+sort_item_t;
+
+/* State of parallel sorting that is shared among its threads.  Work is done in
+ * phases, each of which consists of independent tasks.  The first phase sorts
+ * runs of items, then every phase merges pairs of runs. */
+typedef struct
+{
+	sort_item_t *src;   /* Input of current phase. */
+	sort_item_t *dst;   /* Output of current merging phase. */
+	size_t *bounds;     /* Borders of sorted runs in src (nruns + 1 elements). */
+	int nruns;          /* Number of runs. */
+	int nparts;         /* Number of tasks each merge is split into. */
+	int merging;        /* Whether current phase merges runs. */
+	int ntasks;         /* Number of tasks of current phase. */
+	workers_t *workers; /* Threads that perform tasks. */
+}
+psort_job_t;
+
 static void sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
-		size_t nchildren, int root);
-static void sort_sequence(dir_entry_t *entries, size_t nentries);
-static void sort_by_groups(dir_entry_t *entries, size_t nentries);
-static void sort_by_key(dir_entry_t *entries, size_t nentries, char key,
-		void *data);
-static int sort_dir_list(const void *one, const void *two);
+		size_t nchildren, int root, const sort_spec_t *spec);
+static void sort_sequence(dir_entry_t *entries, size_t nentries,
+		const sort_spec_t *spec);
+static int find_insert_pos(const dir_entry_t entries[], int nentries,
+		const dir_entry_t *entry, const sort_spec_t *spec);
+static int sort_items_in_parallel(sort_item_t *items, size_t nitems);
+static void psort_phase(psort_job_t *job);
+static void psort_task(void *task, void *arg);
+static void psort_merge(psort_job_t *job, int task);
+static size_t co_rank(size_t k, const sort_item_t a[], size_t m,
+		const sort_item_t b[], size_t n);
+static sort_item_t * make_items(dir_entry_t *entries, size_t nentries,
+		const sort_spec_t *spec);
+static void free_items(sort_item_t *items, size_t nitems);
+static void permute_entries(dir_entry_t *entries, sort_item_t *items,
+		size_t nentries);
+static int build_spec(sort_spec_t *spec);
+static int update_groups_cache(view_t *view, const char groups[]);
+static void add_spec_key(sort_spec_t *spec, char key, void *data);
+static void free_spec(sort_spec_t *spec);
+static int spec_has_key(const sort_spec_t *spec, SortingKey key);
+static int compare_by_all_keys(const dir_entry_t *a, const dir_entry_t *b,
+		const sort_spec_t *spec);
+static int compare_by_key(const dir_entry_t *a, const dir_entry_t *b,
+		char key, void *data);
+static int compare_items(const void *a, const void *b);
+static int compare_items_by_key(const sort_item_t *a, const sort_item_t *b,
+		const sort_key_t *key);
+static int compare_item_names(const sort_item_t *a, const sort_item_t *b,
+		int ignore_case);
+static int compare_item_exts(const sort_item_t *a, const sort_item_t *b,
+		int dirs_first);
+static int compare_item_targets(const sort_item_t *a, const sort_item_t *b);
+static int compare_item_groups(const sort_item_t *a, const sort_item_t *b,
+		int group);
+static int compare_entries(const dir_entry_t *first,
+		const dir_entry_t *second, char key, void *data);
 TSTATIC int strnumcmp(const char s[], const char t[]);
 #if !defined(HAVE_STRVERSCMP_FUNC) || !HAVE_STRVERSCMP_FUNC
 static int vercmp(const char s[], const char t[]);
@@ -61,6 +156,8 @@ static int compare_entry_names(const dir_entry_t *a, const dir_entry_t *b,
 static int compare_full_file_names(const char s[], const char t[],
 		int ignore_case);
 static int compare_file_names(const char s[], const char t[], int ignore_case);
+static int compare_names(const char s[], const char t[], const char s_lower[],
+		const char t_lower[]);
 static int compare_file_sizes(const dir_entry_t *f, const dir_entry_t *s);
 static int compare_item_count(const dir_entry_t *f, int fdir,
 		const dir_entry_t *s, int sdir);
@@ -75,17 +172,14 @@ static const char *view_sort;
 static const char *view_sort_groups;
 /* Whether the view displays custom file list. */
 static int custom_view;
-/* Whether it's descending sort. */
-static int sort_descending;
-/* Key used to sort entries in current sorting round. */
-static SortingKey sort_type;
-/* Sorting key specific data. */
-static void *sort_data;
+/* Keys used by compare_items(). */
+static const sort_spec_t *sort_spec;
 
 void
 sort_view(view_t *v)
 {
 	dir_entry_t *unsorted_list;
+	sort_spec_t spec;
 
 	if(v->sort[0] > SK_LAST)
 	{
@@ -98,11 +192,18 @@ sort_view(view_t *v)
 	view_sort_groups = v->sort_groups;
 	custom_view = flist_custom_active(v);
 
+	if(build_spec(&spec) != 0)
+	{
+		/* Just do nothing on memory error. */
+		return;
+	}
+
 	if(!custom_view || !cv_tree(v->custom.type))
 	{
 		/* Tree sorting works fine for flat list, but requires a bit more
 		 * resources, so skip it. */
-		sort_sequence(&v->dir_entry[0], v->list_rows);
+		sort_sequence(&v->dir_entry[0], v->list_rows, &spec);
+		free_spec(&spec);
 		return;
 	}
 
@@ -118,7 +219,7 @@ sort_view(view_t *v)
 	v->dir_entry = dynarray_extend(NULL, v->list_rows*sizeof(*v->dir_entry));
 	if(v->dir_entry != NULL)
 	{
-		sort_tree_slice(&v->dir_entry[0], unsorted_list, v->list_rows, 1);
+		sort_tree_slice(&v->dir_entry[0], unsorted_list, v->list_rows, 1, &spec);
 	}
 	else
 	{
@@ -135,13 +236,15 @@ sort_view(view_t *v)
 	{
 		filters_drop_temporaries(v, unsorted_list);
 	}
+
+	free_spec(&spec);
 }
 
 /* Sorts one level of a tree per invocation, recurring to sort all nested
  * trees. */
 static void
 sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
-		size_t nchildren, int root)
+		size_t nchildren, int root, const sort_spec_t *spec)
 {
 	int i = 0;
 	size_t pos = 0U;
@@ -155,7 +258,7 @@ sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		++i;
 	}
 
-	sort_sequence(entries, i);
+	sort_sequence(entries, i, spec);
 
 	/* Finish sorting of this level by placing nodes at their corresponding
 	 * position starting with the last one.  Each subtree is then sorted
@@ -168,7 +271,7 @@ sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 		if(entries[pos].child_count != 0)
 		{
 			sort_tree_slice(&entries[pos + 1U], &children[entries[pos].child_pos + 1],
-					entries[pos].child_count, 0);
+					entries[pos].child_count, 0, spec);
 		}
 		entries[pos].child_pos = root ? 0 : pos + 1;
 	}
@@ -177,6 +280,8 @@ sort_tree_slice(dir_entry_t *entries, const dir_entry_t *children,
 void
 sort_entries(view_t *v, entries_t entries)
 {
+	sort_spec_t spec;
+
 	if(v->sort_g[0] > SK_LAST)
 	{
 		/* Completely skip sorting if primary key isn't set. */
@@ -188,91 +293,648 @@ sort_entries(view_t *v, entries_t entries)
 	view_sort_groups = v->sort_groups_g;
 	custom_view = flist_custom_active(v);
 
-	sort_sequence(entries.entries, entries.nentries);
+	if(build_spec(&spec) == 0)
+	{
+		sort_sequence(entries.entries, entries.nentries, &spec);
+		free_spec(&spec);
+	}
 }
 
-/* Sorts sequence of file entries (plain list, not tree). */
+void
+sort_view_tail(view_t *v, int nsorted)
+{
+	sort_spec_t spec;
+	dir_entry_t *added;
+	int nadded;
+
+	if(v->sort[0] > SK_LAST || nsorted >= v->list_rows)
+	{
+		/* Nothing to sort or new entries are to stay at the end. */
+		return;
+	}
+
+	if(nsorted == 0 || (flist_custom_active(v) && cv_tree(v->custom.type)))
+	{
+		sort_view(v);
+		return;
+	}
+
+	view = v;
+	view_sort = v->sort;
+	view_sort_groups = v->sort_groups;
+	custom_view = flist_custom_active(v);
+
+	if(build_spec(&spec) != 0)
+	{
+		/* Just do nothing on memory error. */
+		return;
+	}
+
+	nadded = v->list_rows - nsorted;
+	sort_sequence(&v->dir_entry[nsorted], nadded, &spec);
+
+	added = reallocarray(NULL, nadded, sizeof(*added));
+	if(added != NULL)
+	{
+		int i;
+		int nold = nsorted;
+		int end = v->list_rows;
+
+		/* Entries are placed starting from the last one and each of them is
+		 * positioned among older entries by a binary search, so that a batch costs
+		 * a logarithmic number of comparisons per entry instead of comparing with
+		 * the whole list. */
+		memcpy(added, &v->dir_entry[nsorted], nadded*sizeof(*added));
+		for(i = nadded - 1; i >= 0; --i)
+		{
+			const int pos = find_insert_pos(v->dir_entry, nold, &added[i], &spec);
+			const int nafter = nold - pos;
+
+			end -= nafter;
+			memmove(&v->dir_entry[end], &v->dir_entry[pos],
+					nafter*sizeof(*v->dir_entry));
+			v->dir_entry[--end] = added[i];
+			nold = pos;
+		}
+
+		free(added);
+	}
+
+	free_spec(&spec);
+}
+
+/* Finds position of a new entry among sorted ones, equal entries that were
+ * there before go first.  Returns the position. */
+static int
+find_insert_pos(const dir_entry_t entries[], int nentries,
+		const dir_entry_t *entry, const sort_spec_t *spec)
+{
+	int lo = 0, hi = nentries;
+	while(lo < hi)
+	{
+		const int mid = lo + (hi - lo)/2;
+		if(is_parent_dir(entries[mid].name) ||
+				compare_by_all_keys(entry, &entries[mid], spec) >= 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* Sorts sequence of file entries (plain list, not tree).  Data needed for
+ * comparison is extracted once, then all keys are compared in a single pass
+ * over a compact array, which is applied to the entries at the end. */
 static void
-sort_sequence(dir_entry_t *entries, size_t nentries)
+sort_sequence(dir_entry_t *entries, size_t nentries, const sort_spec_t *spec)
 {
-	int i = SK_COUNT;
-	while(--i >= 0)
+	sort_item_t *items;
+
+	if(nentries == 0U)
+	{
+		return;
+	}
+
+	items = make_items(entries, nentries, spec);
+	if(items == NULL)
+	{
+		/* Just do nothing on memory error. */
+		return;
+	}
+
+	sort_spec = spec;
+	if(!sort_items_in_parallel(items, nentries))
+	{
+		qsort(items, nentries, sizeof(*items), &compare_items);
+	}
+	sort_spec = NULL;
+
+	permute_entries(entries, items, nentries);
+	free_items(items, nentries);
+}
+
+/* Sorts long lists of items using 'sortthreads' threads.  Comparison of items
+ * never yields zero, so result matches that of qsort().  Returns non-zero if
+ * items were sorted, otherwise zero is returned. */
+static int
+sort_items_in_parallel(sort_item_t *items, size_t nitems)
+{
+	int i;
+	psort_job_t job = { .src = items };
+	const int nthreads = MIN(MAX(cfg.sort_threads, 1), MAX_PSORT_THREADS);
+	const int nruns = MIN((size_t)nthreads, nitems/MIN_PSORT_RUN);
+
+	if(nruns < 2)
+	{
+		return 0;
+	}
+
+	job.dst = reallocarray(NULL, nitems, sizeof(*job.dst));
+	job.bounds = reallocarray(NULL, nruns + 1, sizeof(*job.bounds));
+	if(job.dst == NULL || job.bounds == NULL)
+	{
+		free(job.dst);
+		free(job.bounds);
+		return 0;
+	}
+
+	/* Current thread takes part in the work as well. */
+	job.workers = workers_create(nthreads - 1, &psort_task, &job);
+	if(job.workers == NULL)
+	{
+		free(job.dst);
+		free(job.bounds);
+		return 0;
+	}
+
+	job.nruns = nruns;
+	job.nparts = nthreads;
+	for(i = 0; i <= nruns; ++i)
+	{
+		job.bounds[i] = nitems*i/nruns;
+	}
+
+	job.ntasks = nruns;
+	psort_phase(&job);
+
+	job.merging = 1;
+	while(job.nruns > 1)
+	{
+		sort_item_t *const src = job.src;
+
+		job.ntasks = (job.nruns + 1)/2*job.nparts;
+		psort_phase(&job);
+
+		/* Borders of merged runs are every second border of their sources. */
+		for(i = 0; 2*i < job.nruns; ++i)
+		{
+			job.bounds[i + 1] = job.bounds[MIN(2*i + 2, job.nruns)];
+		}
+		job.nruns = (job.nruns + 1)/2;
+
+		job.src = job.dst;
+		job.dst = src;
+	}
+
+	if(job.src != items)
+	{
+		memcpy(items, job.src, nitems*sizeof(*items));
+		job.dst = job.src;
+	}
+
+	workers_free(job.workers);
+	free(job.dst);
+	free(job.bounds);
+	return 1;
+}
+
+/* Performs all tasks of a phase of parallel sorting.  Current thread does all
+ * of them if other threads can't be started. */
+static void
+psort_phase(psort_job_t *job)
+{
+	int i;
+	for(i = 0; i < job->ntasks; ++i)
+	{
+		if(workers_append(job->workers, (void *)(long)i) != 0)
+		{
+			psort_task((void *)(long)i, job);
+		}
+	}
+	workers_wait(job->workers);
+}
+
+/* Performs a task of current phase. */
+static void
+psort_task(void *task, void *arg)
+{
+	psort_job_t *const job = arg;
+	const int idx = (long)task;
+
+	if(job->merging)
+	{
+		psort_merge(job, idx);
+	}
+	else
+	{
+		const size_t from = job->bounds[idx], to = job->bounds[idx + 1];
+		qsort(job->src + from, to - from, sizeof(*job->src), &compare_items);
+	}
+}
+
+/* Merges a part of a pair of runs.  Every merge is split into equal parts of
+ * its output, borders of which are found in each of the runs by a binary
+ * search. */
+static void
+psort_merge(psort_job_t *job, int task)
+{
+	const int pair = task/job->nparts, part = task%job->nparts;
+	const size_t base = job->bounds[2*pair];
+	const size_t mid = job->bounds[MIN(2*pair + 1, job->nruns)];
+	const size_t end = job->bounds[MIN(2*pair + 2, job->nruns)];
+	const sort_item_t *const a = job->src + base;
+	const sort_item_t *const b = job->src + mid;
+	const size_t m = mid - base, n = end - mid;
+	const size_t lo = (m + n)*part/job->nparts;
+	const size_t hi = (m + n)*(part + 1)/job->nparts;
+
+	size_t i = co_rank(lo, a, m, b, n), j = lo - i;
+	const size_t i_end = co_rank(hi, a, m, b, n), j_end = hi - i_end;
+	sort_item_t *out = job->dst + base + lo;
+
+	while(i < i_end && j < j_end)
+	{
+		*out++ = (compare_items(&a[i], &b[j]) < 0) ? a[i++] : b[j++];
+	}
+	while(i < i_end)
+	{
+		*out++ = a[i++];
+	}
+	while(j < j_end)
+	{
+		*out++ = b[j++];
+	}
+}
+
+/* Finds how many of the first k elements of merge of two sorted arrays come
+ * from the first array.  Returns the number. */
+static size_t
+co_rank(size_t k, const sort_item_t a[], size_t m, const sort_item_t b[],
+		size_t n)
+{
+	size_t lo = (k > n) ? k - n : 0U;
+	size_t hi = MIN(k, m);
+	while(lo < hi)
+	{
+		const size_t i = lo + (hi - lo)/2;
+		if(compare_items(&a[i], &b[k - i - 1]) > 0)
+		{
+			hi = i;
+		}
+		else
+		{
+			lo = i + 1;
+		}
+	}
+	return lo;
+}
+
+/* Extracts data needed to sort entries by specified keys.  Returns newly
+ * allocated array or NULL on error. */
+static sort_item_t *
+make_items(dir_entry_t *entries, size_t nentries, const sort_spec_t *spec)
+{
+	size_t i;
+	int meta = FMETA_NONE;
+	const int need_lower = spec_has_key(spec, SK_BY_INAME);
+	const int need_short = custom_view
+	                    && (need_lower || spec_has_key(spec, SK_BY_NAME));
+	const int need_size = spec_has_key(spec, SK_BY_SIZE);
+	const int need_nitems = spec_has_key(spec, SK_BY_NITEMS);
+	const int need_target = spec_has_key(spec, SK_BY_TARGET);
+
+	/* Matches of groups are stored right after items. */
+	sort_item_t *const items = reallocarray(NULL, nentries,
+			sizeof(*items) + spec->ngroups*sizeof(*items->groups));
+	regmatch_t *groups;
+	if(items == NULL)
+	{
+		return NULL;
+	}
+	groups = (regmatch_t *)(items + nentries);
+
+	for(i = 0U; i < (size_t)spec->nkeys; ++i)
+	{
+		meta |= flist_meta_of_key(abs(spec->keys[i].key));
+	}
+
+	for(i = 0U; i < nentries; ++i)
+	{
+		dir_entry_t *const entry = &entries[i];
+		sort_item_t *const item = &items[i];
+		char buf[PATH_MAX + 1];
+		int j;
+
+		fentry_ensure_meta(entry, meta);
+
+		item->entry = entry;
+		item->idx = i;
+		item->is_dir = fentry_is_dir(entry);
+		item->is_parent = item->is_dir && is_parent_dir(entry->name);
+		item->ext = strrchr(entry->name, '.');
+		item->target = need_target ? fentry_get_target(entry) : NULL;
+
+		item->groups = &groups[i*spec->ngroups];
+		for(j = 0; j < spec->nkeys; ++j)
+		{
+			const sort_key_t *const key = &spec->keys[j];
+			if(key->group >= 0)
+			{
+				item->groups[key->group] = get_group_match(key->data, entry->name);
+			}
+		}
+		item->size = need_size ? fentry_get_size(view, entry) : 0U;
+		item->nitems = (need_nitems && item->is_dir)
+		             ? fentry_get_nitems(view, entry)
+		             : 0U;
+
+		item->short_path = NULL;
+		item->name = entry->name;
+		if(need_short)
+		{
+			get_short_path_of(view, entry, NF_NONE, 0, sizeof(buf), buf);
+			item->short_path = strdup(buf);
+			item->name = item->short_path;
+		}
+
+		item->lower = NULL;
+		if(need_lower && item->name != NULL)
+		{
+			/* Ignore too small buffer errors by not caring about part that didn't
+			 * fit. */
+			(void)str_to_lower(item->name, buf, sizeof(buf));
+			item->lower = strdup(buf);
+		}
+
+		if(item->name == NULL || (need_lower && item->lower == NULL))
+		{
+			free_items(items, i + 1U);
+			return NULL;
+		}
+	}
+
+	return items;
+}
+
+/* Frees array of items along with data they own. */
+static void
+free_items(sort_item_t *items, size_t nitems)
+{
+	size_t i;
+	for(i = 0U; i < nitems; ++i)
+	{
+		free(items[i].short_path);
+		free(items[i].lower);
+	}
+	free(items);
+}
+
+/* Reorders entries to match order of sorted items by following cycles of the
+ * permutation, so that every entry is moved only once.  Destroys original
+ * positions stored in items. */
+static void
+permute_entries(dir_entry_t *entries, sort_item_t *items, size_t nentries)
+{
+	size_t i;
+	for(i = 0U; i < nentries; ++i)
+	{
+		dir_entry_t tmp;
+		size_t j;
+
+		if((size_t)items[i].idx == i)
+		{
+			continue;
+		}
+
+		tmp = entries[i];
+		j = i;
+		while((size_t)items[j].idx != i)
+		{
+			const size_t k = items[j].idx;
+			entries[j] = entries[k];
+			items[j].idx = j;
+			j = k;
+		}
+		entries[j] = tmp;
+		items[j].idx = j;
+	}
+}
+
+/* Flattens sorting configuration of current view into a list of keys.  Returns
+ * zero on success, otherwise non-zero is returned. */
+static int
+build_spec(sort_spec_t *spec)
+{
+	int i;
+	int nregexps = 0;
+
+	if(ui_view_sort_list_contains(view_sort, SK_BY_GROUPS))
+	{
+		if(update_groups_cache(view, view_sort_groups) != 0)
+		{
+			return 1;
+		}
+		nregexps = view->sort_groups_nre;
+	}
+
+	spec->nkeys = 0;
+	spec->ngroups = 0;
+	spec->keys = reallocarray(NULL, 1 + SK_COUNT*(nregexps + 1),
+			sizeof(*spec->keys));
+	if(spec->keys == NULL)
+	{
+		return 1;
+	}
+
+	/* Directories go first unless specified otherwise. */
+	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	{
+		add_spec_key(spec, SK_BY_DIR, NULL);
+	}
+
+	for(i = 0; i < SK_COUNT; ++i)
 	{
 		const char sorting_key = view_sort[i];
+		int j;
 
 		if(abs(sorting_key) > SK_LAST)
 		{
 			continue;
 		}
 
-		if(sorting_key == SK_BY_GROUPS)
+		if(abs(sorting_key) != SK_BY_GROUPS)
 		{
-			sort_by_groups(entries, nentries);
+			add_spec_key(spec, sorting_key, NULL);
 			continue;
 		}
 
-		sort_by_key(entries, nentries, sorting_key, NULL);
+		for(j = 0; j < nregexps; ++j)
+		{
+			add_spec_key(spec, sorting_key, &view->sort_groups_re[j]);
+			spec->keys[spec->nkeys - 1].group = spec->ngroups++;
+		}
 	}
 
-	if(!ui_view_sort_list_contains(view_sort, SK_BY_DIR))
+	return 0;
+}
+
+/* Makes sure that compiled sorting groups cached in the view correspond to the
+ * value.  Groups that fail to compile are skipped.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+update_groups_cache(view_t *view, const char groups[])
+{
+	char *copy, *group, *state = NULL;
+
+	if(view->sort_groups_src != NULL &&
+			strcmp(view->sort_groups_src, groups) == 0)
 	{
-		sort_by_key(entries, nentries, SK_BY_DIR, NULL);
+		return 0;
+	}
+
+	sort_drop_cache(view);
+
+	copy = strdup(groups);
+	view->sort_groups_src = strdup(groups);
+	if(copy == NULL || view->sort_groups_src == NULL)
+	{
+		free(copy);
+		sort_drop_cache(view);
+		return 1;
 	}
+
+	group = copy;
+	while((group = split_and_get(group, ',', &state)) != NULL)
+	{
+		regex_t *const new_re = reallocarray(view->sort_groups_re,
+				view->sort_groups_nre + 1, sizeof(*new_re));
+		if(new_re == NULL)
+		{
+			free(copy);
+			sort_drop_cache(view);
+			return 1;
+		}
+		view->sort_groups_re = new_re;
+
+		if(regcomp(&new_re[view->sort_groups_nre], group,
+					REG_EXTENDED | REG_ICASE) == 0)
+		{
+			++view->sort_groups_nre;
+		}
+	}
+	free(copy);
+
+	return 0;
 }
 
-/* Sorts specified range of entries according to sorting groups option. */
+void
+sort_drop_cache(view_t *view)
+{
+	int i;
+	for(i = 0; i < view->sort_groups_nre; ++i)
+	{
+		regfree(&view->sort_groups_re[i]);
+	}
+	free(view->sort_groups_re);
+	view->sort_groups_re = NULL;
+	view->sort_groups_nre = 0;
+
+	update_string(&view->sort_groups_src, NULL);
+}
+
+/* Appends a key to the list of keys of the spec. */
 static void
-sort_by_groups(dir_entry_t *entries, size_t nentries)
+add_spec_key(sort_spec_t *spec, char key, void *data)
+{
+	spec->keys[spec->nkeys].key = key;
+	spec->keys[spec->nkeys].data = data;
+	spec->keys[spec->nkeys].group = -1;
+	++spec->nkeys;
+}
+
+/* Frees resources of the spec. */
+static void
+free_spec(sort_spec_t *spec)
+{
+	free(spec->keys);
+}
+
+/* Checks whether the key is used by the spec in any direction.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+spec_has_key(const sort_spec_t *spec, SortingKey key)
 {
-	char **groups = NULL;
-	int ngroups = 0;
-	const int optimize = (view_sort_groups != view->sort_groups_g);
 	int i;
+	for(i = 0; i < spec->nkeys; ++i)
+	{
+		if(abs(spec->keys[i].key) == (int)key)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
 
-	char *const copy = strdup(view_sort_groups);
-	char *group = copy, *state = NULL;
-	while((group = split_and_get(group, ',', &state)) != NULL)
+int
+sort_find_pos(view_t *v, const dir_entry_t *entry)
+{
+	sort_spec_t spec;
+	int l = 0, u = v->list_rows;
+
+	if(v->sort[0] > SK_LAST)
 	{
-		ngroups = add_to_string_array(&groups, ngroups, 1, group);
+		/* Unsorted list, append. */
+		return v->list_rows;
 	}
-	free(copy);
 
-	for(i = ngroups - (optimize ? 1 : 0); i >= 1; --i)
+	view = v;
+	view_sort = v->sort;
+	view_sort_groups = v->sort_groups;
+	custom_view = flist_custom_active(v);
+
+	if(build_spec(&spec) != 0)
 	{
-		regex_t regex;
-		(void)regcomp(&regex, groups[i], REG_EXTENDED | REG_ICASE);
-		sort_by_key(entries, nentries, SK_BY_GROUPS, &regex);
-		regfree(&regex);
+		return v->list_rows;
 	}
-	if(optimize && ngroups != 0)
+
+	while(l < u)
 	{
-		sort_by_key(entries, nentries, SK_BY_GROUPS, &view->primary_group);
+		const int mid = l + (u - l)/2;
+		if(compare_by_all_keys(&v->dir_entry[mid], entry, &spec) <= 0)
+		{
+			l = mid + 1;
+		}
+		else
+		{
+			u = mid;
+		}
 	}
 
-	free_string_array(groups, ngroups);
+	free_spec(&spec);
+	return l;
 }
 
-/* Sorts specified range of entries by the key in a stable way. */
-static void
-sort_by_key(dir_entry_t *entries, size_t nentries, char key, void *data)
+/* Compares two entries the same way sort_sequence() orders them.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+compare_by_all_keys(const dir_entry_t *a, const dir_entry_t *b,
+		const sort_spec_t *spec)
 {
-	unsigned int i;
+	int i;
+	int retval = 0;
 
-	if(nentries == 0U)
+	for(i = 0; i < spec->nkeys && retval == 0; ++i)
 	{
-		return;
+		retval = compare_by_key(a, b, spec->keys[i].key, spec->keys[i].data);
 	}
 
-	sort_descending = (key < 0);
-	sort_type = (SortingKey)abs(key);
-	sort_data = data;
+	return retval;
+}
 
-	for(i = 0U; i < nentries; ++i)
-	{
-		entries[i].tag = i;
-	}
+/* Compares two entries by a single sorting key.  Returns standard -1, 0, 1 for
+ * comparisons. */
+static int
+compare_by_key(const dir_entry_t *a, const dir_entry_t *b, char key,
+		void *data)
+{
+	fentry_ensure_meta(a, flist_meta_of_key(abs(key)));
+	fentry_ensure_meta(b, flist_meta_of_key(abs(key)));
 
-	qsort(entries, nentries, sizeof(*entries), &sort_dir_list);
+	return compare_entries(a, b, key, data);
 }
 
 /* Compares file names containing numbers correctly. */
@@ -336,15 +998,179 @@ skip_leading_zeros(const char str[])
 }
 #endif
 
+/* qsort() callback that compares items by all keys of current spec and keeps
+ * sorting stable.  Returns standard -1, 0, 1 for comparisons. */
 static int
-sort_dir_list(const void *one, const void *two)
+compare_items(const void *a, const void *b)
 {
-	/* TODO: refactor this function sort_dir_list(). */
+	const sort_item_t *const first = a;
+	const sort_item_t *const second = b;
+	int i;
+
+	/* Link to parent directory always goes first. */
+	if(first->is_parent != second->is_parent)
+	{
+		return first->is_parent ? -1 : 1;
+	}
+
+	for(i = 0; i < sort_spec->nkeys; ++i)
+	{
+		const int retval = compare_items_by_key(first, second, &sort_spec->keys[i]);
+		if(retval != 0)
+		{
+			return retval;
+		}
+	}
+
+	return first->idx - second->idx;
+}
+
+/* Compares two items by a single sorting key using their precomputed data
+ * where it's available.  Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_items_by_key(const sort_item_t *a, const sort_item_t *b,
+		const sort_key_t *key)
+{
+	int retval;
+
+	switch(abs(key->key))
+	{
+		case SK_BY_NAME:
+		case SK_BY_INAME:
+			retval = compare_item_names(a, b, abs(key->key) == SK_BY_INAME);
+			break;
+		case SK_BY_DIR:
+			retval = (a->is_dir == b->is_dir) ? 0 : (a->is_dir ? -1 : 1);
+			break;
+		case SK_BY_EXTENSION:
+		case SK_BY_FILEEXT:
+			retval = compare_item_exts(a, b, abs(key->key) == SK_BY_FILEEXT);
+			break;
+		case SK_BY_SIZE:
+			retval = (a->size < b->size) ? -1 : (a->size > b->size);
+			break;
+		case SK_BY_NITEMS:
+			retval = (a->nitems < b->nitems) ? -1 : (a->nitems > b->nitems);
+			break;
+		case SK_BY_TARGET:
+			retval = compare_item_targets(a, b);
+			break;
+		case SK_BY_GROUPS:
+			retval = compare_item_groups(a, b, key->group);
+			break;
+
+		default:
+			return compare_entries(a->entry, b->entry, key->key, key->data);
+	}
+
+	return (key->key < 0) ? -retval : retval;
+}
+
+/* Compares names of two items the same way compare_full_file_names() does.
+ * Returns positive value if a is greater than b, zero if they are equal,
+ * otherwise negative value is returned. */
+static int
+compare_item_names(const sort_item_t *a, const sort_item_t *b, int ignore_case)
+{
+	if(a->name[0] == '.' && b->name[0] != '.')
+	{
+		return -1;
+	}
+	if(a->name[0] != '.' && b->name[0] == '.')
+	{
+		return 1;
+	}
+
+	return ignore_case
+	     ? compare_names(a->name, b->name, a->lower, b->lower)
+	     : compare_names(a->name, b->name, NULL, NULL);
+}
+
+/* Compares extensions of two items the same way compare_entries() does.
+ * Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_item_exts(const sort_item_t *a, const sort_item_t *b, int dirs_first)
+{
+	const char *const a_name = a->entry->name;
+	const char *const b_name = b->entry->name;
+
+	if(dirs_first && a->is_dir && b->is_dir)
+	{
+		return compare_names(a_name, b_name, NULL, NULL);
+	}
+	if(dirs_first && a->is_dir != b->is_dir)
+	{
+		return a->is_dir ? -1 : 1;
+	}
+
+	if(a->ext != NULL && b->ext != NULL)
+	{
+		if(a->ext == a_name && b->ext != b_name)
+		{
+			return -1;
+		}
+		if(a->ext != a_name && b->ext == b_name)
+		{
+			return 1;
+		}
+		return compare_names(a->ext + 1, b->ext + 1, NULL, NULL);
+	}
+
+	if(a->ext != NULL || b->ext != NULL)
+	{
+		return (a->ext != NULL) ? -1 : 1;
+	}
+	return compare_names(a_name, b_name, NULL, NULL);
+}
+
+/* Compares targets of two items the same way compare_targets() does.  Returns
+ * standard -1, 0, 1 for comparisons. */
+static int
+compare_item_targets(const sort_item_t *a, const sort_item_t *b)
+{
+	const FileType a_type = a->entry->type;
+	const FileType b_type = b->entry->type;
+
+	if((a_type == FT_LINK) != (b_type == FT_LINK))
+	{
+		/* One of the entries is not a link. */
+		return (a_type == FT_LINK) ? 1 : -1;
+	}
+	if(a->target == NULL || b->target == NULL)
+	{
+		/* Both entries are not symbolic links or targets are unknown. */
+		return 0;
+	}
+
+	return stroscmp(a->target, b->target);
+}
+
+/* Compares parts of names of two items matched by a sorting group the same way
+ * compare_group() does.  Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_item_groups(const sort_item_t *a, const sort_item_t *b, int group)
+{
+	const regmatch_t *const a_match = &a->groups[group];
+	const regmatch_t *const b_match = &b->groups[group];
+	const size_t a_len = a_match->rm_eo - a_match->rm_so;
+	const size_t b_len = b_match->rm_eo - b_match->rm_so;
+
+	const int result = memcmp(a->entry->name + a_match->rm_so,
+			b->entry->name + b_match->rm_so, MIN(a_len, b_len));
+	return (result != 0) ? result : (a_len > b_len) - (a_len < b_len);
+}
+
+/* Compares entries by the key, which is negative for descending order.  data
+ * is key-specific.  Returns standard -1, 0, 1 for comparisons. */
+static int
+compare_entries(const dir_entry_t *first, const dir_entry_t *second, char key,
+		void *data)
+{
+	/* TODO: refactor this function compare_entries(). */
 
 	int retval;
-	const dir_entry_t *const first = one;
-	const dir_entry_t *const second = two;
 
+	const SortingKey sort_type = (SortingKey)abs(key);
 	const int first_is_dir = fentry_is_dir(first);
 	const int second_is_dir = fentry_is_dir(second);
 
@@ -429,7 +1255,7 @@ sort_dir_list(const void *one, const void *two)
 			break;
 
 		case SK_BY_GROUPS:
-			retval = compare_group(first->name, second->name, sort_data);
+			retval = compare_group(first->name, second->name, data);
 			break;
 
 		case SK_BY_TARGET:
@@ -482,16 +1308,7 @@ sort_dir_list(const void *one, const void *two)
 #endif
 	}
 
-	if(retval == 0)
-	{
-		retval = first->tag - second->tag;
-	}
-	else if(sort_descending)
-	{
-		retval = -retval;
-	}
-
-	return retval;
+	return (key < 0) ? -retval : retval;
 }
 
 /* Compares two file sizes.  Returns standard -1, 0, 1 for comparisons. */
@@ -539,8 +1356,7 @@ compare_group(const char f[], const char s[], regex_t *regex)
 static int
 compare_targets(const dir_entry_t *f, const dir_entry_t *s)
 {
-	char full_path[PATH_MAX + 1];
-	char nlink[PATH_MAX + 1], plink[PATH_MAX + 1];
+	const char *nlink, *plink;
 
 	if((f->type == FT_LINK) != (s->type == FT_LINK))
 	{
@@ -555,13 +1371,9 @@ compare_targets(const dir_entry_t *f, const dir_entry_t *s)
 
 	/* Both entries are symbolic links. */
 
-	get_full_path_of(f, sizeof(full_path), full_path);
-	if(get_link_target(full_path, nlink, sizeof(nlink)) != 0)
-	{
-		return 0;
-	}
-	get_full_path_of(s, sizeof(full_path), full_path);
-	if(get_link_target(full_path, plink, sizeof(plink)) != 0)
+	nlink = fentry_get_target(f);
+	plink = fentry_get_target(s);
+	if(nlink == NULL || plink == NULL)
 	{
 		return 0;
 	}
@@ -609,23 +1421,36 @@ compare_full_file_names(const char s[], const char t[], int ignore_case)
 static int
 compare_file_names(const char s[], const char t[], int ignore_case)
 {
-	const char *s_val = s, *t_val = t;
 	char s_buf[NAME_MAX + 1];
 	char t_buf[NAME_MAX + 1];
-	int result;
 
-	if(ignore_case)
+	if(!ignore_case)
 	{
-		/* Ignore too small buffer errors by not caring about part that didn't
-		 * fit. */
-		(void)str_to_lower(s, s_buf, sizeof(s_buf));
-		(void)str_to_lower(t, t_buf, sizeof(t_buf));
-
-		s_val = s_buf;
-		t_val = t_buf;
+		return compare_names(s, t, NULL, NULL);
 	}
 
-	result = cfg.sort_numbers ? strnumcmp(s_val, t_val) : strcmp(s_val, t_val);
+	/* Ignore too small buffer errors by not caring about part that didn't
+	 * fit. */
+	(void)str_to_lower(s, s_buf, sizeof(s_buf));
+	(void)str_to_lower(t, t_buf, sizeof(t_buf));
+
+	return compare_names(s, t, s_buf, t_buf);
+}
+
+/* Compares two names by their lower-cased versions if they are provided (not
+ * NULL) falling back to original names.  Returns positive value if s is
+ * greater than t, zero if they are equal, otherwise negative value is
+ * returned. */
+static int
+compare_names(const char s[], const char t[], const char s_lower[],
+		const char t_lower[])
+{
+	const int ignore_case = (s_lower != NULL);
+	const char *const s_val = ignore_case ? s_lower : s;
+	const char *const t_val = ignore_case ? t_lower : t;
+
+	int result = cfg.sort_numbers ? strnumcmp(s_val, t_val)
+	                              : strcmp(s_val, t_val);
 	if(result == 0 && ignore_case)
 	{
 		/* Resort to comparing original names when their normalized versions match
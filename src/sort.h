@@ -26,9 +26,22 @@
 /* Sorts entries of the view according to its sorting configuration. */
 void sort_view(view_t *view);
 
+/* Sorts entries of the view that follow first nsorted of them, which are
+ * already sorted, and merges the two parts.  Order of equal entries is
+ * preserved. */
+void sort_view_tail(view_t *view, int nsorted);
+
 /* Sorts specified entries using global settings of the view. */
 void sort_entries(view_t *view, entries_t entries);
 
+/* Finds position in sorted list of entries of the view at which the entry
+ * should be inserted to keep the list sorted.  The entry goes after equal
+ * ones.  Returns the position. */
+int sort_find_pos(view_t *view, const dir_entry_t *entry);
+
+/* Frees data cached in the view by sorting. */
+void sort_drop_cache(view_t *view);
+
 /* Maps primary sort key to second column type.  Returns secondary key that
  * corresponds to the primary one. */
 SortingKey get_secondary_key(SortingKey primary_key);
@@ -26,24 +26,31 @@
 #undef MIN
 #endif
 
+#include <sys/stat.h> /* stat */
+
 #include <assert.h> /* assert() */
 #include <limits.h> /* INT_MIN */
-#include <stddef.h> /* NULL */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
 #include <string.h>
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "ui/colors.h"
 #include "ui/ui.h"
+#include "utils/dcache_file.h"
 #include "utils/env.h"
 #include "utils/fsdata.h"
 #include "utils/log.h"
 #include "utils/macros.h"
 #include "utils/path.h"
 #include "utils/str.h"
+#include "utils/trie.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
 #include "cmd_core.h"
@@ -55,21 +62,83 @@
 #define SCREEN_ENVVAR "STY"
 #define TMUX_ENVVAR "TMUX"
 
-/* dcache entry. */
+/* Number of independently locked parts of dcache. */
+#define DCACHE_SHARDS 16
+
+/* Name of the file in configuration directory that stores dcache. */
+#define DCACHE_FILE "dcache"
+
+/* Size of a buffer that fits path to dcache file. */
+#define DCACHE_FILE_PATH_LEN (PATH_MAX + 1 + sizeof(DCACHE_FILE))
+
+/* Value of dcache entry. */
 typedef struct
 {
 	uint64_t value;   /* Stored value. */
 	time_t timestamp; /* When the value was set. */
+	uint64_t mtime;   /* Modification time of the directory at that moment. */
+	uint64_t inode;   /* Inode number of the directory. */
+	int links;        /* Whether size includes files with several hard links. */
 }
 dcache_data_t;
 
+/* dcache entry. */
+typedef struct
+{
+	dcache_data_t size;   /* Size of the directory. */
+	dcache_data_t nitems; /* Number of items in the directory. */
+}
+dcache_entry_t;
+
+/* Independently locked part of dcache.  Paths are distributed among shards by
+ * their hash, so that readers and writers of different paths rarely meet. */
+typedef struct
+{
+	pthread_rwlock_t lock; /* Lets readers proceed concurrently. */
+	fsdata_t *entries;     /* Entries keyed by real paths. */
+	trie_t *stale;         /* Paths of records of dcache_file of this shard which
+	                          turned out to be outdated. */
+}
+dcache_shard_t;
+
+/* State of dcache_save(). */
+typedef struct
+{
+	dcache_file_entry_t *entries;        /* Entries to be saved. */
+	size_t nentries;                     /* Number of elements in entries. */
+	size_t capacity;                     /* Number of allocated entries. */
+	trie_t *paths;                       /* Set of paths of the entries. */
+	const void *parents[PATH_MAX/2 + 1]; /* Data of nodes on current path. */
+	size_t lens[PATH_MAX/2 + 1];         /* Lengths of paths of the nodes. */
+	int depth;                           /* Number of nodes on current path. */
+	char path[PATH_MAX + 1];             /* Path of the node being visited. */
+}
+dcache_saver_t;
+
 static void load_def_values(status_t *stats, config_t *config);
 static void determine_fuse_umount_cmd(status_t *stats);
 static void set_gtk_available(status_t *stats);
 static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
 static void save_into_history(const char item[], hist_t *hist, int len);
-static void size_updater(void *data, void *arg);
+static void get_entry(const char path[], dcache_entry_t *entry);
+static void count_lookup(uint64_t value);
+static void load_size_data(const char real_path[], dcache_shard_t *shard,
+		dcache_data_t *data);
+static int subtree_is_unchanged(const char real_path[], dcache_shard_t *shard,
+		const dcache_rec_t *rec);
+static int is_rec_valid(const char path[], const dcache_rec_t *rec);
+static void mark_stale(const char real_path[]);
+static void open_dcache_file(void);
+static void get_dcache_file_path(char buf[], size_t buf_len);
+static int update_entry(const char real_path[], const dcache_data_t *size,
+		const dcache_data_t *nitems);
+static dcache_shard_t * get_shard(const char real_path[]);
+static void lock_shard(dcache_shard_t *shard, int write);
+static int collect_size_data(const char name[], int valid,
+		const void *parent_data, void *data, void *arg);
+static int add_saved_entry(dcache_saver_t *saver, const char path[],
+		const dcache_rec_t *rec);
 
 status_t curr_stats;
 
@@ -77,14 +146,22 @@ static int pending_redraw;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
-static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Thread-safety guard for dcache_nitems variable. */
-static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Cache for directory sizes. */
-static fsdata_t *dcache_size;
-/* Cache for directory item count. */
-static fsdata_t *dcache_nitems;
+/* Cache for directory sizes and item counts. */
+static dcache_shard_t dcache_shards[DCACHE_SHARDS];
+/* Whether locks of dcache_shards are initialized. */
+static int dcache_shards_initialized;
+/* Counters of dcache usage (updated atomically). */
+static dcache_stats_t dcache_stats;
+/* Guards opening and closing of dcache_file.  Lookups in the file are done
+ * while holding a lock of a shard, which is taken for writing on closing. */
+static pthread_mutex_t dcache_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Sizes of directories saved by previous sessions, opened on first use. */
+static dcache_file_t *dcache_file;
+/* Whether opening of dcache_file was attempted (read atomically). */
+static int dcache_file_opened;
+/* Incremented on closing dcache_file to let lookups that release locks of
+ * shards in between notice that the file was replaced. */
+static int dcache_file_gen;
 
 int
 stats_init(config_t *config)
@@ -235,13 +312,47 @@ stats_reset(const config_t *config)
 static int
 reset_dircache(void)
 {
-	fsdata_free(dcache_size);
-	dcache_size = fsdata_create(0, 1);
+	int i;
+	int failed = 0;
+
+	if(!dcache_shards_initialized)
+	{
+		for(i = 0; i < DCACHE_SHARDS; ++i)
+		{
+			if(pthread_rwlock_init(&dcache_shards[i].lock, NULL) != 0)
+			{
+				return 1;
+			}
+		}
+		dcache_shards_initialized = 1;
+	}
+
+	/* All shards are locked to make sure the file isn't used by lookups. */
+	pthread_mutex_lock(&dcache_file_mutex);
+	for(i = 0; i < DCACHE_SHARDS; ++i)
+	{
+		dcache_shard_t *const shard = &dcache_shards[i];
+		lock_shard(shard, 1);
+		fsdata_free(shard->entries);
+		/* Paths are resolved before locking a shard. */
+		shard->entries = fsdata_create(0, 0);
+		failed |= (shard->entries == NULL);
+		trie_free(shard->stale);
+		shard->stale = NULL;
+	}
 
-	fsdata_free(dcache_nitems);
-	dcache_nitems = fsdata_create(0, 1);
+	dcache_file_close(dcache_file);
+	dcache_file = NULL;
+	dcache_file_opened = 0;
+	++dcache_file_gen;
 
-	return (dcache_size == NULL || dcache_nitems == NULL);
+	for(i = 0; i < DCACHE_SHARDS; ++i)
+	{
+		pthread_rwlock_unlock(&dcache_shards[i].lock);
+	}
+	pthread_mutex_unlock(&dcache_file_mutex);
+
+	return failed;
 }
 
 void
@@ -475,114 +586,657 @@ hists_search_last(void)
 void
 dcache_get_at(const char path[], uint64_t *size, uint64_t *nitems)
 {
-	/* Initialization to make condition false by default. */
-	dcache_data_t size_data, nitems_data;
-
-	pthread_mutex_lock(&dcache_size_mutex);
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) != 0)
-	{
-		size_data.value = DCACHE_UNKNOWN;
-	}
-	pthread_mutex_unlock(&dcache_size_mutex);
-
-	pthread_mutex_lock(&dcache_nitems_mutex);
-	if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) != 0)
-	{
-		nitems_data.value = DCACHE_UNKNOWN;
-	}
-	pthread_mutex_unlock(&dcache_nitems_mutex);
+	dcache_entry_t entry;
+	get_entry(path, &entry);
 
 	if(size != NULL)
 	{
-		*size = size_data.value;
+		*size = entry.size.value;
+		count_lookup(entry.size.value);
 	}
 	if(nitems != NULL)
 	{
-		*nitems = nitems_data.value;
+		*nitems = entry.nitems.value;
+		count_lookup(entry.nitems.value);
 	}
 }
 
+void
+dcache_get_linkless_size(const char path[], uint64_t *size)
+{
+	dcache_entry_t entry;
+	get_entry(path, &entry);
+
+	*size = entry.size.links ? DCACHE_UNKNOWN : entry.size.value;
+	count_lookup(*size);
+}
+
 void
 dcache_get_of(const dir_entry_t *entry, dcache_result_t *size,
 		dcache_result_t *nitems)
 {
-	dcache_data_t size_data, nitems_data;
+	dcache_entry_t data;
 
 	char full_path[PATH_MAX + 1];
 	get_full_path_of(entry, sizeof(full_path), full_path);
 
-	size->value = DCACHE_UNKNOWN;
-	size->is_valid = 0;
+	get_entry(full_path, &data);
+	count_lookup(data.size.value);
+	count_lookup(data.nitems.value);
+
+	/* We check strictly for less than to handle scenario when multiple changes
+	 * occurred during the same second. */
 
-	nitems->value = DCACHE_UNKNOWN;
-	nitems->is_valid = 0;
+	size->value = data.size.value;
+	size->is_valid = (data.size.value != DCACHE_UNKNOWN)
+	              && (entry->mtime < data.size.timestamp);
+
+	nitems->value = data.nitems.value;
+	nitems->is_valid = (data.nitems.value != DCACHE_UNKNOWN)
+	                && (entry->mtime < data.nitems.timestamp);
+}
 
-	pthread_mutex_lock(&dcache_size_mutex);
-	if(fsdata_get(dcache_size, full_path, &size_data, sizeof(size_data)) == 0)
+/* Retrieves cached data about the path falling back to sizes saved by previous
+ * sessions.  Unknown values are set to DCACHE_UNKNOWN. */
+static void
+get_entry(const char path[], dcache_entry_t *entry)
+{
+	dcache_shard_t *shard;
+	char real_path[PATH_MAX + 1];
+
+	entry->size.value = DCACHE_UNKNOWN;
+	entry->size.links = 0;
+	entry->nitems.value = DCACHE_UNKNOWN;
+
+	/* Resolving path involves system calls, so it's done without a lock. */
+	if(os_realpath(path, real_path) != real_path)
 	{
-		size->value = size_data.value;
-		/* We check strictly for less than to handle scenario when multiple changes
-		 * occurred during the same second. */
-		size->is_valid = (entry->mtime < size_data.timestamp);
+		return;
 	}
-	pthread_mutex_unlock(&dcache_size_mutex);
 
-	pthread_mutex_lock(&dcache_nitems_mutex);
-	if(fsdata_get(dcache_nitems, full_path, &nitems_data,
-				sizeof(nitems_data)) == 0)
+	shard = get_shard(real_path);
+	lock_shard(shard, 0);
+	(void)fsdata_get(shard->entries, real_path, entry, sizeof(*entry));
+	pthread_rwlock_unlock(&shard->lock);
+
+	if(entry->size.value == DCACHE_UNKNOWN)
 	{
-		nitems->value = nitems_data.value;
-		/* We check strictly for less than to handle scenario when multiple changes
-		 * occurred during the same second. */
-		nitems->is_valid = (entry->mtime < nitems_data.timestamp);
+		load_size_data(real_path, shard, &entry->size);
 	}
-	pthread_mutex_unlock(&dcache_nitems_mutex);
 }
 
-void
-dcache_update_parent_sizes(const char path[], uint64_t by)
+/* Updates counters of dcache usage with result of a single lookup. */
+static void
+count_lookup(uint64_t value)
 {
-	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
-	pthread_mutex_unlock(&dcache_size_mutex);
+	(void)__sync_fetch_and_add(&dcache_stats.lookups, 1);
+	if(value != DCACHE_UNKNOWN)
+	{
+		(void)__sync_fetch_and_add(&dcache_stats.hits, 1);
+	}
 }
 
-/* Updates cached value by a fixed amount. */
+/* Looks up size of a directory in the file saved by previous sessions and
+ * moves it to the cache if directory didn't change since then.  Leaves *data
+ * untouched if nothing suitable was found. */
 static void
-size_updater(void *data, void *arg)
+load_size_data(const char real_path[], dcache_shard_t *shard,
+		dcache_data_t *data)
 {
-	const uint64_t *const by = arg;
-	dcache_data_t *const what = data;
+	dcache_rec_t rec;
+	void *dummy;
+	int found;
+
+	if(!(cfg.vifm_info & VINFO_DCACHE))
+	{
+		return;
+	}
+
+	open_dcache_file();
+
+	/* The file is mapped into memory and isn't changed, so lookups in it need
+	 * only to make sure that it's not closed meanwhile. */
+	lock_shard(shard, 0);
+	found = __sync_fetch_and_add(&dcache_file_opened, 0)
+	     && dcache_file != NULL
+	     && trie_get(shard->stale, real_path, &dummy) != 0
+	     && dcache_file_find(dcache_file, real_path, &rec) == 0;
+	pthread_rwlock_unlock(&shard->lock);
+
+	/* Modification time of a directory changes when its list of files changes,
+	 * but not when files of its subdirectories change, so the size is valid only
+	 * if none of the directories of the subtree has changed. */
+	if(found && (!is_rec_valid(real_path, &rec) ||
+				!subtree_is_unchanged(real_path, shard, &rec)))
+	{
+		mark_stale(real_path);
+		found = 0;
+	}
 
-	what->value += *by;
+	if(found)
+	{
+		data->value = rec.size;
+		data->timestamp = rec.timestamp;
+		data->mtime = rec.mtime;
+		data->inode = rec.inode;
+		data->links = (rec.links != 0);
+		(void)update_entry(real_path, data, NULL);
+	}
+}
+
+/* Checks records of all directories under the path saved in the file along
+ * with the record of the path.  Directory of each record must still match it
+ * and must not have changed since size of the path was calculated.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+subtree_is_unchanged(const char real_path[], dcache_shard_t *shard,
+		const dcache_rec_t *rec)
+{
+	char prefix[PATH_MAX + 2];
+	char path[PATH_MAX + 1];
+	int gen;
+	int i;
+
+	snprintf(prefix, sizeof(prefix), "%s%s", real_path,
+			ends_with_slash(real_path) ? "" : "/");
+
+	lock_shard(shard, 0);
+	gen = dcache_file_gen;
+	i = (dcache_file == NULL) ? 0 : dcache_file_lower_bound(dcache_file, prefix);
+	pthread_rwlock_unlock(&shard->lock);
+
+	/* Records of a subtree follow each other in the file.  Shard lock keeps the
+	 * file open, but it's not held while querying file system. */
+	while(1)
+	{
+		dcache_rec_t sub_rec;
+		const char *sub_path;
+
+		lock_shard(shard, 0);
+		if(dcache_file_gen != gen || dcache_file == NULL)
+		{
+			pthread_rwlock_unlock(&shard->lock);
+			return 0;
+		}
+		if(i >= dcache_file_count(dcache_file))
+		{
+			pthread_rwlock_unlock(&shard->lock);
+			return 1;
+		}
+		sub_path = dcache_file_get(dcache_file, i, &sub_rec);
+		if(sub_path != NULL && !starts_with(sub_path, prefix))
+		{
+			pthread_rwlock_unlock(&shard->lock);
+			return 1;
+		}
+		if(sub_path != NULL)
+		{
+			copy_str(path, sizeof(path), sub_path);
+		}
+		pthread_rwlock_unlock(&shard->lock);
+
+		/* Same-second changes are indistinguishable, hence strict comparison. */
+		if(sub_path == NULL || !is_rec_valid(path, &sub_rec) ||
+				sub_rec.mtime >= rec->timestamp)
+		{
+			return 0;
+		}
+
+		++i;
+	}
+}
+
+/* Checks whether directory at the path is the one described by the record and
+ * wasn't changed since then.  Returns non-zero if so, otherwise zero is
+ * returned. */
+static int
+is_rec_valid(const char path[], const dcache_rec_t *rec)
+{
+	struct stat st;
+	return os_stat(path, &st) == 0
+	    && (uint64_t)st.st_mtime == rec->mtime
+	    && (uint64_t)st.st_ino == rec->inode;
+}
+
+/* Marks saved record of the path and records of all its parents as outdated.
+ * Parents are included to not keep their sizes when record of the path is
+ * dropped, which would leave nothing to check their subtree against. */
+static void
+mark_stale(const char real_path[])
+{
+	char path[PATH_MAX + 1];
+	copy_str(path, sizeof(path), real_path);
+
+	while(path[0] != '\0')
+	{
+		dcache_shard_t *const shard = get_shard(path);
+
+		lock_shard(shard, 1);
+		if(shard->stale == NULL)
+		{
+			shard->stale = trie_create();
+		}
+		if(shard->stale != NULL)
+		{
+			(void)trie_put(shard->stale, path);
+		}
+		pthread_rwlock_unlock(&shard->lock);
+
+		if(is_root_dir(path))
+		{
+			break;
+		}
+		remove_last_path_component(path);
+	}
+}
+
+/* Opens file with sizes saved by previous sessions unless it was already
+ * attempted. */
+static void
+open_dcache_file(void)
+{
+	if(__sync_fetch_and_add(&dcache_file_opened, 0))
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dcache_file_mutex);
+	if(!dcache_file_opened)
+	{
+		char file_path[DCACHE_FILE_PATH_LEN];
+		get_dcache_file_path(file_path, sizeof(file_path));
+		dcache_file = dcache_file_open(file_path);
+		/* Make the file visible to lookups only after it's fully opened. */
+		(void)__sync_lock_test_and_set(&dcache_file_opened, 1);
+	}
+	pthread_mutex_unlock(&dcache_file_mutex);
+}
+
+/* Formats path to the file which stores directory sizes between sessions. */
+static void
+get_dcache_file_path(char buf[], size_t buf_len)
+{
+	snprintf(buf, buf_len, "%s/" DCACHE_FILE, cfg.config_dir);
+}
+
+void
+dcache_update_parent_sizes(const char path[], uint64_t by)
+{
+	char parent[PATH_MAX + 1];
+	if(os_realpath(path, parent) != parent)
+	{
+		return;
+	}
+
+	while(!is_root_dir(parent))
+	{
+		dcache_shard_t *shard;
+		dcache_entry_t entry;
+
+		remove_last_path_component(parent);
+		if(parent[0] == '\0')
+		{
+			break;
+		}
+
+		shard = get_shard(parent);
+		lock_shard(shard, 1);
+		if(fsdata_get(shard->entries, parent, &entry, sizeof(entry)) == 0 &&
+				entry.size.value != DCACHE_UNKNOWN)
+		{
+			entry.size.value += by;
+			(void)fsdata_set(shard->entries, parent, &entry, sizeof(entry));
+		}
+		pthread_rwlock_unlock(&shard->lock);
+	}
 }
 
 int
 dcache_set_at(const char path[], uint64_t size, uint64_t nitems)
 {
-	int ret = 0;
 	const time_t ts = time(NULL);
+	const dcache_data_t nitems_data = { .value = nitems, .timestamp = ts };
+	dcache_data_t size_data = { .value = size, .timestamp = ts };
+	char real_path[PATH_MAX + 1];
+
+	if(os_realpath(path, real_path) != real_path)
+	{
+		return 1;
+	}
 
 	if(size != DCACHE_UNKNOWN)
 	{
-		const dcache_data_t data = { .value = size, .timestamp = ts };
+		struct stat st;
+
+		/* This information is used to validate size after it's saved. */
+		if(os_stat(real_path, &st) == 0)
+		{
+			size_data.mtime = st.st_mtime;
+			size_data.inode = st.st_ino;
+		}
+	}
+
+	return update_entry(real_path,
+			(size == DCACHE_UNKNOWN) ? NULL : &size_data,
+			(nitems == DCACHE_UNKNOWN) ? NULL : &nitems_data);
+}
+
+int
+dcache_set_sizes(const dcache_size_t sizes[], int count)
+{
+	int i, j;
+	int ret = 0;
+	const time_t ts = time(NULL);
+	char (*const real_paths)[PATH_MAX + 1] = reallocarray(NULL, count,
+			sizeof(*real_paths));
+	dcache_shard_t **const shards = reallocarray(NULL, count, sizeof(*shards));
+
+	if(real_paths == NULL || shards == NULL)
+	{
+		free(real_paths);
+		free(shards);
+		return 1;
+	}
 
-		pthread_mutex_lock(&dcache_size_mutex);
-		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_size_mutex);
+	for(i = 0; i < count; ++i)
+	{
+		shards[i] = NULL;
+		if(os_realpath(sizes[i].path, real_paths[i]) == real_paths[i])
+		{
+			shards[i] = get_shard(real_paths[i]);
+		}
+		ret |= (shards[i] == NULL);
 	}
 
-	if(nitems != DCACHE_UNKNOWN)
+	/* Each shard is locked at most once. */
+	for(i = 0; i < count; ++i)
 	{
-		const dcache_data_t data = { .value = nitems, .timestamp = ts };
+		dcache_shard_t *const shard = shards[i];
+		if(shard == NULL)
+		{
+			continue;
+		}
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+		lock_shard(shard, 1);
+		for(j = i; j < count; ++j)
+		{
+			dcache_entry_t entry;
+
+			if(shards[j] != shard)
+			{
+				continue;
+			}
+			shards[j] = NULL;
+
+			if(fsdata_get(shard->entries, real_paths[j], &entry,
+						sizeof(entry)) != 0)
+			{
+				entry.nitems.value = DCACHE_UNKNOWN;
+			}
+
+			entry.size.value = sizes[j].size;
+			entry.size.timestamp = ts;
+			entry.size.mtime = sizes[j].mtime;
+			entry.size.inode = sizes[j].inode;
+			entry.size.links = sizes[j].links;
+			ret |= fsdata_set(shard->entries, real_paths[j], &entry, sizeof(entry));
+		}
+		pthread_rwlock_unlock(&shard->lock);
 	}
 
+	free(real_paths);
+	free(shards);
 	return ret;
 }
 
+/* Updates size and/or item count of an entry, NULL values are left intact.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+update_entry(const char real_path[], const dcache_data_t *size,
+		const dcache_data_t *nitems)
+{
+	int ret;
+	dcache_entry_t entry;
+	dcache_shard_t *const shard = get_shard(real_path);
+
+	lock_shard(shard, 1);
+
+	if(fsdata_get(shard->entries, real_path, &entry, sizeof(entry)) != 0)
+	{
+		entry.size.value = DCACHE_UNKNOWN;
+		entry.size.links = 0;
+		entry.nitems.value = DCACHE_UNKNOWN;
+	}
+
+	if(size != NULL)
+	{
+		entry.size = *size;
+	}
+	if(nitems != NULL)
+	{
+		entry.nitems = *nitems;
+	}
+
+	ret = fsdata_set(shard->entries, real_path, &entry, sizeof(entry));
+
+	pthread_rwlock_unlock(&shard->lock);
+	return ret;
+}
+
+/* Picks shard responsible for the path.  Returns the shard. */
+static dcache_shard_t *
+get_shard(const char real_path[])
+{
+	/* djb2 hash function. */
+	unsigned int hash = 5381U;
+	while(*real_path != '\0')
+	{
+		hash = hash*33U + (unsigned char)*real_path++;
+	}
+	return &dcache_shards[hash%DCACHE_SHARDS];
+}
+
+/* Locks the shard for reading or writing counting cases when it's busy. */
+static void
+lock_shard(dcache_shard_t *shard, int write)
+{
+	if(write)
+	{
+		if(pthread_rwlock_trywrlock(&shard->lock) != 0)
+		{
+			(void)__sync_fetch_and_add(&dcache_stats.contended, 1);
+			pthread_rwlock_wrlock(&shard->lock);
+		}
+	}
+	else
+	{
+		if(pthread_rwlock_tryrdlock(&shard->lock) != 0)
+		{
+			(void)__sync_fetch_and_add(&dcache_stats.contended, 1);
+			pthread_rwlock_rdlock(&shard->lock);
+		}
+	}
+}
+
+void
+dcache_get_stats(dcache_stats_t *stats)
+{
+	stats->lookups = __sync_fetch_and_add(&dcache_stats.lookups, 0);
+	stats->hits = __sync_fetch_and_add(&dcache_stats.hits, 0);
+	stats->contended = __sync_fetch_and_add(&dcache_stats.contended, 0);
+}
+
+char *
+dcache_format_stats(void)
+{
+	dcache_stats_t stats;
+	dcache_get_stats(&stats);
+	return format_str("Directory cache: %llu lookups, %llu hits, "
+			"%llu contended locks", (unsigned long long)stats.lookups,
+			(unsigned long long)stats.hits, (unsigned long long)stats.contended);
+}
+
+int
+dcache_save(void)
+{
+	int i;
+	int result;
+	char file_path[DCACHE_FILE_PATH_LEN];
+	dcache_saver_t *const saver = calloc(1, sizeof(*saver));
+	if(saver == NULL)
+	{
+		return 1;
+	}
+
+	saver->paths = trie_create();
+	if(saver->paths == NULL)
+	{
+		free(saver);
+		return 1;
+	}
+
+	result = 0;
+	for(i = 0; i < DCACHE_SHARDS && result == 0; ++i)
+	{
+		dcache_shard_t *const shard = &dcache_shards[i];
+		lock_shard(shard, 0);
+		saver->depth = 0;
+		result = fsdata_traverse(shard->entries, &collect_size_data, saver);
+		pthread_rwlock_unlock(&shard->lock);
+	}
+
+	pthread_mutex_lock(&dcache_file_mutex);
+
+	/* Keep sizes from previous sessions that weren't used by this one. */
+	if(dcache_file != NULL)
+	{
+		for(i = 0; i < dcache_file_count(dcache_file) && result == 0; ++i)
+		{
+			void *dummy;
+			dcache_rec_t rec;
+			dcache_shard_t *shard;
+			int stale;
+			const char *const path = dcache_file_get(dcache_file, i, &rec);
+			if(path == NULL || trie_get(saver->paths, path, &dummy) == 0)
+			{
+				continue;
+			}
+
+			shard = get_shard(path);
+			lock_shard(shard, 0);
+			stale = (trie_get(shard->stale, path, &dummy) == 0);
+			pthread_rwlock_unlock(&shard->lock);
+
+			if(!stale)
+			{
+				result = add_saved_entry(saver, path, &rec);
+			}
+		}
+	}
+
+	pthread_mutex_unlock(&dcache_file_mutex);
+
+	if(result == 0)
+	{
+		get_dcache_file_path(file_path, sizeof(file_path));
+		result = dcache_file_write(file_path, saver->entries, saver->nentries);
+	}
+
+	for(i = 0; i < (int)saver->nentries; ++i)
+	{
+		free(saver->entries[i].path);
+	}
+	free(saver->entries);
+	trie_free(saver->paths);
+	free(saver);
+
+	return result;
+}
+
+/* fsdata_traverse() callback that builds paths of nodes and collects valid
+ * ones.  Returns non-zero to stop traversal on error. */
+static int
+collect_size_data(const char name[], int valid, const void *parent_data,
+		void *data, void *arg)
+{
+	dcache_saver_t *const saver = arg;
+	const dcache_data_t *const size_data = &((dcache_entry_t *)data)->size;
+	size_t len;
+
+	/* Nodes are visited depth-first, so parent is on the stack. */
+	while(saver->depth > 0 && saver->parents[saver->depth - 1] != parent_data)
+	{
+		--saver->depth;
+	}
+
+	if(saver->depth == ARRAY_LEN(saver->parents))
+	{
+		return 1;
+	}
+
+	len = (saver->depth == 0) ? 0U : saver->lens[saver->depth - 1];
+#ifndef _WIN32
+	len += snprintf(saver->path + len, sizeof(saver->path) - len, "/%s", name);
+#else
+	len += snprintf(saver->path + len, sizeof(saver->path) - len, "%s%s",
+			(saver->depth == 0) ? "" : "/", name);
+#endif
+	if(len >= sizeof(saver->path))
+	{
+		return 1;
+	}
+
+	saver->parents[saver->depth] = data;
+	saver->lens[saver->depth] = len;
+	++saver->depth;
+
+	if(valid && size_data->value != DCACHE_UNKNOWN)
+	{
+		const dcache_rec_t rec = {
+			.size = size_data->value,
+			.timestamp = size_data->timestamp,
+			.mtime = size_data->mtime,
+			.inode = size_data->inode,
+			.links = size_data->links,
+		};
+		return add_saved_entry(saver, saver->path, &rec);
+	}
+	return 0;
+}
+
+/* Appends entry to the list of entries to be saved.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+add_saved_entry(dcache_saver_t *saver, const char path[],
+		const dcache_rec_t *rec)
+{
+	dcache_file_entry_t *entry;
+
+	if(saver->nentries == saver->capacity)
+	{
+		const size_t capacity = (saver->capacity == 0U) ? 256U : saver->capacity*2U;
+		void *const entries = reallocarray(saver->entries, capacity,
+				sizeof(*saver->entries));
+		if(entries == NULL)
+		{
+			return 1;
+		}
+		saver->entries = entries;
+		saver->capacity = capacity;
+	}
+
+	entry = &saver->entries[saver->nentries];
+	entry->path = strdup(path);
+	entry->rec = *rec;
+	if(entry->path == NULL || trie_put(saver->paths, path) < 0)
+	{
+		free(entry->path);
+		return 1;
+	}
+
+	++saver->nentries;
+	return 0;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -101,6 +101,26 @@ typedef struct
 }
 dcache_result_t;
 
+/* Element of input for dcache_set_sizes(). */
+typedef struct
+{
+	const char *path; /* Path to a directory. */
+	uint64_t size;    /* Size of the directory. */
+	uint64_t mtime;   /* Modification time of the directory. */
+	uint64_t inode;   /* Inode number of the directory. */
+	int links;        /* Whether size includes files with several hard links. */
+}
+dcache_size_t;
+
+/* Statistics of dcache usage. */
+typedef struct
+{
+	uint64_t lookups;   /* Number of values that were looked up. */
+	uint64_t hits;      /* Number of values that were found. */
+	uint64_t contended; /* Number of times a lock was busy. */
+}
+dcache_stats_t;
+
 /* Current preview (quickview) parameters. */
 typedef struct
 {
@@ -291,6 +311,11 @@ const char * hists_search_last(void);
  * unknown values variables are set to DCACHE_UNKNOWN. */
 void dcache_get_at(const char path[], uint64_t *size, uint64_t *nitems);
 
+/* Retrieves size of the path unless it includes files with several hard links,
+ * which might be shared with other directories and thus can't be summed up
+ * blindly.  On unknown value *size is set to DCACHE_UNKNOWN. */
+void dcache_get_linkless_size(const char path[], uint64_t *size);
+
 /* Retrieves information about the entry checking whether it's outdated. */
 void dcache_get_of(const struct dir_entry_t *entry, dcache_result_t *size,
 		dcache_result_t *nitems);
@@ -302,6 +327,22 @@ void dcache_update_parent_sizes(const char path[], uint64_t by);
  * non-zero is returned. */
 int dcache_set_at(const char path[], uint64_t size, uint64_t nitems);
 
+/* Updates sizes of several directories at once, which is cheaper than doing it
+ * one by one.  Returns zero on success, otherwise non-zero is returned. */
+int dcache_set_sizes(const dcache_size_t sizes[], int count);
+
+/* Retrieves counters of dcache usage since startup. */
+void dcache_get_stats(dcache_stats_t *stats);
+
+/* Formats counters of dcache usage since startup for displaying them.  Returns
+ * newly allocated string or NULL on error. */
+char * dcache_format_stats(void);
+
+/* Saves sizes of directories to a file in configuration directory merging them
+ * with those saved previously.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int dcache_save(void);
+
 #endif /* VIFM__STATUS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
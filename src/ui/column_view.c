@@ -171,6 +171,19 @@ columns_clear(columns_t *cols)
 	cols->count = 0;
 }
 
+size_t
+columns_count(const columns_t *cols)
+{
+	return cols->count;
+}
+
+int
+columns_get_column_id(const columns_t *cols, size_t idx)
+{
+	assert(idx < cols->count && "Column index is out of range.");
+	return cols->list[idx].info.column_id;
+}
+
 void
 columns_clear_column_descs(void)
 {
@@ -103,6 +103,13 @@ void columns_add_column(columns_t *cols, column_info_t info);
 /* Clears list of columns of the cols. */
 void columns_clear(columns_t *cols);
 
+/* Retrieves number of columns.  Returns the number. */
+size_t columns_count(const columns_t *cols);
+
+/* Retrieves id of column at specified position (must be valid).  Returns the
+ * id. */
+int columns_get_column_id(const columns_t *cols, size_t idx);
+
 /* Performs actual formatting of columns. */
 void columns_format_line(columns_t *cols, const void *data,
 		size_t max_line_width);
@@ -1413,7 +1413,7 @@ format_size(int id, const void *data, size_t buf_len, char buf[])
 
 	if(size == DCACHE_UNKNOWN)
 	{
-		size = cdt->entry->size;
+		size = fentry_get_raw_size(cdt->entry);
 	}
 
 	str[0] = '\0';
@@ -1457,7 +1457,7 @@ static void
 format_target(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
-	char full_path[PATH_MAX + 1];
+	const char *target;
 
 	buf[0] = '\0';
 
@@ -1466,8 +1466,11 @@ format_target(int id, const void *data, size_t buf_len, char buf[])
 		return;
 	}
 
-	get_full_path_of(cdt->entry, sizeof(full_path), full_path);
-	(void)get_link_target(full_path, buf, buf_len);
+	target = fentry_get_target(cdt->entry);
+	if(target != NULL)
+	{
+		copy_str(buf, buf_len, target);
+	}
 }
 
 /* File or directory extension format callback for column_view unit. */
@@ -1500,18 +1503,22 @@ static void
 format_time(int id, const void *data, size_t buf_len, char buf[])
 {
 	struct tm *tm_ptr;
+	time_t t;
 	const column_data_t *cdt = data;
 
 	switch(id)
 	{
 		case SK_BY_TIME_MODIFIED:
-			tm_ptr = localtime(&cdt->entry->mtime);
+			t = fentry_get_mtime(cdt->entry);
+			tm_ptr = localtime(&t);
 			break;
 		case SK_BY_TIME_ACCESSED:
-			tm_ptr = localtime(&cdt->entry->atime);
+			t = fentry_get_atime(cdt->entry);
+			tm_ptr = localtime(&t);
 			break;
 		case SK_BY_TIME_CHANGED:
-			tm_ptr = localtime(&cdt->entry->ctime);
+			t = fentry_get_ctime(cdt->entry);
+			tm_ptr = localtime(&t);
 			break;
 
 		default:
@@ -1548,6 +1555,7 @@ format_group(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
 
+	fentry_ensure_meta(cdt->entry, FMETA_OWNER);
 	buf[0] = ' ';
 	get_gid_string(cdt->entry, id == SK_BY_GROUP_ID, buf_len - 1, buf + 1);
 }
@@ -1558,6 +1566,7 @@ format_owner(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
 
+	fentry_ensure_meta(cdt->entry, FMETA_OWNER);
 	buf[0] = ' ';
 	get_uid_string(cdt->entry, id == SK_BY_OWNER_ID, buf_len - 1, buf + 1);
 }
@@ -1567,7 +1576,7 @@ static void
 format_mode(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
-	snprintf(buf, buf_len, " %o", cdt->entry->mode);
+	snprintf(buf, buf_len, " %o", fentry_get_mode(cdt->entry));
 }
 
 /* File permissions mask format callback for column_view unit. */
@@ -1575,7 +1584,7 @@ static void
 format_perms(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
-	get_perm_string(buf, buf_len, cdt->entry->mode);
+	get_perm_string(buf, buf_len, fentry_get_mode(cdt->entry));
 }
 
 /* Hard link count format callback for column_view unit. */
@@ -1583,7 +1592,7 @@ static void
 format_nlinks(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
-	snprintf(buf, buf_len, "%lu", (unsigned long)cdt->entry->nlinks);
+	snprintf(buf, buf_len, "%lu", (unsigned long)fentry_get_nlinks(cdt->entry));
 }
 
 /* Inode number format callback for column_view unit. */
@@ -1591,7 +1600,7 @@ static void
 format_inode(int id, const void *data, size_t buf_len, char buf[])
 {
 	const column_data_t *cdt = data;
-	snprintf(buf, buf_len, "%lu", (unsigned long)cdt->entry->inode);
+	snprintf(buf, buf_len, "%lu", (unsigned long)fentry_get_inode(cdt->entry));
 }
 
 #endif
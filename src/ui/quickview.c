@@ -20,23 +20,28 @@
 #include "quickview.h"
 
 #include <curses.h> /* mvwaddstr() wattrset() */
+#include <sys/stat.h> /* S_ISDIR() S_ISLNK() stat */
 #include <unistd.h> /* usleep() */
 
 #include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL size_t */
-#include <stdio.h> /* FILE SEEK_SET fclose() fdopen() feof() fseek()
-                      tmpfile() */
-#include <stdlib.h> /* free() */
-#include <string.h> /* memmove() strcat() strlen() strncat() */
+#include <stdio.h> /* FILE fclose() feof() */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memcpy() memmove() strcat() strcmp() strcspn() strdup()
+                       strlen() strncat() */
+#include <time.h> /* time_t */
 
 #include "../cfg/config.h"
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/pthread.h"
 #include "../engine/mode.h"
 #include "../modes/dialogs/msg_dialog.h"
 #include "../modes/modes.h"
 #include "../modes/view.h"
+#include "../utils/cancellation.h"
 #include "../utils/file_streams.h"
+#include "../utils/find.h"
 #include "../utils/fs.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
@@ -44,6 +49,7 @@
 #include "../utils/test_helpers.h"
 #include "../utils/utf8.h"
 #include "../utils/utils.h"
+#include "../background.h"
 #include "../filelist.h"
 #include "../filetype.h"
 #include "../macros.h"
@@ -55,16 +61,21 @@
 #include "colors.h"
 #include "escape.h"
 #include "fileview.h"
+#include "qv_cache.h"
 #include "statusbar.h"
 #include "ui.h"
 
 /* Size of buffer holding preview line (in characters). */
 #define PREVIEW_LINE_BUF_LEN 4096
 
+/* Number of directory previews kept in memory. */
+#define DIR_CACHE_SIZE 8
+
 /* State of directory tree print functions. */
 typedef struct
 {
-	FILE *fp;          /* Output preview stream. */
+	char *text;        /* Output preview text. */
+	size_t len;        /* Length of the text. */
 	int n;             /* Current line number (zero based). */
 	int ndirs;         /* Number of seen directories. */
 	int nfiles;        /* Number of seen files. */
@@ -73,9 +84,63 @@ typedef struct
 }
 tree_print_state_t;
 
+/* Cached preview of a directory. */
+typedef struct
+{
+	char *path;              /* Path to the directory. */
+	time_t mtime;            /* Modification time of the directory. */
+	int max_lines;           /* Limit on number of lines of the tree. */
+	char *text;              /* Tree, includes summary if it's complete. */
+	int complete;            /* Whether the tree wasn't truncated. */
+	int has_totals;          /* Whether totals of truncated tree are known. */
+	int ndirs;               /* Total number of directories in the tree. */
+	int nfiles;              /* Total number of files in the tree. */
+	unsigned long long used; /* Value of the use counter on last access. */
+}
+dir_preview_t;
+
+/* Counting of files of a directory in background. */
+typedef struct
+{
+	char *path;   /* Path to the directory. */
+	time_t mtime; /* Modification time of the directory. */
+	int ndirs;    /* Number of directories found so far. */
+	int nfiles;   /* Number of files found so far. */
+
+	/* These fields are guarded by the totals_lock. */
+	int done;    /* Whether counting has finished. */
+	int dropped; /* Whether result isn't needed anymore (the task frees the
+	                structure in this case). */
+}
+dir_totals_t;
+
+/* Source of lines for the preview. */
+typedef struct
+{
+	FILE *fp;         /* Stream to read from or NULL. */
+	const char *text; /* Text to read from if stream is NULL. */
+}
+line_source_t;
+
+static void prefetch(view_t *view, int pos);
 static void view_entry(const dir_entry_t *entry);
 static void view_file(const char path[]);
-static FILE * view_dir(const char path[], int max_lines);
+static FILE * get_cached_preview(const char path[], const char viewer[]);
+TSTATIC char * get_dir_preview(const char path[], int height);
+static dir_preview_t * find_dir_preview(const char path[], time_t mtime,
+		int max_lines);
+static dir_preview_t * pick_dir_preview_slot(void);
+static time_t get_mtime(const char path[]);
+static char * view_dir(const char path[], int max_lines, int *complete);
+static void start_counting(const char path[], time_t mtime);
+static void stop_counting(void);
+static int check_counting(void);
+static void count_task(bg_op_t *bg_op, void *arg);
+static int count_match(const char path[], const struct stat *st, void *arg);
+static void count_found(const char path[], const struct stat *st, void *arg);
+static int count_dropped(void *arg);
+static void free_totals(dir_totals_t *totals);
+static char * format_summary(int ndirs, int nfiles);
 static int print_dir_tree(tree_print_state_t *s, const char path[], int last);
 static int enter_dir(tree_print_state_t *s, const char path[], int last);
 static int visit_file(tree_print_state_t *s, const char path[], int last);
@@ -89,12 +154,27 @@ static void print_tree_entry(tree_print_state_t *s, const char path[],
 		int end_line);
 static void print_entry_prefix(tree_print_state_t *s);
 TSTATIC void view_stream(FILE *fp, int wrapped);
+static void view_text(const char text[], int wrapped);
+static void view_lines(line_source_t *src, int wrapped);
+static char * src_get_line(line_source_t *src, char buf[], size_t bufsz);
+static void src_skip_until_eol(line_source_t *src);
+static int src_eof(const line_source_t *src);
 static int shift_line(char line[], size_t len, size_t offset);
-static size_t add_to_line(FILE *fp, size_t max, char line[], size_t len);
+static size_t add_to_line(line_source_t *src, size_t max, char line[],
+		size_t len);
 static void write_message(const char msg[]);
 static void cleanup_for_text(void);
 static char * expand_viewer_command(const char viewer[]);
 
+/* Protects shared fields of dir_totals_t. */
+static pthread_mutex_t totals_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Counting of files that was started last or NULL. */
+static dir_totals_t *totals;
+/* Previews of directories. */
+static dir_preview_t dir_cache[DIR_CACHE_SIZE];
+/* Counter of accesses to directory previews, defines order of eviction. */
+static unsigned long long dir_use_counter;
+
 int
 qv_ensure_is_shown(void)
 {
@@ -184,6 +264,66 @@ qv_draw(view_t *view)
 
 	refresh_view_win(other_view);
 	ui_view_title_update(other_view);
+
+	/* Neighbours are likely to be viewed next. */
+	if(view == curr_view && curr_stats.load_stage >= 3)
+	{
+		prefetch(view, view->list_pos + 1);
+		prefetch(view, view->list_pos - 1);
+	}
+}
+
+void
+qv_check_cache(void)
+{
+	const int preview_ready = qvc_check();
+	const int totals_ready = check_counting();
+	if((preview_ready || totals_ready) && curr_stats.preview.on)
+	{
+		qv_draw(curr_view);
+	}
+}
+
+/* Schedules loading of preview of a regular file at specified position in the
+ * view if it's previewed by a non-graphical viewer. */
+static void
+prefetch(view_t *view, int pos)
+{
+	char path[PATH_MAX + 1];
+	const dir_entry_t *entry;
+	const char *viewer;
+	char *expanded;
+	int list_pos;
+
+	if(pos < 0 || pos >= view->list_rows)
+	{
+		return;
+	}
+
+	entry = &view->dir_entry[pos];
+	if(entry->type != FT_REG || fentry_is_fake(entry))
+	{
+		return;
+	}
+
+	get_full_path_of(entry, sizeof(path), path);
+	viewer = qv_get_viewer(path);
+	if(is_null_or_empty(viewer) || is_graphical_viewer(viewer))
+	{
+		return;
+	}
+
+	/* Macros are expanded for the current file. */
+	list_pos = view->list_pos;
+	view->list_pos = pos;
+	expanded = expand_viewer_command(viewer);
+	view->list_pos = list_pos;
+
+	if(expanded != NULL)
+	{
+		qvc_prefetch(path, expanded, flist_get_dir(view));
+		free(expanded);
+	}
 }
 
 /* Draws preview of the entry in the other view. */
@@ -235,18 +375,25 @@ view_file(const char path[])
 	int graphical = 0;
 	const char *viewer;
 	const char *clear_cmd;
-	FILE *fp;
+	FILE *fp = NULL;
+	char *text = NULL;
 
 	viewer = qv_get_viewer(path);
 
+	if(viewer != NULL || !is_dir(path))
+	{
+		/* Totals of previously viewed directory aren't needed anymore. */
+		stop_counting();
+	}
+
 	if(viewer == NULL && is_dir(path))
 	{
 		ui_cancellation_reset();
 		ui_cancellation_enable();
-		fp = view_dir(path, ui_qv_height(other_view));
+		text = get_dir_preview(path, ui_qv_height(other_view));
 		ui_cancellation_disable();
 
-		if(fp == NULL)
+		if(text == NULL)
 		{
 			write_message("Failed to view directory");
 			return;
@@ -261,6 +408,17 @@ view_file(const char path[])
 			return;
 		}
 	}
+	else if(!is_graphical_viewer(viewer) && curr_stats.load_stage >= 3)
+	{
+		/* Don't block on viewers that produce text, they are run in background
+		 * and quick view is redrawn once output is ready. */
+		fp = get_cached_preview(path, viewer);
+		if(fp == NULL)
+		{
+			write_message("Loading preview...");
+			return;
+		}
+	}
 	else
 	{
 		graphical = is_graphical_viewer(viewer);
@@ -294,56 +452,364 @@ view_file(const char path[])
 	update_string(&curr_stats.preview.cleanup_cmd, clear_cmd);
 
 	wattrset(other_view->win, 0);
-	view_stream(fp, cfg.wrap_quick_view);
-	fclose(fp);
+	if(fp == NULL)
+	{
+		view_text(text, cfg.wrap_quick_view);
+		free(text);
+	}
+	else
+	{
+		view_stream(fp, cfg.wrap_quick_view);
+		fclose(fp);
+	}
 
 	ui_cancellation_disable();
 }
 
-FILE *
+/* Retrieves output of the viewer for the path from the cache.  Returns the
+ * stream or NULL if it's not available yet. */
+static FILE *
+get_cached_preview(const char path[], const char viewer[])
+{
+	FILE *fp;
+	char *const expanded = expand_viewer_command(viewer);
+	if(expanded == NULL)
+	{
+		return NULL;
+	}
+
+	fp = qvc_get(path, expanded, flist_get_dir(curr_view));
+	free(expanded);
+	return fp;
+}
+
+char *
 qv_view_dir(const char path[])
 {
-	return view_dir(path, INT_MAX);
+	int complete;
+	return view_dir(path, INT_MAX, &complete);
 }
 
-/* Previews directory, actual preview is to be read from returned stream.
- * Returns the stream or NULL on error. */
-static FILE *
-view_dir(const char path[], int max_lines)
+/* Previews directory for quick view of specified height reusing cached
+ * previews.  Totals of a tree that doesn't fit are counted in background.
+ * Returns newly allocated text or NULL on error. */
+TSTATIC char *
+get_dir_preview(const char path[], int height)
 {
-	FILE *fp = os_tmpfile();
+	const int max_lines = MAX(height - 2, 1);
+	const time_t mtime = get_mtime(path);
+	dir_preview_t *preview;
+	char *summary;
+	char *text;
+	int complete;
 
-	if(fp != NULL)
+	(void)check_counting();
+
+	preview = find_dir_preview(path, mtime, max_lines);
+	if(preview == NULL)
 	{
-		tree_print_state_t s = {
-			.fp = fp,
-			.max = max_lines,
-		};
+		text = view_dir(path, max_lines, &complete);
+		if(text == NULL || ui_cancellation_requested())
+		{
+			/* Don't cache incomplete results. */
+			return text;
+		}
 
-		if(print_dir_tree(&s, path, 0) == 0 && s.n != 0)
+		preview = pick_dir_preview_slot();
+		free(preview->path);
+		free(preview->text);
+		preview->path = strdup(path);
+		preview->mtime = mtime;
+		preview->max_lines = max_lines;
+		preview->text = text;
+		preview->complete = complete;
+		preview->has_totals = 0;
+
+		if(preview->path == NULL)
 		{
-			/* Print summary only if we visited the whole subtree. */
-			fprintf(fp, "%s\n%d director%s, %d file%s",
-					ui_cancellation_requested() ? "(cancelled)\n" : "",
-					s.ndirs, (s.ndirs == 1) ? "y" : "ies",
-					s.nfiles, (s.nfiles == 1) ? "" : "s");
+			preview->text = NULL;
+			return text;
 		}
-		else if(ui_cancellation_requested())
+	}
+
+	preview->used = ++dir_use_counter;
+
+	if(preview->complete)
+	{
+		return strdup(preview->text);
+	}
+
+	if(!preview->has_totals)
+	{
+		start_counting(path, mtime);
+		return format_str("%s\n(counting...)", preview->text);
+	}
+
+	summary = format_summary(preview->ndirs, preview->nfiles);
+	text = format_str("%s\n%s", preview->text, summary);
+	free(summary);
+	return text;
+}
+
+/* Looks up cached directory preview.  Returns the preview or NULL. */
+static dir_preview_t *
+find_dir_preview(const char path[], time_t mtime, int max_lines)
+{
+	int i;
+	for(i = 0; i < DIR_CACHE_SIZE; ++i)
+	{
+		dir_preview_t *const preview = &dir_cache[i];
+		if(preview->path != NULL && preview->mtime == mtime &&
+				preview->max_lines == max_lines && strcmp(preview->path, path) == 0)
 		{
-			fputs("(cancelled)", fp);
+			return preview;
 		}
+	}
+	return NULL;
+}
 
-		if(s.n == 0)
+/* Picks slot of the cache for a new directory preview evicting least recently
+ * used one if necessary.  Returns the slot. */
+static dir_preview_t *
+pick_dir_preview_slot(void)
+{
+	int i;
+	dir_preview_t *oldest = &dir_cache[0];
+	for(i = 0; i < DIR_CACHE_SIZE; ++i)
+	{
+		if(dir_cache[i].path == NULL)
 		{
-			fclose(fp);
-			fp = NULL;
+			return &dir_cache[i];
 		}
-		else
+		if(dir_cache[i].used < oldest->used)
 		{
-			fseek(fp, 0, SEEK_SET);
+			oldest = &dir_cache[i];
 		}
 	}
-	return fp;
+	return oldest;
+}
+
+/* Retrieves modification time of a file.  Returns the time or zero on
+ * error. */
+static time_t
+get_mtime(const char path[])
+{
+	struct stat st;
+	return (os_stat(path, &st) == 0) ? st.st_mtime : 0;
+}
+
+/* Previews directory into newly allocated text, which includes summary if the
+ * whole tree fit into max_lines.  *complete is set to non-zero in that case.
+ * Returns the text or NULL on error. */
+static char *
+view_dir(const char path[], int max_lines, int *complete)
+{
+	tree_print_state_t s = {
+		.text = NULL,
+		.len = 0U,
+		.max = max_lines,
+	};
+
+	*complete = (print_dir_tree(&s, path, 0) == 0 && s.n != 0);
+	if(*complete)
+	{
+		/* Print summary only if we visited the whole subtree. */
+		char *const summary = format_summary(s.ndirs, s.nfiles);
+		if(ui_cancellation_requested())
+		{
+			(void)strappend(&s.text, &s.len, "(cancelled)\n");
+		}
+		(void)strappend(&s.text, &s.len, "\n");
+		(void)strappend(&s.text, &s.len, summary);
+		free(summary);
+	}
+	else if(ui_cancellation_requested())
+	{
+		(void)strappend(&s.text, &s.len, "(cancelled)");
+	}
+
+	if(s.n == 0)
+	{
+		free(s.text);
+		return NULL;
+	}
+	return s.text;
+}
+
+/* Starts counting files of the directory in background unless it's already
+ * being counted.  Counting of other directory is stopped. */
+static void
+start_counting(const char path[], time_t mtime)
+{
+	if(totals != NULL)
+	{
+		if(totals->mtime == mtime && strcmp(totals->path, path) == 0)
+		{
+			return;
+		}
+		stop_counting();
+	}
+
+	totals = calloc(1, sizeof(*totals));
+	if(totals == NULL)
+	{
+		return;
+	}
+
+	totals->path = strdup(path);
+	totals->mtime = mtime;
+	if(totals->path == NULL ||
+			bg_execute("Counting files", path, BG_UNDEFINED_TOTAL, 0, &count_task,
+				totals) != 0)
+	{
+		free_totals(totals);
+		totals = NULL;
+	}
+}
+
+/* Stops counting of files if it's in progress. */
+static void
+stop_counting(void)
+{
+	int done;
+
+	if(totals == NULL)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&totals_lock);
+	done = totals->done;
+	totals->dropped = 1;
+	pthread_mutex_unlock(&totals_lock);
+
+	/* Otherwise the task will free it. */
+	if(done)
+	{
+		free_totals(totals);
+	}
+	totals = NULL;
+}
+
+/* Stores result of counting in cached previews once it's ready.  Returns
+ * non-zero if new totals became available, otherwise zero is returned. */
+static int
+check_counting(void)
+{
+	int i;
+	int done;
+
+	if(totals == NULL)
+	{
+		return 0;
+	}
+
+	pthread_mutex_lock(&totals_lock);
+	done = totals->done;
+	pthread_mutex_unlock(&totals_lock);
+
+	if(!done)
+	{
+		return 0;
+	}
+
+	for(i = 0; i < DIR_CACHE_SIZE; ++i)
+	{
+		dir_preview_t *const preview = &dir_cache[i];
+		if(preview->path != NULL && preview->mtime == totals->mtime &&
+				strcmp(preview->path, totals->path) == 0)
+		{
+			preview->has_totals = 1;
+			preview->ndirs = totals->ndirs;
+			preview->nfiles = totals->nfiles;
+		}
+	}
+
+	free_totals(totals);
+	totals = NULL;
+	return 1;
+}
+
+/* Counts directories and files in a tree. */
+static void
+count_task(bg_op_t *bg_op, void *arg)
+{
+	dir_totals_t *const t = arg;
+	char *targets[] = { t->path };
+	const cancellation_t cancellation = { .hook = &count_dropped, .arg = t };
+	const find_params_t params = {
+		.nthreads = cfg.stat_threads,
+		.match = &count_match,
+		.on_found = &count_found,
+		.cancellation = &cancellation,
+		.arg = t,
+	};
+
+	(void)find_files(targets, 1, &params);
+
+	pthread_mutex_lock(&totals_lock);
+	if(t->dropped)
+	{
+		pthread_mutex_unlock(&totals_lock);
+		free_totals(t);
+		return;
+	}
+	t->done = 1;
+	pthread_mutex_unlock(&totals_lock);
+}
+
+/* Accepts every file.  Returns non-zero. */
+static int
+count_match(const char path[], const struct stat *st, void *arg)
+{
+	return 1;
+}
+
+/* Counts a file the same way print_dir_tree() does. */
+static void
+count_found(const char path[], const struct stat *st, void *arg)
+{
+	dir_totals_t *const t = arg;
+	if(S_ISDIR(st->st_mode) || (S_ISLNK(st->st_mode) && is_dir(path)))
+	{
+		++t->ndirs;
+	}
+	else
+	{
+		++t->nfiles;
+	}
+}
+
+/* Checks whether result of counting isn't needed anymore.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+count_dropped(void *arg)
+{
+	dir_totals_t *const t = arg;
+	int dropped;
+
+	pthread_mutex_lock(&totals_lock);
+	dropped = t->dropped;
+	pthread_mutex_unlock(&totals_lock);
+
+	return dropped;
+}
+
+/* Frees counting state. */
+static void
+free_totals(dir_totals_t *totals)
+{
+	free(totals->path);
+	free(totals);
+}
+
+/* Formats summary line of the tree preview.  Returns newly allocated
+ * string. */
+static char *
+format_summary(int ndirs, int nfiles)
+{
+	return format_str("%d director%s, %d file%s", ndirs,
+			(ndirs == 1) ? "y" : "ies", nfiles, (nfiles == 1) ? "" : "s");
 }
 
 /* Produces tree preview of the path.  Returns non-zero to request stopping of
@@ -456,9 +922,9 @@ visit_link(tree_print_state_t *s, const char path[], int last,
 {
 	set_prefix_char(s, last ? '`' : '|');
 	print_tree_entry(s, path, 0);
-	fputs(" -> ", s->fp);
-	fputs(target, s->fp);
-	fputc('\n', s->fp);
+	(void)strappend(&s->text, &s->len, " -> ");
+	(void)strappend(&s->text, &s->len, target);
+	(void)strappendch(&s->text, &s->len, '\n');
 
 	return ++s->n >= s->max;
 }
@@ -503,14 +969,14 @@ static void
 print_tree_entry(tree_print_state_t *s, const char path[], int end_line)
 {
 	print_entry_prefix(s);
-	fputs(get_last_path_component(path), s->fp);
+	(void)strappend(&s->text, &s->len, get_last_path_component(path));
 	if(is_dir(path) && !ends_with_slash(path))
 	{
-		fputc('/', s->fp);
+		(void)strappendch(&s->text, &s->len, '/');
 	}
 	if(end_line)
 	{
-		fputc('\n', s->fp);
+		(void)strappendch(&s->text, &s->len, '\n');
 	}
 }
 
@@ -523,8 +989,8 @@ print_entry_prefix(tree_print_state_t *s)
 	/* Expand " |`" into "    |   `-- ". */
 	while(p[0] != '\0')
 	{
-		fputc(p[0], s->fp);
-		fputs(p[1] == '\0' ? "-- " : "   ", s->fp);
+		(void)strappendch(&s->text, &s->len, p[0]);
+		(void)strappend(&s->text, &s->len, p[1] == '\0' ? "-- " : "   ");
 		++p;
 	}
 }
@@ -534,6 +1000,27 @@ print_entry_prefix(tree_print_state_t *s)
  * should be wrapped. */
 TSTATIC void
 view_stream(FILE *fp, int wrapped)
+{
+	line_source_t src = { .fp = fp, .text = NULL };
+	skip_bom(fp);
+	view_lines(&src, wrapped);
+}
+
+/* Displays the text in the other pane starting from the second line and second
+ * column.  The wrapped parameter determines whether lines should be
+ * wrapped. */
+static void
+view_text(const char text[], int wrapped)
+{
+	line_source_t src = { .fp = NULL, .text = text };
+	view_lines(&src, wrapped);
+}
+
+/* Displays lines of the source in the other pane starting from the second line
+ * and second column.  The wrapped parameter determines whether lines should be
+ * wrapped. */
+static void
+view_lines(line_source_t *src, int wrapped)
 {
 	const size_t left = ui_qv_left(other_view);
 	const size_t top = ui_qv_top(other_view);
@@ -549,17 +1036,16 @@ view_stream(FILE *fp, int wrapped)
 
 	esc_state_init(&state, &cs->color[WIN_COLOR]);
 
-	skip_bom(fp);
-	res = get_line(fp, line, sizeof(line));
+	res = src_get_line(src, line, sizeof(line));
 
 	while(res != NULL && y < top + max_height)
 	{
 		int offset;
 		int printed;
-		const size_t len = add_to_line(fp, max_width, line, sizeof(line));
+		const size_t len = add_to_line(src, max_width, line, sizeof(line));
 		if(!wrapped && line[len - 1] != '\n')
 		{
-			skip_until_eol(fp);
+			src_skip_until_eol(src);
 		}
 
 		offset = esc_print_line(line, other_view->win, left, y, max_width, 0,
@@ -569,11 +1055,60 @@ view_stream(FILE *fp, int wrapped)
 
 		if(y < top + max_height && (!wrapped || shift_line(line, len, offset)))
 		{
-			res = get_line(fp, line, sizeof(line));
+			res = src_get_line(src, line, sizeof(line));
 		}
 	}
 }
 
+/* Reads next line of at most bufsz - 1 characters from the source.  Returns buf
+ * or NULL if there is nothing left to read. */
+static char *
+src_get_line(line_source_t *src, char buf[], size_t bufsz)
+{
+	size_t len;
+
+	if(src->fp != NULL)
+	{
+		return get_line(src->fp, buf, bufsz);
+	}
+
+	if(src->text[0] == '\0' || bufsz <= 1)
+	{
+		return NULL;
+	}
+
+	len = strcspn(src->text, "\n");
+	len += (src->text[len] == '\n');
+	len = MIN(len, bufsz - 1);
+
+	memcpy(buf, src->text, len);
+	buf[len] = '\0';
+	src->text += len;
+	return buf;
+}
+
+/* Skips the rest of the current line of the source. */
+static void
+src_skip_until_eol(line_source_t *src)
+{
+	if(src->fp != NULL)
+	{
+		skip_until_eol(src->fp);
+		return;
+	}
+
+	src->text += strcspn(src->text, "\n");
+	src->text += (src->text[0] == '\n');
+}
+
+/* Checks whether there is nothing left to read from the source.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+src_eof(const line_source_t *src)
+{
+	return (src->fp != NULL) ? feof(src->fp) : (src->text[0] == '\0');
+}
+
 /* Shifts characters in the line of length len, so that characters at the offset
  * position are moved to the beginning of the line.  Returns non-zero if new
  * buffer should be treated as empty. */
@@ -589,17 +1124,17 @@ shift_line(char line[], size_t len, size_t offset)
 	return 1;
 }
 
-/* Tries to add more characters from the fp file, but not exceed length of the
+/* Tries to add more characters from the source, but not exceed length of the
  * line buffer (the len parameter) and maximum number of printable character
  * positions (the max parameter).  Returns new length of the line buffer. */
 static size_t
-add_to_line(FILE *fp, size_t max, char line[], size_t len)
+add_to_line(line_source_t *src, size_t max, char line[], size_t len)
 {
 	size_t n_len = utf8_nstrlen(line) - esc_str_overhead(line);
 	size_t curr_len = strlen(line);
-	while(n_len < max && line[curr_len - 1] != '\n' && !feof(fp))
+	while(n_len < max && line[curr_len - 1] != '\n' && !src_eof(src))
 	{
-		if(get_line(fp, line + curr_len, len - curr_len) == NULL)
+		if(src_get_line(src, line + curr_len, len - curr_len) == NULL)
 		{
 			break;
 		}
@@ -41,6 +41,9 @@ int qv_can_show(void);
  * doesn't make sense (e.g. only one pane is visible). */
 void qv_draw(struct view_t *view);
 
+/* Redraws quick view if preview of its file has been loaded in background. */
+void qv_check_cache(void);
+
 /* Toggles state of the quick view. */
 void qv_toggle(void);
 
@@ -59,9 +62,8 @@ void qv_cleanup(struct view_t *view, const char cmd[]);
  * string stored internally. */
 const char * qv_get_viewer(const char path[]);
 
-/* Previews directory, actual preview is to be read from returned stream.
- * Returns the stream or NULL on error. */
-FILE * qv_view_dir(const char path[]);
+/* Previews directory.  Returns newly allocated text or NULL on error. */
+char * qv_view_dir(const char path[]);
 
 /* Decides on path that should be explored when cursor points to the given
  * entry. */
@@ -70,6 +72,7 @@ void qv_get_path_to_explore(const struct dir_entry_t *entry, char buf[],
 
 TSTATIC_DEFS(
 	void view_stream(FILE *fp, int wrapped);
+	char * get_dir_preview(const char path[], int height);
 )
 
 #endif /* VIFM__UI__QUICKVIEW_H__ */
@@ -0,0 +1,651 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "qv_cache.h"
+
+#include <sys/stat.h> /* stat */
+#include <sys/types.h> /* pid_t */
+#include <unistd.h> /* read() */
+
+#include <errno.h> /* EINTR errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdio.h> /* FILE fclose() fileno() fwrite() rewind() tmpfile() */
+#include <stdlib.h> /* calloc() free() realloc() */
+#include <string.h> /* strcmp() strdup() strlen() */
+#include <time.h> /* time_t */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "../utils/cancellation.h"
+#include "../utils/fs.h"
+#include "../utils/utils.h"
+#include "../background.h"
+
+/* Maximum total size of cached previews including their bookkeeping. */
+#define QVC_MAX_SIZE (16*1024*1024)
+
+/* Maximum number of cached previews. */
+#define QVC_MAX_ENTRIES 256
+
+/* Number of buckets of the table used for lookups, a power of two. */
+#define QVC_NBUCKETS 512
+
+/* Maximum size of a single preview, the rest of output is dropped. */
+#define QVC_MAX_PREVIEW_SIZE (256*1024)
+
+/* Maximum number of viewers that run at the same time. */
+#define QVC_MAX_LOADS 3
+
+/* State of a preview. */
+typedef enum
+{
+	PS_PENDING, /* Waiting for a free slot to start loading. */
+	PS_LOADING, /* Viewer is running and its output is being read. */
+	PS_READY,   /* Output of the viewer is available. */
+}
+PreviewState;
+
+/* Single cached preview. */
+typedef struct cache_entry_t
+{
+	/* Key of the preview. */
+	char *path;     /* Full path to the file. */
+	char *cmd;      /* Expanded viewer command. */
+	time_t mtime;   /* Modification time of the file. */
+	uint64_t size;  /* Size of the file. */
+
+	unsigned int hash;          /* Hash of path and command. */
+	struct cache_entry_t *next; /* Next preview in the same bucket. */
+	int idx;                    /* Position in the previews array. */
+	size_t footprint;           /* Memory taken by the preview when accounted. */
+
+	char *dir;               /* Working directory of the viewer. */
+	unsigned int generation; /* Value of the generation on last request. */
+	unsigned long long used; /* Value of the use counter on last access. */
+	int accounted;           /* Whether data is counted in total size. */
+	FILE *fp;                /* Output of the viewer while it's loading. */
+	pid_t pid;               /* Process of the viewer while it's loading. */
+	bg_op_t *bg_op;          /* Background operation that reads the output. */
+
+	/* These fields are shared with loading thread and are guarded by the
+	 * lock. */
+	PreviewState state; /* State of the preview. */
+	int dropped;        /* Whether the preview was removed from the cache while
+	                       it was loading. */
+	char *data;         /* Output of the viewer. */
+	size_t len;         /* Length of the output. */
+}
+cache_entry_t;
+
+static cache_entry_t * find_preview(const char path[], const char cmd[]);
+static unsigned int hash_key(const char path[], const char cmd[]);
+static cache_entry_t * add_preview(const char path[], const char cmd[],
+		const char dir[]);
+static int is_stale(const cache_entry_t *preview);
+static void get_key(const char path[], time_t *mtime, uint64_t *size);
+static FILE * make_stream(const cache_entry_t *preview);
+static void collect(void);
+static void evict(void);
+static void start_pending(void);
+static void stop_unwanted(void);
+static PreviewState get_state(const cache_entry_t *preview);
+static void start_load(cache_entry_t *preview);
+static void load_task(bg_op_t *bg_op, void *arg);
+static int load_cancelled(void *arg);
+static void remove_preview(int i);
+static void free_preview(cache_entry_t *preview);
+
+/* Protects shared fields of previews. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/* All known previews, is used only by the main thread. */
+static cache_entry_t **previews;
+/* Number of elements in the previews array. */
+static int npreviews;
+/* Previews chained by hashes of their path and command for lookups. */
+static cache_entry_t *buckets[QVC_NBUCKETS];
+/* Total size of ready previews. */
+static size_t total_size;
+/* Counter of accesses, which defines order of eviction. */
+static unsigned long long use_counter;
+/* Counter of qvc_get() calls, requests of older ones are discarded unless their
+ * loading has already started. */
+static unsigned int generation;
+/* Preview requested by the last qvc_get() call or NULL. */
+static cache_entry_t *current;
+
+FILE *
+qvc_get(const char path[], const char cmd[], const char dir[])
+{
+	cache_entry_t *preview;
+	PreviewState state;
+
+	collect();
+	++generation;
+
+	preview = find_preview(path, cmd);
+	if(preview != NULL && is_stale(preview))
+	{
+		remove_preview(preview->idx);
+		preview = NULL;
+	}
+	if(preview == NULL)
+	{
+		preview = add_preview(path, cmd, dir);
+		if(preview == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	preview->generation = generation;
+	preview->used = ++use_counter;
+	current = preview;
+
+	pthread_mutex_lock(&lock);
+	state = preview->state;
+	pthread_mutex_unlock(&lock);
+
+	if(state == PS_READY)
+	{
+		return make_stream(preview);
+	}
+
+	start_pending();
+	return NULL;
+}
+
+void
+qvc_prefetch(const char path[], const char cmd[], const char dir[])
+{
+	/* Preview of a changed file is replaced by qvc_get(), checking it here would
+	 * cost a stat() on every movement of the cursor. */
+	cache_entry_t *preview = find_preview(path, cmd);
+	if(preview == NULL)
+	{
+		preview = add_preview(path, cmd, dir);
+		if(preview == NULL)
+		{
+			return;
+		}
+	}
+
+	preview->generation = generation;
+	start_pending();
+}
+
+int
+qvc_check(void)
+{
+	int ready = 0;
+
+	if(current != NULL && !current->accounted)
+	{
+		pthread_mutex_lock(&lock);
+		ready = (current->state == PS_READY);
+		pthread_mutex_unlock(&lock);
+	}
+
+	collect();
+	stop_unwanted();
+	start_pending();
+	return ready;
+}
+
+void
+qvc_reset(void)
+{
+	while(npreviews != 0)
+	{
+		remove_preview(npreviews - 1);
+	}
+
+	free(previews);
+	previews = NULL;
+	total_size = 0U;
+	current = NULL;
+}
+
+/* Looks up preview by path and command, the preview might be stale.  Returns
+ * the preview or NULL. */
+static cache_entry_t *
+find_preview(const char path[], const char cmd[])
+{
+	const unsigned int hash = hash_key(path, cmd);
+	cache_entry_t *preview = buckets[hash%QVC_NBUCKETS];
+
+	while(preview != NULL)
+	{
+		if(preview->hash == hash && strcmp(preview->path, path) == 0 &&
+				strcmp(preview->cmd, cmd) == 0)
+		{
+			return preview;
+		}
+		preview = preview->next;
+	}
+	return NULL;
+}
+
+/* Computes FNV-1a hash of path and command.  Returns the hash. */
+static unsigned int
+hash_key(const char path[], const char cmd[])
+{
+	unsigned int hash = 2166136261U;
+
+	while(*path != '\0')
+	{
+		hash = (hash ^ (unsigned char)*path++)*16777619U;
+	}
+	hash = (hash ^ '\n')*16777619U;
+	while(*cmd != '\0')
+	{
+		hash = (hash ^ (unsigned char)*cmd++)*16777619U;
+	}
+
+	return hash;
+}
+
+/* Adds pending preview.  Returns the preview or NULL on error. */
+static cache_entry_t *
+add_preview(const char path[], const char cmd[], const char dir[])
+{
+	cache_entry_t **list;
+	cache_entry_t *const preview = calloc(1, sizeof(*preview));
+	if(preview == NULL)
+	{
+		return NULL;
+	}
+
+	preview->path = strdup(path);
+	preview->cmd = strdup(cmd);
+	preview->dir = strdup(dir);
+	preview->state = PS_PENDING;
+	preview->hash = hash_key(path, cmd);
+	get_key(path, &preview->mtime, &preview->size);
+
+	list = reallocarray(previews, npreviews + 1, sizeof(*previews));
+	if(list == NULL || preview->path == NULL || preview->cmd == NULL ||
+			preview->dir == NULL)
+	{
+		if(list != NULL)
+		{
+			previews = list;
+		}
+		free_preview(preview);
+		return NULL;
+	}
+
+	previews = list;
+	preview->idx = npreviews;
+	previews[npreviews++] = preview;
+
+	preview->next = buckets[preview->hash%QVC_NBUCKETS];
+	buckets[preview->hash%QVC_NBUCKETS] = preview;
+
+	/* Make room for the new preview if there are too many of them. */
+	evict();
+	return preview;
+}
+
+/* Checks whether the file changed since the preview was requested.  Returns
+ * non-zero if so, otherwise zero is returned. */
+static int
+is_stale(const cache_entry_t *preview)
+{
+	time_t mtime;
+	uint64_t size;
+	get_key(preview->path, &mtime, &size);
+	return (preview->mtime != mtime || preview->size != size);
+}
+
+/* Retrieves parts of key of a preview that depend on state of the file. */
+static void
+get_key(const char path[], time_t *mtime, uint64_t *size)
+{
+	struct stat st;
+	if(os_stat(path, &st) != 0)
+	{
+		*mtime = 0;
+		*size = 0U;
+		return;
+	}
+
+	*mtime = st.st_mtime;
+	*size = st.st_size;
+}
+
+/* Makes stream out of ready preview.  Returns the stream or NULL on error. */
+static FILE *
+make_stream(const cache_entry_t *preview)
+{
+	FILE *const fp = tmpfile();
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	if(fwrite(preview->data, 1U, preview->len, fp) != preview->len)
+	{
+		fclose(fp);
+		return NULL;
+	}
+
+	rewind(fp);
+	return fp;
+}
+
+/* Accounts previews which finished loading and evicts old ones if necessary. */
+static void
+collect(void)
+{
+	int i;
+
+	pthread_mutex_lock(&lock);
+	for(i = 0; i < npreviews; ++i)
+	{
+		cache_entry_t *const preview = previews[i];
+		if(preview->state == PS_READY && !preview->accounted)
+		{
+			/* Empty previews of failed viewers take memory too. */
+			preview->footprint = sizeof(*preview) + strlen(preview->path) +
+				strlen(preview->cmd) + strlen(preview->dir) + 3U + preview->len;
+			total_size += preview->footprint;
+			preview->accounted = 1;
+		}
+	}
+	pthread_mutex_unlock(&lock);
+
+	evict();
+}
+
+/* Removes least recently used ready previews until total size and number of
+ * previews are within the limits.  Preview requested last is never evicted. */
+static void
+evict(void)
+{
+	while(total_size > QVC_MAX_SIZE || npreviews > QVC_MAX_ENTRIES)
+	{
+		int i;
+		int oldest = -1;
+
+		for(i = 0; i < npreviews; ++i)
+		{
+			cache_entry_t *const preview = previews[i];
+			if(preview->accounted && preview != current &&
+					(oldest == -1 || preview->used < previews[oldest]->used))
+			{
+				oldest = i;
+			}
+		}
+
+		if(oldest == -1)
+		{
+			break;
+		}
+
+		remove_preview(oldest);
+	}
+}
+
+/* Discards pending previews of previous requests and starts loading of the
+ * rest while there are free slots. */
+static void
+start_pending(void)
+{
+	int i;
+	int nloading = 0;
+
+	/* Only the main thread moves previews out of pending state, so it doesn't
+	 * change after being checked. */
+	for(i = npreviews - 1; i >= 0; --i)
+	{
+		if(get_state(previews[i]) == PS_PENDING &&
+				previews[i]->generation != generation)
+		{
+			remove_preview(i);
+		}
+	}
+
+	pthread_mutex_lock(&lock);
+	for(i = 0; i < npreviews; ++i)
+	{
+		nloading += (previews[i]->state == PS_LOADING);
+	}
+	pthread_mutex_unlock(&lock);
+
+	/* Preview that is being looked at goes first. */
+	if(current != NULL && get_state(current) == PS_PENDING &&
+			nloading < QVC_MAX_LOADS)
+	{
+		start_load(current);
+		++nloading;
+	}
+
+	for(i = 0; i < npreviews && nloading < QVC_MAX_LOADS; ++i)
+	{
+		if(get_state(previews[i]) == PS_PENDING)
+		{
+			start_load(previews[i]);
+			++nloading;
+		}
+	}
+}
+
+/* Stops loading of previews that weren't requested after the last qvc_get()
+ * call, which also kills their viewers. */
+static void
+stop_unwanted(void)
+{
+	int i;
+	for(i = npreviews - 1; i >= 0; --i)
+	{
+		if(get_state(previews[i]) == PS_LOADING &&
+				previews[i]->generation != generation)
+		{
+			remove_preview(i);
+		}
+	}
+}
+
+/* Retrieves state of the preview, which might be changed by loading thread.
+ * Returns the state. */
+static PreviewState
+get_state(const cache_entry_t *preview)
+{
+	PreviewState state;
+	pthread_mutex_lock(&lock);
+	state = preview->state;
+	pthread_mutex_unlock(&lock);
+	return state;
+}
+
+/* Runs viewer of the preview and starts reading its output in background.  On
+ * failure the preview becomes ready and empty. */
+static void
+start_load(cache_entry_t *preview)
+{
+	char cwd[PATH_MAX + 1];
+	const int restore_cwd = (get_cwd(cwd, sizeof(cwd)) != NULL);
+
+	/* Viewers might use relative paths. */
+	(void)vifm_chdir(preview->dir);
+	preview->fp = read_cmd_output_pid(preview->cmd, 0, &preview->pid);
+	if(restore_cwd)
+	{
+		(void)vifm_chdir(cwd);
+	}
+
+	pthread_mutex_lock(&lock);
+	if(preview->fp == NULL)
+	{
+		preview->state = PS_READY;
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	preview->state = PS_LOADING;
+	pthread_mutex_unlock(&lock);
+
+	if(bg_execute("Loading preview", preview->cmd, BG_UNDEFINED_TOTAL, 0,
+				&load_task, preview) != 0)
+	{
+		/* Closing the pipe makes the viewer quit on its next write. */
+		fclose(preview->fp);
+		preview->fp = NULL;
+
+		pthread_mutex_lock(&lock);
+		preview->state = PS_READY;
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/* Reads output of a viewer.  Closing the stream after reading enough data makes
+ * viewer quit on its next write.  Viewer is interrupted if the preview is
+ * dropped or the job is cancelled while waiting for its output. */
+static void
+load_task(bg_op_t *bg_op, void *arg)
+{
+	cache_entry_t *const preview = arg;
+	const cancellation_t cancellation = {
+		.hook = &load_cancelled,
+		.arg = preview,
+	};
+	char *data = malloc(QVC_MAX_PREVIEW_SIZE);
+	size_t len = 0U;
+
+	preview->bg_op = bg_op;
+
+	if(data != NULL)
+	{
+		while(len < QVC_MAX_PREVIEW_SIZE)
+		{
+			ssize_t nread;
+
+			wait_for_data_from(preview->pid, preview->fp, 0, &cancellation);
+			if(cancellation_requested(&cancellation))
+			{
+				break;
+			}
+
+			nread = read(fileno(preview->fp), data + len,
+					QVC_MAX_PREVIEW_SIZE - len);
+			if(nread < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if(nread <= 0)
+			{
+				break;
+			}
+			len += nread;
+		}
+
+		/* Don't keep unused part of the buffer. */
+		if(len != 0U)
+		{
+			char *const shrunk = realloc(data, len);
+			data = (shrunk == NULL) ? data : shrunk;
+		}
+	}
+
+	fclose(preview->fp);
+	preview->fp = NULL;
+
+	pthread_mutex_lock(&lock);
+	if(preview->dropped)
+	{
+		pthread_mutex_unlock(&lock);
+		free(data);
+		free_preview(preview);
+		return;
+	}
+
+	preview->data = data;
+	preview->len = (data == NULL) ? 0U : len;
+	preview->state = PS_READY;
+	pthread_mutex_unlock(&lock);
+}
+
+/* Implementation of cancellation hook for loading of a preview.  Returns
+ * non-zero if loading should be stopped. */
+static int
+load_cancelled(void *arg)
+{
+	cache_entry_t *const preview = arg;
+	int dropped;
+
+	pthread_mutex_lock(&lock);
+	dropped = preview->dropped;
+	pthread_mutex_unlock(&lock);
+
+	return dropped || bg_op_cancelled(preview->bg_op);
+}
+
+/* Removes preview from the list.  Preview that's still loading is freed by the
+ * loading thread. */
+static void
+remove_preview(int i)
+{
+	cache_entry_t *const preview = previews[i];
+	cache_entry_t **link = &buckets[preview->hash%QVC_NBUCKETS];
+	int loading;
+
+	if(preview == current)
+	{
+		current = NULL;
+	}
+	if(preview->accounted)
+	{
+		total_size -= preview->footprint;
+	}
+
+	while(*link != preview)
+	{
+		link = &(*link)->next;
+	}
+	*link = preview->next;
+
+	--npreviews;
+	previews[i] = previews[npreviews];
+	previews[i]->idx = i;
+
+	pthread_mutex_lock(&lock);
+	loading = (preview->state == PS_LOADING);
+	preview->dropped = 1;
+	pthread_mutex_unlock(&lock);
+
+	if(!loading)
+	{
+		free_preview(preview);
+	}
+}
+
+/* Frees memory of the preview. */
+static void
+free_preview(cache_entry_t *preview)
+{
+	free(preview->path);
+	free(preview->cmd);
+	free(preview->dir);
+	free(preview->data);
+	free(preview);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,51 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UI__QV_CACHE_H__
+#define VIFM__UI__QV_CACHE_H__
+
+#include <stdio.h> /* FILE */
+
+/* Cache of output of viewers for quick view.  Viewers are run in background
+ * and their output is kept in memory keyed by path, modification time and size
+ * of the file as well as by the viewer command.  Least recently used previews
+ * are dropped when the cache grows too big. */
+
+/* Looks up preview of the file produced by the command, which is run from the
+ * directory.  Missing preview is scheduled for loading, which takes priority
+ * over all previously requested loads.  Returns stream with the preview
+ * positioned at its beginning or NULL if it's not available yet. */
+FILE * qvc_get(const char path[], const char cmd[], const char dir[]);
+
+/* Schedules loading of preview of the file produced by the command if it's not
+ * cached yet.  Loading of prefetched previews starts after loading of the one
+ * requested by the last qvc_get() call. */
+void qvc_prefetch(const char path[], const char cmd[], const char dir[]);
+
+/* Collects results of loading and starts pending loads.  Returns non-zero if
+ * preview requested by the last qvc_get() call became available, otherwise
+ * zero is returned. */
+int qvc_check(void);
+
+/* Drops all cached previews and pending loads. */
+void qvc_reset(void);
+
+#endif /* VIFM__UI__QV_CACHE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
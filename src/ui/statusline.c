@@ -146,13 +146,14 @@ update_stat_window_old(view_t *view, int lazy_redraw)
 	friendly_size_notation(fentry_get_size(view, curr), sizeof(size_buf),
 			size_buf);
 
+	fentry_ensure_meta(curr, FMETA_OWNER);
 	get_uid_string(curr, 0, sizeof(id_buf), id_buf);
 	if(id_buf[0] != '\0')
 		strcat(id_buf, ":");
 	get_gid_string(curr, 0, sizeof(id_buf) - strlen(id_buf),
 			id_buf + strlen(id_buf));
 #ifndef _WIN32
-	get_perm_string(perm_buf, sizeof(perm_buf), curr->mode);
+	get_perm_string(perm_buf, sizeof(perm_buf), fentry_get_mode(curr));
 #else
 	copy_str(perm_buf, sizeof(perm_buf), attr_str_long(curr->attrs));
 #endif
@@ -297,15 +298,17 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 				break;
 			case 'A':
 #ifndef _WIN32
-				get_perm_string(buf, sizeof(buf), curr->mode);
+				get_perm_string(buf, sizeof(buf), fentry_get_mode(curr));
 #else
 				copy_str(buf, sizeof(buf), attr_str_long(curr->attrs));
 #endif
 				break;
 			case 'u':
+				fentry_ensure_meta(curr, FMETA_OWNER);
 				get_uid_string(curr, 0, sizeof(buf), buf);
 				break;
 			case 'g':
+				fentry_ensure_meta(curr, FMETA_OWNER);
 				get_gid_string(curr, 0, sizeof(buf), buf);
 				break;
 			case 's':
@@ -332,7 +335,8 @@ parse_view_macros(view_t *view, const char **format, const char macros[],
 				break;
 			case 'd':
 				{
-					struct tm *tm_ptr = localtime(&curr->mtime);
+					const time_t mtime = fentry_get_mtime(curr);
+					struct tm *tm_ptr = localtime(&mtime);
 					strftime(buf, sizeof(buf), cfg.time_format, tm_ptr);
 				}
 				break;
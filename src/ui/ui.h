@@ -185,6 +185,24 @@ typedef struct
 }
 history_t;
 
+/* Groups of metadata of directory entries, which might be loaded on demand.
+ * File type is always available and isn't listed here. */
+typedef enum
+{
+	FMETA_SIZE  = 1 << 0, /* Size of the file. */
+	FMETA_OWNER = 1 << 1, /* Owning user and group. */
+	FMETA_MODE  = 1 << 2, /* Mode of the file. */
+	FMETA_MTIME = 1 << 3, /* Modification time. */
+	FMETA_ATIME = 1 << 4, /* Access time. */
+	FMETA_CTIME = 1 << 5, /* Change time. */
+	FMETA_INODE = 1 << 6, /* Inode number. */
+	FMETA_NLINK = 1 << 7, /* Number of hard links. */
+
+	FMETA_NONE = 0,                      /* Only type of the file. */
+	FMETA_ALL  = (FMETA_NLINK << 1) - 1, /* All metadata. */
+}
+FileMeta;
+
 /* Enable forward declaration of dir_entry_t. */
 typedef struct dir_entry_t dir_entry_t;
 /* Description of a single directory entry. */
@@ -223,6 +241,11 @@ struct dir_entry_t
 	int child_pos;   /* Position of this entry in among children of its parent.
 	                    Zero for top-level entries. */
 
+	int meta_idx; /* Index of the entry in background metadata loader of the
+	                 view or -1 when metadata of the entry is complete. */
+	int meta_missing; /* Set of FMETA_* flags of metadata that wasn't loaded
+	                     yet and will be fetched on first use. */
+
 	int search_match;      /* Non-zero if the item matches last search.  Equals to
 	                          search match number (top to bottom order). */
 	short int match_left;  /* Starting position of search match. */
@@ -277,6 +300,9 @@ struct cv_data_t
 	/* Names of files in custom view while it's being composed.  Used for
 	 * duplicate elimination during construction of custom list. */
 	struct trie_t *paths_cache;
+
+	/* Command output that's still being added to the list or NULL. */
+	struct flist_stream_t *stream;
 };
 
 /* Various parameters related to local filter. */
@@ -345,6 +371,9 @@ struct view_t
 	/* Monitor that checks for directory changes. */
 	fswatch_t *watch;
 	char watched_dir[PATH_MAX + 1];
+	/* Number of directories of custom view watched in addition to watched_dir or
+	 * -1 if not all of them could be watched. */
+	int extra_watches;
 
 	char last_dir[PATH_MAX + 1];
 
@@ -396,6 +425,11 @@ struct view_t
 	char *sort_groups, *sort_groups_g;
 	/* Primary group in compiled form. */
 	regex_t primary_group;
+	/* All sorting groups compiled by sorting code, which are compiled again when
+	 * sort_groups_src doesn't match the value being used. */
+	char *sort_groups_src;
+	regex_t *sort_groups_re;
+	int sort_groups_nre;
 
 	int history_num;    /* Number of used history elements. */
 	int history_pos;    /* Current position in history. */
@@ -444,6 +478,9 @@ struct view_t
 	uint64_t last_reload; /* Time of last [full] reload. */
 
 	int on_slow_fs; /* Whether current directory has access penalties. */
+
+	/* Background loader of metadata of entries or NULL. */
+	struct meta_loader_t *meta_loader;
 };
 
 extern view_t lwin;
@@ -0,0 +1,358 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* Layout of the file (all numbers are in native byte order, which is verified
+ * by the header):
+ *
+ *   header  | "vifmdc2\n" | uint32 number of records | uint32 byte order mark
+ *   index   | uint64 offset of each record in order of their paths
+ *   records | dcache_rec_t | uint32 path length | path | '\0'
+ */
+
+#include "dcache_file.h"
+
+#ifndef _WIN32
+#include <sys/mman.h> /* MAP_FAILED MAP_PRIVATE PROT_READ mmap() munmap() */
+#include <sys/stat.h> /* fstat() stat */
+#endif
+
+#include <limits.h> /* INT_MAX */
+#include <stdint.h> /* UINT32_MAX uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fileno() fread() fwrite() remove()
+                      snprintf() */
+#include <stdlib.h> /* free() malloc() qsort() realloc() */
+#include <string.h> /* memcmp() memcpy() strcmp() strlen() */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "fs.h"
+#include "utils.h"
+
+/* Magic sequence at the start of the file, which also defines version of the
+ * format. */
+#define MAGIC "vifmdc2\n"
+/* Value used to detect byte order of the file. */
+#define BYTE_ORDER_MARK 0x01020304U
+
+/* Size of the header in bytes. */
+#define HEADER_SIZE (sizeof(MAGIC) - 1U + 2U*sizeof(uint32_t))
+/* Size of fixed part of a record in bytes. */
+#define REC_SIZE (sizeof(dcache_rec_t) + sizeof(uint32_t))
+
+/* Opened file. */
+struct dcache_file_t
+{
+	const char *data; /* Contents of the file. */
+	size_t size;      /* Size of the data. */
+	int count;        /* Number of records. */
+	int mapped;       /* Whether data is mapped into memory. */
+};
+
+static int load_file(dcache_file_t *file, const char path[]);
+static int entry_cmp(const void *a, const void *b);
+static int write_entries(FILE *fp, const dcache_file_entry_t entries[],
+		size_t count);
+
+dcache_file_t *
+dcache_file_open(const char path[])
+{
+	uint32_t count, bom;
+
+	dcache_file_t *const file = malloc(sizeof(*file));
+	if(file == NULL)
+	{
+		return NULL;
+	}
+
+	if(load_file(file, path) != 0)
+	{
+		free(file);
+		return NULL;
+	}
+
+	if(file->size < HEADER_SIZE ||
+			memcmp(file->data, MAGIC, sizeof(MAGIC) - 1U) != 0)
+	{
+		dcache_file_close(file);
+		return NULL;
+	}
+
+	memcpy(&count, file->data + sizeof(MAGIC) - 1U, sizeof(count));
+	memcpy(&bom, file->data + sizeof(MAGIC) - 1U + sizeof(count), sizeof(bom));
+	if(bom != BYTE_ORDER_MARK || count > INT_MAX ||
+			(file->size - HEADER_SIZE)/sizeof(uint64_t) < count)
+	{
+		dcache_file_close(file);
+		return NULL;
+	}
+
+	file->count = count;
+	return file;
+}
+
+/* Makes contents of the file available in memory.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+load_file(dcache_file_t *file, const char path[])
+{
+	char *data;
+	size_t size;
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+#ifndef _WIN32
+	{
+		struct stat st;
+		if(fstat(fileno(fp), &st) == 0 && st.st_size > 0)
+		{
+			void *const map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE,
+					fileno(fp), 0);
+			if(map != MAP_FAILED)
+			{
+				fclose(fp);
+				file->data = map;
+				file->size = st.st_size;
+				file->mapped = 1;
+				return 0;
+			}
+		}
+	}
+#endif
+
+	/* Fallback to reading the whole file. */
+	data = NULL;
+	size = 0U;
+	while(1)
+	{
+		size_t nread;
+		char *const new_data = realloc(data, size + 64*1024);
+		if(new_data == NULL)
+		{
+			free(data);
+			fclose(fp);
+			return 1;
+		}
+		data = new_data;
+
+		nread = fread(data + size, 1, 64*1024, fp);
+		size += nread;
+		if(nread != 64*1024)
+		{
+			break;
+		}
+	}
+	fclose(fp);
+
+	file->data = data;
+	file->size = size;
+	file->mapped = 0;
+	return 0;
+}
+
+void
+dcache_file_close(dcache_file_t *file)
+{
+	if(file == NULL)
+	{
+		return;
+	}
+
+#ifndef _WIN32
+	if(file->mapped)
+	{
+		(void)munmap((void *)file->data, file->size);
+	}
+	else
+#endif
+	{
+		free((void *)file->data);
+	}
+	free(file);
+}
+
+int
+dcache_file_count(const dcache_file_t *file)
+{
+	return file->count;
+}
+
+int
+dcache_file_find(const dcache_file_t *file, const char path[],
+		dcache_rec_t *rec)
+{
+	int l = 0, u = file->count - 1;
+	while(l <= u)
+	{
+		const int i = l + (u - l)/2;
+		dcache_rec_t i_rec;
+		const char *const i_path = dcache_file_get(file, i, &i_rec);
+		const int cmp = (i_path == NULL) ? 1 : strcmp(i_path, path);
+
+		if(cmp == 0)
+		{
+			*rec = i_rec;
+			return 0;
+		}
+
+		if(cmp < 0)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i - 1;
+		}
+	}
+	return 1;
+}
+
+int
+dcache_file_lower_bound(const dcache_file_t *file, const char path[])
+{
+	int l = 0, u = file->count;
+	while(l < u)
+	{
+		const int i = l + (u - l)/2;
+		dcache_rec_t i_rec;
+		const char *const i_path = dcache_file_get(file, i, &i_rec);
+
+		/* Broken records are skipped as if they were greater. */
+		if(i_path != NULL && strcmp(i_path, path) < 0)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i;
+		}
+	}
+	return l;
+}
+
+const char *
+dcache_file_get(const dcache_file_t *file, int idx, dcache_rec_t *rec)
+{
+	uint64_t offset;
+	uint32_t len;
+
+	memcpy(&offset, file->data + HEADER_SIZE + idx*sizeof(offset),
+			sizeof(offset));
+	if(offset > file->size || file->size - offset < REC_SIZE)
+	{
+		return NULL;
+	}
+
+	memcpy(rec, file->data + offset, sizeof(*rec));
+	memcpy(&len, file->data + offset + sizeof(*rec), sizeof(len));
+	if(file->size - offset - REC_SIZE <= len ||
+			file->data[offset + REC_SIZE + len] != '\0')
+	{
+		return NULL;
+	}
+
+	return file->data + offset + REC_SIZE;
+}
+
+int
+dcache_file_write(const char path[], dcache_file_entry_t entries[],
+		size_t count)
+{
+	FILE *fp;
+	int failed;
+	char tmp_file[PATH_MAX + 16];
+
+	if(count > UINT32_MAX)
+	{
+		return 1;
+	}
+
+	qsort(entries, count, sizeof(*entries), &entry_cmp);
+
+	snprintf(tmp_file, sizeof(tmp_file), "%s_%u", path, get_pid());
+	fp = os_fopen(tmp_file, "wb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	failed = write_entries(fp, entries, count);
+	failed |= (fclose(fp) != 0);
+
+	if(failed || rename_file(tmp_file, path) != 0)
+	{
+		(void)remove(tmp_file);
+		return 1;
+	}
+	return 0;
+}
+
+/* qsort() comparer that orders entries by their paths.  Returns standard -1,
+ * 0, 1 for comparisons. */
+static int
+entry_cmp(const void *a, const void *b)
+{
+	const dcache_file_entry_t *const x = a;
+	const dcache_file_entry_t *const y = b;
+	return strcmp(x->path, y->path);
+}
+
+/* Writes header, index and records to the file.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+write_entries(FILE *fp, const dcache_file_entry_t entries[], size_t count)
+{
+	size_t i;
+	const uint32_t count32 = count;
+	const uint32_t bom = BYTE_ORDER_MARK;
+	uint64_t offset = HEADER_SIZE + count*sizeof(uint64_t);
+
+	if(fwrite(MAGIC, sizeof(MAGIC) - 1U, 1, fp) != 1 ||
+			fwrite(&count32, sizeof(count32), 1, fp) != 1 ||
+			fwrite(&bom, sizeof(bom), 1, fp) != 1)
+	{
+		return 1;
+	}
+
+	for(i = 0U; i < count; ++i)
+	{
+		if(fwrite(&offset, sizeof(offset), 1, fp) != 1)
+		{
+			return 1;
+		}
+		offset += REC_SIZE + strlen(entries[i].path) + 1U;
+	}
+
+	for(i = 0U; i < count; ++i)
+	{
+		const uint32_t len = strlen(entries[i].path);
+		if(fwrite(&entries[i].rec, sizeof(entries[i].rec), 1, fp) != 1 ||
+				fwrite(&len, sizeof(len), 1, fp) != 1 ||
+				fwrite(entries[i].path, len + 1U, 1, fp) != 1)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
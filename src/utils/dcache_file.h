@@ -0,0 +1,86 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__DCACHE_FILE_H__
+#define VIFM__UTILS__DCACHE_FILE_H__
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+/* Compact binary file that stores sizes of directories keyed by their paths.
+ * Records are sorted by path and are looked up directly in the file, which is
+ * mapped into memory when possible, so opening the file is cheap regardless of
+ * its size. */
+
+/* Data of a single directory. */
+typedef struct
+{
+	uint64_t size;      /* Size of the directory. */
+	uint64_t timestamp; /* When the size was calculated. */
+	uint64_t mtime;     /* Modification time of the directory at that moment. */
+	uint64_t inode;     /* Inode number of the directory. */
+	uint64_t links;     /* Whether size includes files with several hard links. */
+}
+dcache_rec_t;
+
+/* Element of input for dcache_file_write(). */
+typedef struct
+{
+	char *path;       /* Path to the directory. */
+	dcache_rec_t rec; /* Its data. */
+}
+dcache_file_entry_t;
+
+/* Declaration of opaque type of opened file. */
+typedef struct dcache_file_t dcache_file_t;
+
+/* Opens file at the path for reading.  Returns NULL if the file doesn't exist,
+ * can't be read or has unexpected format. */
+dcache_file_t * dcache_file_open(const char path[]);
+
+/* Closes the file.  file can be NULL. */
+void dcache_file_close(dcache_file_t *file);
+
+/* Retrieves number of records in the file.  Returns the number. */
+int dcache_file_count(const dcache_file_t *file);
+
+/* Looks up record of the path.  Returns zero and fills *rec if found,
+ * otherwise non-zero is returned. */
+int dcache_file_find(const dcache_file_t *file, const char path[],
+		dcache_rec_t *rec);
+
+/* Finds position of the first record whose path isn't less than the path,
+ * which is where records of paths that start with the path begin.  Returns
+ * index in range [0; dcache_file_count()]. */
+int dcache_file_lower_bound(const dcache_file_t *file, const char path[]);
+
+/* Retrieves record by its index in range [0; dcache_file_count()).  Returns
+ * path of the record, which is valid while the file is open, and fills *rec, or
+ * returns NULL if the record is broken. */
+const char * dcache_file_get(const dcache_file_t *file, int idx,
+		dcache_rec_t *rec);
+
+/* Writes count entries to a file at the path replacing it.  Reorders entries.
+ * Returns zero on success, otherwise non-zero is returned. */
+int dcache_file_write(const char path[], dcache_file_entry_t entries[],
+		size_t count);
+
+#endif /* VIFM__UTILS__DCACHE_FILE_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
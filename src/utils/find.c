@@ -0,0 +1,175 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "find.h"
+
+#include <sys/stat.h> /* S_ISDIR() stat */
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* free() reallocarray() */
+#include <string.h> /* strcmp() strdup() */
+
+#include "../compat/reallocarray.h"
+#include "walker.h"
+
+/* File that was found. */
+typedef struct
+{
+	char *path;     /* Full path to the file. */
+	struct stat st; /* Information about the file. */
+}
+find_item_t;
+
+/* Files found in a single directory. */
+typedef struct
+{
+	find_item_t *items; /* List of files. */
+	int nitems;         /* Number of elements in the items. */
+}
+find_batch_t;
+
+static void find_visit(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *arg);
+static int find_entry(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *ctx);
+static void examine(const find_params_t *params, find_batch_t *batch,
+		const char path[], const struct stat *st);
+static void report_batch(walker_t *w, const find_params_t *params,
+		find_batch_t *batch);
+
+int
+find_files(char *const targets[], int ntargets, const find_params_t *params)
+{
+	const walker_params_t walker_params = {
+		.nthreads = params->nthreads,
+		.dir = params->dir,
+		.visit = &find_visit,
+		.on_error = params->on_error,
+		.cancellation = params->cancellation,
+		.arg = (void *)params,
+	};
+
+	return walker_run(targets, ntargets, &walker_params);
+}
+
+/* Matches file targets and examines entries of directories. */
+static void
+find_visit(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *arg)
+{
+	const find_params_t *const params = arg;
+	find_batch_t batch = { .items = NULL, .nitems = 0 };
+
+	if(!S_ISDIR(st->st_mode))
+	{
+		examine(params, &batch, full_path, st);
+		report_batch(w, params, &batch);
+		return;
+	}
+
+	/* Don't prepend "./" to paths to keep them clean for matchers. */
+	if(strcmp(path, ".") == 0)
+	{
+		path = "";
+	}
+	if(strcmp(full_path, ".") == 0)
+	{
+		full_path = "";
+	}
+
+	(void)walker_list(w, path, full_path, &find_entry, &batch);
+	report_batch(w, params, &batch);
+}
+
+/* Examines entry of a directory scheduling subdirectories for visiting except
+ * for symbolic links and whatever is rejected by the filter.  Returns non-zero
+ * to stop listing, otherwise zero is returned. */
+static int
+find_entry(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *ctx)
+{
+	find_batch_t *const batch = ctx;
+	const find_params_t *const params = walker_get_arg(w);
+	const int is_dir = S_ISDIR(st->st_mode);
+
+	if(params->filter != NULL &&
+			!params->filter(full_path, is_dir, params->arg))
+	{
+		return 0;
+	}
+
+	examine(params, batch, full_path, st);
+
+	return (is_dir && walker_schedule(w, path, full_path, st) != 0);
+}
+
+/* Matches the file and remembers it in the batch on success. */
+static void
+examine(const find_params_t *params, find_batch_t *batch, const char path[],
+		const struct stat *st)
+{
+	find_item_t *items;
+
+	if(!params->match(path, st, params->arg))
+	{
+		return;
+	}
+
+	items = reallocarray(batch->items, batch->nitems + 1, sizeof(*items));
+	if(items == NULL)
+	{
+		return;
+	}
+	batch->items = items;
+
+	items[batch->nitems].path = strdup(path);
+	if(items[batch->nitems].path != NULL)
+	{
+		items[batch->nitems].st = *st;
+		++batch->nitems;
+	}
+}
+
+/* Passes files of the batch to the output callback and frees the batch. */
+static void
+report_batch(walker_t *w, const find_params_t *params, find_batch_t *batch)
+{
+	int i;
+
+	if(batch->nitems != 0)
+	{
+		walker_lock_output(w);
+		for(i = 0; i < batch->nitems; ++i)
+		{
+			params->on_found(batch->items[i].path, &batch->items[i].st,
+					params->arg);
+		}
+		walker_unlock_output(w);
+	}
+
+	for(i = 0; i < batch->nitems; ++i)
+	{
+		free(batch->items[i].path);
+	}
+	free(batch->items);
+	batch->items = NULL;
+	batch->nitems = 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,75 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__FIND_H__
+#define VIFM__UTILS__FIND_H__
+
+/* Search for files that doesn't involve external tools.  Directories are
+ * listed by several threads at once and each file is examined by the thread
+ * that listed it using information that was obtained while listing. */
+
+struct cancellation_t;
+struct stat;
+
+/* Decides whether file or directory met in a directory should be examined
+ * (directories are entered only if this returns non-zero).  Can be called from
+ * several threads at the same time.  Returns non-zero if so, otherwise zero is
+ * returned. */
+typedef int (*find_filter_func)(const char path[], int is_dir, void *arg);
+
+/* Checks whether file is what is being looked for.  Can be called from several
+ * threads at the same time.  Returns non-zero if so, otherwise zero is
+ * returned. */
+typedef int (*find_match_func)(const char path[], const struct stat *st,
+		void *arg);
+
+/* Receives full path to a found file along with its lstat() information. */
+typedef void (*find_found_func)(const char path[], const struct stat *st,
+		void *arg);
+
+/* Receives a newly allocated error message, which should be freed by the
+ * callee. */
+typedef void (*find_error_func)(char msg[], void *arg);
+
+/* Parameters of a search. */
+typedef struct
+{
+	int nthreads;    /* Number of threads to use. */
+	const char *dir; /* Base for relative targets or NULL. */
+
+	find_filter_func filter;   /* Prunes the walk, can be NULL. */
+	find_match_func match;     /* Picks files to report. */
+	find_found_func on_found;  /* Receives found files. */
+	find_error_func on_error;  /* Receives error messages, can be NULL. */
+	const struct cancellation_t *cancellation; /* Cancellation state. */
+	void *arg;                                 /* Argument of callbacks. */
+}
+find_params_t;
+
+/* Looks for files among targets.  Targets that are directories are walked
+ * recursively without following symbolic links in them, other targets are
+ * matched themselves.  Files found in a directory are reported together.
+ * Output callbacks are called from several threads, but never at the same
+ * time.  Returns zero on success, otherwise non-zero is returned. */
+int find_files(char *const targets[], int ntargets,
+		const find_params_t *params);
+
+#endif /* VIFM__UTILS__FIND_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -30,11 +30,13 @@
 #endif
 
 #include <sys/stat.h> /* S_* statbuf */
-#include <sys/types.h> /* size_t mode_t */
-#include <unistd.h> /* pathconf() readlink() */
+#include <sys/types.h> /* off_t size_t mode_t */
+#include <fcntl.h> /* O_RDONLY open() */
+#include <unistd.h> /* SEEK_DATA SEEK_HOLE close() lseek() pathconf()
+                       readlink() */
 
 #include <ctype.h> /* isalpha() */
-#include <errno.h> /* errno */
+#include <errno.h> /* ENXIO errno */
 #include <stddef.h> /* NULL */
 #include <stdio.h> /* snprintf() remove() */
 #include <stdlib.h> /* free() qsort() */
@@ -45,6 +47,7 @@
 #include "../compat/os.h"
 #include "../io/iop.h"
 #include "log.h"
+#include "macros.h"
 #include "path.h"
 #include "str.h"
 #include "string_array.h"
@@ -512,6 +515,59 @@ get_file_size(const char path[])
 #endif
 }
 
+uint64_t
+get_file_data_size(const char path[])
+{
+#if !defined(_WIN32) && defined(SEEK_DATA)
+	struct stat st;
+	return (os_lstat(path, &st) == 0) ? get_data_size(path, &st) : 0U;
+#else
+	return get_file_size(path);
+#endif
+}
+
+uint64_t
+get_data_size(const char path[], const struct stat *st)
+{
+#if !defined(_WIN32) && defined(SEEK_DATA)
+	uint64_t size = 0U;
+	off_t data = 0;
+	int complete;
+	int fd;
+
+	/* Files without holes don't need to be examined. */
+	if(!S_ISREG(st->st_mode) ||
+			(uint64_t)st->st_blocks*512U >= (uint64_t)st->st_size)
+	{
+		return (uint64_t)st->st_size;
+	}
+
+	fd = open(path, O_RDONLY);
+	if(fd == -1)
+	{
+		return (uint64_t)st->st_size;
+	}
+
+	while((data = lseek(fd, data, SEEK_DATA)) >= 0)
+	{
+		const off_t hole = lseek(fd, data, SEEK_HOLE);
+		if(hole < 0)
+		{
+			break;
+		}
+		size += hole - data;
+		data = hole;
+	}
+	/* Only reaching end of the file means that all data was found. */
+	complete = (data < 0 && errno == ENXIO);
+	close(fd);
+
+	return complete ? MIN(size, (uint64_t)st->st_size) : (uint64_t)st->st_size;
+#else
+	return (uint64_t)st->st_size;
+#endif
+}
+
 char **
 list_regular_files(const char path[], char *list[], int *len)
 {
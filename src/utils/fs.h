@@ -118,6 +118,17 @@ int is_dir_writable(const char path[]);
  * empty files and on error. */
 uint64_t get_file_size(const char path[]);
 
+/* Gets size of data in the file not counting holes of sparse files, which is
+ * the same as file size on systems that can't find holes.  Returns zero for
+ * both empty files and on error. */
+uint64_t get_file_data_size(const char path[]);
+
+struct stat;
+
+/* Same as get_file_data_size(), but uses lstat() information about the file
+ * obtained by the caller. */
+uint64_t get_data_size(const char path[], const struct stat *st);
+
 /* Appends all regular files inside the path directory.  Reallocates array of
  * strings if necessary to fit all elements.  Returns pointer to reallocated
  * array or source list (on error). */
@@ -24,6 +24,22 @@
 /* Opaque type of a watcher. */
 typedef struct fswatch_t fswatch_t;
 
+/* Kinds of changes reported by fswatch_poll(). */
+typedef enum
+{
+	FSWC_ADDED,   /* File was created or moved into the directory. */
+	FSWC_REMOVED, /* File was deleted or moved out of the directory. */
+	FSWC_UPDATED, /* Contents or attributes of the file have changed. */
+	FSWC_RESCAN,  /* Changes weren't tracked, everything should be re-read. */
+}
+FSWatchChange;
+
+/* Callback invoked by fswatch_poll() for every change.  dir is a path to one of
+ * watched directories as it was passed to the watcher and name is a name of a
+ * file inside of it, both are NULL for FSWC_RESCAN. */
+typedef void (*fswatch_change_cb)(FSWatchChange change, const char dir[],
+		const char name[], void *arg);
+
 /* Creates new watcher for the specified path.  Returns the watcher or NULL on
  * error. */
 fswatch_t * fswatch_create(const char path[]);
@@ -31,11 +47,28 @@ fswatch_t * fswatch_create(const char path[]);
 /* Frees a watcher.  w can be NULL. */
 void fswatch_free(fswatch_t *w);
 
+/* Adds one more directory to be watched by the watcher.  Changes of the
+ * directory itself are then reported only by the watch of its parent, if
+ * any.  Not all implementations support this.  Returns zero on success,
+ * otherwise non-zero is returned. */
+int fswatch_add(fswatch_t *w, const char path[]);
+
+/* Retrieves number of directories watched by the watcher including the one it
+ * was created for.  Watches of directories that were removed go away on
+ * polling.  Returns the number. */
+int fswatch_count(const fswatch_t *w);
+
 /* Checks whether any changes were made to the entity being watched since last
  * query.  Sets *error to indicate whether any issues occurred.  Returns
  * non-zero if so, otherwise zero is returned. */
 int fswatch_changed(fswatch_t *w, int *error);
 
+/* Same as fswatch_changed(), but also reports what has changed by invoking the
+ * callback in order in which changes happened.  Implementations that can't
+ * track individual files report FSWC_RESCAN instead.  Returns non-zero if
+ * there were changes, otherwise zero is returned. */
+int fswatch_poll(fswatch_t *w, int *error, fswatch_change_cb cb, void *arg);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -28,15 +28,26 @@
 #include <errno.h> /* EAGAIN errno */
 #include <stddef.h> /* NULL */
 #include <stdint.h> /* uint32_t */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
+#include <string.h> /* memmove() strdup() */
 #include <time.h> /* time_t time() */
 
 #include "../compat/fs_limits.h"
+#include "../compat/reallocarray.h"
 #include "trie.h"
 
 /* TODO: consider implementation that could reuse already available descriptor
  *       by just removing old watch and then adding a new one. */
 
+/* Directory watched by inotify. */
+typedef struct
+{
+	int wd;     /* Watch descriptor. */
+	char *path; /* Path to the directory. */
+}
+watched_dir_t;
+
 /* Watcher data. */
 struct fswatch_t
 {
@@ -44,6 +55,12 @@ struct fswatch_t
 	int fd;
 	/* Trie to keep track of per file frequency of notifications. */
 	trie_t *stats;
+	/* Watched directories sorted by their watch descriptors. */
+	watched_dir_t *dirs;
+	/* Number of elements in dirs array. */
+	int ndirs;
+	/* Watch descriptor of the directory watcher was created for. */
+	int root_wd;
 };
 
 /* Per file statistics information. */
@@ -57,20 +74,27 @@ typedef struct
 }
 notif_stat_t;
 
+static int process_event(fswatch_t *w, const struct inotify_event *e,
+		time_t now, fswatch_change_cb cb, void *arg);
+static int find_dir(const fswatch_t *w, int wd, int *pos);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
 		time_t now);
+static void report_change(const char dir[], const struct inotify_event *e,
+		fswatch_change_cb cb, void *arg);
 
 fswatch_t *
 fswatch_create(const char path[])
 {
-	int wd;
-
 	fswatch_t *const w = malloc(sizeof(*w));
 	if(w == NULL)
 	{
 		return NULL;
 	}
 
+	w->dirs = NULL;
+	w->ndirs = 0;
+	w->root_wd = -1;
+
 	/* Create tree to collect update frequency statistics. */
 	w->stats = trie_create();
 	if(w->stats == NULL)
@@ -90,16 +114,12 @@ fswatch_create(const char path[])
 	}
 
 	/* Add directory to watch. */
-	wd = inotify_add_watch(w->fd, path, IN_ATTRIB | IN_MODIFY | IN_CREATE |
-			IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_EXCL_UNLINK |
-			IN_CLOSE_WRITE);
-	if(wd == -1)
+	if(fswatch_add(w, path) != 0)
 	{
-		close(w->fd);
-		trie_free_with_data(w->stats, &free);
-		free(w);
+		fswatch_free(w);
 		return NULL;
 	}
+	w->root_wd = w->dirs[0].wd;
 
 	return w;
 }
@@ -109,14 +129,77 @@ fswatch_free(fswatch_t *w)
 {
 	if(w != NULL)
 	{
+		int i;
+		for(i = 0; i < w->ndirs; ++i)
+		{
+			free(w->dirs[i].path);
+		}
+		free(w->dirs);
+
 		trie_free_with_data(w->stats, &free);
 		close(w->fd);
 		free(w);
 	}
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	watched_dir_t *dirs;
+	char *path_copy;
+	int pos;
+
+	const int wd = inotify_add_watch(w->fd, path, IN_ATTRIB | IN_MODIFY |
+			IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_EXCL_UNLINK |
+			IN_CLOSE_WRITE);
+	if(wd == -1)
+	{
+		return 1;
+	}
+
+	/* Same directory reachable by different paths gets the same descriptor. */
+	if(find_dir(w, wd, &pos) >= 0)
+	{
+		return 0;
+	}
+
+	dirs = reallocarray(w->dirs, w->ndirs + 1, sizeof(*dirs));
+	if(dirs == NULL)
+	{
+		(void)inotify_rm_watch(w->fd, wd);
+		return 1;
+	}
+	w->dirs = dirs;
+
+	path_copy = strdup(path);
+	if(path_copy == NULL)
+	{
+		(void)inotify_rm_watch(w->fd, wd);
+		return 1;
+	}
+
+	memmove(&dirs[pos + 1], &dirs[pos], sizeof(*dirs)*(w->ndirs - pos));
+	dirs[pos].path = path_copy;
+	dirs[pos].wd = wd;
+	++w->ndirs;
+
+	return 0;
+}
+
+int
+fswatch_count(const fswatch_t *w)
+{
+	return w->ndirs;
+}
+
 int
 fswatch_changed(fswatch_t *w, int *error)
+{
+	return fswatch_poll(w, error, NULL, NULL);
+}
+
+int
+fswatch_poll(fswatch_t *w, int *error, fswatch_change_cb cb, void *arg)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
@@ -150,7 +233,7 @@ fswatch_changed(fswatch_t *w, int *error)
 		for(p = buf; p < buf + nread; p += sizeof(struct inotify_event) + e->len)
 		{
 			e = (struct inotify_event *)p;
-			if(update_file_stats(w, e, now))
+			if(process_event(w, e, now, cb, arg))
 			{
 				changed = 1;
 			}
@@ -168,6 +251,87 @@ fswatch_changed(fswatch_t *w, int *error)
 	return changed;
 }
 
+/* Filters the event and reports it to the callback if it's not NULL.  Returns
+ * non-zero if this is an interesting event, otherwise zero is returned. */
+static int
+process_event(fswatch_t *w, const struct inotify_event *e, time_t now,
+		fswatch_change_cb cb, void *arg)
+{
+	const int idx = find_dir(w, e->wd, NULL);
+
+	if(idx < 0 && !(e->mask & IN_Q_OVERFLOW))
+	{
+		/* Event for a watch that was already removed. */
+		return 0;
+	}
+
+	if(idx >= 0 && e->wd != w->root_wd)
+	{
+		/* Watch of a removed subdirectory goes away, parent reports removal. */
+		if(e->mask & IN_IGNORED)
+		{
+			free(w->dirs[idx].path);
+			memmove(&w->dirs[idx], &w->dirs[idx + 1],
+					sizeof(*w->dirs)*(w->ndirs - (idx + 1)));
+			--w->ndirs;
+			return 0;
+		}
+
+		/* Changes of subdirectories themselves are reported by their parents. */
+		if(e->len == 0U)
+		{
+			return 0;
+		}
+	}
+
+	if(!update_file_stats(w, e, now))
+	{
+		return 0;
+	}
+
+	if(cb != NULL)
+	{
+		report_change(idx < 0 ? NULL : w->dirs[idx].path, e, cb, arg);
+	}
+	return 1;
+}
+
+/* Looks up watched directory by its watch descriptor.  If pos isn't NULL, it's
+ * set to where the directory is or should be inserted.  Returns index of the
+ * directory or -1 if it's not found. */
+static int
+find_dir(const fswatch_t *w, int wd, int *pos)
+{
+	int l = 0, u = w->ndirs - 1;
+	while(l <= u)
+	{
+		const int i = l + (u - l)/2;
+		if(w->dirs[i].wd == wd)
+		{
+			if(pos != NULL)
+			{
+				*pos = i;
+			}
+			return i;
+		}
+
+		if(w->dirs[i].wd < wd)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i - 1;
+		}
+	}
+
+	if(pos != NULL)
+	{
+		*pos = l;
+	}
+	return -1;
+}
+
 /* Updates information about a file event is about.  Returns non-zero if this is
  * an interesting event that's worth attention (e.g. re-reading information from
  * file system), otherwise zero is returned. */
@@ -179,10 +343,14 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	const uint32_t IMPORTANT_EVENTS = IN_CREATE | IN_DELETE | IN_MOVED_FROM
 	                                | IN_MOVED_TO | IN_Q_OVERFLOW;
 
-	const char *const fname = (e->len == 0U) ? "." : e->name;
+	char fname[32 + NAME_MAX + 1];
 	void *data;
 	notif_stat_t *stats;
 
+	/* Same names can come from different directories. */
+	snprintf(fname, sizeof(fname), "%d/%s", e->wd,
+			(e->len == 0U) ? "." : e->name);
+
 	/* See if we already know this file and retrieve associated information if
 	 * so. */
 	if(trie_get(w->stats, fname, &data) != 0)
@@ -234,6 +402,32 @@ update_file_stats(fswatch_t *w, const struct inotify_event *e, time_t now)
 	return 1;
 }
 
+/* Translates inotify event about a file in the dir into a change of the file
+ * and passes it to the callback. */
+static void
+report_change(const char dir[], const struct inotify_event *e,
+		fswatch_change_cb cb, void *arg)
+{
+	/* Events about the directory itself and lost events can't be mapped onto
+	 * specific files. */
+	if((e->mask & IN_Q_OVERFLOW) || e->len == 0U)
+	{
+		cb(FSWC_RESCAN, NULL, NULL, arg);
+	}
+	else if(e->mask & (IN_CREATE | IN_MOVED_TO))
+	{
+		cb(FSWC_ADDED, dir, e->name, arg);
+	}
+	else if(e->mask & (IN_DELETE | IN_MOVED_FROM))
+	{
+		cb(FSWC_REMOVED, dir, e->name, arg);
+	}
+	else
+	{
+		cb(FSWC_UPDATED, dir, e->name, arg);
+	}
+}
+
 #else
 
 #include "filemon.h"
@@ -282,8 +476,27 @@ fswatch_free(fswatch_t *w)
 	}
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	/* Only one file can be monitored. */
+	return 1;
+}
+
+int
+fswatch_count(const fswatch_t *w)
+{
+	return 1;
+}
+
 int
 fswatch_changed(fswatch_t *w, int *error)
+{
+	return fswatch_poll(w, error, NULL, NULL);
+}
+
+int
+fswatch_poll(fswatch_t *w, int *error, fswatch_change_cb cb, void *arg)
 {
 	int changed;
 
@@ -299,6 +512,11 @@ fswatch_changed(fswatch_t *w, int *error)
 
 	filemon_assign(&w->filemon, &filemon);
 
+	if(changed && cb != NULL)
+	{
+		cb(FSWC_RESCAN, NULL, NULL, arg);
+	}
+
 	return changed;
 }
 
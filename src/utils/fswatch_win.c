@@ -86,8 +86,27 @@ fswatch_free(fswatch_t *w)
 	}
 }
 
+int
+fswatch_add(fswatch_t *w, const char path[])
+{
+	/* Changes are tracked for the whole directory only. */
+	return 1;
+}
+
+int
+fswatch_count(const fswatch_t *w)
+{
+	return 1;
+}
+
 int
 fswatch_changed(fswatch_t *w, int *error)
+{
+	return fswatch_poll(w, error, NULL, NULL);
+}
+
+int
+fswatch_poll(fswatch_t *w, int *error, fswatch_change_cb cb, void *arg)
 {
 	FILETIME ft;
 	int changed;
@@ -109,6 +128,11 @@ fswatch_changed(fswatch_t *w, int *error)
 
 	*error = 0;
 
+	if(changed && cb != NULL)
+	{
+		cb(FSWC_RESCAN, NULL, NULL, arg);
+	}
+
 	return changed;
 }
 
@@ -0,0 +1,452 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "grep.h"
+
+#include <sys/stat.h> /* S_ISDIR() S_ISREG() stat */
+#include <regex.h> /* regex_t regcomp() regexec() regfree() */
+
+#include <errno.h> /* errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* FILE _IONBF fclose() ferror() fread() setvbuf() */
+#include <stdlib.h> /* free() malloc() realloc() */
+#include <string.h> /* memchr() memmove() strchr() strdup() strerror() strpbrk()
+                       strstr() */
+
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "regexp.h"
+#include "str.h"
+#include "string_array.h"
+#include "walker.h"
+
+/* Size of blocks in which files are read. */
+#define GREP_BLOCK_SIZE (256*1024)
+
+/* Buffer that is reused for reading files. */
+typedef struct grep_buf_t grep_buf_t;
+struct grep_buf_t
+{
+	char *data;       /* Contents of a file with space for a terminating null. */
+	size_t size;      /* Number of bytes that can be read into the data. */
+	grep_buf_t *next; /* Next buffer in the list of unused ones. */
+};
+
+/* State of grep_files() that is shared among its threads. */
+typedef struct
+{
+	const grep_params_t *params; /* Parameters of the search. */
+	regex_t re;                  /* Compiled pattern. */
+	const char *literal;         /* The pattern if it's a plain string. */
+
+	pthread_mutex_t bufs_lock; /* Protects the list of buffers. */
+	grep_buf_t *bufs;          /* Buffers that aren't in use at the moment. */
+}
+grep_job_t;
+
+/* Matches found in a single file. */
+typedef struct
+{
+	const char *path; /* Path to the file as it's reported. */
+	char **lines;     /* Formatted matches. */
+	int nlines;       /* Number of elements in the lines. */
+}
+grep_matches_t;
+
+static void grep_visit(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *arg);
+static int grep_entry(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *ctx);
+static void grep_file(walker_t *w, grep_job_t *job, const char path[],
+		const char full_path[], grep_buf_t *buf);
+static char * find_last_newline(char data[], size_t len);
+static void grep_lines(grep_job_t *job, grep_matches_t *matches, char start[],
+		char end[], int *line_num);
+static void grep_literal(grep_job_t *job, grep_matches_t *matches,
+		char start[], char end[], int *line_num);
+static int line_matches(grep_job_t *job, const char line[]);
+static int count_newlines(const char start[], const char end[]);
+static void add_match(grep_matches_t *matches, int line_num, const char line[]);
+static grep_buf_t * take_buf(grep_job_t *job);
+static void put_buf(grep_job_t *job, grep_buf_t *buf);
+
+int
+grep_files(char *const targets[], int ntargets, const grep_params_t *params)
+{
+	int err;
+	grep_job_t job = { .params = params };
+	const walker_params_t walker_params = {
+		.nthreads = params->nthreads,
+		.dir = params->dir,
+		.visit = &grep_visit,
+		.on_error = params->on_error,
+		.cancellation = params->cancellation,
+		.arg = &job,
+	};
+
+	err = regcomp(&job.re, params->pattern, params->cflags | REG_EXTENDED);
+	if(err != 0)
+	{
+		if(params->on_error != NULL)
+		{
+			params->on_error(strdup(get_regexp_error(err, &job.re)), params->arg);
+		}
+		regfree(&job.re);
+		return 1;
+	}
+
+	/* Plain strings are looked up in whole blocks rather than line by line. */
+	if(!(params->cflags & REG_ICASE) && params->pattern[0] != '\0' &&
+			strpbrk(params->pattern, ".[]()*+?{}|^$\\") == NULL)
+	{
+		job.literal = params->pattern;
+	}
+
+	if(pthread_mutex_init(&job.bufs_lock, NULL) != 0)
+	{
+		regfree(&job.re);
+		return 1;
+	}
+
+	err = walker_run(targets, ntargets, &walker_params);
+
+	while(job.bufs != NULL)
+	{
+		grep_buf_t *const buf = job.bufs;
+		job.bufs = buf->next;
+		free(buf->data);
+		free(buf);
+	}
+
+	pthread_mutex_destroy(&job.bufs_lock);
+	regfree(&job.re);
+	return err;
+}
+
+/* Searches file or schedules entries of directory for searching. */
+static void
+grep_visit(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *arg)
+{
+	grep_job_t *const job = arg;
+	grep_buf_t *buf;
+
+	if(S_ISDIR(st->st_mode))
+	{
+		(void)walker_list(w, path, full_path, &grep_entry, job);
+		return;
+	}
+
+	buf = take_buf(job);
+	if(buf != NULL)
+	{
+		grep_file(w, job, path, full_path, buf);
+		put_buf(job, buf);
+	}
+}
+
+/* Schedules regular files and subdirectories of a directory for searching
+ * skipping symbolic links and whatever is rejected by the filter.  Returns
+ * non-zero to stop listing, otherwise zero is returned. */
+static int
+grep_entry(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, void *ctx)
+{
+	grep_job_t *const job = ctx;
+	const grep_params_t *const params = job->params;
+	const int is_dir = S_ISDIR(st->st_mode);
+
+	if(!is_dir && !S_ISREG(st->st_mode))
+	{
+		return 0;
+	}
+
+	if(params->filter != NULL &&
+			!params->filter(full_path, is_dir, params->arg))
+	{
+		return 0;
+	}
+
+	return (walker_schedule(w, path, full_path, st) != 0);
+}
+
+/* Searches single file reading it in large blocks.  Matches are reported after
+ * the whole file is processed and only if it didn't turn out to be binary. */
+static void
+grep_file(walker_t *w, grep_job_t *job, const char path[],
+		const char full_path[], grep_buf_t *buf)
+{
+	grep_matches_t matches = { .path = path, .lines = NULL, .nlines = 0 };
+	int line_num = 1;
+	size_t len = 0U;
+	int skip = 0;
+	FILE *fp;
+	int i;
+
+	fp = os_fopen(full_path, "rb");
+	if(fp == NULL)
+	{
+		walker_report_error(w, path, errno);
+		return;
+	}
+
+	/* Data is read in blocks large enough for stdio buffer to be of no use. */
+	(void)setvbuf(fp, NULL, _IONBF, 0U);
+
+	while(!skip)
+	{
+		size_t nread;
+		char *end;
+
+		/* Make room for a line that doesn't fit into the buffer. */
+		if(len == buf->size)
+		{
+			const size_t new_size = (buf->size == 0U)
+			                      ? GREP_BLOCK_SIZE
+			                      : buf->size*2U;
+			char *const data = realloc(buf->data, new_size + 1U);
+			if(data == NULL)
+			{
+				skip = 1;
+				break;
+			}
+			buf->data = data;
+			buf->size = new_size;
+		}
+
+		nread = fread(buf->data + len, 1U, buf->size - len, fp);
+		if(nread == 0U && ferror(fp))
+		{
+			walker_report_error(w, path, errno);
+			skip = 1;
+			break;
+		}
+
+		if(memchr(buf->data + len, '\0', nread) != NULL ||
+				walker_cancelled(w))
+		{
+			skip = 1;
+			break;
+		}
+
+		len += nread;
+
+		/* Only complete lines are processed until the end of file. */
+		end = (nread == 0U) ? buf->data + len : find_last_newline(buf->data, len);
+		if(end != NULL)
+		{
+			grep_lines(job, &matches, buf->data, end, &line_num);
+			len -= end - buf->data;
+			memmove(buf->data, end, len);
+		}
+
+		if(nread == 0U)
+		{
+			break;
+		}
+	}
+
+	fclose(fp);
+
+	if(skip)
+	{
+		free_string_array(matches.lines, matches.nlines);
+		return;
+	}
+
+	walker_lock_output(w);
+	for(i = 0; i < matches.nlines; ++i)
+	{
+		job->params->on_match(matches.lines[i], job->params->arg);
+	}
+	walker_unlock_output(w);
+	free(matches.lines);
+}
+
+/* Looks for the last newline character of the data.  Returns pointer past it or
+ * NULL if there is none. */
+static char *
+find_last_newline(char data[], size_t len)
+{
+	while(len != 0U)
+	{
+		if(data[--len] == '\n')
+		{
+			return &data[len + 1U];
+		}
+	}
+	return NULL;
+}
+
+/* Searches complete lines in range [start, end) where *end is writable.
+ * *line_num is the number of the first line and is advanced past the range. */
+static void
+grep_lines(grep_job_t *job, grep_matches_t *matches, char start[], char end[],
+		int *line_num)
+{
+	const char saved = *end;
+	*end = '\0';
+
+	if(job->literal != NULL && !job->params->invert)
+	{
+		grep_literal(job, matches, start, end, line_num);
+	}
+	else
+	{
+		while(start < end)
+		{
+			char *eol = memchr(start, '\n', end - start);
+			if(eol == NULL)
+			{
+				eol = end;
+			}
+
+			*eol = '\0';
+			if(line_matches(job, start) != job->params->invert)
+			{
+				add_match(matches, *line_num, start);
+			}
+			*eol = (eol == end) ? '\0' : '\n';
+
+			start = eol + 1;
+			++*line_num;
+		}
+	}
+
+	*end = saved;
+}
+
+/* Looks up plain string in null-terminated range [start, end) without splitting
+ * it into lines first.  *line_num is updated as in grep_lines(). */
+static void
+grep_literal(grep_job_t *job, grep_matches_t *matches, char start[],
+		char end[], int *line_num)
+{
+	char *found;
+	while((found = strstr(start, job->literal)) != NULL)
+	{
+		char *bol = found;
+		char *eol;
+
+		while(bol != start && bol[-1] != '\n')
+		{
+			--bol;
+		}
+		*line_num += count_newlines(start, bol);
+
+		eol = strchr(found, '\n');
+		if(eol == NULL)
+		{
+			add_match(matches, *line_num, bol);
+			++*line_num;
+			return;
+		}
+
+		*eol = '\0';
+		add_match(matches, *line_num, bol);
+		*eol = '\n';
+
+		start = eol + 1;
+		++*line_num;
+	}
+
+	*line_num += count_newlines(start, end);
+}
+
+/* Checks whether null-terminated line matches the pattern.  Returns non-zero if
+ * so, otherwise zero is returned. */
+static int
+line_matches(grep_job_t *job, const char line[])
+{
+	if(job->literal != NULL)
+	{
+		return (strstr(line, job->literal) != NULL);
+	}
+	return (regexec(&job->re, line, 0, NULL, 0) == 0);
+}
+
+/* Counts newline characters in range [start, end).  Returns the count. */
+static int
+count_newlines(const char start[], const char end[])
+{
+	int count = 0;
+	while((start = memchr(start, '\n', end - start)) != NULL)
+	{
+		++start;
+		++count;
+	}
+	return count;
+}
+
+/* Formats and remembers matched line. */
+static void
+add_match(grep_matches_t *matches, int line_num, const char line[])
+{
+	char *const match = format_str("%s:%d:%s", matches->path, line_num, line);
+	if(match == NULL)
+	{
+		return;
+	}
+
+	matches->nlines = put_into_string_array(&matches->lines, matches->nlines,
+			match);
+	if(matches->nlines == 0 || matches->lines[matches->nlines - 1] != match)
+	{
+		free(match);
+	}
+}
+
+/* Picks an unused buffer or makes a new one.  Returns the buffer or NULL on
+ * error. */
+static grep_buf_t *
+take_buf(grep_job_t *job)
+{
+	grep_buf_t *buf;
+
+	pthread_mutex_lock(&job->bufs_lock);
+	buf = job->bufs;
+	if(buf != NULL)
+	{
+		job->bufs = buf->next;
+	}
+	pthread_mutex_unlock(&job->bufs_lock);
+
+	if(buf == NULL)
+	{
+		buf = malloc(sizeof(*buf));
+		if(buf != NULL)
+		{
+			buf->data = NULL;
+			buf->size = 0U;
+		}
+	}
+	return buf;
+}
+
+/* Returns buffer to the list of unused ones. */
+static void
+put_buf(grep_job_t *job, grep_buf_t *buf)
+{
+	pthread_mutex_lock(&job->bufs_lock);
+	buf->next = job->bufs;
+	job->bufs = buf;
+	pthread_mutex_unlock(&job->bufs_lock);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
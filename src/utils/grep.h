@@ -0,0 +1,67 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__GREP_H__
+#define VIFM__UTILS__GREP_H__
+
+/* Search for lines in files that doesn't involve external tools.  Files are
+ * read in large blocks by several threads at once.  Patterns without special
+ * characters are looked up as plain strings in whole blocks, others are matched
+ * line by line. */
+
+struct cancellation_t;
+
+/* Decides whether file or directory met in a directory should be searched.
+ * Returns non-zero if so, otherwise zero is returned. */
+typedef int (*grep_filter_func)(const char path[], int is_dir, void *arg);
+
+/* Receives a newly allocated line of output, which should be freed by the
+ * callee. */
+typedef void (*grep_output_func)(char line[], void *arg);
+
+/* Parameters of a search. */
+typedef struct
+{
+	const char *pattern; /* Extended regular expression to look for. */
+	int cflags;          /* Flags for regcomp(), REG_EXTENDED is implied. */
+	int invert;          /* Whether to look for lines that don't match. */
+	int nthreads;        /* Number of threads to use. */
+	const char *dir;     /* Base for relative targets or NULL. */
+
+	grep_filter_func filter;   /* Filters directory entries, can be NULL. */
+	grep_output_func on_match; /* Receives matched lines. */
+	grep_output_func on_error; /* Receives error messages, can be NULL. */
+	const struct cancellation_t *cancellation; /* Cancellation state. */
+	void *arg;                                 /* Argument of callbacks. */
+}
+grep_params_t;
+
+/* Looks for lines among targets, which are files or directories that are
+ * searched recursively without following symbolic links in them.  Binary files
+ * are skipped.  Matches are reported as "path:line number:text" with paths
+ * relative to the same directory as targets and all matches of a file are
+ * reported together.  Callbacks are called from several threads, but never at
+ * the same time.  Returns zero on success, otherwise non-zero is returned and
+ * error message is reported. */
+int grep_files(char *const targets[], int ntargets,
+		const grep_params_t *params);
+
+#endif /* VIFM__UTILS__GREP_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -245,6 +245,10 @@ int reopen_term_stdin(void);
  * NULL on error, otherwise stream valid for reading is returned. */
 FILE * read_cmd_output(const char cmd[], int preserve_stdin);
 
+/* Same as read_cmd_output(), but also sets *pid to id of the process
+ * ((pid_t)0 for non-*nix like systems), which can be used to stop it. */
+FILE * read_cmd_output_pid(const char cmd[], int preserve_stdin, pid_t *pid);
+
 /* Gets path to directory where files bundled with Vifm are stored.  Returns
  * pointer to a statically allocated buffer. */
 const char * get_installed_data_dir(void);
@@ -258,6 +262,10 @@ void clone_timestamps(const char path[], const char from[],
  * amount in bytes. */
 uint64_t get_free_space(const char at[]);
 
+/* Retrieves number of processors that are available.  Returns the number,
+ * which is at least one. */
+int get_proc_count(void);
+
 #ifdef _WIN32
 #include "utils_win.h"
 #else
@@ -967,6 +967,13 @@ open_tty(void)
 
 FILE *
 read_cmd_output(const char cmd[], int preserve_stdin)
+{
+	pid_t pid;
+	return read_cmd_output_pid(cmd, preserve_stdin, &pid);
+}
+
+FILE *
+read_cmd_output_pid(const char cmd[], int preserve_stdin, pid_t *pid_out)
 {
 	FILE *fp;
 	pid_t pid;
@@ -997,6 +1004,7 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	{
 		close(out_pipe[0]);
 	}
+	*pid_out = pid;
 	return fp;
 }
 
@@ -1052,5 +1060,12 @@ get_free_space(const char at[])
 	return (uint64_t)st.f_bsize*st.f_bavail;
 }
 
+int
+get_proc_count(void)
+{
+	const long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count < 1) ? 1 : (int)count;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -704,6 +704,13 @@ read_cmd_output(const char cmd[], int preserve_stdin)
 	return result;
 }
 
+FILE *
+read_cmd_output_pid(const char cmd[], int preserve_stdin, pid_t *pid)
+{
+	*pid = (pid_t)0;
+	return read_cmd_output(cmd, preserve_stdin);
+}
+
 /* Performs redirection and execution of the command.  Returns file descriptor
  * bound to stdout of the command. */
 static FILE *
@@ -858,6 +865,14 @@ get_free_space(const char at[])
 	return (uint64_t)bytes_per_sector*sectors_per_cluster*number_of_free_clusters;
 }
 
+int
+get_proc_count(void)
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors < 1) ? 1 : (int)info.dwNumberOfProcessors;
+}
+
 /* Extracts root part of the path (drive name or UNC share name).  Returns newly
  * allocated string. */
 static char *
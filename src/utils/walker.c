@@ -0,0 +1,260 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "walker.h"
+
+#include <sys/stat.h> /* stat */
+#include <dirent.h> /* DIR dirent */
+
+#include <errno.h> /* errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* strcmp() strcpy() strerror() strlen() */
+
+#include "../compat/fs_limits.h"
+#include "../compat/os.h"
+#include "../compat/pthread.h"
+#include "cancellation.h"
+#include "path.h"
+#include "str.h"
+#include "workers.h"
+
+/* State of a walk. */
+struct walker_t
+{
+	const walker_params_t *params; /* Parameters of the walk. */
+	workers_t *workers;            /* Threads that visit paths. */
+	pthread_mutex_t output_lock;   /* Serializes calls of output callbacks. */
+};
+
+/* Path to be visited. */
+typedef struct
+{
+	char *path;      /* Path relative to targets. */
+	char *full_path; /* Full path to the file. */
+	struct stat st;  /* Information about the file. */
+}
+walker_task_t;
+
+static int schedule(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, int append);
+static void visit_task(void *task, void *arg);
+static void get_full_path(const char dir[], const char path[], char buf[],
+		size_t buf_len);
+
+int
+walker_run(char *const targets[], int ntargets, const walker_params_t *params)
+{
+	int i;
+	walker_t w = { .params = params };
+
+	if(pthread_mutex_init(&w.output_lock, NULL) != 0)
+	{
+		return 1;
+	}
+
+	/* Current thread takes part in the walk as well. */
+	w.workers = workers_create(params->nthreads - 1, &visit_task, &w);
+	if(w.workers == NULL)
+	{
+		pthread_mutex_destroy(&w.output_lock);
+		return 1;
+	}
+
+	for(i = 0; i < ntargets; ++i)
+	{
+		char full_path[PATH_MAX + 1];
+		struct stat st;
+
+		get_full_path(params->dir, targets[i], full_path, sizeof(full_path));
+		if(os_stat(full_path, &st) != 0)
+		{
+			walker_report_error(&w, targets[i], errno);
+		}
+		else if(schedule(&w, targets[i], full_path, &st, 1) != 0)
+		{
+			break;
+		}
+	}
+
+	workers_free(w.workers);
+	pthread_mutex_destroy(&w.output_lock);
+	return 0;
+}
+
+int
+walker_schedule(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st)
+{
+	return schedule(w, path, full_path, st, 0);
+}
+
+/* Schedules path for visiting either after everything else or before it.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+schedule(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st, int append)
+{
+	const size_t path_len = strlen(path);
+	walker_task_t *const task = malloc(sizeof(*task) + path_len + 1U +
+			strlen(full_path) + 1U);
+	if(task == NULL)
+	{
+		return 1;
+	}
+
+	task->path = (char *)(task + 1);
+	task->full_path = task->path + path_len + 1U;
+	strcpy(task->path, path);
+	strcpy(task->full_path, full_path);
+	task->st = *st;
+
+	if((append ? workers_append : workers_push)(w->workers, task) != 0)
+	{
+		free(task);
+		return 1;
+	}
+	return 0;
+}
+
+/* Visits a path unless walking was cancelled. */
+static void
+visit_task(void *task, void *arg)
+{
+	walker_task_t *const t = task;
+	walker_t *const w = arg;
+
+	if(!walker_cancelled(w))
+	{
+		w->params->visit(w, t->path, t->full_path, &t->st, w->params->arg);
+	}
+
+	free(t);
+}
+
+int
+walker_list(walker_t *w, const char path[], const char full_path[],
+		walker_entry_func entry, void *ctx)
+{
+	struct dirent *dentry;
+	const char *slash, *full_slash;
+
+	DIR *const dir = os_opendir(full_path[0] == '\0' ? "." : full_path);
+	if(dir == NULL)
+	{
+		walker_report_error(w, path, errno);
+		return 1;
+	}
+
+	slash = (path[0] == '\0' || ends_with_slash(path) ? "" : "/");
+	full_slash = (full_path[0] == '\0' || ends_with_slash(full_path) ? "" : "/");
+	while((dentry = os_readdir(dir)) != NULL)
+	{
+		char sub_path[PATH_MAX + 1];
+		char sub_full_path[PATH_MAX + 1];
+		struct stat st;
+
+		if(is_builtin_dir(dentry->d_name))
+		{
+			continue;
+		}
+
+		snprintf(sub_path, sizeof(sub_path), "%s%s%s", path, slash,
+				dentry->d_name);
+		snprintf(sub_full_path, sizeof(sub_full_path), "%s%s%s", full_path,
+				full_slash, dentry->d_name);
+		if(os_lstat(sub_full_path, &st) != 0)
+		{
+			continue;
+		}
+
+		if(entry(w, sub_path, sub_full_path, &st, ctx) != 0 ||
+				walker_cancelled(w))
+		{
+			break;
+		}
+	}
+
+	os_closedir(dir);
+	return 0;
+}
+
+void
+walker_report_error(walker_t *w, const char path[], int error)
+{
+	char *msg;
+
+	if(w->params->on_error == NULL)
+	{
+		return;
+	}
+
+	msg = format_str("%s: %s", path, strerror(error));
+	if(msg != NULL)
+	{
+		walker_lock_output(w);
+		w->params->on_error(msg, w->params->arg);
+		walker_unlock_output(w);
+	}
+}
+
+int
+walker_cancelled(const walker_t *w)
+{
+	return cancellation_requested(w->params->cancellation);
+}
+
+void *
+walker_get_arg(const walker_t *w)
+{
+	return w->params->arg;
+}
+
+void
+walker_lock_output(walker_t *w)
+{
+	pthread_mutex_lock(&w->output_lock);
+}
+
+void
+walker_unlock_output(walker_t *w)
+{
+	pthread_mutex_unlock(&w->output_lock);
+}
+
+/* Resolves path that might be relative to base directory of the walk. */
+static void
+get_full_path(const char dir[], const char path[], char buf[], size_t buf_len)
+{
+	if(dir == NULL || is_path_absolute(path))
+	{
+		copy_str(buf, buf_len, path);
+	}
+	else if(strcmp(path, ".") == 0)
+	{
+		copy_str(buf, buf_len, dir);
+	}
+	else
+	{
+		snprintf(buf, buf_len, "%s/%s", dir, path);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
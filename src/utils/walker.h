@@ -0,0 +1,101 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__WALKER_H__
+#define VIFM__UTILS__WALKER_H__
+
+/* Walker of directory trees built on top of a pool of workers.  Targets and
+ * whatever is scheduled while processing them are visited by several threads
+ * at once, visitor decides which directories to list and which of their
+ * entries to schedule for visiting.  Paths are reported in two forms: as they
+ * are relative to targets and full ones for accessing files. */
+
+struct cancellation_t;
+struct stat;
+
+/* Declaration of opaque walker type. */
+typedef struct walker_t walker_t;
+
+/* Processes a target or a scheduled path along with information about it.
+ * Called from several threads at the same time. */
+typedef void (*walker_visit_func)(walker_t *w, const char path[],
+		const char full_path[], const struct stat *st, void *arg);
+
+/* Processes an entry of a directory being listed along with its lstat()
+ * information.  ctx is the value passed to walker_list().  Returns non-zero to
+ * stop listing, otherwise zero is returned. */
+typedef int (*walker_entry_func)(walker_t *w, const char path[],
+		const char full_path[], const struct stat *st, void *ctx);
+
+/* Receives a newly allocated error message, which should be freed by the
+ * callee. */
+typedef void (*walker_error_func)(char msg[], void *arg);
+
+/* Parameters of a walk. */
+typedef struct
+{
+	int nthreads;    /* Number of threads to use. */
+	const char *dir; /* Base for relative targets or NULL. */
+
+	walker_visit_func visit;    /* Processes targets and scheduled paths. */
+	walker_error_func on_error; /* Receives error messages, can be NULL. */
+	const struct cancellation_t *cancellation; /* Cancellation state. */
+	void *arg;                                 /* Argument of callbacks. */
+}
+walker_params_t;
+
+/* Visits targets, which can be relative to the base directory, and whatever is
+ * scheduled while doing that.  Targets that can't be stat()'ed are reported as
+ * errors.  After cancellation scheduled paths are dropped without visiting
+ * them.  Returns zero on success, otherwise non-zero is returned. */
+int walker_run(char *const targets[], int ntargets,
+		const walker_params_t *params);
+
+/* Schedules path for visiting.  Returns zero on success, otherwise non-zero is
+ * returned. */
+int walker_schedule(walker_t *w, const char path[], const char full_path[],
+		const struct stat *st);
+
+/* Lists directory passing its entries except for "." and ".." to the callback
+ * until cancellation.  Empty paths stand for current directory and add no
+ * prefix to paths of entries.  Failure to open the directory is reported as an
+ * error.  Returns zero on success, otherwise non-zero is returned. */
+int walker_list(walker_t *w, const char path[], const char full_path[],
+		walker_entry_func entry, void *ctx);
+
+/* Reports failure to access the path to the error callback. */
+void walker_report_error(walker_t *w, const char path[], int error);
+
+/* Checks whether walking was cancelled.  Returns non-zero if so, otherwise zero
+ * is returned. */
+int walker_cancelled(const walker_t *w);
+
+/* Retrieves argument of callbacks of the walk.  Returns the argument. */
+void * walker_get_arg(const walker_t *w);
+
+/* Serializes calls of output callbacks of the walker's user.  Must be paired
+ * with walker_unlock_output(). */
+void walker_lock_output(walker_t *w);
+
+/* Allows other threads to call output callbacks. */
+void walker_unlock_output(walker_t *w);
+
+#endif /* VIFM__UTILS__WALKER_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
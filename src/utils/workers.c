@@ -0,0 +1,289 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "workers.h"
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* calloc() free() malloc() */
+
+#include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
+#include "macros.h"
+#include "utils.h"
+
+/* Maximum number of threads of a pool. */
+#define MAX_WORKERS 64
+
+/* Element of the queue of tasks. */
+typedef struct node_t node_t;
+struct node_t
+{
+	void *task;   /* Task to be passed to the callback. */
+	node_t *next; /* Next element of the queue. */
+};
+
+/* Pool of threads. */
+struct workers_t
+{
+	workers_func func; /* Performs tasks. */
+	void *arg;         /* Argument of the callback. */
+
+	pthread_t *ids; /* Identifiers of started threads. */
+	int nthreads;   /* Number of started threads. */
+
+	pthread_mutex_t lock; /* Protects fields below it. */
+	pthread_cond_t cond;  /* Signaled on new tasks, finish and stop. */
+	node_t *head;         /* First task of the queue. */
+	node_t *tail;         /* Last task of the queue. */
+	int queued;           /* Number of tasks in the queue. */
+	int active;           /* Number of tasks being performed. */
+	int stop;             /* Whether threads should exit when queue is empty. */
+};
+
+static void * worker_thread(void *arg);
+static void perform_task(workers_t *w);
+static node_t * make_node(void *task);
+
+workers_t *
+workers_create(int nthreads, workers_func func, void *arg)
+{
+	int i;
+	workers_t *const w = calloc(1, sizeof(*w));
+	if(w == NULL)
+	{
+		return NULL;
+	}
+
+	nthreads = MIN(MAX(nthreads, 0), MAX_WORKERS);
+
+	w->func = func;
+	w->arg = arg;
+	w->ids = reallocarray(NULL, MAX(nthreads, 1), sizeof(*w->ids));
+	if(w->ids == NULL)
+	{
+		free(w);
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&w->lock, NULL) != 0)
+	{
+		free(w->ids);
+		free(w);
+		return NULL;
+	}
+	if(pthread_cond_init(&w->cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&w->lock);
+		free(w->ids);
+		free(w);
+		return NULL;
+	}
+
+	for(i = 0; i < nthreads; ++i)
+	{
+		if(pthread_create(&w->ids[w->nthreads], NULL, &worker_thread, w) == 0)
+		{
+			++w->nthreads;
+		}
+	}
+
+	return w;
+}
+
+void
+workers_free(workers_t *w)
+{
+	int i;
+
+	if(w == NULL)
+	{
+		return;
+	}
+
+	workers_wait(w);
+
+	pthread_mutex_lock(&w->lock);
+	w->stop = 1;
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+
+	for(i = 0; i < w->nthreads; ++i)
+	{
+		(void)pthread_join(w->ids[i], NULL);
+	}
+
+	pthread_cond_destroy(&w->cond);
+	pthread_mutex_destroy(&w->lock);
+	free(w->ids);
+	free(w);
+}
+
+int
+workers_count(const workers_t *w)
+{
+	return w->nthreads;
+}
+
+int
+workers_push(workers_t *w, void *task)
+{
+	node_t *const node = make_node(task);
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&w->lock);
+	node->next = w->head;
+	w->head = node;
+	if(w->tail == NULL)
+	{
+		w->tail = node;
+	}
+	++w->queued;
+	pthread_cond_signal(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+	return 0;
+}
+
+int
+workers_append(workers_t *w, void *task)
+{
+	node_t *const node = make_node(task);
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	pthread_mutex_lock(&w->lock);
+	if(w->tail == NULL)
+	{
+		w->head = node;
+	}
+	else
+	{
+		w->tail->next = node;
+	}
+	w->tail = node;
+	++w->queued;
+	pthread_cond_signal(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+	return 0;
+}
+
+void
+workers_throttle(workers_t *w, int limit)
+{
+	pthread_mutex_lock(&w->lock);
+	while(w->queued != 0 && w->queued >= limit)
+	{
+		perform_task(w);
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+void
+workers_wait(workers_t *w)
+{
+	pthread_mutex_lock(&w->lock);
+	while(w->queued != 0 || w->active != 0)
+	{
+		if(w->queued != 0)
+		{
+			perform_task(w);
+		}
+		else
+		{
+			/* Tasks being performed might add new ones. */
+			pthread_cond_wait(&w->cond, &w->lock);
+		}
+	}
+	pthread_mutex_unlock(&w->lock);
+}
+
+/* Entry point of a thread of the pool.  Returns NULL. */
+static void *
+worker_thread(void *arg)
+{
+	workers_t *const w = arg;
+
+	block_all_thread_signals();
+
+	pthread_mutex_lock(&w->lock);
+	while(1)
+	{
+		while(w->queued == 0 && !w->stop)
+		{
+			pthread_cond_wait(&w->cond, &w->lock);
+		}
+
+		if(w->queued == 0)
+		{
+			break;
+		}
+
+		perform_task(w);
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return NULL;
+}
+
+/* Takes the first task off the queue and performs it.  Must be called with the
+ * lock held, which is released while the task is being performed. */
+static void
+perform_task(workers_t *w)
+{
+	node_t *const node = w->head;
+	void *const task = node->task;
+
+	w->head = node->next;
+	if(w->head == NULL)
+	{
+		w->tail = NULL;
+	}
+	--w->queued;
+	++w->active;
+	pthread_mutex_unlock(&w->lock);
+
+	free(node);
+	w->func(task, w->arg);
+
+	pthread_mutex_lock(&w->lock);
+	if(--w->active == 0 && w->queued == 0)
+	{
+		/* Wake up everyone who waits for tasks to finish. */
+		pthread_cond_broadcast(&w->cond);
+	}
+}
+
+/* Allocates element of the queue.  Returns the element or NULL on error. */
+static node_t *
+make_node(void *task)
+{
+	node_t *const node = malloc(sizeof(*node));
+	if(node != NULL)
+	{
+		node->task = task;
+		node->next = NULL;
+	}
+	return node;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
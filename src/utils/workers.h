@@ -0,0 +1,64 @@
+/* vifm
+ * Copyright (C) 2018 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__UTILS__WORKERS_H__
+#define VIFM__UTILS__WORKERS_H__
+
+/* Pool of threads that perform tasks from a shared queue.  Tasks can add more
+ * tasks to the queue.  Thread that waits for tasks to finish performs them as
+ * well, so a pool without threads still does its job. */
+
+/* Declaration of opaque pool type. */
+typedef struct workers_t workers_t;
+
+/* Performs a task.  Called from several threads at the same time. */
+typedef void (*workers_func)(void *task, void *arg);
+
+/* Creates a pool of up to nthreads threads (some might fail to start), which
+ * perform tasks by calling func with arg.  Returns the pool or NULL on
+ * error. */
+workers_t * workers_create(int nthreads, workers_func func, void *arg);
+
+/* Finishes all tasks of the pool and frees it.  Freeing of NULL pool is OK. */
+void workers_free(workers_t *w);
+
+/* Retrieves number of threads that were started by the pool.  Returns the
+ * number. */
+int workers_count(const workers_t *w);
+
+/* Schedules task to be performed before all queued ones, which keeps walking of
+ * trees close to depth-first order and limits number of queued tasks.  Returns
+ * zero on success, otherwise non-zero is returned. */
+int workers_push(workers_t *w, void *task);
+
+/* Schedules task to be performed after all queued ones.  Returns zero on
+ * success, otherwise non-zero is returned. */
+int workers_append(workers_t *w, void *task);
+
+/* Performs queued tasks in the calling thread while there are at least limit of
+ * them.  This is a way to keep producer of tasks from outpacing the pool. */
+void workers_throttle(workers_t *w, int limit);
+
+/* Performs queued tasks in the calling thread until all of them including those
+ * being performed by other threads are finished. */
+void workers_wait(workers_t *w);
+
+#endif /* VIFM__UTILS__WORKERS_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
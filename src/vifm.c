@@ -32,7 +32,7 @@
 #include <locale.h> /* setlocale() LC_ALL */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* fprintf() fputs() puts() snprintf() */
-#include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS exit() srand() system() */
+#include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS exit() free() srand() system() */
 #include <string.h>
 #include <time.h> /* time() */
 
@@ -59,6 +59,7 @@
 #include "ui/cancellation.h"
 #include "ui/color_manager.h"
 #include "ui/color_scheme.h"
+#include "ui/qv_cache.h"
 #include "ui/quickview.h"
 #include "ui/statusbar.h"
 #include "ui/tabs.h"
@@ -83,6 +84,7 @@
 #include "filelist.h"
 #include "filetype.h"
 #include "flist_hist.h"
+#include "flist_meta.h"
 #include "flist_pos.h"
 #include "fops_common.h"
 #include "ipc.h"
@@ -582,6 +584,9 @@ vifm_restart(void)
 	/* File types and viewers. */
 	ft_reset(curr_stats.exec_env_type == EET_EMULATOR_WITH_X);
 
+	/* Output of viewers, which might be redefined. */
+	qvc_reset();
+
 	/* Undo list. */
 	reset_undo_list();
 
@@ -711,6 +716,13 @@ vifm_choose_files(const view_t *view, int nfiles, char *files[])
 static void _gnuc_noreturn
 vifm_leave(int exit_code, int cquit)
 {
+	char *const stats = dcache_format_stats();
+	if(stats != NULL)
+	{
+		LOG_INFO_MSG("%s", stats);
+		free(stats);
+	}
+
 	vim_write_dir(cquit ? "" : flist_get_dir(curr_view));
 
 	if(cquit && exit_code == EXIT_SUCCESS)
@@ -745,6 +757,8 @@ vifm_finish(const char message[])
 void _gnuc_noreturn
 vifm_exit(int exit_code)
 {
+	flist_free_link_targets();
+	flist_meta_free_threads();
 	ipc_free(curr_stats.ipc);
 	exit(exit_code);
 }
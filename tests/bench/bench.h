@@ -0,0 +1,27 @@
+#ifndef VIFM_TESTS__BENCH__BENCH_H__
+#define VIFM_TESTS__BENCH__BENCH_H__
+
+/* Benchmark of loading directories with and without parallel querying of file
+ * metadata.  Returns exit code. */
+int bench_dirload(int argc, char *argv[]);
+
+/* Benchmark of sorting a long list of entries by several keys in a single pass
+ * (serially and using several threads) compared to a separate pass per key.
+ * Returns exit code. */
+int bench_sort(int argc, char *argv[]);
+
+/* Benchmark of copying a large file by cloning it, in the kernel
+ * (copy_file_range() and sendfile()) and in user space (with and without page
+ * cache).  Returns exit code. */
+int bench_copy(int argc, char *argv[]);
+
+/* Retrieves current time in seconds for measuring durations. */
+double bench_now(void);
+
+/* Prints result of a single measurement. */
+void bench_report(const char name[], double seconds, int items);
+
+#endif /* VIFM_TESTS__BENCH__BENCH_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,140 @@
+#include <unistd.h> /* unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fwrite() printf() snprintf() */
+#include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS atoi() */
+#include <string.h> /* memset() */
+
+#include "../../src/compat/fs_limits.h"
+#include "../../src/io/iop.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
+
+#include "bench.h"
+
+/* Options of copying. */
+enum
+{
+	CLONE     = 1 << 0, /* Try cloning the file. */
+	NOCACHE   = 1 << 1, /* Drop copied data from page cache. */
+	DIRECT_IO = 1 << 2, /* Bypass page cache. */
+};
+
+static int create_file(const char path[], int size_mib);
+static double measure_copy(const char src[], const char dst[],
+		IoCopyMethod method, int flags, int *failed);
+
+int
+bench_copy(int argc, char *argv[])
+{
+	/* Names of ways of copying along with their parameters. */
+	static const struct
+	{
+		const char *name;
+		IoCopyMethod method;
+		int flags;
+	}
+	kinds[] = {
+		{ "clone",             IO_CM_COPY_FILE_RANGE, CLONE },
+		{ "copy_file_range",   IO_CM_COPY_FILE_RANGE, 0 },
+		{ "sendfile",          IO_CM_SENDFILE,        0 },
+		{ "userspace",         IO_CM_USERSPACE,       0 },
+		{ "userspace+nocache", IO_CM_USERSPACE,       NOCACHE },
+		{ "userspace+direct",  IO_CM_USERSPACE,       DIRECT_IO },
+	};
+
+	char src[PATH_MAX + 1], dst[PATH_MAX + 1];
+	const int size_mib = (argc > 0) ? atoi(argv[0]) : 256;
+	const char *const dir = (argc > 1) ? argv[1] : SANDBOX_PATH;
+	int result = EXIT_SUCCESS;
+	size_t i;
+
+	snprintf(src, sizeof(src), "%s/copy-src", dir);
+	snprintf(dst, sizeof(dst), "%s/copy-dst", dir);
+
+	if(create_file(src, size_mib) != 0)
+	{
+		printf("Failed to create %s\n", src);
+		(void)unlink(src);
+		return EXIT_FAILURE;
+	}
+
+	printf("Copying %d MiB file in %s (items are MiB)\n", size_mib, dir);
+	for(i = 0U; i < sizeof(kinds)/sizeof(kinds[0]); ++i)
+	{
+		int failed;
+		const double duration = measure_copy(src, dst, kinds[i].method,
+				kinds[i].flags, &failed);
+		if(failed)
+		{
+			printf("%-24s failed\n", kinds[i].name);
+			result = EXIT_FAILURE;
+			continue;
+		}
+		bench_report(kinds[i].name, duration, size_mib);
+	}
+
+	(void)unlink(src);
+	return result;
+}
+
+/* Creates file of specified size filled with non-zero data.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+create_file(const char path[], int size_mib)
+{
+	char block[1024*1024];
+	int i;
+	FILE *const fp = fopen(path, "wb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < size_mib; ++i)
+	{
+		memset(block, 'a' + i%26, sizeof(block));
+		if(fwrite(block, sizeof(block), 1U, fp) != 1U)
+		{
+			fclose(fp);
+			return 1;
+		}
+	}
+	return (fclose(fp) != 0);
+}
+
+/* Copies the file using specified way of copying and options (combination of
+ * CLONE, NOCACHE and DIRECT_IO) and checks the result.  Sets *failed to
+ * non-zero if copying or the check failed.  Returns duration in seconds. */
+static double
+measure_copy(const char src[], const char dst[], IoCopyMethod method,
+		int flags, int *failed)
+{
+	double start, duration;
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg3.crs = IO_CRS_REPLACE_FILES,
+		.arg4.fast_file_cloning = ((flags & CLONE) != 0),
+		.arg4.nocache = ((flags & NOCACHE) != 0),
+		.arg4.direct_io = ((flags & DIRECT_IO) != 0),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	iop_cp_method = method;
+
+	start = bench_now();
+	*failed = (iop_cp(&args) != 0);
+	duration = bench_now() - start;
+
+	iop_cp_method = IO_CM_COPY_FILE_RANGE;
+
+	*failed |= (args.result.errors.error_count != 0);
+	*failed |= (get_file_size(src) != get_file_size(dst));
+	ioe_errlst_free(&args.result.errors);
+
+	(void)unlink(dst);
+	return duration;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,187 @@
+#include <unistd.h> /* rmdir() unlink() usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() printf() snprintf() */
+#include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS atoi() free() */
+#include <string.h> /* memset() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/tabs.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/filter.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/str.h"
+#include "../../src/background.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_meta.h"
+
+#include "bench.h"
+
+/* Number of times each way of loading is measured. */
+#define NRUNS 3
+
+static int create_files(const char dir[], int count);
+static void remove_files(const char dir[], int count);
+static double measure_load(const char dir[], int threads, int *count);
+
+int
+bench_dirload(int argc, char *argv[])
+{
+	char dir[PATH_MAX + 1];
+	const int threads = (argc > 0) ? atoi(argv[0]) : 8;
+	int count = (argc > 1) ? atoi(argv[1]) : 100000;
+	const int synthetic = (argc <= 2);
+	double serial = 0.0, pooled = 0.0;
+	int i;
+
+	if(synthetic)
+	{
+		snprintf(dir, sizeof(dir), "%s/dirload", SANDBOX_PATH);
+		if(create_files(dir, count) != 0)
+		{
+			printf("Failed to create files in %s\n", dir);
+			remove_files(dir, count);
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		copy_str(dir, sizeof(dir), argv[2]);
+	}
+
+	bg_init();
+	tabs_init();
+
+	/* Untimed load puts metadata of files into caches of the system, so that
+	 * neither of the measurements pays for reading it from a disk. */
+	(void)measure_load(dir, 0, &count);
+
+	/* Order of measurements alternates and the best time of each is taken to
+	 * keep their conditions similar. */
+	for(i = 0; i < NRUNS; ++i)
+	{
+		double s, p;
+		if(i%2 == 0)
+		{
+			s = measure_load(dir, 0, &count);
+			p = measure_load(dir, threads, &count);
+		}
+		else
+		{
+			p = measure_load(dir, threads, &count);
+			s = measure_load(dir, 0, &count);
+		}
+
+		if(i == 0 || s < serial)
+		{
+			serial = s;
+		}
+		if(i == 0 || p < pooled)
+		{
+			pooled = p;
+		}
+	}
+
+	printf("Loading %d files of %s (best of %d runs)\n", count, dir, NRUNS);
+	bench_report("statthreads=0", serial, count);
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "statthreads=%d", threads);
+		bench_report(name, pooled, count);
+	}
+
+	if(synthetic)
+	{
+		remove_files(dir, count);
+	}
+	return EXIT_SUCCESS;
+}
+
+/* Creates directory with specified number of empty files.  Returns zero on
+ * success, otherwise non-zero is returned. */
+static int
+create_files(const char dir[], int count)
+{
+	int i;
+
+	if(os_mkdir(dir, 0700) != 0)
+	{
+		return 1;
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		FILE *fp;
+
+		snprintf(path, sizeof(path), "%s/file%06d", dir, i);
+		fp = fopen(path, "w");
+		if(fp == NULL)
+		{
+			return 1;
+		}
+		fclose(fp);
+	}
+	return 0;
+}
+
+/* Removes directory created by create_files(). */
+static void
+remove_files(const char dir[], int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s/file%06d", dir, i);
+		(void)unlink(path);
+	}
+	(void)rmdir(dir);
+}
+
+/* Loads the directory into a view waiting for all metadata to be available.
+ * Stores number of loaded entries in *count.  Returns duration in seconds. */
+static double
+measure_load(const char dir[], int threads, int *count)
+{
+	view_t *const view = &lwin;
+	char *error;
+	double start, duration;
+
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+	view->list_pos = 0;
+	copy_str(view->curr_dir, sizeof(view->curr_dir), dir);
+	(void)filter_init(&view->local_filter.filter, 1);
+	view->manual_filter = matcher_alloc("", 0, 0, "", &error);
+	free(error);
+	(void)filter_init(&view->auto_filter, 1);
+	view->hide_dot = 1;
+	view->invert = 1;
+	view->sort[0] = SK_BY_NAME;
+	memset(&view->sort[1], SK_NONE, sizeof(view->sort) - 1);
+
+	cfg.stat_threads = threads;
+
+	start = bench_now();
+	populate_dir_list(view, 0);
+	while(flist_meta_loading(view))
+	{
+		(void)flist_meta_apply(view);
+		usleep(1000);
+	}
+	duration = bench_now() - start;
+
+	*count = view->list_rows;
+
+	flist_free_view(view);
+	filter_dispose(&view->local_filter.filter);
+	matcher_free(view->manual_filter);
+	view->manual_filter = NULL;
+	filter_dispose(&view->auto_filter);
+	return duration;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,149 @@
+#include <stdio.h> /* printf() snprintf() */
+#include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS atoi() free() rand() srand() */
+#include <string.h> /* memcpy() memset() strcmp() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/reallocarray.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/macros.h"
+#include "../../src/sort.h"
+
+#include "bench.h"
+
+static dir_entry_t * make_entries(int count);
+static double measure_sort(const dir_entry_t entries[], int count,
+		const char keys[], int nkeys, int single_pass, dir_entry_t **sorted);
+
+int
+bench_sort(int argc, char *argv[])
+{
+	const int count = (argc > 0) ? atoi(argv[0]) : 500000;
+	const int threads = (argc > 1) ? atoi(argv[1]) : 8;
+	const char keys[] = { SK_BY_EXTENSION, SK_BY_INAME, -SK_BY_SIZE };
+	dir_entry_t *entries, *multi, *single, *parallel;
+	double multi_time, single_time, parallel_time;
+	char name[32];
+	int i;
+
+	entries = make_entries(count);
+	if(entries == NULL)
+	{
+		printf("Failed to create %d entries\n", count);
+		return EXIT_FAILURE;
+	}
+
+	cfg.sort_threads = 1;
+	multi_time = measure_sort(entries, count, keys, ARRAY_LEN(keys), 0, &multi);
+	single_time = measure_sort(entries, count, keys, ARRAY_LEN(keys), 1,
+			&single);
+	cfg.sort_threads = threads;
+	parallel_time = measure_sort(entries, count, keys, ARRAY_LEN(keys), 1,
+			&parallel);
+	cfg.sort_threads = 0;
+
+	printf("Sorting %d entries by extension, iname, -size\n", count);
+	bench_report("per-key passes", multi_time, count);
+	bench_report("single pass", single_time, count);
+	snprintf(name, sizeof(name), "sortthreads=%d", threads);
+	bench_report(name, parallel_time, count);
+	if(single_time > 0.0 && parallel_time > 0.0)
+	{
+		printf("%-24s %10.2fx\n", "speedup", multi_time/single_time);
+		printf("%-24s %10.2fx\n", "parallel speedup", multi_time/parallel_time);
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		if(multi[i].name != single[i].name || multi[i].name != parallel[i].name)
+		{
+			printf("Results differ at position %d\n", i);
+			break;
+		}
+	}
+
+	for(i = 0; i < count; ++i)
+	{
+		free(entries[i].name);
+	}
+	free(entries);
+	free(multi);
+	free(single);
+	free(parallel);
+	return (i == count) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Generates list of files with mixed case names, numbers and extensions.
+ * Returns newly allocated array or NULL on error. */
+static dir_entry_t *
+make_entries(int count)
+{
+	static const char *const exts[] = { "txt", "JPG", "c", "h", "tar.gz" };
+
+	int i;
+	dir_entry_t *const entries = reallocarray(NULL, count, sizeof(*entries));
+	if(entries == NULL)
+	{
+		return NULL;
+	}
+
+	srand(1);
+	memset(entries, 0, count*sizeof(*entries));
+	for(i = 0; i < count; ++i)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "%s%d_v%d.%s", (rand()%2) ? "Img" : "img",
+				rand()%1000, rand()%100, exts[rand()%ARRAY_LEN(exts)]);
+		entries[i].name = strdup(name);
+		entries[i].origin = "/";
+		entries[i].type = FT_REG;
+		entries[i].size = rand()%4096;
+		entries[i].meta_idx = -1;
+		if(entries[i].name == NULL)
+		{
+			return NULL;
+		}
+	}
+	return entries;
+}
+
+/* Sorts copy of the entries either at once or by doing a separate stable pass
+ * per key starting with the least significant one.  Stores sorted copy in
+ * *sorted.  Returns duration in seconds. */
+static double
+measure_sort(const dir_entry_t entries[], int count, const char keys[],
+		int nkeys, int single_pass, dir_entry_t **sorted)
+{
+	view_t *const view = &lwin;
+	double start, duration;
+	int i;
+
+	view->dir_entry = reallocarray(NULL, count, sizeof(*view->dir_entry));
+	memcpy(view->dir_entry, entries, count*sizeof(*view->dir_entry));
+	view->list_rows = count;
+
+	start = bench_now();
+	if(single_pass)
+	{
+		memset(view->sort, SK_NONE, sizeof(view->sort));
+		memcpy(view->sort, keys, nkeys);
+		sort_view(view);
+	}
+	else
+	{
+		for(i = nkeys - 1; i >= 0; --i)
+		{
+			memset(view->sort, SK_NONE, sizeof(view->sort));
+			view->sort[0] = keys[i];
+			sort_view(view);
+		}
+	}
+	duration = bench_now() - start;
+
+	*sorted = view->dir_entry;
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+	return duration;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
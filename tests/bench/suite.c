@@ -0,0 +1,60 @@
+#include <sys/time.h> /* gettimeofday() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* printf() puts() */
+#include <stdlib.h> /* EXIT_FAILURE */
+#include <string.h> /* strcmp() */
+
+#include "bench.h"
+
+/* Benchmarks are built along with tests, but aren't run automatically.  Each
+ * one is selected by the first argument and is passed the rest of them. */
+
+int
+main(int argc, char *argv[])
+{
+	if(argc < 2)
+	{
+		puts("Usage: bench <kind> [args...]");
+		puts("");
+		puts("Kinds:");
+		puts("  copy [size-MiB [dir]]");
+		puts("  dirload [threads [count [dir]]]");
+		puts("  sort [count [threads]]");
+		return EXIT_FAILURE;
+	}
+
+	if(strcmp(argv[1], "copy") == 0)
+	{
+		return bench_copy(argc - 2, argv + 2);
+	}
+	if(strcmp(argv[1], "dirload") == 0)
+	{
+		return bench_dirload(argc - 2, argv + 2);
+	}
+	if(strcmp(argv[1], "sort") == 0)
+	{
+		return bench_sort(argc - 2, argv + 2);
+	}
+
+	printf("Unknown benchmark: %s\n", argv[1]);
+	return EXIT_FAILURE;
+}
+
+double
+bench_now(void)
+{
+	struct timeval tv;
+	(void)gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1000000.0;
+}
+
+void
+bench_report(const char name[], double seconds, int items)
+{
+	printf("%-24s %10.3f s %12.0f items/s\n", name, seconds,
+			(seconds > 0.0) ? items/seconds : 0.0);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
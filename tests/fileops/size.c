@@ -1,10 +1,12 @@
 #include <stic.h>
 
-#include <unistd.h> /* usleep() */
+#include <sys/time.h> /* timeval utimes() */
+#include <unistd.h> /* link() rmdir() unlink() usleep() */
 
 #include <string.h> /* strcpy() strdup() */
 
 #include "../../src/cfg/config.h"
+#include "../../src/utils/cancellation.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/filelist.h"
 #include "../../src/fops_misc.h"
@@ -13,7 +15,10 @@
 #include "utils.h"
 
 static void setup_single_entry(view_t *view, const char name[]);
+static void make_tree_old(void);
 static uint64_t wait_for_size(const char path[]);
+static void create_tree(void);
+static void remove_tree(void);
 
 SETUP()
 {
@@ -47,6 +52,144 @@ TEST(parent_dir_entry_triggers_calculation_of_current_dir)
 	assert_int_equal(73728, wait_for_size(TEST_DATA_PATH "/various-sizes"));
 }
 
+TEST(subdirectories_are_processed_in_parallel)
+{
+	uint64_t size;
+
+	create_tree();
+
+	cfg.stat_threads = 4;
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+	cfg.stat_threads = 0;
+
+	dcache_get_at(SANDBOX_PATH "/top", &size, NULL);
+	assert_ulong_equal(10, size);
+	dcache_get_at(SANDBOX_PATH "/top/a", &size, NULL);
+	assert_ulong_equal(4, size);
+	dcache_get_at(SANDBOX_PATH "/top/c/d", &size, NULL);
+	assert_ulong_equal(2, size);
+	dcache_get_at(SANDBOX_PATH "/top/c", &size, NULL);
+	assert_ulong_equal(2, size);
+
+	remove_tree();
+}
+
+TEST(cached_sizes_of_subdirectories_are_used)
+{
+	create_tree();
+
+	assert_success(dcache_set_at(SANDBOX_PATH "/top/c", 100, DCACHE_UNKNOWN));
+	assert_ulong_equal(108, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+
+	remove_tree();
+}
+
+TEST(hard_links_are_counted_once, IF(not_windows))
+{
+	create_tree();
+	assert_success(link(SANDBOX_PATH "/top/a/f", SANDBOX_PATH "/top/b/g"));
+
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+
+	cfg.stat_threads = 4;
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+	cfg.stat_threads = 0;
+
+	assert_success(unlink(SANDBOX_PATH "/top/b/g"));
+	remove_tree();
+}
+
+TEST(hard_links_are_counted_in_each_subdirectory, IF(not_windows))
+{
+	uint64_t size;
+	int i;
+
+	create_tree();
+	assert_success(link(SANDBOX_PATH "/top/a/f", SANDBOX_PATH "/top/b/g"));
+	assert_success(link(SANDBOX_PATH "/top/a/f", SANDBOX_PATH "/top/c/d/g"));
+
+	cfg.stat_threads = 4;
+	for(i = 0; i < 10; ++i)
+	{
+		assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+					&no_cancellation));
+
+		dcache_get_at(SANDBOX_PATH "/top/a", &size, NULL);
+		assert_ulong_equal(4, size);
+		dcache_get_at(SANDBOX_PATH "/top/b", &size, NULL);
+		assert_ulong_equal(8, size);
+		dcache_get_at(SANDBOX_PATH "/top/c", &size, NULL);
+		assert_ulong_equal(6, size);
+	}
+	cfg.stat_threads = 0;
+
+	assert_success(unlink(SANDBOX_PATH "/top/c/d/g"));
+	assert_success(unlink(SANDBOX_PATH "/top/b/g"));
+	remove_tree();
+}
+
+TEST(cached_sizes_with_hard_links_are_not_summed_up, IF(not_windows))
+{
+	create_tree();
+	assert_success(link(SANDBOX_PATH "/top/a/f", SANDBOX_PATH "/top/b/g"));
+
+	assert_ulong_equal(8, fops_dir_size(SANDBOX_PATH "/top/b", 1,
+				&no_cancellation));
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+
+	assert_success(unlink(SANDBOX_PATH "/top/b/g"));
+	remove_tree();
+}
+
+TEST(saved_size_is_not_used_if_nested_directory_changed, IF(not_windows))
+{
+	uint64_t size;
+
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.vifm_info = VINFO_DCACHE;
+
+	create_tree();
+	make_tree_old();
+	assert_ulong_equal(10, fops_dir_size(SANDBOX_PATH "/top", 1,
+				&no_cancellation));
+	assert_success(dcache_save());
+
+	/* Unchanged tree is reused. */
+	assert_success(stats_reset(&cfg));
+	dcache_get_at(SANDBOX_PATH "/top", &size, NULL);
+	assert_ulong_equal(10, size);
+
+	/* Change two levels down doesn't affect modification time of the top. */
+	assert_success(stats_reset(&cfg));
+	write_file(SANDBOX_PATH "/top/c/d/g", "xyz");
+	dcache_get_at(SANDBOX_PATH "/top", &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	assert_ulong_equal(13, fops_dir_size(SANDBOX_PATH "/top", 0,
+				&no_cancellation));
+
+	/* Dropping outdated size of a directory drops sizes of its parents. */
+	assert_success(stats_reset(&cfg));
+	dcache_get_at(SANDBOX_PATH "/top/c/d", &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	assert_success(dcache_save());
+	assert_success(stats_reset(&cfg));
+	assert_success(unlink(SANDBOX_PATH "/top/c/d/g"));
+	make_tree_old();
+	dcache_get_at(SANDBOX_PATH "/top", &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	cfg.vifm_info = 0;
+	assert_success(unlink(SANDBOX_PATH "/dcache"));
+	remove_tree();
+}
+
 static void
 setup_single_entry(view_t *view, const char name[])
 {
@@ -82,5 +225,46 @@ wait_for_size(const char path[])
 	return size;
 }
 
+/* Creates directory tree with files of 4, 4 and 2 bytes. */
+static void
+create_tree(void)
+{
+	create_empty_dir(SANDBOX_PATH "/top");
+	create_empty_dir(SANDBOX_PATH "/top/a");
+	create_empty_dir(SANDBOX_PATH "/top/b");
+	create_empty_dir(SANDBOX_PATH "/top/c");
+	create_empty_dir(SANDBOX_PATH "/top/c/d");
+	write_file(SANDBOX_PATH "/top/a/f", "abcd");
+	write_file(SANDBOX_PATH "/top/b/f", "abcd");
+	write_file(SANDBOX_PATH "/top/c/d/f", "ab");
+}
+
+/* Moves modification times of directories created by create_tree() into the
+ * past, so that their changes in the same second aren't a concern. */
+static void
+make_tree_old(void)
+{
+	const struct timeval tv[2] = { { .tv_sec = 1 }, { .tv_sec = 1 } };
+	assert_success(utimes(SANDBOX_PATH "/top", tv));
+	assert_success(utimes(SANDBOX_PATH "/top/a", tv));
+	assert_success(utimes(SANDBOX_PATH "/top/b", tv));
+	assert_success(utimes(SANDBOX_PATH "/top/c", tv));
+	assert_success(utimes(SANDBOX_PATH "/top/c/d", tv));
+}
+
+/* Removes tree created by create_tree(). */
+static void
+remove_tree(void)
+{
+	assert_success(unlink(SANDBOX_PATH "/top/c/d/f"));
+	assert_success(unlink(SANDBOX_PATH "/top/b/f"));
+	assert_success(unlink(SANDBOX_PATH "/top/a/f"));
+	assert_success(rmdir(SANDBOX_PATH "/top/c/d"));
+	assert_success(rmdir(SANDBOX_PATH "/top/c"));
+	assert_success(rmdir(SANDBOX_PATH "/top/b"));
+	assert_success(rmdir(SANDBOX_PATH "/top/a"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
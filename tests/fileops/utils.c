@@ -4,7 +4,7 @@
 
 #include <unistd.h> /* access() usleep() */
 
-#include <stdio.h> /* FILE fclose() fopen() */
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
 #include <string.h> /* snprintf() strcpy() */
 
 #include "../../src/compat/os.h"
@@ -47,6 +47,15 @@ create_empty_file(const char path[])
 	assert_success(access(path, F_OK));
 }
 
+void
+write_file(const char path[], const char contents[])
+{
+	FILE *const fp = fopen(path, "w");
+	assert_non_null(fp);
+	fputs(contents, fp);
+	fclose(fp);
+}
+
 void
 create_empty_dir(const char path[])
 {
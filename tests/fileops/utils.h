@@ -14,6 +14,9 @@ void view_teardown(struct view_t *view);
 /* Creates empty file at specified path. */
 void create_empty_file(const char path[]);
 
+/* Creates file at specified path with the contents. */
+void write_file(const char path[], const char contents[]);
+
 /* Creates empty directory at specified path. */
 void create_empty_dir(const char path[]);
 
@@ -0,0 +1,153 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+#include <stdint.h> /* uint64_t */
+#include <string.h> /* strcmp() */
+
+#include "../../src/io/private/ioeta.h"
+#include "../../src/io/ioeta.h"
+
+static int count_steps(ioeta_estim_t *estim, const char path[],
+		VisitAction action);
+
+static const io_cancellation_t no_cancellation;
+
+TEST(plan_is_estimated_as_traversal)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_plan(estim, TEST_DATA_PATH "/various-sizes");
+
+	assert_int_equal(7, count_steps(estim, TEST_DATA_PATH "/various-sizes",
+				VA_FILE));
+	assert_int_equal(7, estim->total_items);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(0, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(plan_has_steps_of_traversal)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_tree_t *tree;
+	ioeta_step_t *step;
+	int result = -1;
+
+	ioeta_plan(estim, TEST_DATA_PATH "/existing-files");
+
+	tree = ioeta_plan_find(estim, TEST_DATA_PATH "/existing-files");
+	assert_non_null(tree);
+
+	step = ioeta_plan_next(estim, tree, &result);
+	assert_int_equal(VA_DIR_ENTER, step->action);
+	assert_null(step->name);
+
+	step = ioeta_plan_next(estim, tree, &result);
+	assert_int_equal(VA_FILE, step->action);
+	assert_true(strcmp(step->name, "a") == 0 || strcmp(step->name, "b") == 0 ||
+			strcmp(step->name, "c") == 0);
+
+	assert_non_null(ioeta_plan_next(estim, tree, &result));
+	assert_non_null(ioeta_plan_next(estim, tree, &result));
+
+	step = ioeta_plan_next(estim, tree, &result);
+	assert_int_equal(VA_DIR_LEAVE, step->action);
+	assert_null(step->name);
+
+	assert_null(ioeta_plan_next(estim, tree, &result));
+	assert_int_equal(0, result);
+
+	ioeta_plan_drop(estim, tree);
+	ioeta_free(estim);
+}
+
+TEST(steps_of_files_carry_their_sizes)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_tree_t *tree;
+	ioeta_step_t *step;
+	uint64_t size = 0U;
+	int result = -1;
+
+	ioeta_plan(estim, TEST_DATA_PATH "/various-sizes");
+
+	tree = ioeta_plan_find(estim, TEST_DATA_PATH "/various-sizes");
+	assert_non_null(tree);
+
+	while((step = ioeta_plan_next(estim, tree, &result)) != NULL)
+	{
+		size += step->size;
+	}
+	assert_int_equal(0, result);
+	assert_int_equal(73728, size);
+
+	ioeta_plan_drop(estim, tree);
+	ioeta_free(estim);
+}
+
+TEST(preceding_plans_are_dropped_on_lookup)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_plan(estim, TEST_DATA_PATH "/existing-files");
+	ioeta_plan(estim, TEST_DATA_PATH "/various-sizes");
+
+	assert_int_equal(7, count_steps(estim, TEST_DATA_PATH "/various-sizes",
+				VA_FILE));
+	assert_null(ioeta_plan_find(estim, TEST_DATA_PATH "/existing-files"));
+	assert_null(ioeta_plan_find(estim, TEST_DATA_PATH "/various-sizes"));
+
+	ioeta_free(estim);
+}
+
+TEST(unknown_path_has_no_plan)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	assert_null(ioeta_plan_find(estim, TEST_DATA_PATH "/existing-files"));
+	ioeta_plan(estim, TEST_DATA_PATH "/existing-files");
+	assert_null(ioeta_plan_find(estim, TEST_DATA_PATH "/various-sizes"));
+
+	ioeta_free(estim);
+}
+
+TEST(unused_plans_are_freed)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_plan(estim, TEST_DATA_PATH "/existing-files");
+	ioeta_plan(estim, TEST_DATA_PATH "/various-sizes");
+
+	ioeta_free(estim);
+}
+
+/* Follows plan of a tree counting its steps of specified kind.  Returns the
+ * number. */
+static int
+count_steps(ioeta_estim_t *estim, const char path[], VisitAction action)
+{
+	int count = 0;
+	int result = -1;
+	ioeta_step_t *step;
+
+	ioeta_tree_t *const tree = ioeta_plan_find(estim, path);
+	assert_non_null(tree);
+	if(tree == NULL)
+	{
+		return -1;
+	}
+
+	while((step = ioeta_plan_next(estim, tree, &result)) != NULL)
+	{
+		count += (step->action == action);
+		}
+	assert_int_equal(0, result);
+
+	ioeta_plan_drop(estim, tree);
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -6,19 +6,28 @@
 #endif
 #include <sys/stat.h> /* chmod() stat */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* _Exit() lstat() */
+#include <unistd.h> /* _Exit() lstat() symlink() truncate() */
 
 #include <signal.h> /* SIGXFSZ SIG_IGN signal() */
+#include <stdio.h> /* FILE SEEK_SET fclose() fopen() fputs() fseek() fwrite() */
+#include <string.h> /* memset() */
 #include <stdlib.h> /* EXIT_SUCCESS */
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 
 #include "utils.h"
 
 static void file_is_copied(const char original[]);
+static void file_is_copied_by(IoCopyMethod method);
+static void sparse_file_is_copied(int with_data, int clone);
+static uint64_t allocated_size(const char path[]);
+static void large_file_is_copied(int nocache, int direct_io);
+
+static const io_cancellation_t no_cancellation;
 
 TEST(dir_is_not_copied)
 {
@@ -174,6 +183,187 @@ file_is_copied(const char original[])
 	delete_test_file(SANDBOX_PATH "/copy");
 }
 
+TEST(copy_file_range_copies_files)
+{
+	file_is_copied_by(IO_CM_COPY_FILE_RANGE);
+}
+
+TEST(sendfile_copies_files)
+{
+	file_is_copied_by(IO_CM_SENDFILE);
+}
+
+TEST(userspace_loop_copies_files)
+{
+	file_is_copied_by(IO_CM_USERSPACE);
+}
+
+/* Copies a file starting with the specified way of copying and checks the
+ * result along with reported progress. */
+static void
+file_is_copied_by(IoCopyMethod method)
+{
+	const char *const original = TEST_DATA_PATH
+		"/various-sizes/double-block-size-plus-one-file";
+	const uint64_t size = get_file_size(original);
+
+	io_args_t args = {
+		.arg1.src = original,
+		.arg2.dst = SANDBOX_PATH "/copy",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	iop_cp_method = method;
+	assert_success(iop_cp(&args));
+	iop_cp_method = IO_CM_COPY_FILE_RANGE;
+
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_int_equal(1, args.estim->current_item);
+	assert_ulong_equal(size, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/copy", original));
+
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(sparse_file_is_copied_with_holes, IF(not_windows))
+{
+	sparse_file_is_copied(1, 0);
+}
+
+TEST(file_that_is_a_hole_is_copied_as_a_hole, IF(not_windows))
+{
+	sparse_file_is_copied(0, 0);
+}
+
+TEST(cloned_sparse_file_is_reported_as_its_data, IF(not_windows))
+{
+	sparse_file_is_copied(1, 1);
+}
+
+/* Creates 4 MiB file that is a hole possibly with a bit of data in the middle,
+ * copies (or clones if possible) it and checks that holes are preserved and
+ * aren't counted as progress. */
+static void
+sparse_file_is_copied(int with_data, int clone)
+{
+	const uint64_t size = 4*1024*1024;
+	FILE *fp;
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/sparse",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.fast_file_cloning = clone,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	fp = fopen(SANDBOX_PATH "/sparse", "wb");
+	assert_non_null(fp);
+	if(with_data)
+	{
+		assert_success(fseek(fp, size/2, SEEK_SET));
+		fputs("data", fp);
+	}
+	fclose(fp);
+	assert_success(truncate(SANDBOX_PATH "/sparse", size));
+
+	ioeta_calculate(args.estim, SANDBOX_PATH "/sparse", 0);
+
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_ulong_equal(args.estim->total_bytes, args.estim->current_byte);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/sparse",
+				SANDBOX_PATH "/copy"));
+
+	/* Layout can be checked only if file system supports holes. */
+	if(allocated_size(SANDBOX_PATH "/sparse") < size)
+	{
+		assert_true(args.estim->total_bytes < size);
+		assert_true(allocated_size(SANDBOX_PATH "/copy") < size);
+		if(!with_data)
+		{
+			assert_ulong_equal(0, args.estim->total_bytes);
+		}
+	}
+
+	ioeta_free(args.estim);
+	delete_test_file(SANDBOX_PATH "/sparse");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+/* Retrieves amount of disk space occupied by a file.  Returns the size. */
+static uint64_t
+allocated_size(const char path[])
+{
+#ifndef _WIN32
+	struct stat st;
+	assert_success(lstat(path, &st));
+	return (uint64_t)st.st_blocks*512U;
+#else
+	return get_file_size(path);
+#endif
+}
+
+TEST(file_is_copied_without_caching)
+{
+	large_file_is_copied(1, 0);
+}
+
+TEST(file_is_copied_with_direct_io)
+{
+	large_file_is_copied(0, 1);
+}
+
+/* Copies a file that is large enough for direct I/O and whose size isn't
+ * aligned using specified options and checks the result. */
+static void
+large_file_is_copied(int nocache, int direct_io)
+{
+	char block[64*1024];
+	int i;
+	FILE *fp;
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/large",
+		.arg2.dst = SANDBOX_PATH "/copy",
+		.arg4.nocache = nocache,
+		.arg4.direct_io = direct_io,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	fp = fopen(SANDBOX_PATH "/large", "wb");
+	assert_non_null(fp);
+	for(i = 0; i < 16*16; ++i)
+	{
+		memset(block, 'a' + i%26, sizeof(block));
+		assert_int_equal(1, fwrite(block, sizeof(block), 1U, fp));
+	}
+	fputs("tail", fp);
+	fclose(fp);
+
+	iop_cp_method = IO_CM_USERSPACE;
+	assert_success(iop_cp(&args));
+	iop_cp_method = IO_CM_COPY_FILE_RANGE;
+
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_ulong_equal(16*1024*1024 + 4, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(SANDBOX_PATH "/large",
+				SANDBOX_PATH "/copy"));
+
+	delete_test_file(SANDBOX_PATH "/large");
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
 TEST(appending_works_for_files)
 {
 	uint64_t size;
@@ -446,6 +636,35 @@ TEST(fifo_is_copied, IF(not_windows))
 	assert_int_equal(0, args.result.errors.error_count);
 }
 
+TEST(planned_file_that_is_not_regular_anymore_is_examined, IF(not_windows))
+{
+	struct stat st;
+
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/src",
+		.arg2.dst = SANDBOX_PATH "/dst",
+		.arg4.src_mode = S_IFREG | 0644,
+		.arg4.src_size = 1,
+
+		.result.errors = IOE_ERRLST_INIT,
+	};
+
+	assert_success(symlink(TEST_DATA_PATH "/read/two-lines", args.arg1.src));
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_true(is_symlink(args.arg2.dst));
+	delete_test_file(args.arg1.src);
+	delete_test_file(args.arg2.dst);
+
+	assert_success(mkfifo(args.arg1.src, 0755));
+	assert_success(iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_success(lstat(args.arg2.dst, &st));
+	assert_true(S_ISFIFO(st.st_mode));
+	delete_test_file(args.arg1.src);
+	delete_test_file(args.arg2.dst);
+}
+
 static int
 can_create_sockets(void)
 {
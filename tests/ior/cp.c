@@ -2,17 +2,29 @@
 
 #include <sys/stat.h> /* stat chmod() */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* F_OK access() */
+#include <unistd.h> /* F_OK access() geteuid() */
 
+#include <stdio.h> /* FILE fclose() fgets() fopen() snprintf() */
+#include <string.h> /* strlen() */
+
+#include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/utils.h"
+#include "../../src/utils/workers.h"
 
 #include "utils.h"
 
 static int not_windows(void);
+static int not_windows_nor_root(void);
+static void make_tree(const char root[]);
+static void check_tree(const char root[]);
+static void check_file(const char path[], const char contents[]);
+
+static const io_cancellation_t no_cancellation;
 
 TEST(file_is_copied)
 {
@@ -599,11 +611,209 @@ TEST(symlink_to_dir_is_symlink_after_copy, IF(not_windows))
 	}
 }
 
+TEST(tree_is_copied_by_several_threads, IF(not_windows))
+{
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/tree",
+		.arg2.dst = SANDBOX_PATH "/tree-copy",
+		.arg4.nthreads = 4,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_tree(SANDBOX_PATH "/tree");
+	ioeta_calculate(args.estim, SANDBOX_PATH "/tree", 0);
+
+	assert_success(ior_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+	assert_ulong_equal(args.estim->total_bytes, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	check_tree(SANDBOX_PATH "/tree-copy");
+
+	assert_success(chmod(SANDBOX_PATH "/tree/ro", 0700));
+	assert_success(chmod(SANDBOX_PATH "/tree-copy/ro", 0700));
+	delete_tree(SANDBOX_PATH "/tree");
+	delete_tree(SANDBOX_PATH "/tree-copy");
+}
+
+TEST(failure_to_copy_file_by_a_thread_is_reported, IF(not_windows_nor_root))
+{
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/tree",
+		.arg2.dst = SANDBOX_PATH "/tree-copy",
+		.arg4.nthreads = 4,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_tree(SANDBOX_PATH "/tree");
+	assert_success(chmod(SANDBOX_PATH "/tree/sub1/f05", 0000));
+
+	assert_failure(ior_cp(&args));
+	assert_true(args.result.errors.error_count != 0);
+	ioe_errlst_free(&args.result.errors);
+
+	assert_success(chmod(SANDBOX_PATH "/tree/ro", 0700));
+	if(os_access(SANDBOX_PATH "/tree-copy/ro", F_OK) == 0)
+	{
+		assert_success(chmod(SANDBOX_PATH "/tree-copy/ro", 0700));
+	}
+	delete_tree(SANDBOX_PATH "/tree");
+	delete_tree(SANDBOX_PATH "/tree-copy");
+}
+
+TEST(copying_follows_plan_of_estimation, IF(not_windows))
+{
+	int nthreads;
+	for(nthreads = 1; nthreads <= 4; nthreads += 3)
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/tree",
+			.arg2.dst = SANDBOX_PATH "/tree-copy",
+			.arg4.nthreads = nthreads,
+
+			.estim = ioeta_alloc(NULL, no_cancellation),
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		make_tree(SANDBOX_PATH "/tree");
+		ioeta_plan(args.estim, SANDBOX_PATH "/tree");
+
+		assert_success(ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+		assert_int_equal(61, args.estim->total_items);
+		assert_int_equal(61, args.estim->current_item);
+		assert_ulong_equal(args.estim->total_bytes, args.estim->current_byte);
+		ioeta_free(args.estim);
+
+		check_tree(SANDBOX_PATH "/tree-copy");
+
+		assert_success(chmod(SANDBOX_PATH "/tree/ro", 0700));
+		assert_success(chmod(SANDBOX_PATH "/tree-copy/ro", 0700));
+		delete_tree(SANDBOX_PATH "/tree");
+		delete_tree(SANDBOX_PATH "/tree-copy");
+	}
+}
+
+TEST(pool_of_threads_is_reused_by_copies, IF(not_windows))
+{
+	workers_t *workers = NULL;
+	workers_t *first;
+	io_args_t args = {
+		.arg1.src = SANDBOX_PATH "/tree",
+		.arg2.dst = SANDBOX_PATH "/tree-copy1",
+		.arg4.nthreads = 4,
+		.arg4.workers = &workers,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	make_tree(SANDBOX_PATH "/tree");
+
+	assert_success(ior_cp(&args));
+	assert_non_null(workers);
+	first = workers;
+
+	args.arg2.dst = SANDBOX_PATH "/tree-copy2";
+	assert_success(ior_cp(&args));
+	assert_true(workers == first);
+	assert_int_equal(0, args.result.errors.error_count);
+
+	workers_free(workers);
+
+	check_tree(SANDBOX_PATH "/tree-copy1");
+	check_tree(SANDBOX_PATH "/tree-copy2");
+
+	assert_success(chmod(SANDBOX_PATH "/tree/ro", 0700));
+	assert_success(chmod(SANDBOX_PATH "/tree-copy1/ro", 0700));
+	assert_success(chmod(SANDBOX_PATH "/tree-copy2/ro", 0700));
+	delete_tree(SANDBOX_PATH "/tree");
+	delete_tree(SANDBOX_PATH "/tree-copy1");
+	delete_tree(SANDBOX_PATH "/tree-copy2");
+}
+
 static int
 not_windows(void)
 {
 	return get_env_type() != ET_WIN;
 }
 
+static int
+not_windows_nor_root(void)
+{
+#ifndef _WIN32
+	return geteuid() != 0;
+#else
+	return 0;
+#endif
+}
+
+/* Creates directory with several subdirectories full of files, last of which
+ * is read-only. */
+static void
+make_tree(const char root[])
+{
+	char path[PATH_MAX + 1];
+	int i, j;
+
+	create_empty_dir(root);
+	for(i = 0; i < 3; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/sub%d", root, i);
+		create_empty_dir(path);
+		for(j = 0; j < 20; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/sub%d/f%02d", root, i, j);
+			write_file(path, path + strlen(root));
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/ro", root);
+	create_empty_dir(path);
+	snprintf(path, sizeof(path), "%s/ro/file", root);
+	write_file(path, "/ro/file");
+	snprintf(path, sizeof(path), "%s/ro", root);
+	assert_success(chmod(path, 0500));
+}
+
+/* Checks that tree created by make_tree() was copied correctly. */
+static void
+check_tree(const char root[])
+{
+	char path[PATH_MAX + 1];
+	struct stat st;
+	int i, j;
+
+	for(i = 0; i < 3; ++i)
+	{
+		for(j = 0; j < 20; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/sub%d/f%02d", root, i, j);
+			check_file(path, path + strlen(root));
+		}
+	}
+
+	snprintf(path, sizeof(path), "%s/ro/file", root);
+	check_file(path, "/ro/file");
+	snprintf(path, sizeof(path), "%s/ro", root);
+	assert_success(os_stat(path, &st));
+	assert_int_equal(0500, st.st_mode & 0777);
+}
+
+/* Checks that file has expected contents. */
+static void
+check_file(const char path[], const char contents[])
+{
+	char buf[PATH_MAX + 1] = "";
+	FILE *const fp = fopen(path, "r");
+	assert_non_null(fp);
+	if(fp != NULL)
+	{
+		(void)fgets(buf, sizeof(buf), fp);
+		fclose(fp);
+	}
+	assert_string_equal(contents, buf);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -4,7 +4,7 @@
 
 #include <unistd.h> /* F_OK access() */
 
-#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdio.h> /* FILE fclose() fopen() fputs() snprintf() */
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
@@ -67,6 +67,15 @@ create_empty_file(const char file[])
 	assert_success(access(file, F_OK));
 }
 
+void
+write_file(const char path[], const char contents[])
+{
+	FILE *const fp = fopen(path, "w");
+	assert_non_null(fp);
+	fputs(contents, fp);
+	fclose(fp);
+}
+
 void
 clone_file(const char src[], const char dst[])
 {
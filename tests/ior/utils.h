@@ -12,6 +12,8 @@ void create_empty_dir(const char dir[]);
 
 void create_empty_file(const char file[]);
 
+void write_file(const char path[], const char contents[]);
+
 void clone_file(const char src[], const char dst[]);
 
 void delete_file(const char name[]);
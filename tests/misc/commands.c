@@ -12,6 +12,7 @@
 #include "../../src/engine/functions.h"
 #include "../../src/engine/keys.h"
 #include "../../src/modes/modes.h"
+#include "../../src/ui/statusbar.h"
 #include "../../src/ui/ui.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/utils/env.h"
@@ -549,6 +550,33 @@ TEST(find_command, IF(not_windows))
 	opt_handlers_teardown();
 }
 
+TEST(builtin_find_command, IF(not_windows))
+{
+	opt_handlers_setup();
+
+	assert_success(chdir(TEST_DATA_PATH));
+	strcpy(lwin.curr_dir, test_data);
+
+	assert_success(exec_commands("set findprg=", &lwin, CIT_COMMAND));
+
+	assert_success(exec_commands("find a", &lwin, CIT_COMMAND));
+	assert_int_equal(3, lwin.list_rows);
+
+	assert_success(exec_commands("find compare a", &lwin, CIT_COMMAND));
+	assert_int_equal(1, lwin.list_rows);
+	assert_true(lwin.dir_entry[0].type == FT_DIR);
+
+	assert_success(exec_commands("find *.vifm", &lwin, CIT_COMMAND));
+	assert_int_equal(4, lwin.list_rows);
+	assert_true(lwin.dir_entry[0].size != 0);
+
+	ui_sb_msg("");
+	assert_failure(exec_commands("find no-such-file", &lwin, CIT_COMMAND));
+	assert_string_equal("No files found", ui_sb_last());
+
+	opt_handlers_teardown();
+}
+
 TEST(grep_command, IF(not_windows))
 {
 	opt_handlers_setup();
@@ -574,6 +602,22 @@ TEST(grep_command, IF(not_windows))
 	opt_handlers_teardown();
 }
 
+TEST(builtin_grep_command, IF(not_windows))
+{
+	opt_handlers_setup();
+
+	assert_success(chdir(TEST_DATA_PATH "/scripts"));
+	assert_non_null(get_cwd(lwin.curr_dir, sizeof(lwin.curr_dir)));
+
+	assert_success(exec_commands("set grepprg=", &lwin, CIT_COMMAND));
+
+	ui_sb_msg("");
+	assert_failure(exec_commands("grep no-such-line", &lwin, CIT_COMMAND));
+	assert_string_equal("No matches found: no-such-line", ui_sb_last());
+
+	opt_handlers_teardown();
+}
+
 TEST(touch)
 {
 	to_canonic_path(SANDBOX_PATH, cwd, lwin.curr_dir, sizeof(lwin.curr_dir));
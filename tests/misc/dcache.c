@@ -1,16 +1,34 @@
 #include <stic.h>
 
+#include <sys/time.h> /* timeval utimes() */
+#include <unistd.h> /* rmdir() unlink() */
+
 #include <stddef.h> /* NULL */
-#include <string.h> /* memset() strcpy() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcmp() strcpy() */
 #include <time.h> /* time() */
 
 #include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
 #include "../../src/utils/str.h"
 #include "../../src/status.h"
 
 #include "utils.h"
 
+static char dir[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(dir, sizeof(dir), SANDBOX_PATH, "dir", cwd);
+}
+
 SETUP()
 {
 	update_string(&cfg.shell, "");
@@ -69,5 +87,162 @@ TEST(outdated_data_is_detected)
 	assert_false(nitems.is_valid);
 }
 
+TEST(sizes_are_restored_from_file)
+{
+	uint64_t size;
+
+	assert_success(os_mkdir(dir, 0700));
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.vifm_info = VINFO_DCACHE;
+
+	assert_success(dcache_set_at(dir, 10, DCACHE_UNKNOWN));
+	assert_success(dcache_save());
+
+	/* Drop cached values. */
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(dir, &size, NULL);
+	assert_ulong_equal(10, size);
+
+	/* Saving keeps the value. */
+	assert_success(dcache_save());
+	assert_success(stats_reset(&cfg));
+	dcache_get_at(dir, &size, NULL);
+	assert_ulong_equal(10, size);
+
+	cfg.vifm_info = 0;
+	assert_success(unlink(SANDBOX_PATH "/dcache"));
+	assert_success(rmdir(dir));
+}
+
+TEST(sizes_of_changed_directories_are_not_restored)
+{
+	uint64_t size;
+	struct timeval tv[2] = { { .tv_sec = 1 }, { .tv_sec = 1 } };
+
+	assert_success(os_mkdir(dir, 0700));
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.vifm_info = VINFO_DCACHE;
+
+	assert_success(dcache_set_at(dir, 10, DCACHE_UNKNOWN));
+	assert_success(dcache_save());
+	assert_success(stats_reset(&cfg));
+
+	assert_success(utimes(dir, tv));
+	dcache_get_at(dir, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	/* Outdated value isn't saved again. */
+	assert_success(dcache_save());
+	assert_success(stats_reset(&cfg));
+	tv[0].tv_sec = time(NULL);
+	tv[1].tv_sec = time(NULL);
+	assert_success(utimes(dir, tv));
+	dcache_get_at(dir, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	cfg.vifm_info = 0;
+	assert_success(unlink(SANDBOX_PATH "/dcache"));
+	assert_success(rmdir(dir));
+}
+
+TEST(sizes_are_not_restored_if_disabled)
+{
+	uint64_t size;
+
+	assert_success(os_mkdir(dir, 0700));
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+
+	assert_success(dcache_set_at(dir, 10, DCACHE_UNKNOWN));
+	assert_success(dcache_save());
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(dir, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+
+	assert_success(unlink(SANDBOX_PATH "/dcache"));
+	assert_success(rmdir(dir));
+}
+
+TEST(lookups_and_hits_are_counted)
+{
+	uint64_t size;
+	dcache_stats_t before, after;
+
+	dcache_get_stats(&before);
+
+	assert_success(dcache_set_at(TEST_DATA_PATH "/tree", 10, DCACHE_UNKNOWN));
+	dcache_get_at(TEST_DATA_PATH "/tree", &size, NULL);
+	dcache_get_at(TEST_DATA_PATH "/tree/dir1", &size, NULL);
+
+	dcache_get_stats(&after);
+	assert_ulong_equal(2, after.lookups - before.lookups);
+	assert_ulong_equal(1, after.hits - before.hits);
+}
+
+TEST(displayed_stats_reflect_lookups)
+{
+	uint64_t size;
+	char *before, *after, *expected;
+	dcache_stats_t stats;
+
+	before = dcache_format_stats();
+	dcache_get_at(TEST_DATA_PATH "/tree", &size, NULL);
+	after = dcache_format_stats();
+
+	dcache_get_stats(&stats);
+	expected = format_str("Directory cache: %llu lookups, %llu hits, "
+			"%llu contended locks", (unsigned long long)stats.lookups,
+			(unsigned long long)stats.hits, (unsigned long long)stats.contended);
+
+	assert_string_equal(expected, after);
+	assert_true(strcmp(before, after) != 0);
+
+	free(before);
+	free(after);
+	free(expected);
+}
+
+TEST(sizes_are_set_in_batch)
+{
+	uint64_t size;
+	const dcache_size_t sizes[] = {
+		{ .path = TEST_DATA_PATH "/tree", .size = 1 },
+		{ .path = TEST_DATA_PATH "/tree/dir1", .size = 2 },
+		{ .path = TEST_DATA_PATH "/tree/dir1/dir2", .size = 3 },
+		{ .path = TEST_DATA_PATH "/tree/dir5", .size = 4 },
+	};
+
+	assert_success(dcache_set_sizes(sizes, ARRAY_LEN(sizes)));
+
+	dcache_get_at(TEST_DATA_PATH "/tree", &size, NULL);
+	assert_ulong_equal(1, size);
+	dcache_get_at(TEST_DATA_PATH "/tree/dir1", &size, NULL);
+	assert_ulong_equal(2, size);
+	dcache_get_at(TEST_DATA_PATH "/tree/dir1/dir2", &size, NULL);
+	assert_ulong_equal(3, size);
+	dcache_get_at(TEST_DATA_PATH "/tree/dir5", &size, NULL);
+	assert_ulong_equal(4, size);
+}
+
+TEST(known_sizes_of_parents_are_updated)
+{
+	uint64_t size, nitems;
+
+	assert_success(dcache_set_at(TEST_DATA_PATH "/tree", 10, 2));
+	assert_success(dcache_set_at(TEST_DATA_PATH "/tree/dir1", 5,
+				DCACHE_UNKNOWN));
+
+	dcache_update_parent_sizes(TEST_DATA_PATH "/tree/dir1/dir2", 3);
+
+	dcache_get_at(TEST_DATA_PATH "/tree", &size, &nitems);
+	assert_ulong_equal(13, size);
+	assert_ulong_equal(2, nitems);
+	dcache_get_at(TEST_DATA_PATH "/tree/dir1", &size, NULL);
+	assert_ulong_equal(8, size);
+	dcache_get_at(TEST_DATA_PATH, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,377 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* S_ISREG() chmod() */
+#include <unistd.h> /* chdir() rmdir() unlink() usleep() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() strcmp() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_meta.h"
+#include "../../src/sort.h"
+
+#include "utils.h"
+
+/* Number of files enough to trigger loading in background. */
+#define MANY_FILES 4200
+
+static void create_files(int count);
+static void remove_files(int count);
+static void wait_for_meta(void);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+	char *error;
+
+	assert_success(chdir(SANDBOX_PATH));
+
+	update_string(&cfg.slow_fs_list, "");
+
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+
+	filter_init(&view->local_filter.filter, 1);
+	assert_non_null(view->manual_filter = matcher_alloc("", 0, 0, "", &error));
+	filter_init(&view->auto_filter, 1);
+	view->sort[0] = SK_BY_NAME;
+	memset(&view->sort[1], SK_NONE, sizeof(view->sort) - 1);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+}
+
+TEARDOWN()
+{
+	int i;
+
+	flist_meta_drop(view);
+	flist_meta_free_threads();
+	wait_for_bg();
+
+	for(i = 0; i < view->list_rows; i++)
+		free(view->dir_entry[i].name);
+	dynarray_free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+
+	filter_dispose(&view->auto_filter);
+	matcher_free(view->manual_filter);
+	view->manual_filter = NULL;
+	filter_dispose(&view->local_filter.filter);
+
+	update_string(&cfg.slow_fs_list, NULL);
+}
+
+TEST(small_directory_is_loaded_synchronously)
+{
+	create_file("file");
+	assert_success(os_mkdir("dir", 0700));
+
+	populate_dir_list(view, 0);
+	assert_false(flist_meta_loading(view));
+
+	assert_int_equal(2, view->list_rows);
+	assert_string_equal("dir", view->dir_entry[0].name);
+	assert_int_equal(FT_DIR, view->dir_entry[0].type);
+	assert_int_equal(-1, view->dir_entry[0].meta_idx);
+	assert_string_equal("file", view->dir_entry[1].name);
+	assert_int_equal(FT_REG, view->dir_entry[1].type);
+	assert_int_equal(-1, view->dir_entry[1].meta_idx);
+
+	assert_success(unlink("file"));
+	assert_success(rmdir("dir"));
+}
+
+TEST(missing_metadata_is_loaded_on_demand)
+{
+	create_file("file");
+
+	populate_dir_list(view, 0);
+	assert_int_equal(1, view->list_rows);
+
+	fentry_ensure_meta(&view->dir_entry[0], FMETA_MTIME);
+	assert_int_equal(0, view->dir_entry[0].meta_missing & FMETA_MTIME);
+	assert_true(view->dir_entry[0].mtime != 0);
+
+	assert_success(unlink("file"));
+}
+
+TEST(accessors_load_missing_metadata)
+{
+	FILE *fp;
+
+	fp = fopen("file", "w");
+	assert_non_null(fp);
+	fputs("data", fp);
+	fclose(fp);
+
+	populate_dir_list(view, 0);
+	assert_int_equal(1, view->list_rows);
+
+	assert_int_equal(4, fentry_get_raw_size(&view->dir_entry[0]));
+	assert_int_equal(0, view->dir_entry[0].meta_missing & FMETA_SIZE);
+	assert_true(fentry_get_mtime(&view->dir_entry[0]) != 0);
+#ifndef _WIN32
+	assert_true(S_ISREG(fentry_get_mode(&view->dir_entry[0])));
+	assert_int_equal(0, view->dir_entry[0].meta_missing & FMETA_MODE);
+#endif
+
+	assert_success(unlink("file"));
+}
+
+TEST(lazystat_skips_querying_unneeded_metadata, IF(not_windows))
+{
+	cfg.lazy_stat = 1;
+
+	create_file("file");
+	assert_success(os_mkdir("dir", 0700));
+
+	populate_dir_list(view, 0);
+	assert_false(flist_meta_loading(view));
+
+	assert_int_equal(2, view->list_rows);
+	assert_string_equal("dir", view->dir_entry[0].name);
+	assert_int_equal(FT_DIR, view->dir_entry[0].type);
+	assert_int_equal(FMETA_ALL, view->dir_entry[0].meta_missing);
+	assert_string_equal("file", view->dir_entry[1].name);
+	assert_int_equal(FT_REG, view->dir_entry[1].type);
+	assert_int_equal(FMETA_ALL, view->dir_entry[1].meta_missing);
+
+	assert_true(fentry_get_mtime(&view->dir_entry[1]) != 0);
+	assert_int_equal(0, view->dir_entry[1].meta_missing & FMETA_MTIME);
+
+	cfg.lazy_stat = 0;
+
+	assert_success(unlink("file"));
+	assert_success(rmdir("dir"));
+}
+
+TEST(lazystat_loads_metadata_needed_for_sorting)
+{
+	cfg.lazy_stat = 1;
+	view->sort[0] = SK_BY_TIME_MODIFIED;
+
+	create_file("file");
+
+	populate_dir_list(view, 0);
+	assert_int_equal(1, view->list_rows);
+	assert_int_equal(0, view->dir_entry[0].meta_missing & FMETA_MTIME);
+
+	cfg.lazy_stat = 0;
+
+	assert_success(unlink("file"));
+}
+
+TEST(executables_are_detected_when_mode_is_not_needed, IF(not_windows))
+{
+	cfg.lazy_stat = 1;
+	view->sort[0] = SK_BY_TIME_MODIFIED;
+
+	create_file("exec");
+	assert_success(chmod("exec", 0700));
+
+	populate_dir_list(view, 0);
+	assert_int_equal(1, view->list_rows);
+	assert_int_equal(FT_EXEC, view->dir_entry[0].type);
+
+	cfg.lazy_stat = 0;
+
+	assert_success(unlink("exec"));
+}
+
+TEST(sorting_loads_metadata_it_needs)
+{
+	FILE *fp;
+
+	create_file("a");
+	fp = fopen("b", "w");
+	assert_non_null(fp);
+	fputs("data", fp);
+	fclose(fp);
+
+	populate_dir_list(view, 0);
+	assert_int_equal(2, view->list_rows);
+
+	view->sort[0] = -SK_BY_SIZE;
+	sort_view(view);
+	assert_string_equal("b", view->dir_entry[0].name);
+	assert_int_equal(4, view->dir_entry[0].size);
+	assert_int_equal(0, view->dir_entry[0].meta_missing & FMETA_SIZE);
+	assert_string_equal("a", view->dir_entry[1].name);
+
+	assert_success(unlink("a"));
+	assert_success(unlink("b"));
+}
+
+TEST(needed_metadata_depends_on_sorting)
+{
+	assert_int_equal(FMETA_NONE, flist_meta_needed(view));
+
+	view->sort[0] = SK_BY_TIME_ACCESSED;
+	view->sort[1] = -SK_BY_NAME;
+	assert_int_equal(FMETA_ATIME, flist_meta_needed(view));
+
+	view->sort[1] = -SK_BY_SIZE;
+	assert_int_equal(FMETA_ATIME | FMETA_SIZE | FMETA_MTIME,
+			flist_meta_needed(view));
+}
+
+TEST(large_directory_is_loaded_in_background, IF(not_windows))
+{
+	int i;
+
+	view->sort[0] = SK_BY_SIZE;
+	create_files(MANY_FILES);
+
+	populate_dir_list(view, 0);
+	assert_int_equal(MANY_FILES, view->list_rows);
+
+	wait_for_meta();
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		assert_int_equal(-1, view->dir_entry[i].meta_idx);
+	}
+	/* Only the last file has non-zero size, so after re-sorting it should be at
+	 * the bottom. */
+	assert_string_equal("f4199", view->dir_entry[view->list_rows - 1].name);
+	assert_int_equal(4, view->dir_entry[view->list_rows - 1].size);
+
+	remove_files(MANY_FILES);
+}
+
+TEST(parallel_loading_produces_same_list)
+{
+	cfg.stat_threads = 4;
+
+	create_file("file");
+	create_file("file2");
+	assert_success(os_mkdir("dir", 0700));
+
+	populate_dir_list(view, 0);
+	assert_false(flist_meta_loading(view));
+
+	assert_int_equal(3, view->list_rows);
+	assert_string_equal("dir", view->dir_entry[0].name);
+	assert_int_equal(FT_DIR, view->dir_entry[0].type);
+	assert_string_equal("file", view->dir_entry[1].name);
+	assert_int_equal(FT_REG, view->dir_entry[1].type);
+	assert_string_equal("file2", view->dir_entry[2].name);
+	assert_int_equal(FT_REG, view->dir_entry[2].type);
+
+	cfg.stat_threads = 0;
+
+	assert_success(unlink("file"));
+	assert_success(unlink("file2"));
+	assert_success(rmdir("dir"));
+}
+
+TEST(parallel_background_loading_works, IF(not_windows))
+{
+	int i;
+
+	cfg.stat_threads = 4;
+	view->sort[0] = SK_BY_SIZE;
+	create_files(MANY_FILES);
+
+	populate_dir_list(view, 0);
+	wait_for_meta();
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		assert_int_equal(-1, view->dir_entry[i].meta_idx);
+		assert_int_equal(FT_REG, view->dir_entry[i].type);
+	}
+	assert_string_equal("f4199", view->dir_entry[view->list_rows - 1].name);
+	assert_int_equal(4, view->dir_entry[view->list_rows - 1].size);
+
+	cfg.stat_threads = 0;
+	remove_files(MANY_FILES);
+}
+
+TEST(dropping_loader_resets_pending_state, IF(not_windows))
+{
+	int i;
+
+	create_files(MANY_FILES);
+
+	populate_dir_list(view, 0);
+	flist_meta_drop(view);
+	assert_false(flist_meta_loading(view));
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		assert_int_equal(-1, view->dir_entry[i].meta_idx);
+	}
+
+	wait_for_bg();
+	remove_files(MANY_FILES);
+}
+
+/* Creates specified number of empty files named f0, f1, etc.  Last of them
+ * gets some contents. */
+static void
+create_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "f%d", i);
+		create_file(name);
+	}
+
+	{
+		char name[16];
+		FILE *fp;
+		snprintf(name, sizeof(name), "f%d", count - 1);
+		fp = fopen(name, "w");
+		assert_non_null(fp);
+		fputs("data", fp);
+		fclose(fp);
+	}
+}
+
+/* Removes files created by create_files(). */
+static void
+remove_files(int count)
+{
+	int i;
+	for(i = 0; i < count; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "f%d", i);
+		assert_success(unlink(name));
+	}
+}
+
+/* Applies metadata loaded in background until loading is done. */
+static void
+wait_for_meta(void)
+{
+	int counter = 0;
+	while(flist_meta_loading(view))
+	{
+		(void)flist_meta_apply(view);
+		usleep(5000);
+		if(++counter > 1000)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
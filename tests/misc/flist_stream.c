@@ -0,0 +1,259 @@
+#include <stic.h>
+
+#include <unistd.h> /* usleep() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* remove() snprintf() */
+#include <stdlib.h> /* free() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/utils/trie.h"
+#include "../../src/background.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_stream.h"
+
+#include "utils.h"
+
+static char ** read_all(bg_stream_t *stream, int *nlines);
+
+static char test_data[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(test_data, sizeof(test_data), TEST_DATA_PATH,
+			"existing-files", cwd);
+}
+
+SETUP()
+{
+	opt_handlers_setup();
+	update_string(&cfg.shell, "/bin/sh");
+
+	view_setup(&lwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+	copy_str(lwin.curr_dir, sizeof(lwin.curr_dir), test_data);
+}
+
+TEARDOWN()
+{
+	view_teardown(&lwin);
+	update_string(&cfg.shell, NULL);
+	opt_handlers_teardown();
+}
+
+TEST(lines_are_split_on_newlines, IF(not_windows))
+{
+	int nlines;
+	char **lines;
+	bg_stream_t *const stream = bg_stream_start("", "printf 'a\\r\\nb\\n\\nc'",
+			1);
+	assert_non_null(stream);
+
+	lines = read_all(stream, &nlines);
+	assert_int_equal(4, nlines);
+	assert_string_equal("a", lines[0]);
+	assert_string_equal("b", lines[1]);
+	assert_string_equal("", lines[2]);
+	assert_string_equal("c", lines[3]);
+	assert_null(bg_stream_errors(stream));
+
+	free_string_array(lines, nlines);
+	bg_stream_free(stream);
+}
+
+TEST(null_character_is_picked_as_separator, IF(not_windows))
+{
+	int nlines;
+	char **lines;
+	bg_stream_t *const stream = bg_stream_start("",
+			"printf 'a\\nb\\0\\0c\\0'", 1);
+	assert_non_null(stream);
+
+	lines = read_all(stream, &nlines);
+	assert_int_equal(2, nlines);
+	assert_string_equal("a\nb", lines[0]);
+	assert_string_equal("c", lines[1]);
+
+	free_string_array(lines, nlines);
+	bg_stream_free(stream);
+}
+
+TEST(error_stream_is_collected, IF(not_windows))
+{
+	int nlines;
+	char **lines;
+	bg_stream_t *const stream = bg_stream_start("", "echo out; echo err >&2",
+			1);
+	assert_non_null(stream);
+
+	lines = read_all(stream, &nlines);
+	assert_int_equal(1, nlines);
+	assert_string_equal("out", lines[0]);
+	assert_string_equal("err\n", bg_stream_errors(stream));
+
+	free_string_array(lines, nlines);
+	bg_stream_free(stream);
+}
+
+TEST(running_stream_can_be_freed, IF(not_windows))
+{
+	bg_stream_t *const stream = bg_stream_start("", "echo a; sleep 1", 1);
+	assert_non_null(stream);
+	bg_stream_free(stream);
+}
+
+TEST(extending_keeps_list_sorted_and_cursor_in_place)
+{
+	char path[PATH_MAX + 1];
+	char *lines[] = { "c", "a" };
+	trie_t *const seen = trie_create();
+
+	flist_custom_start(&lwin, "test");
+	assert_non_null(flist_custom_add(&lwin, "b"));
+	assert_success(flist_custom_finish(&lwin, CV_REGULAR, 0));
+	get_full_path_of(&lwin.dir_entry[0], sizeof(path), path);
+	assert_success(trie_put(seen, path));
+
+	assert_int_equal(2, flist_custom_extend(&lwin, lines, 2, seen));
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+	assert_int_equal(1, lwin.list_pos);
+
+	/* Paths that were seen are skipped. */
+	assert_int_equal(0, flist_custom_extend(&lwin, lines, 2, seen));
+	assert_int_equal(3, lwin.list_rows);
+
+	trie_free(seen);
+}
+
+TEST(extending_interleaves_new_entries_with_old_ones)
+{
+	char *first[] = { "f", "b", "d" };
+	char *second[] = { "g", "c", "a", "e" };
+	const char *names = "abcdefg";
+	char path[PATH_MAX + 1], cwd[PATH_MAX + 1];
+	trie_t *const seen = trie_create();
+
+	for(; *names != '\0'; ++names)
+	{
+		snprintf(path, sizeof(path), "%s/%c", SANDBOX_PATH, *names);
+		create_file(path);
+	}
+
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(lwin.curr_dir, sizeof(lwin.curr_dir), SANDBOX_PATH, "", cwd);
+	flist_custom_start(&lwin, "test");
+	assert_success(flist_custom_finish(&lwin, CV_REGULAR, 1));
+
+	assert_int_equal(3, flist_custom_extend(&lwin, first, 3, seen));
+	assert_int_equal(4, flist_custom_extend(&lwin, second, 4, seen));
+	assert_int_equal(7, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+	assert_string_equal("d", lwin.dir_entry[3].name);
+	assert_string_equal("e", lwin.dir_entry[4].name);
+	assert_string_equal("f", lwin.dir_entry[5].name);
+	assert_string_equal("g", lwin.dir_entry[6].name);
+
+	trie_free(seen);
+
+	for(names = "abcdefg"; *names != '\0'; ++names)
+	{
+		snprintf(path, sizeof(path), "%s/%c", SANDBOX_PATH, *names);
+		assert_success(remove(path));
+	}
+}
+
+TEST(placeholder_of_empty_list_is_replaced)
+{
+	char *lines[] = { "b", "a" };
+	trie_t *const seen = trie_create();
+
+	flist_custom_start(&lwin, "test");
+	assert_success(flist_custom_finish(&lwin, CV_VERY, 1));
+	assert_int_equal(1, lwin.list_rows);
+	assert_string_equal("..", lwin.dir_entry[0].name);
+
+	assert_int_equal(2, flist_custom_extend(&lwin, lines, 2, seen));
+	assert_int_equal(2, lwin.list_rows);
+	assert_string_equal("b", lwin.dir_entry[0].name);
+	assert_string_equal("a", lwin.dir_entry[1].name);
+
+	trie_free(seen);
+}
+
+TEST(custom_view_is_filled_from_command, IF(not_windows))
+{
+	int i;
+
+	assert_success(flist_stream_start(&lwin, "printf 'c\\nb\\na\\nb\\n'", 0));
+	assert_true(flist_custom_active(&lwin));
+	assert_non_null(lwin.custom.stream);
+
+	for(i = 0; i < 1000 && lwin.custom.stream != NULL; ++i)
+	{
+		flist_stream_check(&lwin);
+		usleep(5000);
+	}
+	assert_null(lwin.custom.stream);
+
+	assert_string_equal("!printf 'c\\nb\\na\\nb\\n'", lwin.custom.title);
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("a", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("c", lwin.dir_entry[2].name);
+}
+
+TEST(leaving_custom_view_stops_filling_it, IF(not_windows))
+{
+	assert_success(flist_stream_start(&lwin, "sleep 1; echo a", 0));
+	assert_non_null(lwin.custom.stream);
+
+	copy_str(lwin.curr_dir, sizeof(lwin.curr_dir), test_data);
+	flist_stream_check(&lwin);
+	assert_null(lwin.custom.stream);
+}
+
+/* Reads stream until it's finished.  Returns all lines read. */
+static char **
+read_all(bg_stream_t *stream, int *nlines)
+{
+	char **all = NULL;
+	int nall = 0;
+	int finished;
+
+	do
+	{
+		int i, n;
+		char **lines;
+
+		finished = bg_stream_finished(stream);
+		lines = bg_stream_fetch(stream, &n);
+		for(i = 0; i < n; ++i)
+		{
+			nall = put_into_string_array(&all, nall, lines[i]);
+		}
+		free(lines);
+
+		usleep(5000);
+	}
+	while(!finished);
+
+	*nlines = nall;
+	return all;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
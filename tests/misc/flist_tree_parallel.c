@@ -0,0 +1,115 @@
+#include <stic.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/filtering.h"
+
+#include "utils.h"
+
+static void check_parallel_build(view_t *view);
+static void load_tree(view_t *view, int nthreads);
+
+static char tree_path[PATH_MAX + 1];
+
+SETUP_ONCE()
+{
+	char cwd[PATH_MAX + 1];
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(tree_path, sizeof(tree_path), TEST_DATA_PATH, "tree", cwd);
+}
+
+SETUP()
+{
+	update_string(&cfg.fuse_home, "no");
+	update_string(&cfg.slow_fs_list, "");
+
+	view_setup(&lwin);
+	curr_view = &lwin;
+	other_view = &lwin;
+}
+
+TEARDOWN()
+{
+	update_string(&cfg.slow_fs_list, NULL);
+	update_string(&cfg.fuse_home, NULL);
+
+	view_teardown(&lwin);
+}
+
+TEST(tree_is_built_in_parallel_in_the_same_way)
+{
+	check_parallel_build(&lwin);
+	assert_int_equal(12, lwin.list_rows);
+}
+
+TEST(parallel_build_accounts_for_dot_filter)
+{
+	lwin.hide_dot = 1;
+	check_parallel_build(&lwin);
+	assert_int_equal(10, lwin.list_rows);
+}
+
+TEST(parallel_build_accounts_for_manual_filter)
+{
+	(void)replace_matcher(&lwin.manual_filter, "^\\.hidden$");
+	check_parallel_build(&lwin);
+	assert_int_equal(11, lwin.list_rows);
+}
+
+TEST(parallel_build_visits_directories_hidden_by_local_filter)
+{
+	(void)filter_set(&lwin.local_filter.filter, "file|dir");
+	check_parallel_build(&lwin);
+	assert_int_equal(10, lwin.list_rows);
+}
+
+/* Builds tree serially and using several threads and checks that results
+ * match. */
+static void
+check_parallel_build(view_t *view)
+{
+	int i;
+	int filtered;
+	dir_entry_t *entries;
+	int nentries;
+
+	load_tree(view, 0);
+	entries = view->dir_entry;
+	nentries = view->list_rows;
+	filtered = view->filtered;
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+
+	load_tree(view, 4);
+
+	assert_int_equal(nentries, view->list_rows);
+	assert_int_equal(filtered, view->filtered);
+	for(i = 0; i < nentries && i < view->list_rows; ++i)
+	{
+		assert_string_equal(entries[i].name, view->dir_entry[i].name);
+		assert_string_equal(entries[i].origin, view->dir_entry[i].origin);
+		assert_int_equal(entries[i].type, view->dir_entry[i].type);
+		assert_int_equal(entries[i].child_count, view->dir_entry[i].child_count);
+		assert_int_equal(entries[i].child_pos, view->dir_entry[i].child_pos);
+	}
+
+	free_dir_entries(view, &entries, &nentries);
+}
+
+/* Loads tree using specified number of threads. */
+static void
+load_tree(view_t *view, int nthreads)
+{
+	cfg.stat_threads = nthreads;
+	assert_success(flist_load_tree(view, tree_path));
+	cfg.stat_threads = 0;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,191 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* chmod() */
+#include <unistd.h> /* chdir() rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memset() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/fswatch.h"
+#include "../../src/utils/matcher.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/flist_meta.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+static int using_inotify(void);
+static void check_for_changes(UiUpdateEvent expected);
+
+static view_t *const view = &lwin;
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+	char *error;
+
+	assert_success(chdir(SANDBOX_PATH));
+
+	update_string(&cfg.slow_fs_list, "");
+	curr_stats.load_stage = 2;
+
+	assert_true(get_cwd(cwd, sizeof(cwd)) == cwd);
+	copy_str(view->curr_dir, sizeof(view->curr_dir), cwd);
+
+	create_file("b");
+	create_file("d");
+
+	filter_init(&view->local_filter.filter, 1);
+	assert_non_null(view->manual_filter = matcher_alloc("", 0, 0, "", &error));
+	filter_init(&view->auto_filter, 1);
+	view->sort[0] = SK_BY_NAME;
+	memset(&view->sort[1], SK_NONE, sizeof(view->sort) - 1);
+	view->hide_dot = 1;
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+	view->list_pos = 0;
+	view->selected_files = 0;
+	view->filtered = 0;
+
+	populate_dir_list(view, 0);
+	assert_int_equal(2, view->list_rows);
+	(void)ui_view_query_scheduled_event(view);
+}
+
+TEARDOWN()
+{
+	int i;
+
+	fswatch_free(view->watch);
+	view->watch = NULL;
+
+	for(i = 0; i < view->list_rows; i++)
+		free(view->dir_entry[i].name);
+	dynarray_free(view->dir_entry);
+	view->dir_entry = NULL;
+	view->list_rows = 0;
+
+	filter_dispose(&view->auto_filter);
+	matcher_free(view->manual_filter);
+	view->manual_filter = NULL;
+	filter_dispose(&view->local_filter.filter);
+
+	view->hide_dot = 0;
+	curr_stats.load_stage = 0;
+	update_string(&cfg.slow_fs_list, NULL);
+
+	(void)unlink("b");
+	(void)unlink("d");
+}
+
+TEST(new_files_are_inserted_in_sorted_order, IF(using_inotify))
+{
+	view->list_pos = 1;
+
+	create_file("c");
+	create_file("a");
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(4, view->list_rows);
+	assert_string_equal("a", view->dir_entry[0].name);
+	assert_string_equal("b", view->dir_entry[1].name);
+	assert_string_equal("c", view->dir_entry[2].name);
+	assert_string_equal("d", view->dir_entry[3].name);
+	assert_int_equal(3, view->list_pos);
+
+	assert_success(unlink("a"));
+	assert_success(unlink("c"));
+}
+
+TEST(removed_files_are_removed, IF(using_inotify))
+{
+	view->dir_entry[0].selected = 1;
+	view->selected_files = 1;
+
+	assert_success(unlink("b"));
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(1, view->list_rows);
+	assert_string_equal("d", view->dir_entry[0].name);
+	assert_int_equal(0, view->selected_files);
+	assert_int_equal(0, view->list_pos);
+}
+
+TEST(changed_files_are_updated, IF(using_inotify))
+{
+	FILE *const fp = fopen("d", "w");
+	fputs("data", fp);
+	fclose(fp);
+	view->sort[0] = SK_BY_SIZE;
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(2, view->list_rows);
+	assert_string_equal("b", view->dir_entry[0].name);
+	assert_string_equal("d", view->dir_entry[1].name);
+	assert_int_equal(4, view->dir_entry[1].size);
+}
+
+TEST(short_lived_files_do_not_appear, IF(using_inotify))
+{
+	create_file("c");
+	assert_success(unlink("c"));
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(2, view->list_rows);
+	assert_int_equal(0, view->filtered);
+}
+
+TEST(filtered_files_are_counted, IF(using_inotify))
+{
+	create_file(".hidden");
+	check_for_changes(UUE_REDRAW);
+	assert_int_equal(2, view->list_rows);
+	assert_int_equal(1, view->filtered);
+
+	assert_success(unlink(".hidden"));
+	check_for_changes(UUE_REDRAW);
+	assert_int_equal(2, view->list_rows);
+	assert_int_equal(0, view->filtered);
+}
+
+TEST(changes_of_directory_itself_cause_reload, IF(using_inotify))
+{
+	assert_success(chmod(".", 0755));
+	check_for_changes(UUE_RELOAD);
+}
+
+TEST(emptied_directory_is_reloaded, IF(using_inotify))
+{
+	assert_success(unlink("b"));
+	assert_success(unlink("d"));
+	check_for_changes(UUE_RELOAD);
+}
+
+/* Checks view for changes and verifies kind of the resulting update. */
+static void
+check_for_changes(UiUpdateEvent expected)
+{
+	check_if_filelist_has_changed(view);
+	assert_int_equal(expected, ui_view_query_scheduled_event(view));
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
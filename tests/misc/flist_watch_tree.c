@@ -0,0 +1,277 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+#include <string.h> /* memset() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/compat/os.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/fswatch.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/filelist.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+static int using_inotify(void);
+static void check_for_changes(UiUpdateEvent expected);
+static void start_watching(void);
+static void validate_tree(const view_t *view);
+static int find_path(const char path[]);
+
+static view_t *const view = &lwin;
+static char sandbox[PATH_MAX + 1];
+
+SETUP()
+{
+	char cwd[PATH_MAX + 1];
+
+	assert_non_null(get_cwd(cwd, sizeof(cwd)));
+	make_abs_path(sandbox, sizeof(sandbox), SANDBOX_PATH, "", cwd);
+
+	update_string(&cfg.slow_fs_list, "");
+	cfg.max_watches = 512;
+
+	view_setup(view);
+
+	assert_success(os_mkdir(SANDBOX_PATH "/a", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/b", 0700));
+	create_file(SANDBOX_PATH "/a/x");
+	create_file(SANDBOX_PATH "/f");
+}
+
+TEARDOWN()
+{
+	fswatch_free(view->watch);
+	view->watch = NULL;
+
+	view_teardown(view);
+
+	cfg.max_watches = 0;
+	update_string(&cfg.slow_fs_list, NULL);
+
+	(void)unlink(SANDBOX_PATH "/f");
+	(void)unlink(SANDBOX_PATH "/a/x");
+	(void)rmdir(SANDBOX_PATH "/a");
+	(void)rmdir(SANDBOX_PATH "/b");
+}
+
+TEST(all_directories_of_tree_are_watched, IF(using_inotify))
+{
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+	assert_int_equal(2, view->extra_watches);
+}
+
+TEST(exceeding_watch_limit_makes_watch_incomplete, IF(using_inotify))
+{
+	cfg.max_watches = 1;
+
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+	assert_int_equal(-1, view->extra_watches);
+
+	create_file(SANDBOX_PATH "/g");
+	check_for_changes(UUE_RELOAD);
+
+	assert_success(unlink(SANDBOX_PATH "/g"));
+}
+
+TEST(file_added_to_subdirectory_is_inserted, IF(using_inotify))
+{
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+
+	create_file(SANDBOX_PATH "/a/y");
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(6, view->list_rows);
+	validate_tree(view);
+	assert_true(find_path("a/y") == find_path("a/x") + 1);
+	assert_int_equal(2, view->dir_entry[find_path("a")].child_count);
+
+	assert_success(unlink(SANDBOX_PATH "/a/y"));
+}
+
+TEST(file_removed_from_subdirectory_is_replaced_by_leaf, IF(using_inotify))
+{
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+
+	assert_success(unlink(SANDBOX_PATH "/a/x"));
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(5, view->list_rows);
+	validate_tree(view);
+	assert_int_equal(-1, find_path("a/x"));
+	assert_int_equal(1, view->dir_entry[find_path("a")].child_count);
+}
+
+TEST(file_added_to_empty_directory_replaces_leaf, IF(using_inotify))
+{
+	int pos;
+
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+
+	create_file(SANDBOX_PATH "/b/z");
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(5, view->list_rows);
+	validate_tree(view);
+	pos = find_path("b");
+	assert_int_equal(1, view->dir_entry[pos].child_count);
+	assert_string_equal("z", view->dir_entry[pos + 1].name);
+
+	assert_success(unlink(SANDBOX_PATH "/b/z"));
+}
+
+TEST(new_directory_is_added_and_watched, IF(using_inotify))
+{
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+
+	assert_success(os_mkdir(SANDBOX_PATH "/c", 0700));
+	create_file(SANDBOX_PATH "/c/w");
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(7, view->list_rows);
+	validate_tree(view);
+	assert_true(find_path("c/w") >= 0);
+	assert_int_equal(3, view->extra_watches);
+
+	create_file(SANDBOX_PATH "/c/v");
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(8, view->list_rows);
+	validate_tree(view);
+	assert_true(find_path("c/v") >= 0);
+
+	assert_success(unlink(SANDBOX_PATH "/c/v"));
+	assert_success(unlink(SANDBOX_PATH "/c/w"));
+	assert_success(rmdir(SANDBOX_PATH "/c"));
+}
+
+TEST(removed_directory_is_removed_with_subtree, IF(using_inotify))
+{
+	assert_success(flist_load_tree(view, sandbox));
+	start_watching();
+
+	view->list_pos = find_path("a/x");
+
+	assert_success(unlink(SANDBOX_PATH "/a/x"));
+	assert_success(rmdir(SANDBOX_PATH "/a"));
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(3, view->list_rows);
+	validate_tree(view);
+	assert_int_equal(-1, find_path("a"));
+	assert_true(view->list_pos >= 0 && view->list_pos < view->list_rows);
+}
+
+TEST(files_of_custom_view_are_updated_and_removed, IF(using_inotify))
+{
+	FILE *fp;
+
+	copy_str(view->curr_dir, sizeof(view->curr_dir), sandbox);
+	flist_custom_start(view, "test");
+	flist_custom_add(view, SANDBOX_PATH "/a/x");
+	flist_custom_add(view, SANDBOX_PATH "/f");
+	assert_success(flist_custom_finish(view, CV_REGULAR, 0));
+	start_watching();
+	assert_int_equal(1, view->extra_watches);
+
+	fp = fopen(SANDBOX_PATH "/a/x", "w");
+	fputs("data", fp);
+	fclose(fp);
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(2, view->list_rows);
+	assert_int_equal(4, view->dir_entry[find_path("a/x")].size);
+
+	assert_success(unlink(SANDBOX_PATH "/f"));
+	check_for_changes(UUE_REDRAW);
+
+	assert_int_equal(1, view->list_rows);
+	assert_string_equal("x", view->dir_entry[0].name);
+}
+
+/* Creates watch for the view that was just loaded. */
+static void
+start_watching(void)
+{
+	(void)ui_view_query_scheduled_event(view);
+	check_for_changes(UUE_NONE);
+	assert_non_null(view->watch);
+}
+
+/* Checks view for changes and verifies kind of the resulting update.  Changes
+ * are applied in place only after startup. */
+static void
+check_for_changes(UiUpdateEvent expected)
+{
+	curr_stats.load_stage = 2;
+	check_if_filelist_has_changed(view);
+	curr_stats.load_stage = 0;
+	assert_int_equal(expected, ui_view_query_scheduled_event(view));
+}
+
+/* Checks consistency of tree structure. */
+static void
+validate_tree(const view_t *view)
+{
+	int i;
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		const dir_entry_t *const e = &view->dir_entry[i];
+		assert_true(i + e->child_count + 1 <= view->list_rows);
+		assert_true(i - e->child_pos >= 0);
+
+		if(e->child_pos != 0)
+		{
+			const int j = i - e->child_pos;
+			const dir_entry_t *const p = &view->dir_entry[j];
+			assert_true(p->child_count >= e->child_pos);
+			assert_true(j + p->child_count >= e->child_pos + e->child_count);
+		}
+	}
+}
+
+/* Looks up entry by path relative to the sandbox.  Returns its position or
+ * -1. */
+static int
+find_path(const char path[])
+{
+	int i;
+	char expected[PATH_MAX + 1];
+	snprintf(expected, sizeof(expected), "%s/%s", sandbox, path);
+
+	for(i = 0; i < view->list_rows; ++i)
+	{
+		char full_path[PATH_MAX + 1];
+		get_full_path_of(&view->dir_entry[i], sizeof(full_path), full_path);
+		if(paths_are_equal(full_path, expected))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int
+using_inotify(void)
+{
+#ifdef HAVE_INOTIFY
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
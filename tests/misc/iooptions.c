@@ -0,0 +1,51 @@
+#include <stic.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/engine/cmds.h"
+#include "../../src/ui/ui.h"
+#include "../../src/cmd_core.h"
+#include "../../src/opt_handlers.h"
+
+#include "utils.h"
+
+SETUP()
+{
+	view_setup(&lwin);
+	view_setup(&rwin);
+
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	init_commands();
+	opt_handlers_setup();
+}
+
+TEARDOWN()
+{
+	opt_handlers_teardown();
+	reset_cmds();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(iooptions)
+{
+	assert_success(exec_commands("set iooptions=nocache,directio", &lwin,
+				CIT_COMMAND));
+	assert_false(cfg.fast_file_cloning);
+	assert_true(cfg.io_nocache);
+	assert_true(cfg.io_direct);
+
+	assert_success(exec_commands("set iooptions=fastfilecloning", &lwin,
+				CIT_COMMAND));
+	assert_true(cfg.fast_file_cloning);
+	assert_false(cfg.io_nocache);
+	assert_false(cfg.io_direct);
+
+	assert_success(exec_commands("set iooptions=", &lwin, CIT_COMMAND));
+	assert_false(cfg.fast_file_cloning);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,95 @@
+#include <stic.h>
+
+#include <unistd.h> /* usleep() */
+
+#include <string.h> /* strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/menus/menus.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/background.h"
+
+#include "utils.h"
+
+static void wait_for_stream(void);
+
+static menu_data_t m;
+
+SETUP()
+{
+	opt_handlers_setup();
+	update_string(&cfg.shell, "/bin/sh");
+
+	menus_init_data(&m, &lwin, strdup("test"), strdup("No matches"));
+}
+
+TEARDOWN()
+{
+	menus_reset_data(&m);
+
+	update_string(&cfg.shell, NULL);
+	opt_handlers_teardown();
+}
+
+TEST(nothing_is_done_without_stream)
+{
+	assert_false(menus_stream_check());
+	assert_int_equal(0, m.len);
+}
+
+TEST(output_is_appended_to_menu, IF(not_windows))
+{
+	cfg.tab_stop = 4;
+
+	m.len = add_to_string_array(&m.items, m.len, 1, "first");
+	m.stream = bg_stream_start("", "printf 'a\\tb\\nc\\n'", 1);
+	assert_non_null(m.stream);
+
+	wait_for_stream();
+
+	assert_int_equal(3, m.len);
+	assert_string_equal("first", m.items[0]);
+	assert_string_equal("a   b", m.items[1]);
+	assert_string_equal("c", m.items[2]);
+
+	cfg.tab_stop = 8;
+}
+
+TEST(search_matches_cover_new_items, IF(not_windows))
+{
+	m.len = add_to_string_array(&m.items, m.len, 1, "a");
+	m.len = add_to_string_array(&m.items, m.len, 1, "b");
+
+	menus_search_reset(m.state, 0, 1);
+	assert_true(menus_search("[ac]", &m, 1));
+	assert_int_equal(1, menus_search_matched(m.state));
+
+	m.stream = bg_stream_start("", "printf 'c\\nd\\na\\n'", 1);
+	assert_non_null(m.stream);
+
+	wait_for_stream();
+
+	assert_int_equal(5, m.len);
+	assert_int_equal(3, menus_search_matched(m.state));
+
+	menus_search_repeat(m.state, 0);
+	assert_int_equal(2, m.pos);
+	menus_search_repeat(m.state, 0);
+	assert_int_equal(4, m.pos);
+}
+
+/* Feeds menu until command finishes. */
+static void
+wait_for_stream(void)
+{
+	while(m.stream != NULL)
+	{
+		(void)menus_stream_check();
+		usleep(5000);
+	}
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
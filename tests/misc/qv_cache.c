@@ -0,0 +1,209 @@
+#include <stic.h>
+
+#include <unistd.h> /* unlink() usleep() */
+
+#include <stdio.h> /* FILE fclose() fgets() fopen() */
+#include <string.h> /* strcmp() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/qv_cache.h"
+#include "../../src/utils/str.h"
+
+#include "utils.h"
+
+#define RUNS SANDBOX_PATH "/runs"
+#define FILE_A SANDBOX_PATH "/a"
+#define FILE_B SANDBOX_PATH "/b"
+
+static FILE * wait_for_preview(const char path[], const char cmd[]);
+static void check_preview(FILE *fp, const char expected[]);
+static int count_runs(void);
+
+SETUP()
+{
+	opt_handlers_setup();
+	update_string(&cfg.shell, "/bin/sh");
+
+	write_file(FILE_A, "a");
+	write_file(FILE_B, "b");
+}
+
+TEARDOWN()
+{
+	qvc_reset();
+
+	assert_success(unlink(FILE_A));
+	assert_success(unlink(FILE_B));
+	(void)unlink(RUNS);
+
+	update_string(&cfg.shell, NULL);
+	opt_handlers_teardown();
+}
+
+TEST(preview_is_loaded_in_background, IF(not_windows))
+{
+	int counter = 0;
+
+	assert_null(qvc_get(FILE_A, "echo preview", SANDBOX_PATH));
+
+	while(!qvc_check())
+	{
+		usleep(5000);
+		if(++counter > 100)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+	assert_false(qvc_check());
+
+	check_preview(qvc_get(FILE_A, "echo preview", SANDBOX_PATH), "preview\n");
+}
+
+TEST(viewer_is_run_in_specified_directory, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "cat a"), "a");
+}
+
+TEST(cached_preview_is_reused, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "echo >> runs; cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "echo >> runs; cat a"), "a");
+	check_preview(qvc_get(FILE_A, "echo >> runs; cat a", SANDBOX_PATH), "a");
+
+	assert_int_equal(1, count_runs());
+}
+
+TEST(different_viewer_is_a_miss, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "echo 1", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "echo 1"), "1\n");
+	assert_null(qvc_get(FILE_A, "echo 2", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "echo 2"), "2\n");
+	check_preview(qvc_get(FILE_A, "echo 1", SANDBOX_PATH), "1\n");
+}
+
+TEST(changed_file_is_a_miss, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "cat a"), "a");
+
+	write_file(FILE_A, "changed");
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "cat a"), "changed");
+}
+
+TEST(changed_file_is_a_miss_after_prefetch, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "cat a"), "a");
+
+	write_file(FILE_A, "changed");
+	qvc_prefetch(FILE_A, "cat a", SANDBOX_PATH);
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "cat a"), "changed");
+}
+
+TEST(prefetch_runs_viewer, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "cat a", SANDBOX_PATH));
+	qvc_prefetch(FILE_B, "echo >> runs; cat b", SANDBOX_PATH);
+	check_preview(wait_for_preview(FILE_A, "cat a"), "a");
+
+	check_preview(wait_for_preview(FILE_B, "echo >> runs; cat b"), "b");
+	assert_int_equal(1, count_runs());
+}
+
+TEST(failure_to_run_viewer_results_in_empty_preview, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "exit 1", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "exit 1"), "");
+}
+
+TEST(reset_drops_previews, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "echo >> runs; cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "echo >> runs; cat a"), "a");
+
+	qvc_reset();
+
+	assert_null(qvc_get(FILE_A, "echo >> runs; cat a", SANDBOX_PATH));
+	check_preview(wait_for_preview(FILE_A, "echo >> runs; cat a"), "a");
+	assert_int_equal(2, count_runs());
+}
+
+TEST(unwanted_viewers_are_stopped, IF(not_windows))
+{
+	assert_null(qvc_get(FILE_A, "exec sleep 10", SANDBOX_PATH));
+	assert_null(qvc_get(FILE_A, "exec sleep 11", SANDBOX_PATH));
+	assert_null(qvc_get(FILE_A, "exec sleep 12", SANDBOX_PATH));
+
+	/* All slots are taken by hanging viewers at this point. */
+	assert_null(qvc_get(FILE_B, "cat b", SANDBOX_PATH));
+	(void)qvc_check();
+	check_preview(wait_for_preview(FILE_B, "cat b"), "b");
+}
+
+/* Waits until preview becomes available.  Returns the preview stream. */
+static FILE *
+wait_for_preview(const char path[], const char cmd[])
+{
+	int counter = 0;
+	FILE *fp;
+
+	while((fp = qvc_get(path, cmd, SANDBOX_PATH)) == NULL)
+	{
+		usleep(5000);
+		if(++counter > 100)
+		{
+			assert_fail("Waiting for too long.");
+			break;
+		}
+	}
+	return fp;
+}
+
+/* Checks that preview stream is present and has expected contents. */
+static void
+check_preview(FILE *fp, const char expected[])
+{
+	char buf[128] = "";
+
+	assert_non_null(fp);
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	if(fgets(buf, sizeof(buf), fp) == NULL)
+	{
+		buf[0] = '\0';
+	}
+	fclose(fp);
+
+	assert_string_equal(expected, buf);
+}
+
+/* Counts how many times viewer was run.  Returns the count. */
+static int
+count_runs(void)
+{
+	char buf[16];
+	int count = 0;
+	FILE *const fp = fopen(RUNS, "r");
+	if(fp == NULL)
+	{
+		return 0;
+	}
+
+	while(fgets(buf, sizeof(buf), fp) != NULL)
+	{
+		++count;
+	}
+	fclose(fp);
+	return count;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -1,6 +1,6 @@
 #include <stic.h>
 
-#include <unistd.h> /* chdir() unlink() */
+#include <unistd.h> /* chdir() symlink() unlink() */
 
 #include <locale.h> /* LC_ALL setlocale() */
 #include <string.h> /* memset() strcpy() */
@@ -9,6 +9,7 @@
 #include "../../src/ui/ui.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/utils/str.h"
+#include "../../src/filelist.h"
 #include "../../src/sort.h"
 #include "../../src/status.h"
 
@@ -51,6 +52,7 @@ SETUP()
 TEARDOWN()
 {
 	update_string(&cfg.shell, NULL);
+	flist_free_link_targets();
 
 	view_teardown(&lwin);
 	view_teardown(&rwin);
@@ -421,6 +423,7 @@ TEST(groups_sorting_works)
 	sort_view(&lwin);
 
 	regfree(&lwin.primary_group);
+	sort_drop_cache(&lwin);
 	update_string(&lwin.sort_groups, NULL);
 
 	assert_string_equal("1-done", lwin.dir_entry[0].name);
@@ -432,8 +435,173 @@ TEST(groups_sorting_works)
 	assert_string_equal("11-todo-publish", lwin.dir_entry[6].name);
 }
 
+TEST(change_of_groups_is_picked_up)
+{
+	view_teardown(&lwin);
+
+	lwin.list_rows = 3;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("c-2-y");
+	lwin.dir_entry[0].type = FT_REG;
+	lwin.dir_entry[1].name = strdup("a-3-x");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[2].name = strdup("b-1-z");
+	lwin.dir_entry[2].type = FT_REG;
+
+	lwin.sort[0] = -SK_BY_GROUPS;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	update_string(&lwin.sort_groups, "-([0-9])-,-(x)$");
+	sort_view(&lwin);
+	assert_string_equal("a-3-x", lwin.dir_entry[0].name);
+	assert_string_equal("c-2-y", lwin.dir_entry[1].name);
+	assert_string_equal("b-1-z", lwin.dir_entry[2].name);
+
+	update_string(&lwin.sort_groups, "-(.)$");
+	sort_view(&lwin);
+	assert_string_equal("b-1-z", lwin.dir_entry[0].name);
+	assert_string_equal("c-2-y", lwin.dir_entry[1].name);
+	assert_string_equal("a-3-x", lwin.dir_entry[2].name);
+
+	sort_drop_cache(&lwin);
+	update_string(&lwin.sort_groups, NULL);
+}
+
+TEST(multiple_keys_are_applied_in_order_of_priority)
+{
+	view_teardown(&lwin);
+
+	lwin.list_rows = 4;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("b.txt");
+	lwin.dir_entry[0].type = FT_REG;
+	lwin.dir_entry[0].size = 1;
+	lwin.dir_entry[1].name = strdup("a.c");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[1].size = 5;
+	lwin.dir_entry[2].name = strdup("d.txt");
+	lwin.dir_entry[2].type = FT_REG;
+	lwin.dir_entry[2].size = 3;
+	lwin.dir_entry[3].name = strdup("c.txt");
+	lwin.dir_entry[3].type = FT_REG;
+	lwin.dir_entry[3].size = 3;
+
+	lwin.sort[0] = SK_BY_EXTENSION;
+	lwin.sort[1] = -SK_BY_SIZE;
+	memset(&lwin.sort[2], SK_NONE, sizeof(lwin.sort) - 2);
+
+	sort_view(&lwin);
+
+	/* Order of d.txt and c.txt is preserved. */
+	assert_string_equal("a.c", lwin.dir_entry[0].name);
+	assert_string_equal("d.txt", lwin.dir_entry[1].name);
+	assert_string_equal("c.txt", lwin.dir_entry[2].name);
+	assert_string_equal("b.txt", lwin.dir_entry[3].name);
+}
+
+TEST(parent_dir_stays_first_in_descending_order)
+{
+	view_teardown(&lwin);
+
+	lwin.list_rows = 4;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("a");
+	lwin.dir_entry[0].type = FT_DIR;
+	lwin.dir_entry[1].name = strdup("file");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[2].name = strdup("..");
+	lwin.dir_entry[2].type = FT_DIR;
+	lwin.dir_entry[3].name = strdup("b");
+	lwin.dir_entry[3].type = FT_DIR;
+
+	lwin.sort[0] = -SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	sort_view(&lwin);
+
+	assert_string_equal("..", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+	assert_string_equal("file", lwin.dir_entry[3].name);
+}
+
 #ifndef _WIN32
 
+TEST(target_sorting_works)
+{
+	view_teardown(&lwin);
+
+	assert_success(symlink("z", SANDBOX_PATH "/a"));
+	assert_success(symlink("y", SANDBOX_PATH "/b"));
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	lwin.list_rows = 3;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("a");
+	lwin.dir_entry[0].type = FT_LINK;
+	lwin.dir_entry[0].origin = lwin.curr_dir;
+	lwin.dir_entry[1].name = strdup("file");
+	lwin.dir_entry[1].type = FT_REG;
+	lwin.dir_entry[1].origin = lwin.curr_dir;
+	lwin.dir_entry[2].name = strdup("b");
+	lwin.dir_entry[2].type = FT_LINK;
+	lwin.dir_entry[2].origin = lwin.curr_dir;
+
+	lwin.sort[0] = SK_BY_TARGET;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+
+	sort_view(&lwin);
+
+	assert_string_equal("file", lwin.dir_entry[0].name);
+	assert_string_equal("b", lwin.dir_entry[1].name);
+	assert_string_equal("a", lwin.dir_entry[2].name);
+
+	assert_success(unlink(SANDBOX_PATH "/a"));
+	assert_success(unlink(SANDBOX_PATH "/b"));
+}
+
+TEST(link_target_is_reread_when_link_changes)
+{
+	dir_entry_t entry = {
+		.name = "link", .origin = SANDBOX_PATH, .type = FT_LINK, .mtime = 1,
+	};
+
+	assert_success(symlink("x", SANDBOX_PATH "/link"));
+	assert_string_equal("x", fentry_get_target(&entry));
+
+	assert_success(unlink(SANDBOX_PATH "/link"));
+	assert_success(symlink("y", SANDBOX_PATH "/link"));
+	assert_string_equal("x", fentry_get_target(&entry));
+
+	entry.mtime = 2;
+	assert_string_equal("y", fentry_get_target(&entry));
+
+	assert_success(unlink(SANDBOX_PATH "/link"));
+	entry.mtime = 3;
+	assert_null(fentry_get_target(&entry));
+}
+
+TEST(freeing_link_targets_causes_rereading)
+{
+	dir_entry_t entry = {
+		.name = "link", .origin = SANDBOX_PATH, .type = FT_LINK, .mtime = 1,
+	};
+
+	assert_success(symlink("x", SANDBOX_PATH "/link"));
+	assert_string_equal("x", fentry_get_target(&entry));
+
+	assert_success(unlink(SANDBOX_PATH "/link"));
+	assert_success(symlink("y", SANDBOX_PATH "/link"));
+	flist_free_link_targets();
+	assert_string_equal("y", fentry_get_target(&entry));
+
+	assert_success(unlink(SANDBOX_PATH "/link"));
+}
+
 TEST(inode_sorting_works)
 {
 	view_teardown(&lwin);
@@ -0,0 +1,124 @@
+#include <stic.h>
+
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcpy() memset() strcmp() strcpy() strdup() */
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/str.h"
+#include "../../src/sort.h"
+#include "../../src/status.h"
+
+#include "utils.h"
+
+/* Enough entries to be split among four threads. */
+#define NENTRIES (4*16384 + 3)
+
+static void check_parallel_sort(view_t *view);
+
+SETUP()
+{
+	int i;
+
+	update_string(&cfg.shell, "");
+	assert_success(stats_init(&cfg));
+
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	lwin.list_rows = NENTRIES;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	for(i = 0; i < NENTRIES; ++i)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "f%06d", NENTRIES - i);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].origin = lwin.curr_dir;
+		lwin.dir_entry[i].type = (i%5 == 0) ? FT_DIR : FT_REG;
+		lwin.dir_entry[i].size = i%7;
+		lwin.dir_entry[i].mtime = i%3;
+	}
+}
+
+TEARDOWN()
+{
+	cfg.sort_threads = 0;
+	view_teardown(&lwin);
+	update_string(&cfg.shell, NULL);
+}
+
+TEST(parallel_sort_is_stable)
+{
+	lwin.sort[0] = SK_BY_SIZE;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	check_parallel_sort(&lwin);
+}
+
+TEST(parallel_sort_by_several_keys_works)
+{
+	lwin.sort[0] = -SK_BY_TIME_MODIFIED;
+	lwin.sort[1] = SK_BY_SIZE;
+	lwin.sort[2] = -SK_BY_NAME;
+	memset(&lwin.sort[3], SK_NONE, sizeof(lwin.sort) - 3);
+	check_parallel_sort(&lwin);
+}
+
+TEST(many_threads_sort_list_correctly)
+{
+	int i;
+
+	cfg.sort_threads = 64;
+	lwin.sort[0] = SK_BY_NAME;
+	memset(&lwin.sort[1], SK_NONE, sizeof(lwin.sort) - 1);
+	sort_view(&lwin);
+
+	for(i = 1; i < NENTRIES; ++i)
+	{
+		const dir_entry_t *const prev = &lwin.dir_entry[i - 1];
+		const dir_entry_t *const curr = &lwin.dir_entry[i];
+		if(prev->type == curr->type ? strcmp(prev->name, curr->name) > 0
+		                            : prev->type != FT_DIR)
+		{
+			break;
+		}
+	}
+	assert_int_equal(NENTRIES, i);
+}
+
+/* Sorts entries of the view serially and using several threads starting with
+ * the same order and checks that results match. */
+static void
+check_parallel_sort(view_t *view)
+{
+	int i;
+	char **const names = malloc(NENTRIES*sizeof(*names));
+	dir_entry_t *const unsorted = malloc(NENTRIES*sizeof(*unsorted));
+	memcpy(unsorted, view->dir_entry, NENTRIES*sizeof(*unsorted));
+
+	cfg.sort_threads = 1;
+	sort_view(view);
+	for(i = 0; i < NENTRIES; ++i)
+	{
+		names[i] = view->dir_entry[i].name;
+	}
+
+	memcpy(view->dir_entry, unsorted, NENTRIES*sizeof(*unsorted));
+	cfg.sort_threads = 4;
+	sort_view(view);
+
+	for(i = 0; i < NENTRIES; ++i)
+	{
+		if(view->dir_entry[i].name != names[i])
+		{
+			assert_string_equal(names[i], view->dir_entry[i].name);
+			break;
+		}
+	}
+
+	free(unsorted);
+	free(names);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -5,7 +5,7 @@
 
 #include <locale.h> /* LC_ALL setlocale() */
 #include <stddef.h> /* NULL */
-#include <stdio.h> /* FILE fclose() fopen() fread() */
+#include <stdio.h> /* FILE fclose() fopen() fputs() fread() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* memset() strcpy() strdup() */
 
@@ -184,6 +184,15 @@ create_file(const char path[])
 	}
 }
 
+void
+write_file(const char path[], const char contents[])
+{
+	FILE *const fp = fopen(path, "w");
+	assert_non_null(fp);
+	fputs(contents, fp);
+	fclose(fp);
+}
+
 void
 create_executable(const char path[])
 {
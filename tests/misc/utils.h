@@ -45,6 +45,9 @@ void view_teardown(struct view_t *view);
 /* Creates file at the path. */
 void create_file(const char path[]);
 
+/* Creates file at the path with the contents. */
+void write_file(const char path[], const char contents[]);
+
 /* Creates executable file at the path. */
 void create_executable(const char path[]);
 
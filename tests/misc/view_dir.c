@@ -1,16 +1,21 @@
 #include <stic.h>
 
-#include <unistd.h> /* rmdir() symlink() */
+#include <unistd.h> /* rmdir() symlink() usleep() */
 
 #include <stdio.h> /* remove() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strlen() */
 
 #include "../../src/compat/os.h"
 #include "../../src/ui/quickview.h"
 #include "../../src/utils/fs.h"
+#include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 
 #include "utils.h"
 
+static char * wait_for_totals(const char path[], int height);
+
 static char *saved_cwd;
 
 SETUP()
@@ -33,13 +38,13 @@ TEST(file_can_not_be_viewed)
 TEST(empty_dir_produces_single_line_and_dirs_have_trailing_slash)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("empty-dir", 0777));
 
-	fp = qv_view_dir("empty-dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("empty-dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(3, nlines);
 	assert_string_equal("empty-dir/", lines[0]);
@@ -47,7 +52,7 @@ TEST(empty_dir_produces_single_line_and_dirs_have_trailing_slash)
 	assert_string_equal("0 directories, 0 files", lines[2]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(rmdir("empty-dir"));
 }
@@ -55,14 +60,14 @@ TEST(empty_dir_produces_single_line_and_dirs_have_trailing_slash)
 TEST(single_file_is_displayed_correctly_file_without_slash)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("dir", 0777));
 	create_file("dir/file");
 
-	fp = qv_view_dir("dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(4, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -71,7 +76,7 @@ TEST(single_file_is_displayed_correctly_file_without_slash)
 	assert_string_equal("0 directories, 1 file", lines[3]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(remove("dir/file"));
 	assert_success(rmdir("dir"));
@@ -80,14 +85,14 @@ TEST(single_file_is_displayed_correctly_file_without_slash)
 TEST(single_subdir_is_displayed_correctly)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("dir", 0777));
 	assert_success(os_mkdir("dir/nested", 0777));
 
-	fp = qv_view_dir("dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(4, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -96,7 +101,7 @@ TEST(single_subdir_is_displayed_correctly)
 	assert_string_equal("1 directory, 0 files", lines[3]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(rmdir("dir/nested"));
 	assert_success(rmdir("dir"));
@@ -105,15 +110,15 @@ TEST(single_subdir_is_displayed_correctly)
 TEST(multiple_nested_dirs_treated_correctly)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("dir", 0777));
 	assert_success(os_mkdir("dir/nested1", 0777));
 	assert_success(os_mkdir("dir/nested1/nested2", 0777));
 
-	fp = qv_view_dir("dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(5, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -123,7 +128,7 @@ TEST(multiple_nested_dirs_treated_correctly)
 	assert_string_equal("2 directories, 0 files", lines[4]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(rmdir("dir/nested1/nested2"));
 	assert_success(rmdir("dir/nested1"));
@@ -133,15 +138,15 @@ TEST(multiple_nested_dirs_treated_correctly)
 TEST(multiple_files_treated_correctly)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("dir", 0777));
 	create_file("dir/file1");
 	create_file("dir/file2");
 
-	fp = qv_view_dir("dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(5, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -151,7 +156,7 @@ TEST(multiple_files_treated_correctly)
 	assert_string_equal("0 directories, 2 files", lines[4]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(remove("dir/file2"));
 	assert_success(remove("dir/file1"));
@@ -161,7 +166,7 @@ TEST(multiple_files_treated_correctly)
 TEST(multiple_non_empty_dirs_have_correct_prefixes_plus_sorting)
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	assert_success(os_mkdir("dir", 0777));
@@ -170,8 +175,8 @@ TEST(multiple_non_empty_dirs_have_correct_prefixes_plus_sorting)
 	create_file("dir/sub1/file");
 	create_file("dir/sub2/file");
 
-	fp = qv_view_dir("dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir("dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(7, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -183,7 +188,7 @@ TEST(multiple_non_empty_dirs_have_correct_prefixes_plus_sorting)
 	assert_string_equal("2 directories, 2 files", lines[6]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(remove("dir/sub1/file"));
 	assert_success(remove("dir/sub2/file"));
@@ -195,7 +200,7 @@ TEST(multiple_non_empty_dirs_have_correct_prefixes_plus_sorting)
 TEST(symlinks_are_not_resolved_in_tree_preview, IF(not_windows))
 {
 	int nlines;
-	FILE *fp;
+	char *text;
 	char **lines;
 
 	restore_cwd(saved_cwd);
@@ -208,8 +213,8 @@ TEST(symlinks_are_not_resolved_in_tree_preview, IF(not_windows))
 	assert_success(symlink(".", SANDBOX_PATH "/dir/link"));
 #endif
 
-	fp = qv_view_dir(SANDBOX_PATH "/dir");
-	lines = read_file_lines(fp, &nlines);
+	text = qv_view_dir(SANDBOX_PATH "/dir");
+	lines = break_into_lines(text, strlen(text), &nlines, 0);
 
 	assert_int_equal(4, nlines);
 	assert_string_equal("dir/", lines[0]);
@@ -218,11 +223,72 @@ TEST(symlinks_are_not_resolved_in_tree_preview, IF(not_windows))
 	assert_string_equal("1 directory, 0 files", lines[3]);
 
 	free_string_array(lines, nlines);
-	fclose(fp);
+	free(text);
 
 	assert_success(unlink(SANDBOX_PATH "/dir/link"));
 	assert_success(rmdir(SANDBOX_PATH "/dir"));
 }
 
+TEST(truncated_tree_preview_gets_totals_in_background)
+{
+	char *text = get_dir_preview(TEST_DATA_PATH "/tree", 4);
+	assert_string_equal("tree/\n|-- .hidden\n\n(counting...)", text);
+	free(text);
+
+	text = wait_for_totals(TEST_DATA_PATH "/tree", 4);
+	assert_string_equal("tree/\n|-- .hidden\n\n5 directories, 7 files", text);
+	free(text);
+}
+
+TEST(directory_preview_is_cached)
+{
+	char *text;
+
+	assert_success(os_mkdir(SANDBOX_PATH "/top", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/top/dir", 0700));
+
+	text = get_dir_preview(SANDBOX_PATH "/top", 10);
+	assert_string_equal("top/\n`-- dir/\n\n1 directory, 0 files", text);
+	free(text);
+
+	/* This doesn't change modification time of the root. */
+	create_file(SANDBOX_PATH "/top/dir/file");
+
+	text = get_dir_preview(SANDBOX_PATH "/top", 10);
+	assert_string_equal("top/\n`-- dir/\n\n1 directory, 0 files", text);
+	free(text);
+
+	/* Different height is a miss. */
+	text = get_dir_preview(SANDBOX_PATH "/top", 11);
+	assert_string_equal("top/\n`-- dir/\n    `-- file\n\n1 directory, 1 file",
+			text);
+	free(text);
+
+	assert_success(unlink(SANDBOX_PATH "/top/dir/file"));
+	assert_success(rmdir(SANDBOX_PATH "/top/dir"));
+	assert_success(rmdir(SANDBOX_PATH "/top"));
+}
+
+/* Retrieves preview of the directory after totals of its tree are counted.
+ * Returns the preview. */
+static char *
+wait_for_totals(const char path[], int height)
+{
+	int counter = 0;
+	char *text;
+
+	while(ends_with(text = get_dir_preview(path, height), "(counting...)"))
+	{
+		free(text);
+		usleep(5000);
+		if(++counter > 100)
+		{
+			assert_fail("Waiting for too long.");
+			return NULL;
+		}
+	}
+	return text;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
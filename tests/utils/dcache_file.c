@@ -0,0 +1,104 @@
+#include <stic.h>
+
+#include <unistd.h> /* unlink() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+
+#include "../../src/utils/dcache_file.h"
+
+#define FILE_PATH SANDBOX_PATH "/dcache"
+
+TEST(missing_file_is_not_opened)
+{
+	assert_null(dcache_file_open(FILE_PATH));
+}
+
+TEST(file_of_wrong_format_is_not_opened)
+{
+	FILE *const fp = fopen(FILE_PATH, "w");
+	fputs("vifminfo\n", fp);
+	fclose(fp);
+
+	assert_null(dcache_file_open(FILE_PATH));
+
+	assert_success(unlink(FILE_PATH));
+}
+
+TEST(empty_list_is_written_and_read)
+{
+	dcache_file_t *file;
+
+	assert_success(dcache_file_write(FILE_PATH, NULL, 0));
+
+	file = dcache_file_open(FILE_PATH);
+	assert_non_null(file);
+	assert_int_equal(0, dcache_file_count(file));
+	dcache_file_close(file);
+
+	assert_success(unlink(FILE_PATH));
+}
+
+TEST(records_are_sorted_and_found)
+{
+	dcache_rec_t rec;
+	dcache_file_t *file;
+	dcache_file_entry_t entries[] = {
+		{ .path = "/b", .rec = { .size = 2, .timestamp = 20, .mtime = 200 } },
+		{ .path = "/a/b", .rec = { .size = 3, .inode = 3000 } },
+		{ .path = "/a", .rec = { .size = 1, .timestamp = 10, .inode = 1000 } },
+	};
+
+	assert_success(dcache_file_write(FILE_PATH, entries, 3));
+
+	file = dcache_file_open(FILE_PATH);
+	assert_non_null(file);
+	assert_int_equal(3, dcache_file_count(file));
+
+	assert_string_equal("/a", dcache_file_get(file, 0, &rec));
+	assert_ulong_equal(1, rec.size);
+	assert_string_equal("/a/b", dcache_file_get(file, 1, &rec));
+	assert_ulong_equal(3, rec.size);
+	assert_string_equal("/b", dcache_file_get(file, 2, &rec));
+	assert_ulong_equal(2, rec.size);
+
+	assert_success(dcache_file_find(file, "/b", &rec));
+	assert_ulong_equal(2, rec.size);
+	assert_ulong_equal(20, rec.timestamp);
+	assert_ulong_equal(200, rec.mtime);
+	assert_success(dcache_file_find(file, "/a", &rec));
+	assert_ulong_equal(1000, rec.inode);
+	assert_failure(dcache_file_find(file, "/c", &rec));
+	assert_failure(dcache_file_find(file, "/", &rec));
+
+	dcache_file_close(file);
+
+	assert_success(unlink(FILE_PATH));
+}
+
+TEST(lower_bound_points_at_first_record_of_a_subtree)
+{
+	dcache_file_t *file;
+	dcache_file_entry_t entries[] = {
+		{ .path = "/a" }, { .path = "/a-b" }, { .path = "/a/b" },
+		{ .path = "/a/c" }, { .path = "/b" },
+	};
+
+	assert_success(dcache_file_write(FILE_PATH, entries, 5));
+
+	file = dcache_file_open(FILE_PATH);
+	assert_non_null(file);
+
+	assert_int_equal(0, dcache_file_lower_bound(file, "/"));
+	assert_int_equal(0, dcache_file_lower_bound(file, "/a"));
+	assert_int_equal(2, dcache_file_lower_bound(file, "/a/"));
+	assert_int_equal(4, dcache_file_lower_bound(file, "/a/d"));
+	assert_int_equal(5, dcache_file_lower_bound(file, "/c"));
+
+	dcache_file_close(file);
+
+	assert_success(unlink(FILE_PATH));
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,209 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stddef.h> /* NULL */
+#include <stdlib.h> /* qsort() */
+#include <string.h> /* strcmp() strdup() strstr() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/cancellation.h"
+#include "../../src/utils/find.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/utils/str.h"
+
+#include "utils.h"
+
+static void run_find(char *targets[], int ntargets, int nthreads);
+static int skip_ignored(const char path[], int is_dir, void *arg);
+static int match_all(const char path[], const struct stat *st, void *arg);
+static int match_c(const char path[], const struct stat *st, void *arg);
+static void on_found(const char path[], const struct stat *st, void *arg);
+static void on_error(char msg[], void *arg);
+static int sort_cmp(const void *a, const void *b);
+
+static char **found;
+static int nfound;
+static char **errors;
+static int nerrors;
+static long long total_size;
+static find_filter_func filter;
+static find_match_func match;
+
+SETUP()
+{
+	write_file(SANDBOX_PATH "/a", "aaa");
+	write_file(SANDBOX_PATH "/b", "b");
+	assert_success(os_mkdir(SANDBOX_PATH "/sub", 0700));
+	write_file(SANDBOX_PATH "/sub/c", "cc");
+	assert_success(os_mkdir(SANDBOX_PATH "/ignored", 0700));
+	write_file(SANDBOX_PATH "/ignored/c", "c");
+
+	filter = NULL;
+	match = &match_all;
+	total_size = 0;
+}
+
+TEARDOWN()
+{
+	assert_success(unlink(SANDBOX_PATH "/ignored/c"));
+	assert_success(rmdir(SANDBOX_PATH "/ignored"));
+	assert_success(unlink(SANDBOX_PATH "/sub/c"));
+	assert_success(rmdir(SANDBOX_PATH "/sub"));
+	assert_success(unlink(SANDBOX_PATH "/b"));
+	assert_success(unlink(SANDBOX_PATH "/a"));
+
+	free_string_array(found, nfound);
+	found = NULL;
+	nfound = 0;
+	free_string_array(errors, nerrors);
+	errors = NULL;
+	nerrors = 0;
+}
+
+TEST(files_and_directories_are_found)
+{
+	char *targets[] = { "." };
+	run_find(targets, 1, 1);
+
+	assert_int_equal(6, nfound);
+	assert_string_equal(SANDBOX_PATH "/a", found[0]);
+	assert_string_equal(SANDBOX_PATH "/b", found[1]);
+	assert_string_equal(SANDBOX_PATH "/ignored", found[2]);
+	assert_string_equal(SANDBOX_PATH "/ignored/c", found[3]);
+	assert_string_equal(SANDBOX_PATH "/sub", found[4]);
+	assert_string_equal(SANDBOX_PATH "/sub/c", found[5]);
+	assert_int_equal(0, nerrors);
+}
+
+TEST(matcher_picks_files)
+{
+	char *targets[] = { "." };
+	match = &match_c;
+	run_find(targets, 1, 1);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/ignored/c", found[0]);
+	assert_string_equal(SANDBOX_PATH "/sub/c", found[1]);
+}
+
+TEST(filter_prunes_subtrees)
+{
+	char *targets[] = { "." };
+	filter = &skip_ignored;
+	match = &match_c;
+	run_find(targets, 1, 1);
+
+	assert_int_equal(1, nfound);
+	assert_string_equal(SANDBOX_PATH "/sub/c", found[0]);
+}
+
+TEST(results_do_not_depend_on_number_of_threads)
+{
+	char *targets[] = { "." };
+	run_find(targets, 1, 4);
+
+	assert_int_equal(6, nfound);
+	assert_string_equal(SANDBOX_PATH "/a", found[0]);
+	assert_string_equal(SANDBOX_PATH "/sub/c", found[5]);
+}
+
+TEST(stat_information_is_reported)
+{
+	char *targets[] = { "a", "sub" };
+	match = &match_c;
+	run_find(targets, 2, 1);
+
+	assert_int_equal(1, nfound);
+	assert_int_equal(2, total_size);
+}
+
+TEST(file_targets_are_matched_themselves)
+{
+	char *targets[] = { "a", "sub/c" };
+	run_find(targets, 2, 1);
+
+	assert_int_equal(2, nfound);
+	assert_string_equal(SANDBOX_PATH "/a", found[0]);
+	assert_string_equal(SANDBOX_PATH "/sub/c", found[1]);
+	assert_int_equal(5, total_size);
+}
+
+TEST(missing_targets_are_reported)
+{
+	char *targets[] = { "missing" };
+	run_find(targets, 1, 1);
+
+	assert_int_equal(0, nfound);
+	assert_int_equal(1, nerrors);
+	assert_non_null(strstr(errors[0], "missing: "));
+}
+
+/* Searches sandbox collecting sorted results. */
+static void
+run_find(char *targets[], int ntargets, int nthreads)
+{
+	const find_params_t params = {
+		.nthreads = nthreads,
+		.dir = SANDBOX_PATH,
+		.filter = filter,
+		.match = match,
+		.on_found = &on_found,
+		.on_error = &on_error,
+		.cancellation = &no_cancellation,
+	};
+
+	assert_success(find_files(targets, ntargets, &params));
+	qsort(found, nfound, sizeof(*found), &sort_cmp);
+}
+
+/* Filter that rejects "ignored" directory.  Returns non-zero for other
+ * entries. */
+static int
+skip_ignored(const char path[], int is_dir, void *arg)
+{
+	return !(is_dir && ends_with(path, "/ignored"));
+}
+
+/* Matcher that accepts everything.  Returns non-zero. */
+static int
+match_all(const char path[], const struct stat *st, void *arg)
+{
+	return 1;
+}
+
+/* Matcher that accepts files named "c".  Returns non-zero for them. */
+static int
+match_c(const char path[], const struct stat *st, void *arg)
+{
+	return ends_with(path, "/c");
+}
+
+/* Collects found files and their sizes. */
+static void
+on_found(const char path[], const struct stat *st, void *arg)
+{
+	nfound = add_to_string_array(&found, nfound, 1, path);
+	if(!S_ISDIR(st->st_mode))
+	{
+		total_size += st->st_size;
+	}
+}
+
+/* Collects errors. */
+static void
+on_error(char msg[], void *arg)
+{
+	nerrors = put_into_string_array(&errors, nerrors, msg);
+}
+
+/* qsort() comparer of strings.  Returns standard -1, 0, 1 for comparisons. */
+static int
+sort_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -1,13 +1,19 @@
 #include <stic.h>
 
-#include <stdio.h> /* remove() snprintf() */
+#include <stdio.h> /* FILE fclose() fopen() remove() snprintf() */
+#include <string.h> /* strlen() */
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
 #include "../../src/utils/fswatch.h"
 #include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
 
+static void collect_change(FSWatchChange change, const char dir[],
+		const char name[], void *arg);
+static void collect_subdir_change(FSWatchChange change, const char dir[],
+		const char name[], void *arg);
 static int using_inotify(void);
 
 static char sandbox[PATH_MAX + 1];
@@ -155,6 +161,137 @@ TEST(file_recreation_removes_ban, IF(using_inotify))
 	assert_success(remove(SANDBOX_PATH "/testdir"));
 }
 
+TEST(changes_are_reported_in_order, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	char changes[16] = "";
+
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	os_mkdir(SANDBOX_PATH "/testdir", 0700);
+	os_chmod(SANDBOX_PATH "/testdir", 0777);
+	assert_success(remove(SANDBOX_PATH "/testdir"));
+	assert_true(fswatch_poll(watch, &error, &collect_change, changes));
+	assert_false(error);
+	assert_string_equal("+*-", changes);
+
+	fswatch_free(watch);
+}
+
+TEST(changes_in_added_directories_are_reported, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	char subdir[PATH_MAX + 1];
+	char changes[16] = "";
+	FILE *fp;
+
+	snprintf(subdir, sizeof(subdir), "%s/testdir", sandbox);
+	assert_success(os_mkdir(subdir, 0700));
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_success(fswatch_add(watch, subdir));
+	assert_false(fswatch_poll(watch, &error, &collect_subdir_change, changes));
+
+	fp = fopen(SANDBOX_PATH "/testdir/file", "w");
+	assert_non_null(fp);
+	fclose(fp);
+	assert_success(remove(SANDBOX_PATH "/testdir/file"));
+	assert_true(fswatch_poll(watch, &error, &collect_subdir_change, changes));
+	assert_false(error);
+	assert_string_equal("+*-", changes);
+
+	fswatch_free(watch);
+
+	assert_success(remove(subdir));
+}
+
+TEST(watches_of_removed_directories_are_dropped, IF(using_inotify))
+{
+	fswatch_t *watch;
+	int error;
+	char subdir[PATH_MAX + 1];
+
+	snprintf(subdir, sizeof(subdir), "%s/testdir", sandbox);
+	assert_success(os_mkdir(subdir, 0700));
+
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_int_equal(1, fswatch_count(watch));
+	assert_success(fswatch_add(watch, subdir));
+	assert_int_equal(2, fswatch_count(watch));
+
+	assert_success(remove(subdir));
+	assert_true(fswatch_changed(watch, &error));
+	assert_false(error);
+	assert_int_equal(1, fswatch_count(watch));
+
+	fswatch_free(watch);
+}
+
+TEST(no_changes_are_reported_without_events)
+{
+	fswatch_t *watch;
+	int error;
+	char changes[16] = "";
+
+	assert_non_null(watch = fswatch_create(sandbox));
+
+	assert_false(fswatch_poll(watch, &error, &collect_change, changes));
+	assert_false(error);
+	assert_string_equal("", changes);
+
+	fswatch_free(watch);
+}
+
+/* Appends character that corresponds to the change to the buffer in arg. */
+static void
+collect_change(FSWatchChange change, const char dir[], const char name[],
+		void *arg)
+{
+	char *const changes = arg;
+	const size_t len = strlen(changes);
+
+	if(change != FSWC_RESCAN)
+	{
+		assert_string_equal(sandbox, dir);
+		assert_string_equal("testdir", name);
+	}
+
+	switch(change)
+	{
+		case FSWC_ADDED:   changes[len] = '+'; break;
+		case FSWC_REMOVED: changes[len] = '-'; break;
+		case FSWC_UPDATED: changes[len] = '*'; break;
+		case FSWC_RESCAN:  changes[len] = '!'; break;
+	}
+	changes[len + 1] = '\0';
+}
+
+/* Same as collect_change(), but expects changes of a file in a subdirectory. */
+static void
+collect_subdir_change(FSWatchChange change, const char dir[],
+		const char name[], void *arg)
+{
+	char *const changes = arg;
+	const size_t len = strlen(changes);
+
+	if(change != FSWC_RESCAN)
+	{
+		assert_true(ends_with(dir, "/testdir"));
+		assert_string_equal("file", name);
+	}
+
+	switch(change)
+	{
+		case FSWC_ADDED:   changes[len] = '+'; break;
+		case FSWC_REMOVED: changes[len] = '-'; break;
+		case FSWC_UPDATED: changes[len] = '*'; break;
+		case FSWC_RESCAN:  changes[len] = '!'; break;
+	}
+	changes[len + 1] = '\0';
+}
+
 static int
 using_inotify(void)
 {
@@ -0,0 +1,249 @@
+#include <stic.h>
+
+#include <unistd.h> /* rmdir() unlink() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* FILE fclose() fopen() fprintf() fputs() fwrite() */
+#include <stdlib.h> /* free() qsort() */
+#include <string.h> /* memset() strcmp() strstr() */
+
+#include "../../src/compat/os.h"
+#include "../../src/utils/cancellation.h"
+#include "../../src/utils/grep.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/utils/str.h"
+
+#include "utils.h"
+
+static int run_grep(const char pattern[], int invert, int nthreads);
+static int skip_ignored(const char path[], int is_dir, void *arg);
+static void on_match(char line[], void *arg);
+static void on_error(char line[], void *arg);
+static int sort_cmp(const void *a, const void *b);
+
+static char **matches;
+static int nmatches;
+static char **errors;
+static int nerrors;
+static grep_filter_func filter;
+
+SETUP()
+{
+	write_file(SANDBOX_PATH "/a", "foo\nbar\nfoobar");
+	write_file(SANDBOX_PATH "/b", "nothing here\n");
+	assert_success(os_mkdir(SANDBOX_PATH "/sub", 0700));
+	write_file(SANDBOX_PATH "/sub/c", "xfoo\r\n\nFOO\n");
+	assert_success(os_mkdir(SANDBOX_PATH "/ignored", 0700));
+	write_file(SANDBOX_PATH "/ignored/d", "foo\n");
+
+	filter = NULL;
+}
+
+TEARDOWN()
+{
+	assert_success(unlink(SANDBOX_PATH "/ignored/d"));
+	assert_success(rmdir(SANDBOX_PATH "/ignored"));
+	assert_success(unlink(SANDBOX_PATH "/sub/c"));
+	assert_success(rmdir(SANDBOX_PATH "/sub"));
+	assert_success(unlink(SANDBOX_PATH "/b"));
+	assert_success(unlink(SANDBOX_PATH "/a"));
+
+	free_string_array(matches, nmatches);
+	matches = NULL;
+	nmatches = 0;
+	free_string_array(errors, nerrors);
+	errors = NULL;
+	nerrors = 0;
+}
+
+TEST(plain_string_is_found)
+{
+	assert_success(run_grep("foo", 0, 1));
+
+	assert_int_equal(4, nmatches);
+	assert_string_equal("./a:1:foo", matches[0]);
+	assert_string_equal("./a:3:foobar", matches[1]);
+	assert_string_equal("./ignored/d:1:foo", matches[2]);
+	assert_string_equal("./sub/c:1:xfoo\r", matches[3]);
+	assert_int_equal(0, nerrors);
+}
+
+TEST(regular_expression_is_matched)
+{
+	assert_success(run_grep("^(foo|FOO)$", 0, 1));
+
+	assert_int_equal(3, nmatches);
+	assert_string_equal("./a:1:foo", matches[0]);
+	assert_string_equal("./ignored/d:1:foo", matches[1]);
+	assert_string_equal("./sub/c:3:FOO", matches[2]);
+}
+
+TEST(search_can_be_inverted)
+{
+	assert_success(run_grep("o", 1, 1));
+
+	assert_int_equal(3, nmatches);
+	assert_string_equal("./a:2:bar", matches[0]);
+	assert_string_equal("./sub/c:2:", matches[1]);
+	assert_string_equal("./sub/c:3:FOO", matches[2]);
+}
+
+TEST(entries_can_be_filtered)
+{
+	filter = &skip_ignored;
+	assert_success(run_grep("foo", 0, 1));
+
+	assert_int_equal(3, nmatches);
+	assert_string_equal("./a:1:foo", matches[0]);
+	assert_string_equal("./a:3:foobar", matches[1]);
+	assert_string_equal("./sub/c:1:xfoo\r", matches[2]);
+}
+
+TEST(results_do_not_depend_on_number_of_threads)
+{
+	assert_success(run_grep("foo", 0, 4));
+
+	assert_int_equal(4, nmatches);
+	assert_string_equal("./a:1:foo", matches[0]);
+	assert_string_equal("./a:3:foobar", matches[1]);
+	assert_string_equal("./ignored/d:1:foo", matches[2]);
+	assert_string_equal("./sub/c:1:xfoo\r", matches[3]);
+}
+
+TEST(binary_files_are_skipped)
+{
+	FILE *const fp = fopen(SANDBOX_PATH "/bin", "wb");
+	fwrite("foo\n\0\n", 1, 6, fp);
+	fclose(fp);
+
+	assert_success(run_grep("foo", 0, 1));
+	assert_int_equal(4, nmatches);
+
+	assert_success(unlink(SANDBOX_PATH "/bin"));
+}
+
+TEST(lines_are_counted_across_blocks)
+{
+	int i;
+	FILE *const fp = fopen(SANDBOX_PATH "/big", "w");
+	for(i = 1; i <= 100000; ++i)
+	{
+		fprintf(fp, "x%d\n", i);
+	}
+	fclose(fp);
+
+	assert_success(run_grep("x77777", 0, 1));
+	assert_int_equal(1, nmatches);
+	assert_string_equal("./big:77777:x77777", matches[0]);
+
+	free_string_array(matches, nmatches);
+	matches = NULL;
+	nmatches = 0;
+
+	assert_success(run_grep("^x9999[0-9]$", 0, 1));
+	assert_int_equal(10, nmatches);
+	assert_string_equal("./big:99990:x99990", matches[0]);
+	assert_string_equal("./big:99999:x99999", matches[9]);
+
+	assert_success(unlink(SANDBOX_PATH "/big"));
+}
+
+TEST(lines_longer_than_block_are_handled)
+{
+	static char line[600*1024];
+	FILE *const fp = fopen(SANDBOX_PATH "/long", "w");
+
+	memset(line, 'y', sizeof(line) - 1);
+	line[sizeof(line) - 1] = '\0';
+	fputs(line, fp);
+	fputs("\nlong\n", fp);
+	fclose(fp);
+
+	assert_success(run_grep("long", 0, 1));
+	assert_int_equal(1, nmatches);
+	assert_string_equal("./long:2:long", matches[0]);
+
+	assert_success(unlink(SANDBOX_PATH "/long"));
+}
+
+TEST(missing_targets_are_reported)
+{
+	char *targets[] = { "missing" };
+	const grep_params_t params = {
+		.pattern = "foo",
+		.cflags = 0,
+		.nthreads = 1,
+		.dir = SANDBOX_PATH,
+		.on_match = &on_match,
+		.on_error = &on_error,
+		.cancellation = &no_cancellation,
+	};
+
+	assert_success(grep_files(targets, 1, &params));
+	assert_int_equal(0, nmatches);
+	assert_int_equal(1, nerrors);
+	assert_non_null(strstr(errors[0], "missing: "));
+}
+
+TEST(wrong_pattern_is_reported)
+{
+	assert_failure(run_grep("*(", 0, 1));
+	assert_int_equal(0, nmatches);
+	assert_int_equal(1, nerrors);
+}
+
+/* Searches sandbox collecting sorted results.  Returns what grep_files()
+ * returns. */
+static int
+run_grep(const char pattern[], int invert, int nthreads)
+{
+	int result;
+	char *targets[] = { "." };
+	const grep_params_t params = {
+		.pattern = pattern,
+		.cflags = 0,
+		.invert = invert,
+		.nthreads = nthreads,
+		.dir = SANDBOX_PATH,
+		.filter = filter,
+		.on_match = &on_match,
+		.on_error = &on_error,
+		.cancellation = &no_cancellation,
+	};
+
+	result = grep_files(targets, 1, &params);
+	qsort(matches, nmatches, sizeof(*matches), &sort_cmp);
+	return result;
+}
+
+/* Filter that rejects "ignored" directory.  Returns non-zero for other
+ * entries. */
+static int
+skip_ignored(const char path[], int is_dir, void *arg)
+{
+	return !(is_dir && ends_with(path, "/ignored"));
+}
+
+/* Collects matches. */
+static void
+on_match(char line[], void *arg)
+{
+	nmatches = put_into_string_array(&matches, nmatches, line);
+}
+
+/* Collects errors. */
+static void
+on_error(char line[], void *arg)
+{
+	nerrors = put_into_string_array(&errors, nerrors, line);
+}
+
+/* qsort() comparer of strings.  Returns standard -1, 0, 1 for comparisons. */
+static int
+sort_cmp(const void *a, const void *b)
+{
+	return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -350,6 +350,27 @@ TEST(mime_type_pattern, IF(has_mime_type_detection))
 	matcher_free(m);
 }
 
+TEST(mime_matchers_are_recognized)
+{
+	char *error;
+	matcher_t *m;
+
+	assert_non_null(m = matcher_alloc("<text/plain>", 0, 1, "", &error));
+	assert_null(error);
+	assert_true(matcher_is_mime(m));
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("!<text/plain>", 0, 1, "", &error));
+	assert_null(error);
+	assert_true(matcher_is_mime(m));
+	matcher_free(m);
+
+	assert_non_null(m = matcher_alloc("*.txt", 0, 1, "", &error));
+	assert_null(error);
+	assert_false(matcher_is_mime(m));
+	matcher_free(m);
+}
+
 TEST(mime_type_inclusion, IF(has_mime_type_detection))
 {
 	char *error;
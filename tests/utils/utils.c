@@ -1,5 +1,9 @@
 #include "utils.h"
 
+#include <stic.h>
+
+#include <stdio.h> /* FILE fclose() fopen() fputs() */
+
 int
 windows(void)
 {
@@ -16,5 +20,14 @@ not_windows(void)
 	return !windows();
 }
 
+void
+write_file(const char path[], const char contents[])
+{
+	FILE *const fp = fopen(path, "w");
+	assert_non_null(fp);
+	fputs(contents, fp);
+	fclose(fp);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -9,6 +9,9 @@ int windows(void);
  * otherwise zero is returned. */
 int not_windows(void);
 
+/* Creates file at the path with the contents. */
+void write_file(const char path[], const char contents[]);
+
 #endif /* VIFM_TESTS__UTILS__UTILS_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
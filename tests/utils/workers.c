@@ -0,0 +1,138 @@
+#include <stic.h>
+
+#include <stddef.h> /* NULL */
+
+#include "../../src/utils/workers.h"
+
+static void count_task(void *task, void *arg);
+static void spawn_task(void *task, void *arg);
+static void order_task(void *task, void *arg);
+
+static workers_t *pool;
+static int order[8];
+static int norder;
+
+TEST(pool_without_threads_performs_tasks_on_wait)
+{
+	int count = 0;
+	int i;
+
+	pool = workers_create(0, &count_task, &count);
+	assert_non_null(pool);
+	assert_int_equal(0, workers_count(pool));
+
+	for(i = 0; i < 10; ++i)
+	{
+		assert_success(workers_append(pool, NULL));
+	}
+	assert_int_equal(0, count);
+
+	workers_wait(pool);
+	assert_int_equal(10, count);
+
+	workers_free(pool);
+}
+
+TEST(tasks_can_add_more_tasks)
+{
+	int count = 0;
+
+	pool = workers_create(4, &spawn_task, &count);
+	assert_non_null(pool);
+
+	assert_success(workers_push(pool, (void *)(long)10));
+	workers_wait(pool);
+
+	/* 10 + 9 + ... + 1 + 0 */
+	assert_int_equal(55, count);
+
+	workers_free(pool);
+}
+
+TEST(freeing_finishes_tasks)
+{
+	int count = 0;
+	int i;
+
+	pool = workers_create(2, &count_task, &count);
+	assert_non_null(pool);
+
+	for(i = 0; i < 100; ++i)
+	{
+		assert_success(workers_push(pool, NULL));
+	}
+
+	workers_free(pool);
+	assert_int_equal(100, count);
+}
+
+TEST(push_and_append_determine_order)
+{
+	pool = workers_create(0, &order_task, NULL);
+	assert_non_null(pool);
+
+	norder = 0;
+	assert_success(workers_append(pool, (void *)(long)2));
+	assert_success(workers_append(pool, (void *)(long)3));
+	assert_success(workers_push(pool, (void *)(long)1));
+	workers_wait(pool);
+
+	assert_int_equal(3, norder);
+	assert_int_equal(1, order[0]);
+	assert_int_equal(2, order[1]);
+	assert_int_equal(3, order[2]);
+
+	workers_free(pool);
+}
+
+TEST(throttling_performs_tasks_over_the_limit)
+{
+	int count = 0;
+	int i;
+
+	pool = workers_create(0, &count_task, &count);
+	assert_non_null(pool);
+
+	for(i = 0; i < 10; ++i)
+	{
+		assert_success(workers_append(pool, NULL));
+	}
+
+	workers_throttle(pool, 4);
+	assert_int_equal(7, count);
+
+	workers_free(pool);
+	assert_int_equal(10, count);
+}
+
+TEST(freeing_null_is_ok)
+{
+	workers_free(NULL);
+}
+
+static void
+count_task(void *task, void *arg)
+{
+	(void)__sync_fetch_and_add((int *)arg, 1);
+}
+
+static void
+spawn_task(void *task, void *arg)
+{
+	const int n = (long)task;
+
+	(void)__sync_fetch_and_add((int *)arg, n);
+	if(n > 0)
+	{
+		assert_success(workers_push(pool, (void *)(long)(n - 1)));
+	}
+}
+
+static void
+order_task(void *task, void *arg)
+{
+	order[norder++] = (long)task;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */